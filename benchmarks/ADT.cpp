@@ -0,0 +1,113 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static void BM_DenseMapInsert(benchmark::State &State) {
+  unsigned N = State.range(0);
+  for (auto _ : State) {
+    DenseMap<unsigned, unsigned> Map;
+    for (unsigned I = 0; I != N; ++I)
+      Map[I * 37] = I;
+    benchmark::DoNotOptimize(Map.size());
+  }
+  State.SetItemsProcessed(State.iterations() * N);
+}
+BENCHMARK(BM_DenseMapInsert)->Range(16, 1 << 16);
+
+static void BM_DenseMapLookup(benchmark::State &State) {
+  unsigned N = State.range(0);
+  DenseMap<const void *, unsigned> Map;
+  std::vector<char> Objects(N);
+  for (unsigned I = 0; I != N; ++I)
+    Map[&Objects[I]] = I;
+  for (auto _ : State) {
+    // Half of the lookups miss.
+    for (unsigned I = 0; I != N; ++I)
+      benchmark::DoNotOptimize(Map.find(&Objects[I] + (I & 1) * N));
+  }
+  State.SetItemsProcessed(State.iterations() * N);
+}
+BENCHMARK(BM_DenseMapLookup)->Range(16, 1 << 16);
+
+static void BM_SmallVectorPushBack(benchmark::State &State) {
+  unsigned N = State.range(0);
+  for (auto _ : State) {
+    SmallVector<unsigned, 16> Vec;
+    for (unsigned I = 0; I != N; ++I)
+      Vec.push_back(I);
+    benchmark::DoNotOptimize(Vec.data());
+  }
+  State.SetItemsProcessed(State.iterations() * N);
+}
+BENCHMARK(BM_SmallVectorPushBack)->Arg(8)->Arg(16)->Arg(64)->Arg(4096);
+
+static std::vector<std::string> makeKeys(unsigned N) {
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; I != N; ++I)
+    Keys.push_back("llvm.benchmark.key." + std::to_string(I * 7919u));
+  return Keys;
+}
+
+static void BM_StringMapInsert(benchmark::State &State) {
+  std::vector<std::string> Keys = makeKeys(State.range(0));
+  for (auto _ : State) {
+    StringMap<unsigned> Map;
+    for (const std::string &Key : Keys)
+      ++Map[Key];
+    benchmark::DoNotOptimize(Map.size());
+  }
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+BENCHMARK(BM_StringMapInsert)->Range(16, 1 << 16);
+
+static void BM_StringMapLookup(benchmark::State &State) {
+  std::vector<std::string> Keys = makeKeys(State.range(0));
+  StringMap<unsigned> Map;
+  for (const std::string &Key : Keys)
+    Map[Key] = 0;
+  for (auto _ : State)
+    for (const std::string &Key : Keys)
+      benchmark::DoNotOptimize(Map.find(Key));
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+BENCHMARK(BM_StringMapLookup)->Range(16, 1 << 16);
+
+static APInt makeAPInt(unsigned BitWidth, uint64_t Seed) {
+  APInt Val(BitWidth, 0);
+  for (unsigned I = 0; I < BitWidth; I += 64)
+    Val.insertBits(APInt(std::min(64u, BitWidth - I), Seed * (I + 1) | 1), I);
+  return Val;
+}
+
+static void BM_APIntMul(benchmark::State &State) {
+  unsigned BitWidth = State.range(0);
+  APInt A = makeAPInt(BitWidth, 0x9E3779B97F4A7C15ULL);
+  APInt B = makeAPInt(BitWidth, 0xC2B2AE3D27D4EB4FULL);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(A * B);
+}
+BENCHMARK(BM_APIntMul)->Arg(64)->Arg(128)->Arg(1024);
+
+static void BM_APIntUDiv(benchmark::State &State) {
+  unsigned BitWidth = State.range(0);
+  APInt A = makeAPInt(BitWidth, 0x9E3779B97F4A7C15ULL);
+  APInt B = makeAPInt(BitWidth / 2, 0xC2B2AE3D27D4EB4FULL).zext(BitWidth);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(A.udiv(B));
+}
+BENCHMARK(BM_APIntUDiv)->Arg(128)->Arg(1024);
+
+static void BM_APIntToString(benchmark::State &State) {
+  APInt A = makeAPInt(State.range(0), 0x9E3779B97F4A7C15ULL);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(A.toString(10, /*Signed=*/false));
+}
+BENCHMARK(BM_APIntToString)->Arg(64)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+#include "SyntheticIR.h"
+#include "benchmark/benchmark.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+using namespace llvm::benchmarks;
+
+// Compile for the host when its target is built, and for the first target
+// that is otherwise.
+static std::unique_ptr<TargetMachine> createTargetMachine(CodeGenOpt::Level OL) {
+  std::string TripleName = sys::getDefaultTargetTriple();
+  std::string Error;
+  const Target *T = TargetRegistry::lookupTarget(TripleName, Error);
+  if (!T) {
+    for (const Target &Candidate : TargetRegistry::targets()) {
+      if (!Candidate.hasTargetMachine())
+        continue;
+      T = &Candidate;
+      TripleName = Triple::normalize(Candidate.getName());
+      break;
+    }
+  }
+  if (!T)
+    return nullptr;
+  std::unique_ptr<TargetMachine> TM(T->createTargetMachine(
+      TripleName, "", "", TargetOptions(), None, None, OL));
+  if (TM && OL == CodeGenOpt::None) {
+    // Measure SelectionDAG instruction selection, not FastISel.
+    TM->setO0WantsFastISel(false);
+    TM->setFastISel(false);
+  }
+  return TM;
+}
+
+static void runCodeGen(benchmark::State &State, CodeGenOpt::Level OL,
+                       TargetMachine::CodeGenFileType FileType) {
+  std::unique_ptr<TargetMachine> TM = createTargetMachine(OL);
+  if (!TM) {
+    State.SkipWithError("no target available");
+    return;
+  }
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      parseSyntheticIR(makeSyntheticIR(State.range(0)), Context);
+  M->setTargetTriple(TM->getTargetTriple().str());
+  M->setDataLayout(TM->createDataLayout());
+
+  for (auto _ : State) {
+    State.PauseTiming();
+    std::unique_ptr<Module> Clone = CloneModule(*M);
+    legacy::PassManager PM;
+    SmallString<0> Buffer;
+    raw_svector_ostream OS(Buffer);
+    if (TM->addPassesToEmitFile(PM, OS, nullptr, FileType)) {
+      State.SkipWithError("target does not support this file type");
+      break;
+    }
+    State.ResumeTiming();
+
+    PM.run(*Clone);
+  }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+
+// At -O0 without FastISel, the pipeline is dominated by SelectionDAG
+// instruction selection.
+static void BM_SelectionDAGISel(benchmark::State &State) {
+  runCodeGen(State, CodeGenOpt::None, TargetMachine::CGFT_Null);
+}
+BENCHMARK(BM_SelectionDAGISel)->Arg(10)->Arg(200);
+
+static void BM_CodeGenAssembly(benchmark::State &State) {
+  runCodeGen(State, CodeGenOpt::Default, TargetMachine::CGFT_AssemblyFile);
+}
+BENCHMARK(BM_CodeGenAssembly)->Arg(10)->Arg(200);
+
+// Compared with BM_CodeGenAssembly, this measures MC object emission.
+static void BM_CodeGenObject(benchmark::State &State) {
+  runCodeGen(State, CodeGenOpt::Default, TargetMachine::CGFT_ObjectFile);
+}
+BENCHMARK(BM_CodeGenObject)->Arg(10)->Arg(200);
+
+int main(int argc, char **argv) {
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+}
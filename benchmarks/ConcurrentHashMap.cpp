@@ -0,0 +1,85 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/ConcurrentHashMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+// Every thread interns the same symbol names, starting at a different
+// offset, as the threads of a linker do for the symbols referenced from
+// several object files.
+static const std::vector<std::string> &getSymbolNames() {
+  static std::vector<std::string> Names = [] {
+    std::vector<std::string> Names;
+    for (unsigned I = 0; I < 1 << 16; ++I)
+      Names.push_back("_ZN4llvm6detail" + std::to_string(I * 7919u) + "E");
+    return Names;
+  }();
+  return Names;
+}
+
+// The baseline: a StringMap behind a global lock.
+static std::mutex BaselineMutex;
+static std::unique_ptr<StringMap<unsigned, BumpPtrAllocator>> BaselineMap;
+
+static void BM_InternMutexStringMap(benchmark::State &State) {
+  const std::vector<std::string> &Names = getSymbolNames();
+  size_t Offset = State.thread_index * Names.size() / State.threads;
+  if (State.thread_index == 0)
+    BaselineMap.reset(new StringMap<unsigned, BumpPtrAllocator>());
+  for (auto _ : State) {
+    for (size_t I = 0, E = Names.size(); I != E; ++I) {
+      std::lock_guard<std::mutex> Lock(BaselineMutex);
+      ++(*BaselineMap)[Names[(I + Offset) % E]];
+    }
+  }
+  State.SetItemsProcessed(State.iterations() * Names.size());
+  if (State.thread_index == 0)
+    BaselineMap.reset();
+}
+BENCHMARK(BM_InternMutexStringMap)->ThreadRange(1, 16)->UseRealTime();
+
+static std::unique_ptr<ConcurrentStringMap<std::atomic<unsigned>>>
+    ConcurrentMap;
+
+static void BM_InternConcurrentStringMap(benchmark::State &State) {
+  const std::vector<std::string> &Names = getSymbolNames();
+  size_t Offset = State.thread_index * Names.size() / State.threads;
+  if (State.thread_index == 0)
+    ConcurrentMap.reset(new ConcurrentStringMap<std::atomic<unsigned>>());
+  for (auto _ : State) {
+    for (size_t I = 0, E = Names.size(); I != E; ++I)
+      ++ConcurrentMap->try_emplace(Names[(I + Offset) % E], 0)
+            .first->getValue();
+  }
+  State.SetItemsProcessed(State.iterations() * Names.size());
+  if (State.thread_index == 0)
+    ConcurrentMap.reset();
+}
+BENCHMARK(BM_InternConcurrentStringMap)->ThreadRange(1, 16)->UseRealTime();
+
+// Interning pointers, as done for the uniqued metadata and types of a module.
+static std::unique_ptr<ConcurrentDenseMap<const void *, unsigned>>
+    ConcurrentPtrMap;
+
+static void BM_InternConcurrentDenseMap(benchmark::State &State) {
+  const std::vector<std::string> &Names = getSymbolNames();
+  size_t Offset = State.thread_index * Names.size() / State.threads;
+  if (State.thread_index == 0)
+    ConcurrentPtrMap.reset(new ConcurrentDenseMap<const void *, unsigned>());
+  for (auto _ : State) {
+    for (size_t I = 0, E = Names.size(); I != E; ++I)
+      ConcurrentPtrMap->try_emplace(Names[(I + Offset) % E].data(), I);
+  }
+  State.SetItemsProcessed(State.iterations() * Names.size());
+  if (State.thread_index == 0)
+    ConcurrentPtrMap.reset();
+}
+BENCHMARK(BM_InternConcurrentDenseMap)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include "benchmark/benchmark.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Error.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::object;
+
+// The object file to read the debug info from.  Point
+// LLVM_BENCHMARK_DWARF_INPUT at a larger binary to get more representative
+// numbers.
+static OwningBinary<ObjectFile> loadObject(benchmark::State &State) {
+  const char *Path = getenv("LLVM_BENCHMARK_DWARF_INPUT");
+  if (!Path)
+    Path = LLVM_BENCHMARK_DEFAULT_DWARF_INPUT;
+  Expected<OwningBinary<ObjectFile>> Obj = ObjectFile::createObjectFile(Path);
+  if (!Obj) {
+    State.SkipWithError(toString(Obj.takeError()).c_str());
+    return OwningBinary<ObjectFile>();
+  }
+  return std::move(*Obj);
+}
+
+// Extract every DIE and line table, as llvm-dwarfdump and the linkers'
+// debug info handling do.
+static void BM_DWARFParse(benchmark::State &State) {
+  OwningBinary<ObjectFile> Binary = loadObject(State);
+  ObjectFile *Obj = Binary.getBinary();
+  if (!Obj)
+    return;
+  for (auto _ : State) {
+    std::unique_ptr<DWARFContext> DICtx = DWARFContext::create(*Obj);
+    unsigned NumDIEs = 0;
+    for (const auto &U : DICtx->compile_units()) {
+      NumDIEs += U->getNumDIEs();
+      benchmark::DoNotOptimize(DICtx->getLineTableForUnit(U.get()));
+    }
+    benchmark::DoNotOptimize(NumDIEs);
+  }
+  State.SetBytesProcessed(State.iterations() * Obj->getData().size());
+}
+BENCHMARK(BM_DWARFParse);
+
+// Symbolize every address that has a row in the line tables.
+static void BM_DWARFLineLookup(benchmark::State &State) {
+  OwningBinary<ObjectFile> Binary = loadObject(State);
+  ObjectFile *Obj = Binary.getBinary();
+  if (!Obj)
+    return;
+  std::unique_ptr<DWARFContext> DICtx = DWARFContext::create(*Obj);
+  std::vector<object::SectionedAddress> Addresses;
+  for (const auto &U : DICtx->compile_units())
+    if (const auto *LT = DICtx->getLineTableForUnit(U.get()))
+      for (const auto &Row : LT->Rows)
+        Addresses.push_back(Row.Address);
+  if (Addresses.empty()) {
+    State.SkipWithError("no line table rows");
+    return;
+  }
+  for (auto _ : State)
+    for (object::SectionedAddress Address : Addresses)
+      benchmark::DoNotOptimize(DICtx->getLineInfoForAddress(Address));
+  State.SetItemsProcessed(State.iterations() * Addresses.size());
+}
+BENCHMARK(BM_DWARFLineLookup);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,74 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CRC.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/xxhash.h"
+#include <string>
+
+using namespace llvm;
+
+static std::string makeInput(size_t Size) {
+  std::string Input;
+  for (size_t I = 0; I != Size; ++I)
+    Input += char('a' + (I * 7 + I / 13) % 26);
+  return Input;
+}
+
+static void BM_xxHash64(benchmark::State &State) {
+  std::string Input = makeInput(State.range(0));
+  for (auto _ : State)
+    benchmark::DoNotOptimize(xxHash64(Input));
+  State.SetBytesProcessed(State.iterations() * Input.size());
+}
+BENCHMARK(BM_xxHash64)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_xxh3_64bits(benchmark::State &State) {
+  std::string Input = makeInput(State.range(0));
+  for (auto _ : State)
+    benchmark::DoNotOptimize(xxh3_64bits(Input));
+  State.SetBytesProcessed(State.iterations() * Input.size());
+}
+BENCHMARK(BM_xxh3_64bits)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_djbHash(benchmark::State &State) {
+  std::string Input = makeInput(State.range(0));
+  for (auto _ : State)
+    benchmark::DoNotOptimize(djbHash(Input));
+  State.SetBytesProcessed(State.iterations() * Input.size());
+}
+BENCHMARK(BM_djbHash)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_crc32(benchmark::State &State) {
+  std::string Input = makeInput(State.range(0));
+  for (auto _ : State)
+    benchmark::DoNotOptimize(crc32(0, Input));
+  State.SetBytesProcessed(State.iterations() * Input.size());
+}
+BENCHMARK(BM_crc32)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_crc32c(benchmark::State &State) {
+  std::string Input = makeInput(State.range(0));
+  for (auto _ : State)
+    benchmark::DoNotOptimize(crc32c(0, Input));
+  State.SetBytesProcessed(State.iterations() * Input.size());
+}
+BENCHMARK(BM_crc32c)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+// Search for a needle which only occurs at the very end, so that the whole
+// haystack is scanned.
+static void BM_StringRefFind(benchmark::State &State) {
+  std::string Haystack = makeInput(State.range(0));
+  std::string Needle = "#include <" + std::to_string(State.range(1)) + ">";
+  Haystack += Needle;
+  StringRef Ref(Haystack);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(Ref.find(Needle));
+  State.SetBytesProcessed(State.iterations() * Haystack.size());
+}
+BENCHMARK(BM_StringRefFind)
+    ->Args({64, 1})
+    ->Args({4096, 1})
+    ->Args({1 << 20, 1})
+    ->Args({4096, 1 << 30});
+
+BENCHMARK_MAIN();
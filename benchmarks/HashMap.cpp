@@ -0,0 +1,120 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SwissMap.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+// Compare SwissMap with DenseMap on the kind of keys LLVM's hottest tables
+// use: pointers to objects scattered over the heap.  The keys are shuffled so
+// that the lookups have no locality beyond what the table itself provides.
+
+namespace {
+struct Object {
+  char Payload[24];
+};
+} // end anonymous namespace
+
+static std::vector<const Object *>
+makeKeys(unsigned N, std::vector<std::unique_ptr<Object>> &Storage) {
+  std::vector<const Object *> Keys;
+  for (unsigned I = 0; I != N; ++I) {
+    Storage.emplace_back(new Object());
+    Keys.push_back(Storage.back().get());
+  }
+  std::shuffle(Keys.begin(), Keys.end(), std::mt19937(42));
+  return Keys;
+}
+
+template <typename MapT> static void BM_Insert(benchmark::State &State) {
+  std::vector<std::unique_ptr<Object>> Storage;
+  std::vector<const Object *> Keys = makeKeys(State.range(0), Storage);
+  for (auto _ : State) {
+    MapT Map;
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Map[Keys[I]] = I;
+    benchmark::DoNotOptimize(Map.size());
+  }
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+
+template <typename MapT> static void BM_LookupHit(benchmark::State &State) {
+  std::vector<std::unique_ptr<Object>> Storage;
+  std::vector<const Object *> Keys = makeKeys(State.range(0), Storage);
+  MapT Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+  std::shuffle(Keys.begin(), Keys.end(), std::mt19937(7));
+  for (auto _ : State)
+    for (const Object *Key : Keys)
+      benchmark::DoNotOptimize(Map.find(Key));
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+
+template <typename MapT> static void BM_LookupMiss(benchmark::State &State) {
+  std::vector<std::unique_ptr<Object>> Storage;
+  std::vector<const Object *> Keys = makeKeys(State.range(0), Storage);
+  std::vector<std::unique_ptr<Object>> MissStorage;
+  std::vector<const Object *> Misses = makeKeys(State.range(0), MissStorage);
+  MapT Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+  for (auto _ : State)
+    for (const Object *Key : Misses)
+      benchmark::DoNotOptimize(Map.find(Key));
+  State.SetItemsProcessed(State.iterations() * Misses.size());
+}
+
+// Erase and reinsert every key, which leaves tombstones or deleted slots
+// behind.
+template <typename MapT> static void BM_EraseInsert(benchmark::State &State) {
+  std::vector<std::unique_ptr<Object>> Storage;
+  std::vector<const Object *> Keys = makeKeys(State.range(0), Storage);
+  MapT Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+  for (auto _ : State)
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I) {
+      Map.erase(Keys[I]);
+      Map[Keys[I]] = I;
+    }
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+
+template <typename MapT> static void BM_Iterate(benchmark::State &State) {
+  std::vector<std::unique_ptr<Object>> Storage;
+  std::vector<const Object *> Keys = makeKeys(State.range(0), Storage);
+  MapT Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+  for (auto _ : State) {
+    unsigned Sum = 0;
+    for (const auto &KV : Map)
+      Sum += KV.second;
+    benchmark::DoNotOptimize(Sum);
+  }
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+
+using DenseMapT = DenseMap<const Object *, unsigned>;
+using SwissMapT = SwissMap<const Object *, unsigned>;
+
+// From 10 to 10M entries.
+static void applySizes(benchmark::internal::Benchmark *B) {
+  B->RangeMultiplier(10)->Range(10, 10000000);
+}
+
+#define HASHMAP_BENCHMARK(Name)                                                \
+  BENCHMARK_TEMPLATE(Name, DenseMapT)->Apply(applySizes);                      \
+  BENCHMARK_TEMPLATE(Name, SwissMapT)->Apply(applySizes)
+
+HASHMAP_BENCHMARK(BM_Insert);
+HASHMAP_BENCHMARK(BM_LookupHit);
+HASHMAP_BENCHMARK(BM_LookupMiss);
+HASHMAP_BENCHMARK(BM_EraseInsert);
+HASHMAP_BENCHMARK(BM_Iterate);
+
+BENCHMARK_MAIN();
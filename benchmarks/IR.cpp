@@ -0,0 +1,110 @@
+#include "SyntheticIR.h"
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace llvm;
+using namespace llvm::benchmarks;
+
+static void BM_ParseAssembly(benchmark::State &State) {
+  std::string IR = makeSyntheticIR(State.range(0));
+  for (auto _ : State) {
+    LLVMContext Context;
+    benchmark::DoNotOptimize(parseSyntheticIR(IR, Context));
+  }
+  State.SetBytesProcessed(State.iterations() * IR.size());
+}
+BENCHMARK(BM_ParseAssembly)->Arg(10)->Arg(1000);
+
+static void BM_Verifier(benchmark::State &State) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      parseSyntheticIR(makeSyntheticIR(State.range(0)), Context);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(verifyModule(*M));
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(BM_Verifier)->Arg(10)->Arg(1000);
+
+static void BM_DominatorTree(benchmark::State &State) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      parseSyntheticIR(makeSyntheticIR(State.range(0)), Context);
+  for (auto _ : State)
+    for (Function &F : *M) {
+      DominatorTree DT(F);
+      benchmark::DoNotOptimize(DT.getRoot());
+    }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(BM_DominatorTree)->Arg(10)->Arg(1000);
+
+static void BM_BitcodeWriter(benchmark::State &State) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      parseSyntheticIR(makeSyntheticIR(State.range(0)), Context);
+  size_t Size = 0;
+  for (auto _ : State) {
+    SmallVector<char, 0> Buffer;
+    BitcodeWriter Writer(Buffer);
+    Writer.writeModule(*M);
+    Writer.writeSymtab();
+    Writer.writeStrtab();
+    Size = Buffer.size();
+  }
+  State.SetBytesProcessed(State.iterations() * Size);
+}
+BENCHMARK(BM_BitcodeWriter)->Arg(10)->Arg(1000);
+
+static SmallVector<char, 0> makeBitcode(unsigned NumFunctions) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      parseSyntheticIR(makeSyntheticIR(NumFunctions), Context);
+  SmallVector<char, 0> Buffer;
+  BitcodeWriter Writer(Buffer);
+  Writer.writeModule(*M);
+  Writer.writeSymtab();
+  Writer.writeStrtab();
+  return Buffer;
+}
+
+// Read the whole module, function bodies included.
+static void BM_BitcodeReader(benchmark::State &State) {
+  SmallVector<char, 0> Bitcode = makeBitcode(State.range(0));
+  MemoryBufferRef Buffer(StringRef(Bitcode.data(), Bitcode.size()), "bench");
+  for (auto _ : State) {
+    LLVMContext Context;
+    Expected<std::unique_ptr<Module>> M = parseBitcodeFile(Buffer, Context);
+    if (!M) {
+      State.SkipWithError(toString(M.takeError()).c_str());
+      break;
+    }
+  }
+  State.SetBytesProcessed(State.iterations() * Bitcode.size());
+}
+BENCHMARK(BM_BitcodeReader)->Arg(10)->Arg(1000);
+
+// Read only the module-level records, as the LTO linker does first.
+static void BM_BitcodeReaderLazy(benchmark::State &State) {
+  SmallVector<char, 0> Bitcode = makeBitcode(State.range(0));
+  MemoryBufferRef Buffer(StringRef(Bitcode.data(), Bitcode.size()), "bench");
+  for (auto _ : State) {
+    LLVMContext Context;
+    Expected<std::unique_ptr<Module>> M =
+        getLazyBitcodeModule(Buffer, Context);
+    if (!M) {
+      State.SkipWithError(toString(M.takeError()).c_str());
+      break;
+    }
+  }
+  State.SetBytesProcessed(State.iterations() * Bitcode.size());
+}
+BENCHMARK(BM_BitcodeReaderLazy)->Arg(10)->Arg(1000);
+
+BENCHMARK_MAIN();
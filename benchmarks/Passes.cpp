@@ -0,0 +1,78 @@
+#include "SyntheticIR.h"
+#include "benchmark/benchmark.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Scalar/SROA.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+using namespace llvm::benchmarks;
+
+// Run PassT over every function of a fresh copy of M.  Only the pass itself
+// is timed, the analyses it requires included.
+template <typename PassT>
+static void runFunctionPass(benchmark::State &State, const Module &M) {
+  for (auto _ : State) {
+    State.PauseTiming();
+    std::unique_ptr<Module> Clone = CloneModule(M);
+    PassBuilder PB;
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    ModulePassManager MPM;
+    MPM.addPass(createModuleToFunctionPassAdaptor(PassT()));
+    State.ResumeTiming();
+
+    MPM.run(*Clone, MAM);
+  }
+  State.SetItemsProcessed(State.iterations() * M.size());
+}
+
+// The frontend-style IR, with locals in allocas.
+static std::unique_ptr<Module> getUnoptimizedModule(unsigned NumFunctions,
+                                                    LLVMContext &Context) {
+  return parseSyntheticIR(makeSyntheticIR(NumFunctions), Context);
+}
+
+// The IR after SROA, which is what InstCombine and GVN usually see.
+static std::unique_ptr<Module> getPromotedModule(unsigned NumFunctions,
+                                                 LLVMContext &Context) {
+  std::unique_ptr<Module> M = getUnoptimizedModule(NumFunctions, Context);
+  PassBuilder PB;
+  FunctionAnalysisManager FAM;
+  PB.registerFunctionAnalyses(FAM);
+  SROA Pass;
+  for (Function &F : *M)
+    Pass.run(F, FAM);
+  return M;
+}
+
+static void BM_SROA(benchmark::State &State) {
+  LLVMContext Context;
+  runFunctionPass<SROA>(State, *getUnoptimizedModule(State.range(0), Context));
+}
+BENCHMARK(BM_SROA)->Arg(10)->Arg(500);
+
+static void BM_InstCombine(benchmark::State &State) {
+  LLVMContext Context;
+  runFunctionPass<InstCombinePass>(
+      State, *getPromotedModule(State.range(0), Context));
+}
+BENCHMARK(BM_InstCombine)->Arg(10)->Arg(500);
+
+static void BM_GVN(benchmark::State &State) {
+  LLVMContext Context;
+  runFunctionPass<GVN>(State, *getPromotedModule(State.range(0), Context));
+}
+BENCHMARK(BM_GVN)->Arg(10)->Arg(500);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+//===- SyntheticIR.h - Generated IR for the benchmarks ----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Generate a target-independent module that looks like unoptimized frontend
+// output: locals live in allocas, loops carry redundant loads and
+// simplifiable arithmetic, and functions call each other.  It gives SROA,
+// InstCombine and GVN something to do, and exercises the parser, the bitcode
+// reader and writer and the code generator with a mix of control flow.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_BENCHMARKS_SYNTHETICIR_H
+#define LLVM_BENCHMARKS_SYNTHETICIR_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+namespace benchmarks {
+
+inline std::string makeSyntheticIR(unsigned NumFunctions) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "target datalayout = \"e-m:e-i64:64-n32:64-S128\"\n\n";
+  for (unsigned F = 0; F != NumFunctions; ++F) {
+    OS << "define i64 @f" << F << "(i64* %p, i64 %n, i64 %x) {\n"
+       << "entry:\n"
+       << "  %acc = alloca i64\n"
+       << "  %i = alloca i64\n"
+       << "  store i64 0, i64* %acc\n"
+       << "  store i64 0, i64* %i\n"
+       << "  br label %cond\n"
+       << "cond:\n"
+       << "  %iv = load i64, i64* %i\n"
+       << "  %c = icmp slt i64 %iv, %n\n"
+       << "  br i1 %c, label %body, label %exit\n"
+       << "body:\n"
+       << "  %gep = getelementptr inbounds i64, i64* %p, i64 %iv\n"
+       << "  %v = load i64, i64* %gep\n"
+       << "  %gep2 = getelementptr inbounds i64, i64* %p, i64 %iv\n"
+       << "  %v2 = load i64, i64* %gep2\n"
+       << "  %m = mul i64 %v, 8\n"
+       << "  %a = add i64 %m, 0\n"
+       << "  %s = add i64 %a, %v2\n"
+       << "  %odd = and i64 %v, 1\n"
+       << "  %isodd = icmp ne i64 %odd, 0\n"
+       << "  br i1 %isodd, label %then, label %else\n"
+       << "then:\n"
+       << "  %t = xor i64 %s, " << F * 31 + 7 << "\n"
+       << "  br label %latch\n"
+       << "else:\n"
+       << "  %e = sub i64 %s, %x\n"
+       << "  store i64 %e, i64* %gep\n"
+       << "  br label %latch\n"
+       << "latch:\n"
+       << "  %phi = phi i64 [ %t, %then ], [ %e, %else ]\n"
+       << "  %a0 = load i64, i64* %acc\n"
+       << "  %a1 = add i64 %a0, %phi\n"
+       << "  store i64 %a1, i64* %acc\n"
+       << "  %inext = add nsw i64 %iv, 1\n"
+       << "  store i64 %inext, i64* %i\n"
+       << "  br label %cond\n"
+       << "exit:\n"
+       << "  %r = load i64, i64* %acc\n";
+    if (F == 0) {
+      OS << "  ret i64 %r\n";
+    } else {
+      OS << "  %call = call i64 @f" << F - 1 << "(i64* %p, i64 %n, i64 %r)\n"
+         << "  %ret = add i64 %call, %r\n"
+         << "  ret i64 %ret\n";
+    }
+    OS << "}\n\n";
+  }
+  return OS.str();
+}
+
+inline std::unique_ptr<Module> parseSyntheticIR(StringRef IR,
+                                                LLVMContext &Context) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Context);
+  if (!M)
+    report_fatal_error("failed to parse the synthetic IR: " +
+                       Err.getMessage());
+  return M;
+}
+
+} // end namespace benchmarks
+} // end namespace llvm
+
+#endif // LLVM_BENCHMARKS_SYNTHETICIR_H
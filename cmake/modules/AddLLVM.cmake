@@ -1175,6 +1175,7 @@ function(add_benchmark benchmark_name)
   set_output_directory(${benchmark_name} BINARY_DIR ${outdir} LIBRARY_DIR ${outdir})
   set_property(TARGET ${benchmark_name} PROPERTY FOLDER "Utils")
   target_link_libraries(${benchmark_name} PRIVATE benchmark)
+  set_property(GLOBAL APPEND PROPERTY LLVM_BENCHMARKS ${benchmark_name})
 endfunction()
 
 function(llvm_add_go_executable binary pkgpath)
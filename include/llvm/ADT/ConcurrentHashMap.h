@@ -0,0 +1,280 @@
+//===- ConcurrentHashMap.h - Sharded thread-safe hash maps ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines ConcurrentStringMap and ConcurrentDenseMap, hash maps
+/// that may be read and inserted into by several threads at once.
+///
+/// Both split their keys over a fixed number of shards, each of which is a
+/// regular StringMap or DenseMap guarded by a lock of its own, so that
+/// threads inserting different keys rarely contend.  Entries are allocated
+/// from a ConcurrentBumpPtrAllocator shared by all shards and never move, so
+/// the references returned by insertion stay valid until the map is cleared
+/// or destroyed.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_CONCURRENTHASHMAP_H
+#define LLVM_ADT_CONCURRENTHASHMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ConcurrentBumpPtrAllocator.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+namespace llvm {
+
+namespace detail {
+
+/// Pick the shard of a key from the top bits of its mixed hash, which are
+/// independent of the low bits the shard's own table indexes with.
+template <unsigned NumShards> unsigned getShardIndex(unsigned Hash) {
+  static_assert(isPowerOf2_32(NumShards), "NumShards must be a power of 2");
+  if (NumShards == 1)
+    return 0;
+  return (uint32_t(Hash) * 0x9E3779B1u) >> (32 - Log2_32(NumShards));
+}
+
+/// A map guarded by a lock, padded so that the locks of neighbouring shards
+/// do not share a cache line.
+template <typename MapTy> struct LockedShard {
+  template <typename... ArgsTy>
+  explicit LockedShard(ArgsTy &&... Args)
+      : Map(std::forward<ArgsTy>(Args)...) {}
+
+  std::mutex Mutex;
+  MapTy Map;
+  char Padding[64];
+};
+
+} // end namespace detail
+
+/// A thread-safe map from strings to values.
+///
+/// try_emplace() either inserts a new entry or returns the existing one, and
+/// never invalidates the entries returned before.  The entries themselves are
+/// not protected by the map: threads modifying the value of a shared entry
+/// need to synchronize on their own.
+template <typename ValueTy, unsigned NumShards = 64>
+class ConcurrentStringMap {
+public:
+  using MapEntryTy = StringMapEntry<ValueTy>;
+
+  ConcurrentStringMap() {
+    for (unsigned I = 0; I != NumShards; ++I)
+      Shards[I].reset(new ShardTy(Allocator));
+  }
+  ConcurrentStringMap(const ConcurrentStringMap &) = delete;
+  ConcurrentStringMap &operator=(const ConcurrentStringMap &) = delete;
+
+  /// Insert a new entry constructed from \p Args unless \p Key is already in
+  /// the map.  Return the entry for \p Key and whether it was inserted.
+  template <typename... ArgsTy>
+  std::pair<MapEntryTy *, bool> try_emplace(StringRef Key, ArgsTy &&... Args) {
+    ShardTy &S = getShard(Key);
+    std::lock_guard<std::mutex> Lock(S.Mutex);
+    auto Result = S.Map.try_emplace(Key, std::forward<ArgsTy>(Args)...);
+    return {&*Result.first, Result.second};
+  }
+
+  std::pair<MapEntryTy *, bool> insert(std::pair<StringRef, ValueTy> KV) {
+    return try_emplace(KV.first, std::move(KV.second));
+  }
+
+  /// Return the entry for \p Key, or null if there is none.
+  MapEntryTy *find(StringRef Key) const {
+    ShardTy &S = getShard(Key);
+    std::lock_guard<std::mutex> Lock(S.Mutex);
+    auto I = S.Map.find(Key);
+    return I == S.Map.end() ? nullptr : &*I;
+  }
+
+  /// Return the value for \p Key, or a default-constructed value if there is
+  /// none.
+  ValueTy lookup(StringRef Key) const {
+    MapEntryTy *Entry = find(Key);
+    return Entry ? Entry->getValue() : ValueTy();
+  }
+
+  size_t count(StringRef Key) const { return find(Key) ? 1 : 0; }
+
+  size_t size() const {
+    size_t Size = 0;
+    for (auto &S : Shards) {
+      std::lock_guard<std::mutex> Lock(S->Mutex);
+      Size += S->Map.size();
+    }
+    return Size;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /// Call \p Fn on every entry, one shard at a time.  Entries inserted
+  /// concurrently may or may not be visited.
+  template <typename FuncTy> void forEach(FuncTy Fn) const {
+    for (auto &S : Shards) {
+      std::lock_guard<std::mutex> Lock(S->Mutex);
+      for (auto &Entry : S->Map)
+        Fn(Entry);
+    }
+  }
+
+  /// Like forEach(), but visit the shards in parallel.  \p Fn must be safe
+  /// to call from several threads at once.
+  template <typename FuncTy> void parallelForEach(FuncTy Fn) const {
+    parallel::for_each_n(parallel::par, 0u, NumShards, [&](unsigned I) {
+      ShardTy &S = *Shards[I];
+      std::lock_guard<std::mutex> Lock(S.Mutex);
+      for (auto &Entry : S.Map)
+        Fn(Entry);
+    });
+  }
+
+  /// Remove all entries.  Must not run concurrently with any other method.
+  void clear() {
+    for (auto &S : Shards)
+      S->Map.clear();
+    Allocator.Reset();
+  }
+
+  const ConcurrentBumpPtrAllocator &getAllocator() const { return Allocator; }
+
+private:
+  using ShardTy =
+      detail::LockedShard<StringMap<ValueTy, ConcurrentBumpPtrAllocator &>>;
+
+  ShardTy &getShard(StringRef Key) const {
+    return *Shards[detail::getShardIndex<NumShards>(djbHash(Key, 0))];
+  }
+
+  // Declared first so that it outlives the entries.
+  ConcurrentBumpPtrAllocator Allocator;
+  std::unique_ptr<ShardTy> Shards[NumShards];
+};
+
+/// A thread-safe DenseMap.
+///
+/// Unlike DenseMap, the key/value pairs are stored outside of the table, so
+/// that try_emplace() can return a reference that stays valid while other
+/// threads insert.  The same caveats as for ConcurrentStringMap apply to
+/// modifying the values.
+template <typename KeyT, typename ValueT, unsigned NumShards = 64,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+class ConcurrentDenseMap {
+public:
+  using value_type = std::pair<const KeyT, ValueT>;
+
+  ConcurrentDenseMap() {
+    for (unsigned I = 0; I != NumShards; ++I)
+      Shards[I].reset(new ShardTy());
+  }
+  ConcurrentDenseMap(const ConcurrentDenseMap &) = delete;
+  ConcurrentDenseMap &operator=(const ConcurrentDenseMap &) = delete;
+
+  /// Insert a new entry constructed from \p Args unless \p Key is already in
+  /// the map.  Return the entry for \p Key and whether it was inserted.
+  template <typename... ArgsTy>
+  std::pair<value_type *, bool> try_emplace(const KeyT &Key,
+                                            ArgsTy &&... Args) {
+    ShardTy &S = getShard(Key);
+    std::lock_guard<std::mutex> Lock(S.Mutex);
+    auto Result = S.Map.try_emplace(Key, nullptr);
+    if (!Result.second)
+      return {Result.first->second, false};
+    value_type *Entry = new (Entries.Allocate())
+        value_type(std::piecewise_construct, std::forward_as_tuple(Key),
+                   std::forward_as_tuple(std::forward<ArgsTy>(Args)...));
+    Result.first->second = Entry;
+    return {Entry, true};
+  }
+
+  std::pair<value_type *, bool> insert(std::pair<KeyT, ValueT> KV) {
+    return try_emplace(KV.first, std::move(KV.second));
+  }
+
+  /// Return the entry for \p Key, or null if there is none.
+  value_type *find(const KeyT &Key) const {
+    ShardTy &S = getShard(Key);
+    std::lock_guard<std::mutex> Lock(S.Mutex);
+    return S.Map.lookup(Key);
+  }
+
+  /// Return the value for \p Key, or a default-constructed value if there is
+  /// none.
+  ValueT lookup(const KeyT &Key) const {
+    value_type *Entry = find(Key);
+    return Entry ? Entry->second : ValueT();
+  }
+
+  size_t count(const KeyT &Key) const { return find(Key) ? 1 : 0; }
+
+  size_t size() const {
+    size_t Size = 0;
+    for (auto &S : Shards) {
+      std::lock_guard<std::mutex> Lock(S->Mutex);
+      Size += S->Map.size();
+    }
+    return Size;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /// Call \p Fn on every entry, one shard at a time.  Entries inserted
+  /// concurrently may or may not be visited.
+  template <typename FuncTy> void forEach(FuncTy Fn) const {
+    for (auto &S : Shards) {
+      std::lock_guard<std::mutex> Lock(S->Mutex);
+      for (auto &KV : S->Map)
+        Fn(*KV.second);
+    }
+  }
+
+  /// Like forEach(), but visit the shards in parallel.  \p Fn must be safe
+  /// to call from several threads at once.
+  template <typename FuncTy> void parallelForEach(FuncTy Fn) const {
+    parallel::for_each_n(parallel::par, 0u, NumShards, [&](unsigned I) {
+      ShardTy &S = *Shards[I];
+      std::lock_guard<std::mutex> Lock(S.Mutex);
+      for (auto &KV : S.Map)
+        Fn(*KV.second);
+    });
+  }
+
+  /// Remove all entries.  Must not run concurrently with any other method.
+  void clear() {
+    for (auto &S : Shards)
+      S->Map.clear();
+    Entries.DestroyAll();
+  }
+
+private:
+  using ShardTy =
+      detail::LockedShard<DenseMap<KeyT, value_type *, KeyInfoT>>;
+
+  ShardTy &getShard(const KeyT &Key) const {
+    return *Shards[detail::getShardIndex<NumShards>(
+        KeyInfoT::getHashValue(Key))];
+  }
+
+  // Declared first so that it outlives the shards.
+  SpecificConcurrentBumpPtrAllocator<value_type> Entries;
+  std::unique_ptr<ShardTy> Shards[NumShards];
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_CONCURRENTHASHMAP_H
@@ -25,9 +25,11 @@
 #ifndef LLVM_ADT_STATISTIC_H
 #define LLVM_ADT_STATISTIC_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Compiler.h"
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -44,15 +46,23 @@ class raw_ostream;
 class raw_fd_ostream;
 class StringRef;
 
+/// Set by EnableShardedStatistics() or -stats-sharded.
+extern bool StatisticShardingEnabled;
+
 class Statistic {
 public:
   const char *DebugType;
   const char *Name;
   const char *Desc;
-  std::atomic<unsigned> Value;
+  /// The value, minus the updates still held by per-thread counters.
+  std::atomic<uint64_t> Value;
   std::atomic<bool> Initialized;
+  /// Slot of the statistic in the per-thread counters, 0 until the statistic
+  /// is first registered.
+  unsigned Index;
 
-  unsigned getValue() const { return Value.load(std::memory_order_relaxed); }
+  /// Return the value, including the updates of all threads.
+  uint64_t getValue() const;
   const char *getDebugType() const { return DebugType; }
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
@@ -64,64 +74,74 @@ public:
     Desc = desc;
     Value = 0;
     Initialized = false;
+    Index = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return getValue(); }
+  operator uint64_t() const { return getValue(); }
 
 #if LLVM_ENABLE_STATS
-   const Statistic &operator=(unsigned Val) {
-    Value.store(Val, std::memory_order_relaxed);
-    return init();
+  // With sharding enabled, the value returned by the postfix operators only
+  // reflects the updates made by the calling thread.
+
+  const Statistic &operator=(uint64_t Val) {
+    init();
+    if (StatisticShardingEnabled)
+      setSharded(Val);
+    else
+      Value.store(Val, std::memory_order_relaxed);
+    return *this;
   }
 
   const Statistic &operator++() {
-    Value.fetch_add(1, std::memory_order_relaxed);
-    return init();
+    add(1);
+    return *this;
   }
 
-  unsigned operator++(int) {
-    init();
-    return Value.fetch_add(1, std::memory_order_relaxed);
+  uint64_t operator++(int) {
+    return add(1);
   }
 
   const Statistic &operator--() {
-    Value.fetch_sub(1, std::memory_order_relaxed);
-    return init();
+    add(-1);
+    return *this;
   }
 
-  unsigned operator--(int) {
-    init();
-    return Value.fetch_sub(1, std::memory_order_relaxed);
+  uint64_t operator--(int) {
+    return add(-1);
   }
 
-  const Statistic &operator+=(unsigned V) {
+  const Statistic &operator+=(uint64_t V) {
     if (V == 0)
       return *this;
-    Value.fetch_add(V, std::memory_order_relaxed);
-    return init();
+    add(V);
+    return *this;
   }
 
-  const Statistic &operator-=(unsigned V) {
+  const Statistic &operator-=(uint64_t V) {
     if (V == 0)
       return *this;
-    Value.fetch_sub(V, std::memory_order_relaxed);
-    return init();
+    add(-V);
+    return *this;
   }
 
-  void updateMax(unsigned V) {
-    unsigned PrevMax = Value.load(std::memory_order_relaxed);
+  void updateMax(uint64_t V) {
+    init();
+    if (StatisticShardingEnabled) {
+      updateMaxSharded(V);
+      return;
+    }
+    uint64_t PrevMax = Value.load(std::memory_order_relaxed);
     // Keep trying to update max until we succeed or another thread produces
     // a bigger max than us.
     while (V > PrevMax && !Value.compare_exchange_weak(
                               PrevMax, V, std::memory_order_relaxed)) {
     }
-    init();
   }
 
 #else  // Statistics are disabled in release builds.
 
-  const Statistic &operator=(unsigned Val) {
+  const Statistic &operator=(uint64_t Val) {
     return *this;
   }
 
@@ -129,7 +149,7 @@ public:
     return *this;
   }
 
-  unsigned operator++(int) {
+  uint64_t operator++(int) {
     return 0;
   }
 
@@ -137,19 +157,19 @@ public:
     return *this;
   }
 
-  unsigned operator--(int) {
+  uint64_t operator--(int) {
     return 0;
   }
 
-  const Statistic &operator+=(const unsigned &V) {
+  const Statistic &operator+=(const uint64_t &V) {
     return *this;
   }
 
-  const Statistic &operator-=(const unsigned &V) {
+  const Statistic &operator-=(const uint64_t &V) {
     return *this;
   }
 
-  void updateMax(unsigned V) {}
+  void updateMax(uint64_t V) {}
 
 #endif  // LLVM_ENABLE_STATS
 
@@ -160,13 +180,65 @@ protected:
     return *this;
   }
 
+  /// Add \p Delta, modulo 2^64, and return the previous value.
+  uint64_t add(uint64_t Delta) {
+    init();
+    if (StatisticShardingEnabled)
+      return addSharded(Delta);
+    return Value.fetch_add(Delta, std::memory_order_relaxed);
+  }
+
   void RegisterStatistic();
+  uint64_t addSharded(uint64_t Delta);
+  void setSharded(uint64_t Val);
+  void updateMaxSharded(uint64_t V);
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC)                                               \
-  static llvm::Statistic VARNAME = {DEBUG_TYPE, #VARNAME, DESC, {0}, {false}}
+  static llvm::Statistic VARNAME = {DEBUG_TYPE, #VARNAME, DESC, {0}, {false}, 0}
+
+/// The values of the registered statistics at one point in time.  Take one
+/// before and one after some work, such as the compilation of a module, and
+/// diff them to get the statistics of that work alone.  Updates made by other
+/// threads in the meantime are included.
+class StatisticSnapshot {
+public:
+  struct Entry {
+    const char *DebugType;
+    const char *Name;
+    const char *Desc;
+    uint64_t Value;
+  };
+
+  /// Return the entries, sorted by debug type, name and description.
+  ArrayRef<Entry> entries() const { return Entries; }
+
+  /// Return the value of statistic \p Name of \p DebugType, or 0 if it is not
+  /// in the snapshot.
+  uint64_t lookup(StringRef DebugType, StringRef Name) const;
+
+  /// Return the statistics whose value changed since \p Earlier, with the
+  /// difference as their value.
+  StatisticSnapshot diff(const StatisticSnapshot &Earlier) const;
+
+  /// Print the snapshot in the format of PrintStatistics().
+  void print(raw_ostream &OS) const;
+
+private:
+  friend StatisticSnapshot TakeStatisticSnapshot();
+
+  std::vector<Entry> Entries;
+};
+
+/// Return the current values of the registered statistics.
+StatisticSnapshot TakeStatisticSnapshot();
+
+/// Count statistic updates in per-thread counters that are summed when read,
+/// instead of in one counter shared by all threads.  This must be called
+/// before any statistic is updated.
+void EnableShardedStatistics();
 
 /// Enable the collection and printing of statistics.
 void EnableStatistics(bool PrintOnExit = true);
@@ -196,7 +268,7 @@ void PrintStatisticsJSON(raw_ostream &OS);
 /// during it's execution. It will return the value at the point that it is
 /// read. However, it will prevent new statistics from registering until it
 /// completes.
-const std::vector<std::pair<StringRef, unsigned>> GetStatistics();
+const std::vector<std::pair<StringRef, uint64_t>> GetStatistics();
 
 /// Reset the statistics. This can be used to zero and de-register the
 /// statistics in order to measure a compilation.
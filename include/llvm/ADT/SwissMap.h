@@ -0,0 +1,739 @@
+//===- llvm/ADT/SwissMap.h - Group-probed hash table ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissMap and SwissSet classes, hash tables with the
+// interface of DenseMap and DenseSet which probe groups of one-byte control
+// words with SIMD instructions, in the style of Abseil's "Swiss tables".
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSMAP_H
+#define LLVM_ADT_SWISSMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/type_traits.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+namespace detail {
+
+/// The control byte of an unused slot.  The control byte of a slot in use
+/// holds seven bits of the hash of its key, so it is never negative.
+const int8_t SwissCtrlEmpty = -128;
+/// The control byte of a slot whose entry was erased.
+const int8_t SwissCtrlDeleted = -2;
+
+/// A group of control bytes, which are matched all at once.  A match yields
+/// a mask with bit I set if control byte I matches.
+class SwissGroup {
+public:
+  enum : unsigned { Width = 16 };
+
+#ifdef __SSE2__
+  explicit SwissGroup(const int8_t *Ctrl)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Ctrl))) {}
+
+  uint32_t match(int8_t Tag) const {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Tag), Ctrl));
+  }
+  uint32_t matchEmpty() const { return match(SwissCtrlEmpty); }
+  /// Empty and deleted slots are exactly those with the sign bit set.
+  uint32_t matchEmptyOrDeleted() const { return _mm_movemask_epi8(Ctrl); }
+
+private:
+  __m128i Ctrl;
+#else
+  explicit SwissGroup(const int8_t *Ctrl) { memcpy(this->Ctrl, Ctrl, Width); }
+
+  uint32_t match(int8_t Tag) const {
+    uint32_t Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Mask |= uint32_t(Ctrl[I] == Tag) << I;
+    return Mask;
+  }
+  uint32_t matchEmpty() const { return match(SwissCtrlEmpty); }
+  uint32_t matchEmptyOrDeleted() const {
+    uint32_t Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Mask |= uint32_t(Ctrl[I] < 0) << I;
+    return Mask;
+  }
+
+private:
+  int8_t Ctrl[Width];
+#endif
+};
+
+} // end namespace detail
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          bool IsConst = false>
+class SwissMapIterator;
+
+/// A hash table with the interface of DenseMap.
+///
+/// Every slot has a control byte, which is either empty, deleted, or holds
+/// seven bits of the hash of the slot's key.  The control bytes are kept
+/// apart from the slots and are probed sixteen at a time, so a lookup
+/// usually reads one group of control bytes and compares a single key, and
+/// never touches the slots of unrelated keys.  Unlike DenseMap, no key values
+/// are reserved, so only KeyInfoT::getHashValue and KeyInfoT::isEqual are
+/// used.
+///
+/// As with DenseMap, iterators and references to entries are invalidated by
+/// insertion, and the iteration order is unspecified.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename BucketT = llvm::detail::DenseMapPair<KeyT, ValueT>>
+class SwissMap : public DebugEpochBase {
+  template <typename T>
+  using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+  using Group = detail::SwissGroup;
+
+  BucketT *Slots = nullptr;
+  int8_t *Ctrl = nullptr;
+  /// Zero, or a power of two which is at least Group::Width.
+  unsigned NumSlots = 0;
+  unsigned NumEntries = 0;
+  /// The number of empty slots which can be filled before the table must be
+  /// rehashed.
+  unsigned GrowthLeft = 0;
+
+public:
+  using size_type = unsigned;
+  using key_type = KeyT;
+  using mapped_type = ValueT;
+  using value_type = BucketT;
+
+  using iterator = SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT>;
+  using const_iterator =
+      SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+
+  /// Create an empty map with room for \p InitialReserve entries.
+  explicit SwissMap(unsigned InitialReserve = 0) { reserve(InitialReserve); }
+
+  SwissMap(const SwissMap &Other) { copyFrom(Other); }
+
+  SwissMap(SwissMap &&Other) { swap(Other); }
+
+  template <typename InputIt> SwissMap(const InputIt &I, const InputIt &E) {
+    reserve(std::distance(I, E));
+    insert(I, E);
+  }
+
+  SwissMap(std::initializer_list<value_type> Vals) {
+    reserve(Vals.size());
+    insert(Vals.begin(), Vals.end());
+  }
+
+  ~SwissMap() {
+    destroyAll();
+    operator delete(Slots);
+  }
+
+  SwissMap &operator=(const SwissMap &Other) {
+    if (&Other != this)
+      copyFrom(Other);
+    return *this;
+  }
+
+  SwissMap &operator=(SwissMap &&Other) {
+    destroyAll();
+    operator delete(Slots);
+    Slots = nullptr;
+    Ctrl = nullptr;
+    NumSlots = NumEntries = GrowthLeft = 0;
+    incrementEpoch();
+    swap(Other);
+    return *this;
+  }
+
+  void swap(SwissMap &RHS) {
+    incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Slots, RHS.Slots);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumSlots, RHS.NumSlots);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+  }
+
+  inline iterator begin() {
+    if (empty())
+      return end();
+    return iterator(Slots, Ctrl, Slots + NumSlots, *this);
+  }
+  inline iterator end() {
+    return iterator(Slots + NumSlots, Ctrl + NumSlots, Slots + NumSlots,
+                    *this, true);
+  }
+  inline const_iterator begin() const {
+    if (empty())
+      return end();
+    return const_iterator(Slots, Ctrl, Slots + NumSlots, *this);
+  }
+  inline const_iterator end() const {
+    return const_iterator(Slots + NumSlots, Ctrl + NumSlots,
+                          Slots + NumSlots, *this, true);
+  }
+
+  LLVM_NODISCARD bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can contain at least \p NumEntries items
+  /// before resizing again.
+  void reserve(size_type NumEntries) {
+    incrementEpoch();
+    unsigned MinSlots = getMinSlotsForEntries(NumEntries);
+    if (MinSlots > NumSlots)
+      rehash(MinSlots);
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && GrowthLeft == getMaxEntries(NumSlots))
+      return;
+
+    // If the capacity of the table is huge, and the # elements used is small,
+    // shrink the table.
+    if (NumEntries * 4 < NumSlots && NumSlots > 64) {
+      shrink_and_clear();
+      return;
+    }
+
+    destroyAll();
+    memset(Ctrl, detail::SwissCtrlEmpty, NumSlots);
+    NumEntries = 0;
+    GrowthLeft = getMaxEntries(NumSlots);
+  }
+
+  /// Release the table and size it for the number of entries it had.
+  void shrink_and_clear() {
+    unsigned OldNumEntries = NumEntries;
+    destroyAll();
+    operator delete(Slots);
+    Slots = nullptr;
+    Ctrl = nullptr;
+    NumSlots = NumEntries = GrowthLeft = 0;
+    incrementEpoch();
+    if (OldNumEntries)
+      rehash(std::max(64u, getMinSlotsForEntries(OldNumEntries)));
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const_arg_type_t<KeyT> Val) const {
+    return findSlot(Val) ? 1 : 0;
+  }
+
+  iterator find(const_arg_type_t<KeyT> Val) { return find_as(Val); }
+  const_iterator find(const_arg_type_t<KeyT> Val) const {
+    return find_as(Val);
+  }
+
+  /// Alternate version of find() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    if (BucketT *Slot = findSlot(Val))
+      return makeIterator(Slot);
+    return end();
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    if (const BucketT *Slot = findSlot(Val))
+      return makeConstIterator(Slot);
+    return end();
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const_arg_type_t<KeyT> Val) const {
+    if (const BucketT *Slot = findSlot(Val))
+      return Slot->getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    return insertImpl(Key, std::move(Key), std::forward<Ts>(Args)...);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    return insertImpl(Key, Key, std::forward<Ts>(Args)...);
+  }
+
+  /// Alternate version of insert() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <typename LookupKeyT>
+  std::pair<iterator, bool> insert_as(std::pair<KeyT, ValueT> &&KV,
+                                      const LookupKeyT &Val) {
+    return insertImpl(Val, std::move(KV.first), std::move(KV.second));
+  }
+
+  /// insert - Range insertion of pairs.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    BucketT *Slot = findSlot(Val);
+    if (!Slot)
+      return false;
+    eraseSlot(Slot - Slots);
+    return true;
+  }
+  void erase(iterator I) {
+    assert(isPointerIntoBucketsArray(&*I) && "Iterator not into this map!");
+    eraseSlot(&*I - Slots);
+  }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    return *try_emplace(Key).first;
+  }
+
+  ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    return *try_emplace(std::move(Key)).first;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the map's array of slots (i.e. either to a key or
+  /// value in the map).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= static_cast<const void *>(Slots) &&
+           Ptr < static_cast<const void *>(Slots + NumSlots);
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the slots
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Slots; }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by the map, not including the
+  /// memory used by the entries themselves.
+  size_t getMemorySize() const {
+    return size_t(NumSlots) * (sizeof(BucketT) + 1);
+  }
+
+private:
+  iterator makeIterator(BucketT *Slot) {
+    return iterator(Slot, Ctrl + (Slot - Slots), Slots + NumSlots, *this,
+                    true);
+  }
+  const_iterator makeConstIterator(const BucketT *Slot) const {
+    return const_iterator(Slot, Ctrl + (Slot - Slots), Slots + NumSlots,
+                          *this, true);
+  }
+
+  /// Mix the hash supplied by KeyInfoT, since the hashes of pointers and
+  /// integers are often poor in some of their bits.  The low seven bits of the
+  /// result are stored in the control bytes, and the rest pick the first
+  /// group to probe.
+  template <typename LookupKeyT>
+  static uint64_t getHash(const LookupKeyT &Val) {
+    uint64_t Hash =
+        uint64_t(KeyInfoT::getHashValue(Val)) * 0x9E3779B97F4A7C15ULL;
+    return Hash ^ (Hash >> 32);
+  }
+  static int8_t getTag(uint64_t Hash) { return Hash & 0x7F; }
+
+  /// The most entries a table of \p NumSlots slots holds, for a maximum
+  /// load factor of 7/8.
+  static unsigned getMaxEntries(unsigned NumSlots) {
+    return NumSlots - NumSlots / 8;
+  }
+
+  static unsigned getMinSlotsForEntries(unsigned NumEntries) {
+    if (NumEntries == 0)
+      return 0;
+    uint64_t MinSlots = (uint64_t(NumEntries) * 8 + 6) / 7;
+    return std::max<uint64_t>(Group::Width, NextPowerOf2(MinSlots - 1));
+  }
+
+  /// The first group to probe for \p Hash.
+  size_t getFirstGroup(uint64_t Hash) const {
+    return (Hash >> 7) & (NumSlots / Group::Width - 1);
+  }
+
+  /// The group after \p GroupIdx in a probe sequence, \p Step groups on.
+  /// Stepping by 1, 2, 3 and so on visits every group once.
+  size_t getNextGroup(size_t GroupIdx, size_t Step) const {
+    return (GroupIdx + Step) & (NumSlots / Group::Width - 1);
+  }
+
+  template <typename LookupKeyT>
+  BucketT *findSlot(const LookupKeyT &Val) const {
+    if (NumSlots == 0)
+      return nullptr;
+    uint64_t Hash = getHash(Val);
+    int8_t Tag = getTag(Hash);
+    size_t GroupIdx = getFirstGroup(Hash);
+    for (size_t Step = 1;; ++Step) {
+      size_t First = GroupIdx * Group::Width;
+      Group G(Ctrl + First);
+      for (uint32_t Mask = G.match(Tag); Mask; Mask &= Mask - 1) {
+        BucketT *Slot = Slots + First + countTrailingZeros(Mask, ZB_Undefined);
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, Slot->getFirst())))
+          return Slot;
+      }
+      // An empty slot ends the probe sequence of every key which hashes to
+      // this group or any before it.
+      if (LLVM_LIKELY(G.matchEmpty()))
+        return nullptr;
+      GroupIdx = getNextGroup(GroupIdx, Step);
+    }
+  }
+
+  /// Return the first empty or deleted slot in the probe sequence of
+  /// \p Hash.
+  size_t findInsertSlot(uint64_t Hash) const {
+    size_t GroupIdx = getFirstGroup(Hash);
+    for (size_t Step = 1;; ++Step) {
+      size_t First = GroupIdx * Group::Width;
+      if (uint32_t Mask = Group(Ctrl + First).matchEmptyOrDeleted())
+        return First + countTrailingZeros(Mask, ZB_Undefined);
+      GroupIdx = getNextGroup(GroupIdx, Step);
+    }
+  }
+
+  template <typename LookupKeyT, typename KeyArg, typename... ValueArgs>
+  std::pair<iterator, bool> insertImpl(const LookupKeyT &Val, KeyArg &&Key,
+                                       ValueArgs &&... Values) {
+    if (BucketT *Slot = findSlot(Val))
+      return std::make_pair(makeIterator(Slot), false);
+
+    incrementEpoch();
+    uint64_t Hash = getHash(Val);
+    size_t Idx = NumSlots ? findInsertSlot(Hash) : 0;
+    if (NumSlots == 0 ||
+        (Ctrl[Idx] == detail::SwissCtrlEmpty && GrowthLeft == 0)) {
+      // Grow the table, unless it is mostly deleted slots, in which case
+      // rehashing it in place makes room.
+      if (NumEntries + 1 > getMaxEntries(NumSlots) / 2)
+        rehash(std::max<unsigned>(Group::Width, NumSlots * 2));
+      else
+        rehash(NumSlots);
+      Idx = findInsertSlot(Hash);
+    }
+
+    if (Ctrl[Idx] == detail::SwissCtrlEmpty)
+      --GrowthLeft;
+    Ctrl[Idx] = getTag(Hash);
+    ++NumEntries;
+    BucketT *Slot = Slots + Idx;
+    ::new (&Slot->getFirst()) KeyT(std::forward<KeyArg>(Key));
+    ::new (&Slot->getSecond()) ValueT(std::forward<ValueArgs>(Values)...);
+    return std::make_pair(makeIterator(Slot), true);
+  }
+
+  void eraseSlot(size_t Idx) {
+    BucketT *Slot = Slots + Idx;
+    Slot->getSecond().~ValueT();
+    Slot->getFirst().~KeyT();
+    --NumEntries;
+    incrementEpoch();
+
+    // A key is only ever placed past a group which had no empty or deleted
+    // slots, so a group which still has an empty slot cannot be in the
+    // middle of any probe sequence, and the slot can be reused freely.
+    size_t First = Idx & ~size_t(Group::Width - 1);
+    if (Group(Ctrl + First).matchEmpty()) {
+      Ctrl[Idx] = detail::SwissCtrlEmpty;
+      ++GrowthLeft;
+    } else {
+      Ctrl[Idx] = detail::SwissCtrlDeleted;
+    }
+  }
+
+  void destroyAll() {
+    if (is_trivially_copyable<KeyT>::value &&
+        is_trivially_copyable<ValueT>::value)
+      return;
+    for (unsigned I = 0; I != NumSlots; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      Slots[I].getSecond().~ValueT();
+      Slots[I].getFirst().~KeyT();
+    }
+  }
+
+  /// Allocate a table of \p Num slots, all empty.  The control bytes follow
+  /// the slots in the same allocation.
+  void allocateSlots(unsigned Num) {
+    NumSlots = Num;
+    Slots = static_cast<BucketT *>(
+        operator new((sizeof(BucketT) + 1) * size_t(Num)));
+    Ctrl = reinterpret_cast<int8_t *>(Slots + Num);
+    memset(Ctrl, detail::SwissCtrlEmpty, Num);
+  }
+
+  /// Move every entry into a new table of \p NewNumSlots slots, which also
+  /// drops all deleted slots.
+  void rehash(unsigned NewNumSlots) {
+    assert(getMaxEntries(NewNumSlots) >= NumEntries && "Table too small!");
+    BucketT *OldSlots = Slots;
+    int8_t *OldCtrl = Ctrl;
+    unsigned OldNumSlots = NumSlots;
+    allocateSlots(NewNumSlots);
+    GrowthLeft = getMaxEntries(NewNumSlots) - NumEntries;
+
+    for (unsigned I = 0; I != OldNumSlots; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      BucketT &Old = OldSlots[I];
+      uint64_t Hash = getHash(Old.getFirst());
+      size_t Idx = findInsertSlot(Hash);
+      Ctrl[Idx] = getTag(Hash);
+      ::new (&Slots[Idx].getFirst()) KeyT(std::move(Old.getFirst()));
+      ::new (&Slots[Idx].getSecond()) ValueT(std::move(Old.getSecond()));
+      Old.getSecond().~ValueT();
+      Old.getFirst().~KeyT();
+    }
+    operator delete(OldSlots);
+  }
+
+  void copyFrom(const SwissMap &Other) {
+    destroyAll();
+    operator delete(Slots);
+    Slots = nullptr;
+    Ctrl = nullptr;
+    NumSlots = 0;
+    incrementEpoch();
+
+    if (Other.NumSlots)
+      allocateSlots(Other.NumSlots);
+    NumEntries = Other.NumEntries;
+    GrowthLeft = Other.GrowthLeft;
+    if (!NumSlots)
+      return;
+    memcpy(Ctrl, Other.Ctrl, NumSlots);
+    for (unsigned I = 0; I != NumSlots; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      ::new (&Slots[I].getFirst()) KeyT(Other.Slots[I].getFirst());
+      ::new (&Slots[I].getSecond()) ValueT(Other.Slots[I].getSecond());
+    }
+  }
+};
+
+/// Equality comparison for SwissMap.
+///
+/// Iterates over elements of LHS confirming that each (key, value) pair in LHS
+/// is also in RHS, and that no additional pairs are in RHS.
+/// Equivalent to N calls to RHS.find and N value comparisons. Amortized
+/// complexity is linear, worst case is O(N^2) (if every hash collides).
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+bool operator==(const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  if (LHS.size() != RHS.size())
+    return false;
+
+  for (auto &KV : LHS) {
+    auto I = RHS.find(KV.first);
+    if (I == RHS.end() || I->second != KV.second)
+      return false;
+  }
+
+  return true;
+}
+
+/// Inequality comparison for SwissMap.
+///
+/// Equivalent to !(LHS == RHS). See operator== for performance notes.
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+bool operator!=(const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  return !(LHS == RHS);
+}
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          bool IsConst>
+class SwissMapIterator : DebugEpochBase::HandleBase {
+  friend class SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+  friend class SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT, false>;
+
+  using ConstIterator = SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+
+public:
+  using difference_type = ptrdiff_t;
+  using value_type =
+      typename std::conditional<IsConst, const BucketT, BucketT>::type;
+  using pointer = value_type *;
+  using reference = value_type &;
+  using iterator_category = std::forward_iterator_tag;
+
+private:
+  pointer Ptr = nullptr;
+  const int8_t *Ctrl = nullptr;
+  pointer End = nullptr;
+
+public:
+  SwissMapIterator() = default;
+
+  SwissMapIterator(pointer Pos, const int8_t *Ctrl, pointer E,
+                   const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ptr(Pos), Ctrl(Ctrl), End(E) {
+    assert(isHandleInSync() && "invalid construction!");
+    if (!NoAdvance)
+      AdvancePastEmptySlots();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined copy
+  // constructor.
+  template <bool IsConstSrc,
+            typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+  SwissMapIterator(
+      const SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ptr(I.Ptr), Ctrl(I.Ctrl), End(I.End) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ptr == RHS.Ptr;
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ptr != RHS.Ptr;
+  }
+
+  inline SwissMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptySlots();
+    return *this;
+  }
+  SwissMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    SwissMapIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+private:
+  void AdvancePastEmptySlots() {
+    assert(Ptr <= End);
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+inline size_t capacity_in_bytes(const SwissMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+/// A hash set with the interface of DenseSet, built on SwissMap.
+template <typename ValueT, typename ValueInfoT = DenseMapInfo<ValueT>>
+class SwissSet
+    : public detail::DenseSetImpl<
+          ValueT, SwissMap<ValueT, detail::DenseSetEmpty, ValueInfoT,
+                           detail::DenseSetPair<ValueT>>,
+          ValueInfoT> {
+  using BaseT =
+      detail::DenseSetImpl<ValueT,
+                           SwissMap<ValueT, detail::DenseSetEmpty, ValueInfoT,
+                                    detail::DenseSetPair<ValueT>>,
+                           ValueInfoT>;
+
+public:
+  using BaseT::BaseT;
+};
+
+/// The map and set types of LLVM's hottest hash tables, such as the uniquing
+/// tables of LLVMContext and the map of ValueMap.  They are SwissMap and
+/// SwissSet when LLVM is configured with LLVM_ENABLE_SWISS_MAP, and DenseMap
+/// and DenseSet otherwise.
+#if LLVM_ENABLE_SWISS_MAP
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+using HotDenseMap = SwissMap<KeyT, ValueT, KeyInfoT>;
+template <typename ValueT, typename ValueInfoT = DenseMapInfo<ValueT>>
+using HotDenseSet = SwissSet<ValueT, ValueInfoT>;
+#else
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+using HotDenseMap = DenseMap<KeyT, ValueT, KeyInfoT>;
+template <typename ValueT, typename ValueInfoT = DenseMapInfo<ValueT>>
+using HotDenseSet = DenseSet<ValueT, ValueInfoT>;
+#endif
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_SWISSMAP_H
@@ -17,6 +17,7 @@
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Error.h"
 #include <functional>
 
 namespace llvm {
@@ -37,6 +38,17 @@ ModuleSummaryIndex buildModuleSummaryIndex(
     std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
     ProfileSummaryInfo *PSI);
 
+/// Compute a \c ModuleSummaryIndex from a module whose function bodies are
+/// read lazily, reading each body before it is summarized.
+///
+/// The bodies may be dropped again once summarized, so the index names the
+/// global values rather than refers to them, as an index read from bitcode
+/// does.  Returns the error of the first function body that cannot be read.
+Expected<ModuleSummaryIndex> buildModuleSummaryIndexFromLazyModule(
+    const Module &M,
+    std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
+    ProfileSummaryInfo *PSI);
+
 /// Analysis pass to provide the ModuleSummaryIndex object.
 class ModuleSummaryIndexAnalysis
     : public AnalysisInfoMixin<ModuleSummaryIndexAnalysis> {
@@ -612,6 +612,12 @@ public:
   /// vector loads/stores.
   bool enableMaskedInterleavedAccessVectorization() const;
 
+  /// Return true if the loop vectorizer should fold the remainder of
+  /// loop \p L into the vector loop by masking instead of emitting a scalar
+  /// epilogue, e.g. because the target can limit the number of active lanes
+  /// cheaply.
+  bool preferPredicateOverEpilogue(Loop *L) const;
+
   /// Indicate that it is potentially unsafe to automatically vectorize
   /// floating-point operations because the semantics of vector and scalar
   /// floating-point semantics may differ. For example, ARM NEON v7 SIMD math
@@ -1117,6 +1123,7 @@ public:
       bool IsZeroCmp) const = 0;
   virtual bool enableInterleavedAccessVectorization() = 0;
   virtual bool enableMaskedInterleavedAccessVectorization() = 0;
+  virtual bool preferPredicateOverEpilogue(Loop *L) = 0;
   virtual bool isFPVectorizationPotentiallyUnsafe() = 0;
   virtual bool allowsMisalignedMemoryAccesses(LLVMContext &Context,
                                               unsigned BitWidth,
@@ -1412,6 +1419,9 @@ public:
   bool enableMaskedInterleavedAccessVectorization() override {
     return Impl.enableMaskedInterleavedAccessVectorization();
   }
+  bool preferPredicateOverEpilogue(Loop *L) override {
+    return Impl.preferPredicateOverEpilogue(L);
+  }
   bool isFPVectorizationPotentiallyUnsafe() override {
     return Impl.isFPVectorizationPotentiallyUnsafe();
   }
@@ -284,6 +284,8 @@ public:
 
   bool enableMaskedInterleavedAccessVectorization() { return false; }
 
+  bool preferPredicateOverEpilogue(Loop *L) { return false; }
+
   bool isFPVectorizationPotentiallyUnsafe() { return false; }
 
   bool allowsMisalignedMemoryAccesses(LLVMContext &Context,
@@ -77,10 +77,10 @@ class Module;
     friend Expected<BitcodeFileContents>
     getBitcodeFileContents(MemoryBufferRef Buffer);
 
-    Expected<std::unique_ptr<Module>> getModuleImpl(LLVMContext &Context,
-                                                    bool MaterializeAll,
-                                                    bool ShouldLazyLoadMetadata,
-                                                    bool IsImporting);
+    Expected<std::unique_ptr<Module>>
+    getModuleImpl(LLVMContext &Context, bool MaterializeAll,
+                  bool ShouldLazyLoadMetadata, bool IsImporting,
+                  uint64_t MaterializedBudget = 0);
 
   public:
     StringRef getBuffer() const {
@@ -99,6 +99,16 @@ class Module;
                                                     bool ShouldLazyLoadMetadata,
                                                     bool IsImporting);
 
+    /// Read the bitcode module for a read-only client that looks at one
+    /// function body at a time. Function bodies are read on demand, as with
+    /// getLazyModule, but once the bodies read take more than about
+    /// MaterializedBudget bytes, materializing a function drops the bodies of
+    /// the least recently materialized ones, which become materializable
+    /// again. Functions whose blocks have their address taken are never
+    /// dropped. Materializing the whole module stops the paging.
+    Expected<std::unique_ptr<Module>>
+    getPagedModule(LLVMContext &Context, uint64_t MaterializedBudget);
+
     /// Read the entire bitcode module and return it.
     Expected<std::unique_ptr<Module>> parseModule(LLVMContext &Context);
 
@@ -148,6 +158,15 @@ class Module;
       std::unique_ptr<MemoryBuffer> &&Buffer, LLVMContext &Context,
       bool ShouldLazyLoadMetadata = false, bool IsImporting = false);
 
+  /// Read the header of the specified bitcode buffer and prepare for paging
+  /// of function bodies under MaterializedBudget, as described in
+  /// BitcodeModule::getPagedModule. The module takes ownership of the memory
+  /// buffer if successful. On error, this *does not* move Buffer.
+  Expected<std::unique_ptr<Module>>
+  getOwningPagedBitcodeModule(std::unique_ptr<MemoryBuffer> &&Buffer,
+                              LLVMContext &Context,
+                              uint64_t MaterializedBudget);
+
   /// Read the header of the specified bitcode buffer and extract just the
   /// triple information. If successful, this returns a string. On error, this
   /// returns "".
@@ -26,6 +26,7 @@ namespace llvm {
 
 class BitstreamWriter;
 class Module;
+class raw_mmap_ostream;
 class raw_ostream;
 
   class BitcodeWriter {
@@ -45,8 +46,11 @@ class raw_ostream;
     std::vector<Module *> Mods;
 
   public:
-    /// Create a BitcodeWriter that writes to Buffer.
-    BitcodeWriter(SmallVectorImpl<char> &Buffer);
+    /// Create a BitcodeWriter that writes to Buffer.  If \p FS is given,
+    /// Buffer is flushed to it as it grows, and only holds the tail of the
+    /// bitcode written so far.
+    BitcodeWriter(SmallVectorImpl<char> &Buffer,
+                  raw_mmap_ostream *FS = nullptr);
 
     ~BitcodeWriter();
 
@@ -131,6 +135,15 @@ class raw_ostream;
                           bool GenerateHash = false,
                           ModuleHash *ModHash = nullptr);
 
+  /// Like the above, but flush the bitcode to \p Out as it is generated
+  /// rather than buffering all of it in memory, unless the whole of it is
+  /// needed at the end to compute a module hash or a Darwin wrapper header.
+  void WriteBitcodeToFile(const Module &M, raw_mmap_ostream &Out,
+                          bool ShouldPreserveUseListOrder = false,
+                          const ModuleSummaryIndex *Index = nullptr,
+                          bool GenerateHash = false,
+                          ModuleHash *ModHash = nullptr);
+
   /// Write the specified thin link bitcode file (i.e., the minimized bitcode
   /// file) to the given raw output stream, where it will be written in a new
   /// bitcode block. The thin link bitcode file is used for thin link, and it
@@ -20,13 +20,31 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/raw_mmap_ostream.h"
+#include <algorithm>
 #include <vector>
 
 namespace llvm {
 
 class BitstreamWriter {
+  /// Out - The buffer the stream is written to.  If FS is set, it only holds
+  /// the data after the first FlushedBytes bytes of the stream.
   SmallVectorImpl<char> &Out;
 
+  /// FS - The file Out is flushed to once it grows past FlushThreshold, or
+  /// null to keep the whole stream in Out.
+  raw_mmap_ostream *FS;
+
+  /// FSStart - The position in FS the stream starts at.
+  uint64_t FSStart;
+
+  /// FlushThreshold - The size in bytes Out may grow to before it is flushed
+  /// at the end of the next block.
+  uint64_t FlushThreshold;
+
+  /// FlushedBytes - The number of bytes of the stream written to FS.
+  uint64_t FlushedBytes = 0;
+
   /// CurBit - Always between 0 and 31 inclusive, specifies the next bit to use.
   unsigned CurBit;
 
@@ -72,17 +90,59 @@ class BitstreamWriter {
                reinterpret_cast<const char *>(&Value + 1));
   }
 
-  size_t GetBufferOffset() const { return Out.size(); }
+  uint64_t GetBufferOffset() const { return FlushedBytes + Out.size(); }
 
   size_t GetWordIndex() const {
-    size_t Offset = GetBufferOffset();
+    uint64_t Offset = GetBufferOffset();
     assert((Offset & 3) == 0 && "Not 32-bit aligned");
     return Offset / 4;
   }
 
+  /// Write Out to FS if it has grown past the threshold.  Only called at the
+  /// end of a block, where the stream is word aligned.
+  void FlushToFile() {
+    if (!FS || Out.size() < FlushThreshold)
+      return;
+    FS->write(Out.data(), Out.size());
+    FlushedBytes += Out.size();
+    Out.clear();
+  }
+
+  /// Backpatch a word some of whose bytes have been flushed to FS already.
+  void BackpatchFlushedWord(uint64_t ByteNo, unsigned StartBit,
+                            unsigned NewWord) {
+    using namespace llvm::support;
+    // An unaligned word spans two words.
+    char Bytes[8];
+    size_t NumBytes = StartBit ? 8 : 4;
+    size_t NumFlushed = std::min<uint64_t>(NumBytes, FlushedBytes - ByteNo);
+    StringRef Flushed = FS->getWrittenData().substr(FSStart + ByteNo);
+    assert(Out.size() >= NumBytes - NumFlushed && "Patching past the end");
+    std::copy(Flushed.begin(), Flushed.begin() + NumFlushed, Bytes);
+    std::copy(Out.begin(), Out.begin() + (NumBytes - NumFlushed),
+              Bytes + NumFlushed);
+
+    assert((!endian::readAtBitAlignment<uint32_t, little, unaligned>(
+               Bytes, StartBit)) &&
+           "Expected to be patching over 0-value placeholders");
+    endian::writeAtBitAlignment<uint32_t, little, unaligned>(Bytes, NewWord,
+                                                             StartBit);
+
+    FS->pwrite(Bytes, NumFlushed, FSStart + ByteNo);
+    std::copy(Bytes + NumFlushed, Bytes + NumBytes, Out.begin());
+  }
+
 public:
-  explicit BitstreamWriter(SmallVectorImpl<char> &O)
-    : Out(O), CurBit(0), CurValue(0), CurCodeSize(2) {}
+  /// Create a BitstreamWriter that writes to \p O.  If \p FS is given, the
+  /// contents of \p O are written to it whenever they grow past
+  /// \p FlushThreshold megabytes at the end of a block, which bounds the
+  /// memory used for large streams.
+  explicit BitstreamWriter(SmallVectorImpl<char> &O,
+                           raw_mmap_ostream *FS = nullptr,
+                           uint32_t FlushThreshold = 512)
+      : Out(O), FS(FS), FSStart(FS ? FS->tell() : 0),
+        FlushThreshold(uint64_t(FlushThreshold) << 20), CurBit(0),
+        CurValue(0), CurCodeSize(2) {}
 
   ~BitstreamWriter() {
     assert(CurBit == 0 && "Unflushed data remaining");
@@ -103,7 +163,10 @@ public:
   /// with the specified value.
   void BackpatchWord(uint64_t BitNo, unsigned NewWord) {
     using namespace llvm::support;
-    unsigned ByteNo = BitNo / 8;
+    uint64_t ByteNo = BitNo / 8;
+    if (ByteNo < FlushedBytes)
+      return BackpatchFlushedWord(ByteNo, BitNo & 7, NewWord);
+    ByteNo -= FlushedBytes;
     assert((!endian::readAtBitAlignment<uint32_t, little, unaligned>(
                &Out[ByteNo], BitNo & 7)) &&
            "Expected to be patching over 0-value placeholders");
@@ -245,6 +308,7 @@ public:
     CurCodeSize = B.PrevCodeSize;
     CurAbbrevs = std::move(B.PrevAbbrevs);
     BlockScope.pop_back();
+    FlushToFile();
   }
 
   //===--------------------------------------------------------------------===//
@@ -26,6 +26,9 @@
 /* Define if threads enabled */
 #cmakedefine01 LLVM_ENABLE_THREADS
 
+/* Define if the hottest hash tables use SwissMap rather than DenseMap */
+#cmakedefine01 LLVM_ENABLE_SWISS_MAP
+
 /* Has gcc/MSVC atomic intrinsics */
 #cmakedefine01 LLVM_HAS_ATOMICS
 
@@ -34,6 +34,10 @@ public:
 
   /// Make sure the given GlobalValue is fully read.
   ///
+  /// A materializer that pages function bodies (see
+  /// BitcodeModule::getPagedModule) may drop the bodies of other functions
+  /// read earlier to stay within its memory budget, making them
+  /// materializable again; the body of \p GV itself is never dropped here.
   virtual Error materialize(GlobalValue *GV) = 0;
 
   /// Make sure the entire Module has been completely read.
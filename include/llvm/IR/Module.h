@@ -507,7 +507,9 @@ public:
   GVMaterializer *getMaterializer() const { return Materializer.get(); }
   bool isMaterialized() const { return !getMaterializer(); }
 
-  /// Make sure the GlobalValue is fully read.
+  /// Make sure the GlobalValue is fully read. If the materializer pages
+  /// function bodies, this may drop the bodies of other functions, which must
+  /// then be materialized again before they are looked at.
   llvm::Error materialize(GlobalValue *GV);
 
   /// Make sure all GlobalValues in this Module are fully read and clear the
@@ -45,7 +45,8 @@ extern bool TimePassesIsEnabled;
 /// It provides the pass-instrumentation callbacks that measure the pass
 /// execution time. They collect timing info into individual timers as
 /// passes are being run. At the end of its life-time it prints the resulting
-/// timing report.
+/// timing report.  With -track-perf-counters the report also has the hardware
+/// performance counters of each pass, as in the legacy pass manager.
 class TimePassesHandler {
   /// Value of this type is capable of uniquely identifying pass invocations.
   /// It is a pair of string Pass-Identifier (which for now is common
@@ -15,6 +15,7 @@
 #define LLVM_IRREADER_IRREADER_H
 
 #include "llvm/ADT/StringRef.h"
+#include <cstdint>
 #include <memory>
 
 namespace llvm {
@@ -45,6 +46,17 @@ std::unique_ptr<Module>
 getLazyIRFileModule(StringRef Filename, SMDiagnostic &Err, LLVMContext &Context,
                     bool ShouldLazyLoadMetadata = false);
 
+/// If the given file holds a bitcode image, return a Module for it which
+/// reads function bodies on demand out of the file, mapped rather than copied
+/// into memory where possible, and drops the least recently read bodies once
+/// they take more than about MaterializedBudget bytes.  See
+/// BitcodeModule::getPagedModule.  Otherwise, attempt to parse it as LLVM
+/// Assembly and return a fully populated Module.
+std::unique_ptr<Module> getPagedIRFileModule(StringRef Filename,
+                                             SMDiagnostic &Err,
+                                             LLVMContext &Context,
+                                             uint64_t MaterializedBudget);
+
 /// If the given MemoryBuffer holds a bitcode image, return a Module
 /// for it.  Otherwise, attempt to parse it as LLVM Assembly and return
 /// a Module for it.
@@ -72,6 +72,12 @@ void computeLTOCacheKey(
     const std::set<GlobalValue::GUID> &CfiFunctionDefs = {},
     const std::set<GlobalValue::GUID> &CfiFunctionDecls = {});
 
+/// Computes a unique hash for a partition of the regular LTO module from its
+/// bitcode \p PartitionBC and the code generation options in \p Conf.
+/// The hash is produced in \p Key.
+void computeLTOPartitionCacheKey(SmallString<40> &Key, const lto::Config &Conf,
+                                 StringRef PartitionBC);
+
 namespace lto {
 
 /// Given the original \p Path to an output file, replace any path
@@ -284,7 +290,9 @@ public:
   /// function to add native object files to the link.
   ///
   /// The Cache parameter is optional. If supplied, it will be used to cache
-  /// native object files and add them to the link.
+  /// native object files and add them to the link. Those are the objects of
+  /// the ThinLTO backends and, when the regular LTO module is split for
+  /// parallel code generation, the objects of each of its partitions.
   ///
   /// The client will receive at most one callback (via either AddStream or
   /// Cache) for each task identifier.
@@ -404,7 +412,7 @@ private:
   Error addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
                    const SymbolResolution *&ResI, const SymbolResolution *ResE);
 
-  Error runRegularLTO(AddStreamFn AddStream);
+  Error runRegularLTO(AddStreamFn AddStream, NativeObjectCache Cache);
   Error runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache);
 
   Error checkPartiallySplit();
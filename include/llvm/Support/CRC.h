@@ -14,12 +14,20 @@
 #ifndef LLVM_SUPPORT_CRC_H
 #define LLVM_SUPPORT_CRC_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
 
 namespace llvm {
 /// zlib independent CRC32 calculation.
 uint32_t crc32(uint32_t CRC, StringRef S);
+
+/// CRC-32C (Castagnoli) calculation, continuing from \p CRC.  This uses the
+/// SSE4.2 crc32 instruction when the host supports it.
+uint32_t crc32c(uint32_t CRC, ArrayRef<uint8_t> Data);
+inline uint32_t crc32c(uint32_t CRC, StringRef S) {
+  return crc32c(CRC, makeArrayRef(S.bytes_begin(), S.size()));
+}
 } // end namespace llvm
 
 #endif
@@ -0,0 +1,246 @@
+//===- ConcurrentBumpPtrAllocator.h - Concurrent allocator ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines the ConcurrentBumpPtrAllocator, a bump-pointer allocator
+/// which may be used from several threads at once, and the
+/// SpecificConcurrentBumpPtrAllocator built on top of it.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_CONCURRENTBUMPPTRALLOCATOR_H
+#define LLVM_SUPPORT_CONCURRENTBUMPPTRALLOCATOR_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+
+/// A bump-pointer allocator that may be shared between threads.
+///
+/// Every thread allocating from the allocator bumps a pointer in a slab of
+/// its own, so allocations never synchronize with each other.  Slabs are
+/// taken from a pool shared by all threads, which is the only state guarded
+/// by a lock; it is taken once per slab, not once per allocation.  As with
+/// BumpPtrAllocator, the slab size doubles every 128 slabs and requests
+/// larger than the size threshold get a slab of their own.
+///
+/// Allocate() and Deallocate() may be called concurrently.  Reset() and the
+/// destructor must not run concurrently with any other method.  The
+/// statistics may be queried at any time, but only reflect the allocations
+/// that happened before the query.
+class ConcurrentBumpPtrAllocator
+    : public AllocatorBase<ConcurrentBumpPtrAllocator> {
+public:
+  /// Allocation statistics of one thread.
+  struct ThreadStatistics {
+    /// The system thread id, as returned by llvm::get_threadid().
+    uint64_t ThreadID;
+    /// The number of bytes the thread has asked for.
+    size_t BytesAllocated;
+    /// The number of slabs the thread has taken from the pool.
+    size_t NumSlabs;
+    /// The number of custom-sized slabs the thread has allocated.
+    size_t NumCustomSizedSlabs;
+  };
+
+  explicit ConcurrentBumpPtrAllocator(size_t SlabSize = 4096,
+                                      size_t SizeThreshold = 4096);
+  ConcurrentBumpPtrAllocator(const ConcurrentBumpPtrAllocator &) = delete;
+  ConcurrentBumpPtrAllocator &
+  operator=(const ConcurrentBumpPtrAllocator &) = delete;
+  ~ConcurrentBumpPtrAllocator();
+
+  /// Deallocate all slabs but the current one of each thread and reset the
+  /// threads' pointers to the beginning of those, freeing all memory
+  /// allocated so far.
+  void Reset();
+
+  /// Allocate space at the specified alignment.
+  LLVM_ATTRIBUTE_RETURNS_NONNULL LLVM_ATTRIBUTE_RETURNS_NOALIAS void *
+  Allocate(size_t Size, size_t Alignment) {
+    assert(Alignment > 0 && "0-byte alignnment is not allowed. Use 1 instead.");
+    ThreadState &TS = getThreadState();
+
+    // Only the owning thread writes its counters, so there is no need for an
+    // atomic read-modify-write.
+    TS.BytesAllocated.store(
+        TS.BytesAllocated.load(std::memory_order_relaxed) + Size,
+        std::memory_order_relaxed);
+
+    size_t Adjustment = alignmentAdjustment(TS.CurPtr, Alignment);
+    assert(Adjustment + Size >= Size && "Adjustment + Size must not overflow");
+
+    size_t SizeToAllocate = Size;
+#if LLVM_ADDRESS_SANITIZER_BUILD
+    // Add trailing bytes as a "red zone" under ASan.
+    SizeToAllocate += RedZoneSize;
+#endif
+
+    if (Adjustment + SizeToAllocate <= size_t(TS.End - TS.CurPtr)) {
+      char *AlignedPtr = TS.CurPtr + Adjustment;
+      TS.CurPtr = AlignedPtr + SizeToAllocate;
+      __msan_allocated_memory(AlignedPtr, Size);
+      __asan_unpoison_memory_region(AlignedPtr, Size);
+      return AlignedPtr;
+    }
+    return AllocateSlow(TS, Size, SizeToAllocate, Alignment);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<ConcurrentBumpPtrAllocator>::Allocate;
+
+  // Like BumpPtrAllocator, never free the storage.
+  void Deallocate(const void *Ptr, size_t Size) {
+    __asan_poison_memory_region(Ptr, Size);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<ConcurrentBumpPtrAllocator>::Deallocate;
+
+  size_t GetNumSlabs() const;
+  size_t getTotalMemory() const;
+  size_t getBytesAllocated() const;
+
+  /// Return the statistics of every thread that allocated from this
+  /// allocator, in the order in which they first did so.
+  std::vector<ThreadStatistics> getThreadStatistics() const;
+
+  void setRedZoneSize(size_t NewSize) { RedZoneSize = NewSize; }
+
+  void PrintStats() const;
+
+private:
+  static constexpr size_t NoSlab = ~size_t(0);
+
+  struct ThreadState {
+    /// The next free byte and the end of the current slab of the thread.
+    char *CurPtr = nullptr;
+    char *End = nullptr;
+
+    /// The index of the current slab in Slabs, or NoSlab.
+    size_t CurSlab = NoSlab;
+
+    std::atomic<size_t> BytesAllocated{0};
+    std::atomic<size_t> NumSlabs{0};
+    std::atomic<size_t> NumCustomSizedSlabs{0};
+    uint64_t ThreadID;
+
+    /// Keep the bump pointers of different threads on different cache
+    /// lines.
+    char Padding[64];
+  };
+
+  /// A slab and the end of its used part.  UsedEnd is only up to date once
+  /// no thread allocates from the slab anymore; see syncUsedEnds().
+  struct SlabInfo {
+    char *Begin;
+    size_t Size;
+    char *UsedEnd;
+  };
+
+  ThreadState &getThreadState();
+  ThreadState &getThreadStateSlow();
+  void *AllocateSlow(ThreadState &TS, size_t Size, size_t SizeToAllocate,
+                     size_t Alignment);
+  size_t computeSlabSize(size_t SlabIdx) const;
+
+  /// Record the current pointer of every thread as the end of the used part
+  /// of its slab.
+  void syncUsedEnds();
+
+  /// Call \p Fn on the used part of every slab.  Must not run concurrently
+  /// with allocations.
+  void forEachUsedRange(function_ref<void(char *, char *)> Fn);
+
+  /// Never reused, so that a stale entry in the per-thread lookup cache of a
+  /// destroyed allocator never matches a new one.
+  const uint64_t ID;
+  const size_t SlabSize;
+  const size_t SizeThreshold;
+
+  /// The number of bytes to put between allocations when running under
+  /// a sanitizer.
+  size_t RedZoneSize = 1;
+
+  /// Guards everything below.
+  mutable std::mutex PoolMutex;
+  std::vector<SlabInfo> Slabs;
+  std::vector<SlabInfo> CustomSizedSlabs;
+  std::vector<std::unique_ptr<ThreadState>> ThreadStates;
+  DenseMap<uint64_t, ThreadState *> ThreadStateMap;
+
+  template <typename T> friend class SpecificConcurrentBumpPtrAllocator;
+};
+
+/// A ConcurrentBumpPtrAllocator that allows only elements of a specific type
+/// to be allocated.
+///
+/// This allows calling the destructor in DestroyAll() and when the allocator
+/// is destroyed.
+template <typename T> class SpecificConcurrentBumpPtrAllocator {
+  ConcurrentBumpPtrAllocator Allocator;
+
+public:
+  SpecificConcurrentBumpPtrAllocator() {
+    // Because SpecificConcurrentBumpPtrAllocator walks the memory to call
+    // destructors, it can't have red zones between allocations.
+    Allocator.setRedZoneSize(0);
+  }
+  ~SpecificConcurrentBumpPtrAllocator() { DestroyAll(); }
+
+  /// Call the destructor of each allocated object and deallocate all but the
+  /// current slab of each thread, freeing all memory allocated so far.  Must
+  /// not run concurrently with allocations.
+  void DestroyAll() {
+    Allocator.forEachUsedRange([](char *Begin, char *End) {
+      Begin = (char *)alignAddr(Begin, alignof(T));
+      for (char *Ptr = Begin; Ptr + sizeof(T) <= End; Ptr += sizeof(T))
+        reinterpret_cast<T *>(Ptr)->~T();
+    });
+    Allocator.Reset();
+  }
+
+  /// Allocate space for an array of objects without constructing them.  May
+  /// be called from several threads at once.
+  T *Allocate(size_t num = 1) { return Allocator.Allocate<T>(num); }
+
+  std::vector<ConcurrentBumpPtrAllocator::ThreadStatistics>
+  getThreadStatistics() const {
+    return Allocator.getThreadStatistics();
+  }
+};
+
+} // end namespace llvm
+
+inline void *operator new(size_t Size,
+                          llvm::ConcurrentBumpPtrAllocator &Allocator) {
+  struct S {
+    char c;
+    union {
+      double D;
+      long double LD;
+      long long L;
+      void *P;
+    } x;
+  };
+  return Allocator.Allocate(
+      Size, std::min((size_t)llvm::NextPowerOf2(Size), offsetof(S, x)));
+}
+
+inline void operator delete(void *, llvm::ConcurrentBumpPtrAllocator &) {}
+
+#endif // LLVM_SUPPORT_CONCURRENTBUMPPTRALLOCATOR_H
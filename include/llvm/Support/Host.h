@@ -37,6 +37,17 @@
 
 #include <string>
 
+/// \macro LLVM_X86_TARGET_DISPATCH
+/// Whether functions can be compiled with __attribute__((target)) for x86
+/// extensions beyond the ones of the rest of the file, to be selected at run
+/// time with sys::hasHostCPUFeature.
+#if (defined(__x86_64__) || defined(__i386__)) &&                             \
+    (defined(__GNUC__) || defined(__clang__))
+#define LLVM_X86_TARGET_DISPATCH 1
+#else
+#define LLVM_X86_TARGET_DISPATCH 0
+#endif
+
 namespace llvm {
 namespace sys {
 
@@ -80,6 +91,21 @@ constexpr bool IsBigEndianHost = false;
   /// \return - True on success.
   bool getHostCPUFeatures(StringMap<bool> &Features);
 
+  /// Return true if the host CPU supports \p Feature, an LLVM feature name as
+  /// returned by getHostCPUFeatures.  The features are only queried once, so
+  /// this is cheap enough to select between implementations at run time.
+  bool hasHostCPUFeature(StringRef Feature);
+
+  /// Return false if code that selects an implementation at run time with
+  /// hasHostCPUFeature, see LLVM_X86_TARGET_DISPATCH, has to use its portable
+  /// implementation.
+  bool isTargetDispatchEnabled();
+
+  /// Make code that selects an implementation at run time use its portable
+  /// implementation, whatever the host supports, or allow the vector ones
+  /// again.  Both compute the same results, which lets tests compare them.
+  void setTargetDispatchEnabled(bool Enabled);
+
   /// Get the number of physical cores (as opposed to logical cores returned
   /// from thread::hardware_concurrency(), which includes hyperthreads).
   /// Returns -1 if unknown for the current host system.
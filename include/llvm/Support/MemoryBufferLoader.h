@@ -0,0 +1,79 @@
+//===- MemoryBufferLoader.h - Concurrent MemoryBuffer loading ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the MemoryBufferLoader class, which reads batches of
+// files into MemoryBuffers in the background.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_MEMORYBUFFERLOADER_H
+#define LLVM_SUPPORT_MEMORYBUFFERLOADER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// Loads files into MemoryBuffers on a pool of threads.
+///
+/// Each file is opened, given a readahead hint and mapped (or read) by
+/// MemoryBuffer::getOpenFile, and the pages of a mapped file are faulted in
+/// before its future becomes ready.  Files are started in the order they are
+/// requested, so a tool which loads all of its inputs up front can work on
+/// the first ones while the later ones are still being read.  This pays off
+/// most when I/O latency dominates, as with cold caches or network file
+/// systems.
+///
+/// Without LLVM_ENABLE_THREADS, files are loaded synchronously by load().
+class MemoryBufferLoader {
+public:
+  using BufferOrError = ErrorOr<std::unique_ptr<MemoryBuffer>>;
+
+  /// Create a loader which reads up to \p ThreadCount files at a time.  The
+  /// default of 0 uses twice the hardware concurrency, since the threads
+  /// mostly wait for I/O.  The threads are started by the first request, and
+  /// a first loadAll() starts no more threads than it has files.  Callers
+  /// which keep a window of load() requests in flight should pass the size
+  /// of the window.
+  explicit MemoryBufferLoader(unsigned ThreadCount = 0);
+
+  /// Wait for all loads to finish.
+  ~MemoryBufferLoader();
+
+  /// Start loading \p Filename.  The arguments are as for
+  /// MemoryBuffer::getFile.
+  std::future<BufferOrError> load(const Twine &Filename,
+                                  bool RequiresNullTerminator = true,
+                                  bool IsVolatile = false);
+
+  /// Start loading each of \p Filenames, in order.
+  std::vector<std::future<BufferOrError>>
+  loadAll(ArrayRef<std::string> Filenames, bool RequiresNullTerminator = true,
+          bool IsVolatile = false);
+
+private:
+  /// Return the pool, starting it with at most \p NumFiles threads if this
+  /// is the first request.
+  ThreadPool &getPool(size_t NumFiles);
+
+  unsigned ThreadCount;
+  std::mutex PoolLock;
+  std::unique_ptr<ThreadPool> Pool;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_MEMORYBUFFERLOADER_H
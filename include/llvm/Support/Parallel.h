@@ -14,6 +14,7 @@
 #include "llvm/Support/MathExtras.h"
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -41,6 +42,21 @@ struct is_execution_policy
 constexpr sequential_execution_policy seq{};
 constexpr parallel_execution_policy par{};
 
+/// Counters of the default executor, summed over all threads since the
+/// start of the process.  Diff two snapshots to measure a region.
+struct ExecutorStatistics {
+  /// Tasks run, either by a worker or by a thread waiting for a TaskGroup.
+  uint64_t TasksRun = 0;
+  /// Tasks taken from the queue of another thread.
+  uint64_t Steals = 0;
+  /// Time workers spent asleep because there was nothing to run.
+  uint64_t IdleNanoseconds = 0;
+};
+
+/// Return the counters of the default executor.  They are all zero if LLVM
+/// was built without threads.
+ExecutorStatistics getExecutorStatistics();
+
 namespace detail {
 
 #if LLVM_ENABLE_THREADS
@@ -71,17 +87,22 @@ public:
   }
 };
 
+/// A group of tasks run by the default executor.
+///
+/// Tasks spawned from a worker thread go to the queue of that worker, from
+/// where idle workers steal them.  sync() runs queued tasks on the calling
+/// thread until the group is done, so TaskGroups nest without tying up the
+/// thread that waits for them.
 class TaskGroup {
-  Latch L;
-  bool Parallel;
+  std::atomic<size_t> Pending{0};
 
 public:
-  TaskGroup();
+  TaskGroup() = default;
   ~TaskGroup();
 
   void spawn(std::function<void()> f);
 
-  void sync() const { L.sync(); }
+  void sync() const;
 };
 
 #if defined(_MSC_VER)
@@ -19,24 +19,37 @@
 #include <future>
 
 #include <atomic>
+#include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
+class ThreadPoolTaskGroup;
+
+/// Scheduling priority of a ThreadPool task.  Queued tasks of a higher
+/// priority run before those of a lower one, in submission order within a
+/// priority.  Tasks that are already running are never preempted.
+enum class ThreadPoolPriority { Low, Normal, High };
+
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
 /// The pool keeps a vector of threads alive, waiting on a condition variable
 /// for some work to become available.
 class ThreadPool {
+  /// Result type of calling \p Function with \p Args.
+  template <typename Function, typename... Args>
+  using TaskResultTy = decltype(
+      std::bind(std::declval<Function>(), std::declval<Args>()...)());
+
 public:
   using TaskTy = std::function<void()>;
-  using PackagedTaskTy = std::packaged_task<void()>;
 
   /// Construct a pool with the number of threads found by
   /// hardware_concurrency().
@@ -49,52 +62,171 @@ public:
   ~ThreadPool();
 
   /// Asynchronous submission of a task to the pool. The returned future can be
-  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  /// used to wait for the task to finish and get its result, and is
+  /// *non-blocking* on destruction.
   template <typename Function, typename... Args>
-  inline std::shared_future<void> async(Function &&F, Args &&... ArgList) {
-    auto Task =
-        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
-    return asyncImpl(std::move(Task));
+  std::shared_future<TaskResultTy<Function, Args...>>
+  async(Function &&F, Args &&... ArgList) {
+    return async(ThreadPoolPriority::Normal, std::forward<Function>(F),
+                 std::forward<Args>(ArgList)...);
   }
 
-  /// Asynchronous submission of a task to the pool. The returned future can be
-  /// used to wait for the task to finish and is *non-blocking* on destruction.
-  template <typename Function>
-  inline std::shared_future<void> async(Function &&F) {
-    return asyncImpl(std::forward<Function>(F));
+  /// Like async(F, Args...), but queue the task at priority \p Priority.
+  template <typename Function, typename... Args>
+  std::shared_future<TaskResultTy<Function, Args...>>
+  async(ThreadPoolPriority Priority, Function &&F, Args &&... ArgList) {
+    std::function<TaskResultTy<Function, Args...>()> Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return asyncImpl(std::move(Task), nullptr, Priority);
   }
 
+  /// Like async(F, Args...), but add the task to \p Group, at the priority of
+  /// the group.
+  template <typename Function, typename... Args>
+  std::shared_future<TaskResultTy<Function, Args...>>
+  async(ThreadPoolTaskGroup &Group, Function &&F, Args &&... ArgList);
+
   /// Blocking wait for all the threads to complete and the queue to be empty.
   /// It is an error to try to add new tasks while blocking on this call.
   void wait();
 
+  /// Blocking wait for all the tasks of \p Group to complete.  Tasks of
+  /// other groups may still be queued or running when this returns.  When
+  /// called from a thread of this pool, the waiting thread runs the queued
+  /// tasks of the group itself instead of blocking.
+  void wait(ThreadPoolTaskGroup &Group);
+
 private:
+  struct QueuedTask {
+    TaskTy Fn;
+    ThreadPoolTaskGroup *Group;
+  };
+
   /// Asynchronous submission of a task to the pool. The returned future can be
   /// used to wait for the task to finish and is *non-blocking* on destruction.
-  std::shared_future<void> asyncImpl(TaskTy F);
+  template <typename ResTy>
+  std::shared_future<ResTy> asyncImpl(std::function<ResTy()> Task,
+                                      ThreadPoolTaskGroup *Group,
+                                      ThreadPoolPriority Priority) {
+#if LLVM_ENABLE_THREADS
+    /// Wrap the Task in a packaged_task to return a future object.
+    auto PackagedTask =
+        std::make_shared<std::packaged_task<ResTy()>>(std::move(Task));
+    auto Future = PackagedTask->get_future().share();
+    enqueue([PackagedTask] { (*PackagedTask)(); }, Group, Priority);
+    return Future;
+#else
+    // Get a Future with launch::deferred execution using std::async
+    auto Future = std::async(std::launch::deferred, std::move(Task)).share();
+    // Wrap the future so that both ThreadPool::wait() can operate and the
+    // returned future can be sync'ed on.
+    enqueue([Future] { Future.wait(); }, Group, Priority);
+    return Future;
+#endif
+  }
+
+  /// Queue \p Task, which belongs to \p Group if not null.
+  void enqueue(TaskTy Task, ThreadPoolTaskGroup *Group,
+               ThreadPoolPriority Priority);
+
+  /// Pop the next task to run, or the next one of \p Group if not null.
+  /// Returns false if there is none.  QueueLock must be held.
+  bool popTask(QueuedTask &Task, ThreadPoolTaskGroup *Group);
+
+  /// Run \p Task and update the counters.  QueueLock must be held on entry
+  /// and is held on exit, but not while the task runs.
+  void runTask(QueuedTask &Task, std::unique_lock<std::mutex> &Lock);
+
+  /// Return true if a task is queued.  QueueLock must be held.
+  bool hasQueuedTasks() const;
+
+  /// Return true if the calling thread is one of the pool.
+  bool isWorkerThread() const;
 
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
+  /// Tasks waiting for execution in the pool, per priority.
+  std::deque<QueuedTask> Tasks[3];
 
-  /// Locking and signaling for accessing the Tasks queue.
+  /// Locking and signaling for accessing the Tasks queue.  The lock also
+  /// guards ActiveThreads and the counters of the task groups.
   std::mutex QueueLock;
   std::condition_variable QueueCondition;
 
-  /// Locking and signaling for job completion
-  std::mutex CompletionLock;
+  /// Signaling for job completion
   std::condition_variable CompletionCondition;
 
   /// Keep track of the number of thread actually busy
-  std::atomic<unsigned> ActiveThreads;
+  unsigned ActiveThreads = 0;
 
 #if LLVM_ENABLE_THREADS // avoids warning for unused variable
   /// Signal for the destruction of the pool, asking thread to exit.
   bool EnableFlag;
 #endif
 };
+
+/// A group of tasks of a ThreadPool that can be waited for and cancelled
+/// separately from the other tasks of the pool.
+///
+/// Cancellation is cooperative: cancel() only raises a flag that the tasks
+/// of the group poll with isCancelled() to return early.  Tasks queued after
+/// the cancellation still run, so their futures are always satisfied.
+class ThreadPoolTaskGroup {
+public:
+  explicit ThreadPoolTaskGroup(
+      ThreadPool &Pool, ThreadPoolPriority Priority = ThreadPoolPriority::Normal)
+      : Pool(Pool), Priority(Priority) {}
+
+  /// Blocking destructor: waits for all the tasks of the group.
+  ~ThreadPoolTaskGroup() { wait(); }
+
+  ThreadPoolTaskGroup(const ThreadPoolTaskGroup &) = delete;
+  ThreadPoolTaskGroup &operator=(const ThreadPoolTaskGroup &) = delete;
+
+  /// Calls ThreadPool::async() for this group.
+  template <typename Function, typename... Args>
+  auto async(Function &&F, Args &&... ArgList)
+      -> decltype(std::declval<ThreadPool &>().async(
+          std::declval<ThreadPoolTaskGroup &>(), std::forward<Function>(F),
+          std::forward<Args>(ArgList)...)) {
+    return Pool.async(*this, std::forward<Function>(F),
+                      std::forward<Args>(ArgList)...);
+  }
+
+  /// Calls ThreadPool::wait() for this group.
+  void wait() { Pool.wait(*this); }
+
+  /// Ask the tasks of the group to stop.
+  void cancel() { Cancelled.store(true, std::memory_order_relaxed); }
+
+  /// Return true once cancel() has been called.
+  bool isCancelled() const {
+    return Cancelled.load(std::memory_order_relaxed);
+  }
+
+  ThreadPoolPriority getPriority() const { return Priority; }
+
+private:
+  friend class ThreadPool;
+
+  ThreadPool &Pool;
+  ThreadPoolPriority Priority;
+  std::atomic<bool> Cancelled{false};
+  /// Queued and running tasks, guarded by the lock of the pool.
+  unsigned Pending = 0;
+};
+
+template <typename Function, typename... Args>
+std::shared_future<ThreadPool::TaskResultTy<Function, Args...>>
+ThreadPool::async(ThreadPoolTaskGroup &Group, Function &&F,
+                  Args &&... ArgList) {
+  assert(&Group.Pool == this && "Task group of another pool");
+  std::function<TaskResultTy<Function, Args...>()> Task =
+      std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+  return asyncImpl(std::move(Task), &Group, Group.getPriority());
 }
 
+} // namespace llvm
+
 #endif // LLVM_SUPPORT_THREAD_POOL_H
@@ -18,9 +18,16 @@ extern TimeTraceProfiler *TimeTraceProfilerInstance;
 
 /// Initialize the time trace profiler.
 /// This sets up the global \p TimeTraceProfilerInstance
-/// variable to be the profiler instance.
+/// variable to be the profiler instance.  Every thread that begins a time
+/// section afterwards records to its own buffer, so the profiler can be used
+/// from several threads at once.
 void timeTraceProfilerInitialize();
 
+/// Initialize the time trace profiler to keep the sections longer than
+/// \p Granularity microseconds, and at most \p BufferSize of them per thread,
+/// instead of following -time-trace-granularity and -time-trace-buffer-size.
+void timeTraceProfilerInitialize(unsigned Granularity, unsigned BufferSize);
+
 /// Cleanup the time trace profiler, if it was initialized.
 void timeTraceProfilerCleanup();
 
@@ -29,11 +36,18 @@ inline bool timeTraceProfilerEnabled() {
   return TimeTraceProfilerInstance != nullptr;
 }
 
-/// Write profiling data to output file.
+/// Write profiling data to output file, with one track per thread.  All
+/// sections of all threads must have ended.
 /// Data produced is JSON, in Chrome "Trace Event" format, see
 /// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview
 void timeTraceProfilerWrite(raw_pwrite_stream &OS);
 
+/// Return the number of bytes the profiler holds for the sections recorded
+/// so far, summed over all threads.  Each thread keeps at most
+/// -time-trace-buffer-size sections, so this stays bounded however long the
+/// profiler runs.  No thread may be recording while this is called.
+size_t timeTraceProfilerMemoryUsage();
+
 /// Manually begin a time section, with the given \p Name and \p Detail.
 /// Profiler copies the string data, so the pointers can be given into
 /// temporaries. Time sections can be hierarchical; every Begin must have a
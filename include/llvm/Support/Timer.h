@@ -28,20 +28,41 @@ class TimeRecord {
   double UserTime;       ///< User time elapsed.
   double SystemTime;     ///< System time elapsed.
   ssize_t MemUsed;       ///< Memory allocated (in bytes).
+  uint64_t Cycles;       ///< CPU cycles, with -track-perf-counters.
+  uint64_t Instructions; ///< Instructions retired, with -track-perf-counters.
+  uint64_t CacheMisses;  ///< Last level cache misses.
+  uint64_t BranchMisses; ///< Mispredicted branches.
+  /// Nanoseconds the perf counters were enabled and running.  Only set
+  /// between getCurrentTime() and scalePerfCounters().
+  uint64_t PerfTimeEnabled;
+  uint64_t PerfTimeRunning;
 public:
-  TimeRecord() : WallTime(0), UserTime(0), SystemTime(0), MemUsed(0) {}
+  TimeRecord()
+      : WallTime(0), UserTime(0), SystemTime(0), MemUsed(0), Cycles(0),
+        Instructions(0), CacheMisses(0), BranchMisses(0), PerfTimeEnabled(0),
+        PerfTimeRunning(0) {}
 
   /// Get the current time and memory usage.  If Start is true we get the memory
   /// usage before the time, otherwise we get time before memory usage.  This
   /// matters if the time to get the memory usage is significant and shouldn't
-  /// be counted as part of a duration.
+  /// be counted as part of a duration.  The hardware performance counters of
+  /// the calling thread are read closest to the timed region.  They are raw
+  /// counts; subtract two readings, then call scalePerfCounters().
   static TimeRecord getCurrentTime(bool Start = true);
 
+  /// Scale the perf counter deltas of this record up to the whole interval
+  /// if the kernel multiplexed the counters for part of it.
+  void scalePerfCounters();
+
   double getProcessTime() const { return UserTime + SystemTime; }
   double getUserTime() const { return UserTime; }
   double getSystemTime() const { return SystemTime; }
   double getWallTime() const { return WallTime; }
   ssize_t getMemUsed() const { return MemUsed; }
+  uint64_t getCycles() const { return Cycles; }
+  uint64_t getInstructions() const { return Instructions; }
+  uint64_t getCacheMisses() const { return CacheMisses; }
+  uint64_t getBranchMisses() const { return BranchMisses; }
 
   bool operator<(const TimeRecord &T) const {
     // Sort by Wall Time elapsed, as it is the only thing really accurate
@@ -49,16 +70,28 @@ public:
   }
 
   void operator+=(const TimeRecord &RHS) {
-    WallTime   += RHS.WallTime;
-    UserTime   += RHS.UserTime;
-    SystemTime += RHS.SystemTime;
-    MemUsed    += RHS.MemUsed;
+    WallTime     += RHS.WallTime;
+    UserTime     += RHS.UserTime;
+    SystemTime   += RHS.SystemTime;
+    MemUsed      += RHS.MemUsed;
+    Cycles       += RHS.Cycles;
+    Instructions += RHS.Instructions;
+    CacheMisses  += RHS.CacheMisses;
+    BranchMisses += RHS.BranchMisses;
+    PerfTimeEnabled += RHS.PerfTimeEnabled;
+    PerfTimeRunning += RHS.PerfTimeRunning;
   }
   void operator-=(const TimeRecord &RHS) {
-    WallTime   -= RHS.WallTime;
-    UserTime   -= RHS.UserTime;
-    SystemTime -= RHS.SystemTime;
-    MemUsed    -= RHS.MemUsed;
+    WallTime     -= RHS.WallTime;
+    UserTime     -= RHS.UserTime;
+    SystemTime   -= RHS.SystemTime;
+    MemUsed      -= RHS.MemUsed;
+    Cycles       -= RHS.Cycles;
+    Instructions -= RHS.Instructions;
+    CacheMisses  -= RHS.CacheMisses;
+    BranchMisses -= RHS.BranchMisses;
+    PerfTimeEnabled -= RHS.PerfTimeEnabled;
+    PerfTimeRunning -= RHS.PerfTimeRunning;
   }
 
   /// Print the current time record to \p OS, with a breakdown showing
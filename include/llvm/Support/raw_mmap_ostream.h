@@ -0,0 +1,101 @@
+//===- raw_mmap_ostream.h - Memory-mapped file output stream ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the raw_mmap_ostream class, a raw_pwrite_stream that
+// writes into a memory mapping of its output file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_RAW_MMAP_OSTREAM_H
+#define LLVM_SUPPORT_RAW_MMAP_OSTREAM_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <system_error>
+
+namespace llvm {
+
+/// A raw_pwrite_stream that writes to a file through a growable memory
+/// mapping.
+///
+/// The stream's buffer is the mapping itself, so data is copied once, from
+/// the writer straight into the page cache, and is never held in a separate
+/// heap buffer.  The file grows by doubling the mapping as needed and is
+/// truncated to the size written when the stream is closed.
+///
+/// Only regular files can be mapped.  If the output is anything else, such as
+/// a pipe or /dev/null, the constructor fails with errc::not_supported and
+/// the caller is expected to fall back to raw_fd_ostream.
+class raw_mmap_ostream : public raw_pwrite_stream {
+  int FD = -1;
+  std::unique_ptr<sys::fs::mapped_file_region> Region;
+
+  /// The position of the start of the stream's buffer in the file.
+  uint64_t Pos = 0;
+
+  /// The size of the file when it is closed: the end of the data written
+  /// furthest into the file.
+  uint64_t End = 0;
+
+  std::error_code EC;
+
+  /// See raw_ostream::write_impl.
+  void write_impl(const char *Ptr, size_t Size) override;
+
+  void pwrite_impl(const char *Ptr, size_t Size, uint64_t Offset) override;
+
+  /// Return the current position within the stream, not counting the bytes
+  /// currently in the buffer.
+  uint64_t current_pos() const override { return Pos; }
+
+  /// Grow the mapping to at least \p Size bytes.
+  std::error_code reserve(uint64_t Size);
+
+  /// Point the stream's buffer at the mapping from Pos on.
+  void resetBuffer();
+
+  void error_detected(std::error_code EC) { this->EC = EC; }
+
+public:
+  /// Open \p Filename for writing, truncating it, and map it.
+  ///
+  /// \param EC - Set to errc::not_supported if the file is not a regular
+  /// file, or to the error which occurred while opening or mapping it.
+  raw_mmap_ostream(StringRef Filename, std::error_code &EC);
+
+  ~raw_mmap_ostream() override;
+
+  /// Unmap the file, truncate it to the size written and close it.  The
+  /// stream must not be written to afterwards.
+  void close();
+
+  /// Move the write position to \p Off, which may be past the end of the
+  /// data written so far.  Return the new position.
+  uint64_t seek(uint64_t Off);
+
+  /// Return the data written so far.  The result is invalidated by further
+  /// writes.
+  StringRef getWrittenData();
+
+  /// Return the value of the flag in this raw_mmap_ostream indicating whether
+  /// an output error has been encountered.
+  bool has_error() const { return bool(EC); }
+
+  std::error_code error() const { return EC; }
+
+  /// Set the flag read by has_error() to false.  If the error flag is set at
+  /// the time when this raw_ostream's destructor is called,
+  /// report_fatal_error is called to report the error.
+  void clear_error() { EC = std::error_code(); }
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_RAW_MMAP_OSTREAM_H
@@ -49,6 +49,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
@@ -75,6 +76,15 @@ cl::opt<std::string> ModuleSummaryDotFile(
     cl::value_desc("filename"),
     cl::desc("File to emit dot graph of new summary into."));
 
+// Return a ValueInfo for GV, which refers to GV if the index keeps the IR and
+// only names it otherwise.
+static ValueInfo getOrInsertValueInfo(ModuleSummaryIndex &Index,
+                                      const GlobalValue *GV) {
+  if (Index.haveGVs())
+    return Index.getOrInsertValueInfo(GV);
+  return Index.getOrInsertValueInfo(GV->getGUID(), GV->getName());
+}
+
 // Walk through the operands of a given User via worklist iteration and populate
 // the set of GlobalValue references encountered. Invoked either on an
 // Instruction or a GlobalVariable (which walks its initializer).
@@ -113,7 +123,7 @@ static bool findRefEdges(ModuleSummaryIndex &Index, const User *CurUser,
         // the reference set unless it is a callee. Callees are handled
         // specially by WriteFunction and are added to a separate list.
         if (!(CS && CS.isCallee(&OI)))
-          RefEdges.insert(Index.getOrInsertValueInfo(GV));
+          RefEdges.insert(getOrInsertValueInfo(Index, GV));
         continue;
       }
       Worklist.push_back(Operand);
@@ -320,8 +330,8 @@ static void computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
         // to record the call edge to the alias in that case. Eventually
         // an alias summary will be created to associate the alias and
         // aliasee.
-        auto &ValueInfo = CallGraphEdges[Index.getOrInsertValueInfo(
-            cast<GlobalValue>(CalledValue))];
+        auto &ValueInfo = CallGraphEdges[getOrInsertValueInfo(
+            Index, cast<GlobalValue>(CalledValue))];
         ValueInfo.updateHotness(Hotness);
         // Add the relative block frequency to CalleeInfo if there is no profile
         // information.
@@ -346,7 +356,7 @@ static void computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
           for (auto &Op : MD->operands()) {
             Function *Callee = mdconst::extract_or_null<Function>(Op);
             if (Callee)
-              CallGraphEdges[Index.getOrInsertValueInfo(Callee)];
+              CallGraphEdges[getOrInsertValueInfo(Index, Callee)];
           }
         }
 
@@ -407,7 +417,8 @@ static void computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
       TypeCheckedLoadConstVCalls.takeVector());
   if (NonRenamableLocal)
     CantBePromoted.insert(F.getGUID());
-  Index.addGlobalValueSummary(F, std::move(FuncSummary));
+  Index.addGlobalValueSummary(getOrInsertValueInfo(Index, &F),
+                              std::move(FuncSummary));
 }
 
 static void
@@ -430,7 +441,8 @@ computeVariableSummary(ModuleSummaryIndex &Index, const GlobalVariable &V,
     CantBePromoted.insert(V.getGUID());
   if (HasBlockAddress)
     GVarSummary->setNotEligibleToImport();
-  Index.addGlobalValueSummary(V, std::move(GVarSummary));
+  Index.addGlobalValueSummary(getOrInsertValueInfo(Index, &V),
+                              std::move(GVarSummary));
 }
 
 static void
@@ -448,7 +460,7 @@ computeAliasSummary(ModuleSummaryIndex &Index, const GlobalAlias &A,
   AS->setAliasee(AliaseeVI, AliaseeVI.getSummaryList()[0].get());
   if (NonRenamableLocal)
     CantBePromoted.insert(A.getGUID());
-  Index.addGlobalValueSummary(A, std::move(AS));
+  Index.addGlobalValueSummary(getOrInsertValueInfo(Index, &A), std::move(AS));
 }
 
 // Set LiveRoot flag on entries matching the given value name.
@@ -458,16 +470,16 @@ static void setLiveRoot(ModuleSummaryIndex &Index, StringRef Name) {
       Summary->setLive(true);
 }
 
-ModuleSummaryIndex llvm::buildModuleSummaryIndex(
+static Expected<ModuleSummaryIndex> computeModuleSummaryIndex(
     const Module &M,
     std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
-    ProfileSummaryInfo *PSI) {
+    ProfileSummaryInfo *PSI, bool HaveGVs) {
   assert(PSI);
   bool EnableSplitLTOUnit = false;
   if (auto *MD = mdconst::extract_or_null<ConstantInt>(
           M.getModuleFlag("EnableSplitLTOUnit")))
     EnableSplitLTOUnit = MD->getZExtValue();
-  ModuleSummaryIndex Index(/*HaveGVs=*/true, EnableSplitLTOUnit);
+  ModuleSummaryIndex Index(HaveGVs, EnableSplitLTOUnit);
 
   // Identify the local values in the llvm.used and llvm.compiler.used sets,
   // which should not be exported as they would then require renaming and
@@ -533,13 +545,15 @@ ModuleSummaryIndex llvm::buildModuleSummaryIndex(
                     ArrayRef<FunctionSummary::VFuncId>{},
                     ArrayRef<FunctionSummary::ConstVCall>{},
                     ArrayRef<FunctionSummary::ConstVCall>{});
-            Index.addGlobalValueSummary(*GV, std::move(Summary));
+            Index.addGlobalValueSummary(getOrInsertValueInfo(Index, GV),
+                                        std::move(Summary));
           } else {
             std::unique_ptr<GlobalVarSummary> Summary =
                 llvm::make_unique<GlobalVarSummary>(
                     GVFlags, GlobalVarSummary::GVarFlags(),
                     ArrayRef<ValueInfo>{});
-            Index.addGlobalValueSummary(*GV, std::move(Summary));
+            Index.addGlobalValueSummary(getOrInsertValueInfo(Index, GV),
+                                        std::move(Summary));
           }
         });
   }
@@ -555,6 +569,11 @@ ModuleSummaryIndex llvm::buildModuleSummaryIndex(
     if (F.isDeclaration())
       continue;
 
+    // Read the body if the module is read lazily. A paged module may drop it
+    // again as later functions are read, once it has been summarized.
+    if (Error Err = const_cast<Function &>(F).materialize())
+      return std::move(Err);
+
     DominatorTree DT(const_cast<Function &>(F));
     BlockFrequencyInfo *BFI = nullptr;
     std::unique_ptr<BlockFrequencyInfo> BFIPtr;
@@ -641,7 +660,25 @@ ModuleSummaryIndex llvm::buildModuleSummaryIndex(
     Index.exportToDot(OSDot);
   }
 
-  return Index;
+  return std::move(Index);
+}
+
+ModuleSummaryIndex llvm::buildModuleSummaryIndex(
+    const Module &M,
+    std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
+    ProfileSummaryInfo *PSI) {
+  // The function bodies of a materialized module have all been read, so
+  // there is nothing left to fail.
+  return cantFail(computeModuleSummaryIndex(M, std::move(GetBFICallback), PSI,
+                                            /*HaveGVs=*/true));
+}
+
+Expected<ModuleSummaryIndex> llvm::buildModuleSummaryIndexFromLazyModule(
+    const Module &M,
+    std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
+    ProfileSummaryInfo *PSI) {
+  return computeModuleSummaryIndex(M, std::move(GetBFICallback), PSI,
+                                   /*HaveGVs=*/false);
 }
 
 AnalysisKey ModuleSummaryIndexAnalysis::Key;
@@ -286,6 +286,10 @@ bool TargetTransformInfo::enableMaskedInterleavedAccessVectorization() const {
   return TTIImpl->enableMaskedInterleavedAccessVectorization();
 }
 
+bool TargetTransformInfo::preferPredicateOverEpilogue(Loop *L) const {
+  return TTIImpl->preferPredicateOverEpilogue(L);
+}
+
 bool TargetTransformInfo::isFPVectorizationPotentiallyUnsafe() const {
   return TTIImpl->isFPVectorizationPotentiallyUnsafe();
 }
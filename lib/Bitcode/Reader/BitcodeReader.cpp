@@ -15,6 +15,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -70,12 +71,14 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
@@ -92,6 +95,11 @@ static cl::opt<bool> PrintSummaryGUIDs(
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> BitcodeDecodeThreads(
+    "bitcode-decode-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of threads decoding function blocks ahead of the reader "
+             "when a whole module is materialized (0 = none)"));
+
 namespace {
 
 enum {
@@ -437,6 +445,61 @@ BitcodeReaderBase::readNameFromStrtab(ArrayRef<uint64_t> Record) {
 
 namespace {
 
+/// The top-level entries of a FUNCTION_BLOCK, decoded from the bitstream
+/// ahead of parseFunctionBody().  Records are kept with their operands.
+/// Anything else (sub-blocks, the end of the block, malformed input) is kept
+/// as the bit position of its abbrev ID, for the reader to seek to and handle
+/// as if it had come across it in the stream.
+struct DecodedFunctionBlock {
+  struct Entry {
+    bool IsRecord;
+    /// The record code, or the bit position to seek to.
+    uint64_t CodeOrBitNo;
+    /// The operands of a record, as a range of Ops.
+    size_t OpsBegin, OpsEnd;
+  };
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+};
+
+} // end anonymous namespace
+
+/// Decode the function block at \p BitNo in \p Cursor.  This only reads the
+/// bitstream, so it can run concurrently with the reader that owns the
+/// stream.  Errors are left for parseFunctionBody() to report.
+static void decodeFunctionBlock(BitstreamCursor &Cursor, uint64_t BitNo,
+                                DecodedFunctionBlock &Block) {
+  Cursor.JumpToBit(BitNo);
+  if (Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+    return;
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    uint64_t EntryBitNo = Cursor.GetCurrentBitNo();
+    BitstreamEntry Entry =
+        Cursor.advance(BitstreamCursor::AF_DontPopBlockAtEnd |
+                       BitstreamCursor::AF_DontAutoprocessAbbrevs);
+    if (Entry.Kind != BitstreamEntry::Record) {
+      Block.Entries.push_back({false, EntryBitNo, 0, 0});
+      if (Entry.Kind != BitstreamEntry::SubBlock || Cursor.SkipBlock())
+        return;
+      continue;
+    }
+    if (Entry.ID == bitc::DEFINE_ABBREV) {
+      Cursor.ReadAbbrevRecord();
+      continue;
+    }
+
+    Record.clear();
+    unsigned Code = Cursor.readRecord(Entry.ID, Record);
+    size_t OpsBegin = Block.Ops.size();
+    Block.Ops.insert(Block.Ops.end(), Record.begin(), Record.end());
+    Block.Entries.push_back({true, Code, OpsBegin, Block.Ops.size()});
+  }
+}
+
+namespace {
+
 class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule = nullptr;
@@ -493,6 +556,23 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// Function blocks being decoded on other threads ahead of
+  /// materializeModule().  See -bitcode-decode-threads.
+  DenseMap<Function *,
+           std::shared_future<std::shared_ptr<const DecodedFunctionBlock>>>
+      DecodingFunctionBlocks;
+
+  /// In paging mode, the estimated size of the function bodies that may be
+  /// kept before older ones are dropped; 0 if bodies are never dropped.
+  uint64_t MaterializedBudget = 0;
+
+  /// The functions whose bodies may be dropped in paging mode, least recently
+  /// materialized first, with the estimated sizes of their bodies.
+  using PagedFunctionList = std::list<std::pair<Function *, uint64_t>>;
+  PagedFunctionList PagedFunctions;
+  DenseMap<Function *, PagedFunctionList::iterator> PagedFunctionMap;
+  uint64_t PagedSize = 0;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -530,6 +610,7 @@ public:
 
   Error materialize(GlobalValue *GV) override;
   Error materializeModule() override;
+  void setMaterializedBudget(uint64_t Budget) { MaterializedBudget = Budget; }
   std::vector<StructType *> getIdentifiedStructTypes() const override;
 
   /// Main interface to parsing a bitcode buffer.
@@ -670,7 +751,11 @@ private:
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   Error rememberAndSkipMetadata();
   Error typeCheckLoadStoreInst(Type *ValType, Type *PtrType);
-  Error parseFunctionBody(Function *F);
+  Error parseFunctionBody(Function *F,
+                          const DecodedFunctionBlock *Decoded = nullptr);
+  void decodeFunctionBlockAsync(ThreadPool &Pool, Function *F);
+  void addPagedFunction(Function *F);
+  void dropPagedFunctionBodies(Function *Keep);
   Error globalCleanup();
   Error resolveGlobalAndIndirectSymbolInits();
   Error parseUseLists();
@@ -3414,8 +3499,10 @@ Error BitcodeReader::typeCheckLoadStoreInst(Type *ValType, Type *PtrType) {
   return Error::success();
 }
 
-/// Lazily parse the specified function body block.
-Error BitcodeReader::parseFunctionBody(Function *F) {
+/// Lazily parse the specified function body block.  If \p Decoded is given,
+/// the records of the block have already been read from the stream.
+Error BitcodeReader::parseFunctionBody(Function *F,
+                                       const DecodedFunctionBlock *Decoded) {
   if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return error("Invalid record");
 
@@ -3449,9 +3536,22 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
 
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
+  size_t NextDecoded = 0;
 
   while (true) {
-    BitstreamEntry Entry = Stream.advance();
+    BitstreamEntry Entry;
+    const DecodedFunctionBlock::Entry *DecodedRecord = nullptr;
+    if (!Decoded) {
+      Entry = Stream.advance();
+    } else if (NextDecoded == Decoded->Entries.size()) {
+      Entry = BitstreamEntry::getError();
+    } else if (Decoded->Entries[NextDecoded].IsRecord) {
+      DecodedRecord = &Decoded->Entries[NextDecoded++];
+      Entry = BitstreamEntry::getRecord(DecodedRecord->CodeOrBitNo);
+    } else {
+      Stream.JumpToBit(Decoded->Entries[NextDecoded++].CodeOrBitNo);
+      Entry = Stream.advance();
+    }
 
     switch (Entry.Kind) {
     case BitstreamEntry::Error:
@@ -3499,7 +3599,14 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     // Read a record.
     Record.clear();
     Instruction *I = nullptr;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode;
+    if (DecodedRecord) {
+      BitCode = DecodedRecord->CodeOrBitNo;
+      Record.append(Decoded->Ops.begin() + DecodedRecord->OpsBegin,
+                    Decoded->Ops.begin() + DecodedRecord->OpsEnd);
+    } else {
+      BitCode = Stream.readRecord(Entry.ID, Record);
+    }
     switch (BitCode) {
     default: // Default behavior: reject
       return error("Invalid value");
@@ -4828,9 +4935,16 @@ SyncScope::ID BitcodeReader::getDecodedSyncScopeID(unsigned Val) {
 
 Error BitcodeReader::materialize(GlobalValue *GV) {
   Function *F = dyn_cast<Function>(GV);
-  // If it's not a function or is already material, ignore the request.
-  if (!F || !F->isMaterializable())
+  if (!F)
     return Error::success();
+  // If it's already material, ignore the request, but keep its body around
+  // longer if it is paged.
+  if (!F->isMaterializable()) {
+    auto PFI = PagedFunctionMap.find(F);
+    if (PFI != PagedFunctionMap.end())
+      PagedFunctions.splice(PagedFunctions.end(), PagedFunctions, PFI->second);
+    return Error::success();
+  }
 
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
@@ -4847,7 +4961,15 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   // Move the bit stream to the saved position of the deferred function body.
   Stream.JumpToBit(DFII->second);
 
-  if (Error Err = parseFunctionBody(F))
+  // Pick up the function block if it has been decoded ahead of time.
+  std::shared_ptr<const DecodedFunctionBlock> Decoded;
+  auto DFBI = DecodingFunctionBlocks.find(F);
+  if (DFBI != DecodingFunctionBlocks.end()) {
+    Decoded = DFBI->second.get();
+    DecodingFunctionBlocks.erase(DFBI);
+  }
+
+  if (Error Err = parseFunctionBody(F, Decoded.get()))
     return Err;
   F->setIsMaterializable(false);
 
@@ -4887,21 +5009,106 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
     }
   }
 
+  if (MaterializedBudget)
+    addPagedFunction(F);
+
   // Bring in any functions that this function forward-referenced via
   // blockaddresses.
-  return materializeForwardReferencedFunctions();
+  if (Error Err = materializeForwardReferencedFunctions())
+    return Err;
+
+  // Stay within the budget, once the functions brought in above are read.
+  if (MaterializedBudget && !WillMaterializeAllForwardRefs)
+    dropPagedFunctionBodies(F);
+  return Error::success();
+}
+
+/// Estimate the memory taken by the body of \p F.
+static uint64_t getFunctionBodySize(const Function &F) {
+  uint64_t Size = 0;
+  for (const BasicBlock &BB : F) {
+    Size += sizeof(BasicBlock);
+    for (const Instruction &I : BB)
+      Size += sizeof(Instruction) + I.getNumOperands() * sizeof(Use);
+  }
+  return Size;
+}
+
+/// Return true if the blocks of \p F are referenced from outside its body,
+/// which would be left dangling if the body were dropped.
+static bool hasAddressTakenBlock(const Function &F) {
+  return any_of(F, [](const BasicBlock &BB) { return BB.hasAddressTaken(); });
+}
+
+/// Record the body of \p F, just materialized, as the most recently used one.
+void BitcodeReader::addPagedFunction(Function *F) {
+  if (hasAddressTakenBlock(*F))
+    return;
+  uint64_t Size = getFunctionBodySize(*F);
+  PagedFunctionMap[F] =
+      PagedFunctions.insert(PagedFunctions.end(), std::make_pair(F, Size));
+  PagedSize += Size;
+}
+
+/// Drop the least recently used function bodies, other than the one of
+/// \p Keep, while the bodies kept are over the budget.  A dropped function is
+/// materializable again: its body is read anew from the stream if needed.
+void BitcodeReader::dropPagedFunctionBodies(Function *Keep) {
+  while (PagedSize > MaterializedBudget && !PagedFunctions.empty() &&
+         PagedFunctions.front().first != Keep) {
+    Function *F = PagedFunctions.front().first;
+    PagedSize -= PagedFunctions.front().second;
+    PagedFunctionMap.erase(F);
+    PagedFunctions.pop_front();
+
+    // A blockaddress may have been taken since F was read.
+    if (hasAddressTakenBlock(*F))
+      continue;
+
+    // Unlike Function::dropAllReferences, keep the prefix, prologue and
+    // personality, which are read with the module.  The attachments are read
+    // with the body, so they go with it.
+    for (BasicBlock &BB : *F)
+      BB.dropAllReferences();
+    while (!F->empty())
+      F->begin()->eraseFromParent();
+    F->clearMetadata();
+    F->setIsMaterializable(true);
+  }
 }
 
 Error BitcodeReader::materializeModule() {
   if (Error Err = materializeMetadata())
     return Err;
 
+  // Keep every body from now on.
+  MaterializedBudget = 0;
+  PagedFunctions.clear();
+  PagedFunctionMap.clear();
+  PagedSize = 0;
+
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  // Decode function blocks on other threads, a bounded number of functions
+  // ahead of the reader.  Only reading the bitstream is done in parallel: the
+  // IR is still built here, in order, so the result is the same.
+  Optional<ThreadPool> DecodePool;
+  if (BitcodeDecodeThreads)
+    DecodePool.emplace(BitcodeDecodeThreads);
+  unsigned DecodeWindow = 4 * BitcodeDecodeThreads;
+  Module::iterator NextToDecode = TheModule->begin();
+  auto ClearDecoding = make_scope_exit([&] { DecodingFunctionBlocks.clear(); });
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Function &F : *TheModule) {
+    if (DecodePool)
+      for (; NextToDecode != TheModule->end() &&
+             DecodingFunctionBlocks.size() < DecodeWindow;
+           ++NextToDecode)
+        decodeFunctionBlockAsync(*DecodePool, &*NextToDecode);
+
     if (Error Err = materialize(&F))
       return Err;
   }
@@ -4949,6 +5156,26 @@ Error BitcodeReader::materializeModule() {
   return Error::success();
 }
 
+/// Start decoding the body of \p F on \p Pool, if it is still to be read
+/// and its position in the stream is known.
+void BitcodeReader::decodeFunctionBlockAsync(ThreadPool &Pool, Function *F) {
+  if (!F->isMaterializable())
+    return;
+  uint64_t BitNo = DeferredFunctionInfo.lookup(F);
+  if (!BitNo)
+    return;
+
+  ArrayRef<uint8_t> Bytes = Stream.getBitcodeBytes();
+  BitstreamBlockInfo *Info = &BlockInfo;
+  DecodingFunctionBlocks[F] = Pool.async([=] {
+    BitstreamCursor Cursor(Bytes);
+    Cursor.setBlockInfo(Info);
+    auto Block = std::make_shared<DecodedFunctionBlock>();
+    decodeFunctionBlock(Cursor, BitNo, *Block);
+    return std::shared_ptr<const DecodedFunctionBlock>(std::move(Block));
+  });
+}
+
 std::vector<StructType *> BitcodeReader::getIdentifiedStructTypes() const {
   return IdentifiedStructTypes;
 }
@@ -5925,7 +6152,8 @@ llvm::getBitcodeFileContents(MemoryBufferRef Buffer) {
 /// everything.
 Expected<std::unique_ptr<Module>>
 BitcodeModule::getModuleImpl(LLVMContext &Context, bool MaterializeAll,
-                             bool ShouldLazyLoadMetadata, bool IsImporting) {
+                             bool ShouldLazyLoadMetadata, bool IsImporting,
+                             uint64_t MaterializedBudget) {
   BitstreamCursor Stream(Buffer);
 
   std::string ProducerIdentification;
@@ -5942,6 +6170,7 @@ BitcodeModule::getModuleImpl(LLVMContext &Context, bool MaterializeAll,
   Stream.JumpToBit(ModuleBit);
   auto *R = new BitcodeReader(std::move(Stream), Strtab, ProducerIdentification,
                               Context);
+  R->setMaterializedBudget(MaterializedBudget);
 
   std::unique_ptr<Module> M =
       llvm::make_unique<Module>(ModuleIdentifier, Context);
@@ -5970,6 +6199,13 @@ BitcodeModule::getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
   return getModuleImpl(Context, false, ShouldLazyLoadMetadata, IsImporting);
 }
 
+Expected<std::unique_ptr<Module>>
+BitcodeModule::getPagedModule(LLVMContext &Context,
+                              uint64_t MaterializedBudget) {
+  assert(MaterializedBudget && "Paging needs a budget");
+  return getModuleImpl(Context, false, false, false, MaterializedBudget);
+}
+
 // Parse the specified bitcode buffer and merge the index into CombinedIndex.
 // We don't use ModuleIdentifier here because the client may need to control the
 // module path used in the combined summary (e.g. when reading summaries for
@@ -6119,6 +6355,20 @@ Expected<std::unique_ptr<Module>> llvm::getOwningLazyBitcodeModule(
   return MOrErr;
 }
 
+Expected<std::unique_ptr<Module>>
+llvm::getOwningPagedBitcodeModule(std::unique_ptr<MemoryBuffer> &&Buffer,
+                                  LLVMContext &Context,
+                                  uint64_t MaterializedBudget) {
+  Expected<BitcodeModule> BM = getSingleModule(*Buffer);
+  if (!BM)
+    return BM.takeError();
+
+  auto MOrErr = BM->getPagedModule(Context, MaterializedBudget);
+  if (MOrErr)
+    (*MOrErr)->setOwnedMemoryBuffer(std::move(Buffer));
+  return MOrErr;
+}
+
 Expected<std::unique_ptr<Module>>
 BitcodeModule::parseModule(LLVMContext &Context) {
   return getModuleImpl(Context, true, false, false);
@@ -4234,8 +4234,9 @@ static void writeBitcodeHeader(BitstreamWriter &Stream) {
   Stream.Emit(0xD, 4);
 }
 
-BitcodeWriter::BitcodeWriter(SmallVectorImpl<char> &Buffer)
-    : Buffer(Buffer), Stream(new BitstreamWriter(Buffer)) {
+BitcodeWriter::BitcodeWriter(SmallVectorImpl<char> &Buffer,
+                             raw_mmap_ostream *FS)
+    : Buffer(Buffer), Stream(new BitstreamWriter(Buffer, FS)) {
   writeBitcodeHeader(*Stream);
 }
 
@@ -4332,11 +4333,13 @@ void BitcodeWriter::writeIndex(
   IndexWriter.write();
 }
 
-/// Write the specified module to the specified output stream.
-void llvm::WriteBitcodeToFile(const Module &M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder,
-                              const ModuleSummaryIndex *Index,
-                              bool GenerateHash, ModuleHash *ModHash) {
+/// Write the specified module to the specified output stream, flushing the
+/// bitcode to FS as it is generated if FS is non-null.
+static void writeBitcodeToStream(const Module &M, raw_ostream &Out,
+                                 raw_mmap_ostream *FS,
+                                 bool ShouldPreserveUseListOrder,
+                                 const ModuleSummaryIndex *Index,
+                                 bool GenerateHash, ModuleHash *ModHash) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -4346,7 +4349,12 @@ void llvm::WriteBitcodeToFile(const Module &M, raw_ostream &Out,
   if (TT.isOSDarwin() || TT.isOSBinFormatMachO())
     Buffer.insert(Buffer.begin(), BWH_HeaderSize, 0);
 
-  BitcodeWriter Writer(Buffer);
+  // The wrapper header and the module hash are computed from the buffer, so
+  // it has to hold all of the bitcode then.
+  if (!Buffer.empty() || GenerateHash)
+    FS = nullptr;
+
+  BitcodeWriter Writer(Buffer, FS);
   Writer.writeModule(M, ShouldPreserveUseListOrder, Index, GenerateHash,
                      ModHash);
   Writer.writeSymtab();
@@ -4355,8 +4363,26 @@ void llvm::WriteBitcodeToFile(const Module &M, raw_ostream &Out,
   if (TT.isOSDarwin() || TT.isOSBinFormatMachO())
     emitDarwinBCHeaderAndTrailer(Buffer, TT);
 
-  // Write the generated bitstream to "Out".
-  Out.write((char*)&Buffer.front(), Buffer.size());
+  // Write the generated bitstream, or what is left of it, to "Out".
+  if (!Buffer.empty())
+    Out.write((char*)&Buffer.front(), Buffer.size());
+}
+
+/// Write the specified module to the specified output stream.
+void llvm::WriteBitcodeToFile(const Module &M, raw_ostream &Out,
+                              bool ShouldPreserveUseListOrder,
+                              const ModuleSummaryIndex *Index,
+                              bool GenerateHash, ModuleHash *ModHash) {
+  writeBitcodeToStream(M, Out, nullptr, ShouldPreserveUseListOrder, Index,
+                       GenerateHash, ModHash);
+}
+
+void llvm::WriteBitcodeToFile(const Module &M, raw_mmap_ostream &Out,
+                              bool ShouldPreserveUseListOrder,
+                              const ModuleSummaryIndex *Index,
+                              bool GenerateHash, ModuleHash *ModHash) {
+  writeBitcodeToStream(M, Out, &Out, ShouldPreserveUseListOrder, Index,
+                       GenerateHash, ModHash);
 }
 
 void IndexBitcodeWriter::write() {
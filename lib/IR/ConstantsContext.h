@@ -21,6 +21,7 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/SwissMap.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -617,7 +618,7 @@ private:
   };
 
 public:
-  using MapTy = DenseSet<ConstantClass *, MapInfo>;
+  using MapTy = HotDenseSet<ConstantClass *, MapInfo>;
 
 private:
   MapTy Map;
@@ -758,7 +758,7 @@ void MDNode::deleteAsSubclass() {
 }
 
 template <class T, class InfoT>
-static T *uniquifyImpl(T *N, DenseSet<T *, InfoT> &Store) {
+static T *uniquifyImpl(T *N, HotDenseSet<T *, InfoT> &Store) {
   if (T *U = getUniqued(Store, N))
     return U;
 
@@ -13,13 +13,13 @@
 #ifndef LLVM_IR_METADATAIMPL_H
 #define LLVM_IR_METADATAIMPL_H
 
-#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SwissMap.h"
 #include "llvm/IR/Metadata.h"
 
 namespace llvm {
 
 template <class T, class InfoT>
-static T *getUniqued(DenseSet<T *, InfoT> &Store,
+static T *getUniqued(HotDenseSet<T *, InfoT> &Store,
                      const typename InfoT::KeyTy &Key) {
   auto I = Store.find_as(Key);
   return I == Store.end() ? nullptr : *I;
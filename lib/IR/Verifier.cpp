@@ -93,6 +93,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Statepoint.h"
 #include "llvm/IR/Type.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/IR/Use.h"
 #include "llvm/IR/User.h"
 #include "llvm/IR/Value.h"
@@ -103,6 +104,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -113,6 +115,11 @@
 
 using namespace llvm;
 
+static cl::opt<unsigned> VerifierThreads(
+    "verifier-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of threads verifying the functions of a module "
+             "(0 = verify them on the calling thread)"));
+
 namespace llvm {
 
 struct VerifierSupport {
@@ -306,6 +313,10 @@ class Verifier : public InstVisitor<Verifier>, VerifierSupport {
 
   TBAAVerifier TBAAVerifyHelper;
 
+  /// Whether the prototypes of the intrinsics were checked before verifying
+  /// the functions, so calls to them need not check them again.
+  bool IntrinsicSignaturesChecked = false;
+
   void checkAtomicMemAccessSize(Type *Ty, const Instruction *I);
 
 public:
@@ -392,6 +403,20 @@ public:
     return !Broken;
   }
 
+  /// Merge in what \p Other, which verified other functions of the same
+  /// module, collected for the checks that span functions.  Returns false if
+  /// one of those checks fails across the two sets of functions.
+  bool mergeFunctionState(const Verifier &Other);
+
+  /// Check that the prototype of the intrinsic \p IF lines up with what the
+  /// .td files describe.  Matching the prototype may add types to the
+  /// context, so this is done once per declaration before functions are
+  /// verified concurrently.
+  bool verifyIntrinsicSignature(const Function &IF);
+
+  /// Don't check the prototypes of called intrinsics again.
+  void setIntrinsicSignaturesChecked() { IntrinsicSignaturesChecked = true; }
+
 private:
   // Verification methods...
   void visitGlobalValue(const GlobalValue &GV);
@@ -1628,10 +1653,13 @@ void Verifier::verifyParameterAttrs(AttributeSet Attrs, Type *Ty,
          "'noinline and alwaysinline' are incompatible!",
          V);
 
+  // Getting the attribute set adds it to the context, which must not happen
+  // when functions are verified concurrently, without a stream.
   AttrBuilder IncompatibleAttrs = AttributeFuncs::typeIncompatible(Ty);
   Assert(!AttrBuilder(Attrs).overlaps(IncompatibleAttrs),
          "Wrong types for attribute: " +
-             AttributeSet::get(Context, IncompatibleAttrs).getAsString(),
+             (OS ? AttributeSet::get(Context, IncompatibleAttrs).getAsString()
+                 : std::string()),
          V);
 
   if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
@@ -4133,15 +4161,9 @@ void Verifier::visitInstruction(Instruction &I) {
   InstsInThisBlock.insert(&I);
 }
 
-/// Allow intrinsics to be verified in different ways.
-void Verifier::visitIntrinsicCall(Intrinsic::ID ID, CallBase &Call) {
-  Function *IF = Call.getCalledFunction();
-  Assert(IF->isDeclaration(), "Intrinsic functions should never be defined!",
-         IF);
-
-  // Verify that the intrinsic prototype lines up with what the .td files
-  // describe.
-  FunctionType *IFTy = IF->getFunctionType();
+bool Verifier::verifyIntrinsicSignature(const Function &IF) {
+  Intrinsic::ID ID = IF.getIntrinsicID();
+  FunctionType *IFTy = IF.getFunctionType();
   bool IsVarArg = IFTy->isVarArg();
 
   SmallVector<Intrinsic::IITDescriptor, 8> Table;
@@ -4149,36 +4171,56 @@ void Verifier::visitIntrinsicCall(Intrinsic::ID ID, CallBase &Call) {
   ArrayRef<Intrinsic::IITDescriptor> TableRef = Table;
 
   SmallVector<Type *, 4> ArgTys;
-  Assert(!Intrinsic::matchIntrinsicType(IFTy->getReturnType(),
-                                        TableRef, ArgTys),
-         "Intrinsic has incorrect return type!", IF);
+  if (Intrinsic::matchIntrinsicType(IFTy->getReturnType(), TableRef,
+                                    ArgTys)) {
+    CheckFailed("Intrinsic has incorrect return type!", &IF);
+    return false;
+  }
   for (unsigned i = 0, e = IFTy->getNumParams(); i != e; ++i)
-    Assert(!Intrinsic::matchIntrinsicType(IFTy->getParamType(i),
-                                          TableRef, ArgTys),
-           "Intrinsic has incorrect argument type!", IF);
+    if (Intrinsic::matchIntrinsicType(IFTy->getParamType(i), TableRef,
+                                      ArgTys)) {
+      CheckFailed("Intrinsic has incorrect argument type!", &IF);
+      return false;
+    }
 
   // Verify if the intrinsic call matches the vararg property.
-  if (IsVarArg)
-    Assert(!Intrinsic::matchIntrinsicVarArg(IsVarArg, TableRef),
-           "Intrinsic was not defined with variable arguments!", IF);
-  else
-    Assert(!Intrinsic::matchIntrinsicVarArg(IsVarArg, TableRef),
-           "Callsite was not defined with variable arguments!", IF);
+  if (Intrinsic::matchIntrinsicVarArg(IsVarArg, TableRef)) {
+    CheckFailed(IsVarArg ? "Intrinsic was not defined with variable arguments!"
+                         : "Callsite was not defined with variable arguments!",
+                &IF);
+    return false;
+  }
 
   // All descriptors should be absorbed by now.
-  Assert(TableRef.empty(), "Intrinsic has too few arguments!", IF);
+  if (!TableRef.empty()) {
+    CheckFailed("Intrinsic has too few arguments!", &IF);
+    return false;
+  }
 
   // Now that we have the intrinsic ID and the actual argument types (and we
   // know they are legal for the intrinsic!) get the intrinsic name through the
   // usual means.  This allows us to verify the mangling of argument types into
   // the name.
   const std::string ExpectedName = Intrinsic::getName(ID, ArgTys);
-  Assert(ExpectedName == IF->getName(),
-         "Intrinsic name not mangled correctly for type arguments! "
-         "Should be: " +
-             ExpectedName,
+  if (ExpectedName != IF.getName()) {
+    CheckFailed("Intrinsic name not mangled correctly for type arguments! "
+                "Should be: " +
+                    ExpectedName,
+                &IF);
+    return false;
+  }
+  return true;
+}
+
+/// Allow intrinsics to be verified in different ways.
+void Verifier::visitIntrinsicCall(Intrinsic::ID ID, CallBase &Call) {
+  Function *IF = Call.getCalledFunction();
+  Assert(IF->isDeclaration(), "Intrinsic functions should never be defined!",
          IF);
 
+  if (!IntrinsicSignaturesChecked && !verifyIntrinsicSignature(*IF))
+    return;
+
   // If the intrinsic takes MDNode arguments, verify that they are either global
   // or are local to *this* function.
   for (Value *V : Call.args())
@@ -4881,6 +4923,27 @@ void Verifier::verifyDeoptimizeCallingConvs() {
   }
 }
 
+bool Verifier::mergeFunctionState(const Verifier &Other) {
+  for (const auto &Attachment : Other.DISubprogramAttachments) {
+    auto Inserted = DISubprogramAttachments.insert(Attachment);
+    if (!Inserted.second && Inserted.first->second != Attachment.second)
+      return false;
+  }
+  for (const auto &HasSource : Other.HasSourceDebugInfo) {
+    auto Inserted = HasSourceDebugInfo.insert(HasSource);
+    if (!Inserted.second && Inserted.first->second != HasSource.second)
+      return false;
+  }
+  for (const auto &Counts : Other.FrameEscapeInfo) {
+    auto &Merged = FrameEscapeInfo[Counts.first];
+    Merged.first = std::max(Merged.first, Counts.second.first);
+    Merged.second = std::max(Merged.second, Counts.second.second);
+  }
+  CUVisited.insert(Other.CUVisited.begin(), Other.CUVisited.end());
+  MDNodes.insert(Other.MDNodes.begin(), Other.MDNodes.end());
+  return true;
+}
+
 void Verifier::verifySourceDebugInfo(const DICompileUnit &U, const DIFile &F) {
   bool HasSource = F.getSource().hasValue();
   if (!HasSourceDebugInfo.count(&U))
@@ -4904,14 +4967,96 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
   return !V.verify(F);
 }
 
+/// Build the parts of the IR that are computed the first time they are read
+/// and that verifying a function reads, so that several functions can be
+/// verified at the same time, and check the prototypes of the intrinsics
+/// with \p V.  Returns false if one of them is broken.
+static bool prepareForConcurrentVerification(Verifier &V, const Module &M) {
+  for (const Function &F : M) {
+    (void)F.arg_begin();
+    if (F.isDeclaration() && F.getIntrinsicID() != Intrinsic::not_intrinsic &&
+        !V.verifyIntrinsicSignature(F))
+      return false;
+  }
+
+  // Whether a struct is sized is cached in the type.  The visited set stops
+  // the recursion through invalid recursive types.
+  TypeFinder StructTypes;
+  StructTypes.run(M, /*onlyNamed=*/false);
+  for (StructType *STy : StructTypes) {
+    SmallPtrSet<Type *, 4> Visited;
+    (void)STy->isSized(&Visited);
+  }
+  (void)ConstantTokenNone::get(M.getContext());
+  return true;
+}
+
+/// Verify the functions of \p M on \p ThreadCount threads, each verifying
+/// runs of consecutive functions with its own Verifier, and merge the state
+/// of the checks that span functions into \p V.  Nothing is printed: if any
+/// check fails, \p V is left untouched and false is returned, for the caller
+/// to verify the functions again one at a time and report the failures in
+/// the usual order.
+static bool verifyFunctionsConcurrently(Verifier &V, const Module &M,
+                                        bool TreatBrokenDebugInfoAsError,
+                                        unsigned ThreadCount) {
+  {
+    Verifier Checker(/*OS=*/nullptr, TreatBrokenDebugInfoAsError, M);
+    if (!prepareForConcurrentVerification(Checker, M))
+      return false;
+  }
+
+  // A few runs per thread balance the load when function sizes vary.
+  size_t NumFunctions = M.size();
+  size_t RunSize = std::max<size_t>(1, NumFunctions / (8 * ThreadCount));
+  std::vector<std::unique_ptr<Verifier>> Verifiers;
+  // Not a vector<bool>, whose elements share words between threads.
+  std::vector<char> Failed;
+  for (size_t I = 0; I < NumFunctions; I += RunSize) {
+    Verifiers.push_back(llvm::make_unique<Verifier>(
+        /*OS=*/nullptr, TreatBrokenDebugInfoAsError, M));
+    Verifiers.back()->setIntrinsicSignaturesChecked();
+  }
+  Failed.resize(Verifiers.size());
+
+  {
+    ThreadPool Pool(ThreadCount);
+    Module::const_iterator RunBegin = M.begin();
+    for (size_t Run = 0; Run != Verifiers.size(); ++Run) {
+      Module::const_iterator RunEnd = RunBegin;
+      for (size_t I = 0; I != RunSize && RunEnd != M.end(); ++I)
+        ++RunEnd;
+      Pool.async([&, Run, RunBegin, RunEnd] {
+        bool RunFailed = false;
+        for (const Function &F : make_range(RunBegin, RunEnd))
+          RunFailed |= !Verifiers[Run]->verify(F);
+        Failed[Run] = RunFailed || Verifiers[Run]->hasBrokenDebugInfo();
+      });
+      RunBegin = RunEnd;
+    }
+    Pool.wait();
+  }
+
+  if (any_of(Failed, [](char RunFailed) { return RunFailed; }))
+    return false;
+  for (size_t Run = 1; Run < Verifiers.size(); ++Run)
+    if (!Verifiers.front()->mergeFunctionState(*Verifiers[Run]))
+      return false;
+  if (!Verifiers.empty())
+    V.mergeFunctionState(*Verifiers.front());
+  return true;
+}
+
 bool llvm::verifyModule(const Module &M, raw_ostream *OS,
                         bool *BrokenDebugInfo) {
   // Don't use a raw_null_ostream.  Printing IR is expensive.
   Verifier V(OS, /*ShouldTreatBrokenDebugInfoAsError=*/!BrokenDebugInfo, M);
 
   bool Broken = false;
-  for (const Function &F : M)
-    Broken |= !V.verify(F);
+  if (!VerifierThreads ||
+      !verifyFunctionsConcurrently(V, M, !BrokenDebugInfo, VerifierThreads))
+    for (const Function &F : M)
+      Broken |= !V.verify(F);
 
   Broken |= !V.verify();
   if (BrokenDebugInfo)
@@ -65,6 +65,43 @@ std::unique_ptr<Module> llvm::getLazyIRFileModule(StringRef Filename,
                          ShouldLazyLoadMetadata);
 }
 
+std::unique_ptr<Module> llvm::getPagedIRFileModule(StringRef Filename,
+                                                   SMDiagnostic &Err,
+                                                   LLVMContext &Context,
+                                                   uint64_t MaterializedBudget) {
+  // Without the need for a null terminator, the file is mapped if it is large
+  // enough, and function bodies are read straight out of the mapping.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFileOrSTDIN(Filename, /*FileSize=*/-1,
+                                   /*RequiresNullTerminator=*/false);
+  if (std::error_code EC = FileOrErr.getError()) {
+    Err = SMDiagnostic(Filename, SourceMgr::DK_Error,
+                       "Could not open input file: " + EC.message());
+    return nullptr;
+  }
+
+  std::unique_ptr<MemoryBuffer> &Buffer = FileOrErr.get();
+  if (!isBitcode((const unsigned char *)Buffer->getBufferStart(),
+                 (const unsigned char *)Buffer->getBufferEnd())) {
+    // The assembly parser needs a null terminated buffer.
+    std::unique_ptr<MemoryBuffer> Copy = MemoryBuffer::getMemBufferCopy(
+        Buffer->getBuffer(), Buffer->getBufferIdentifier());
+    return parseAssembly(Copy->getMemBufferRef(), Err, Context);
+  }
+
+  StringRef Identifier = Buffer->getBufferIdentifier();
+  Expected<std::unique_ptr<Module>> ModuleOrErr =
+      getOwningPagedBitcodeModule(std::move(Buffer), Context,
+                                  MaterializedBudget);
+  if (Error E = ModuleOrErr.takeError()) {
+    handleAllErrors(std::move(E), [&](ErrorInfoBase &EIB) {
+      Err = SMDiagnostic(Identifier, SourceMgr::DK_Error, EIB.message());
+    });
+    return nullptr;
+  }
+  return std::move(ModuleOrErr.get());
+}
+
 std::unique_ptr<Module> llvm::parseIR(MemoryBufferRef Buffer, SMDiagnostic &Err,
                                       LLVMContext &Context,
                                       bool UpgradeDebugInfo,
@@ -1061,8 +1061,21 @@ void IRLinker::flushRAUWWorklist() {
     Value *New;
     std::tie(Old, New) = Elem;
 
+    // Drop the dead constants still using Old, such as the casts left behind
+    // by earlier links that replaced an appending variable, rather than carry
+    // them over to New each time.
+    Old->removeDeadConstantUsers();
     Old->replaceAllUsesWith(New);
+
+    // The initializer of a replaced appending variable grows with every
+    // module linked in: drop it now rather than at the end of the move.
+    ConstantArray *OldInit = nullptr;
+    if (auto *GV = dyn_cast<GlobalVariable>(Old))
+      if (GV->hasAppendingLinkage() && GV->hasInitializer())
+        OldInit = dyn_cast<ConstantArray>(GV->getInitializer());
     Old->eraseFromParent();
+    if (OldInit && OldInit->use_empty())
+      OldInit->destroyConstant();
   }
   RAUWWorklist.clear();
 }
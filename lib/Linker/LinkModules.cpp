@@ -481,20 +481,23 @@ bool ModuleLinker::run() {
   }
 
   // Alias have to go first, since we are not able to find their comdats
-  // otherwise.
-  for (auto I = DstM.alias_begin(), E = DstM.alias_end(); I != E;) {
-    GlobalAlias &GV = *I++;
-    dropReplacedComdat(GV, ReplacedDstComdats);
-  }
+  // otherwise.  The dest module only grows as modules are linked into it, so
+  // skip walking it when there is nothing to drop.
+  if (!ReplacedDstComdats.empty()) {
+    for (auto I = DstM.alias_begin(), E = DstM.alias_end(); I != E;) {
+      GlobalAlias &GV = *I++;
+      dropReplacedComdat(GV, ReplacedDstComdats);
+    }
 
-  for (auto I = DstM.global_begin(), E = DstM.global_end(); I != E;) {
-    GlobalVariable &GV = *I++;
-    dropReplacedComdat(GV, ReplacedDstComdats);
-  }
+    for (auto I = DstM.global_begin(), E = DstM.global_end(); I != E;) {
+      GlobalVariable &GV = *I++;
+      dropReplacedComdat(GV, ReplacedDstComdats);
+    }
 
-  for (auto I = DstM.begin(), E = DstM.end(); I != E;) {
-    Function &GV = *I++;
-    dropReplacedComdat(GV, ReplacedDstComdats);
+    for (auto I = DstM.begin(), E = DstM.end(); I != E;) {
+      Function &GV = *I++;
+      dropReplacedComdat(GV, ReplacedDstComdats);
+    }
   }
 
   for (GlobalVariable &GV : SrcM->globals())
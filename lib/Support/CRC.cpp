@@ -6,15 +6,22 @@
 //
 //===----------------------------------------------------------------------===//
 //
-//  This file implements llvm::crc32 function.
+//  This file implements llvm::crc32 and llvm::crc32c functions.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/CRC.h"
 #include "llvm/Config/config.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/Threading.h"
 #include <array>
+#include <cstring>
+
+#if LLVM_X86_TARGET_DISPATCH
+#include <immintrin.h>
+#endif
 
 using namespace llvm;
 
@@ -66,3 +73,67 @@ uint32_t llvm::crc32(uint32_t CRC, StringRef S) {
   return ::crc32(CRC, (const Bytef *)S.data(), S.size());
 }
 #endif
+
+using CRC32CTable = std::array<uint32_t, 256>;
+
+static void initCRC32CTable(CRC32CTable *Tbl) {
+  for (uint32_t I = 0; I < Tbl->size(); ++I) {
+    uint32_t V = I;
+    for (unsigned J = 0; J < 8; ++J)
+      V = (V & 1) ? (V >> 1) ^ 0x82F63B78U : V >> 1;
+    (*Tbl)[I] = V;
+  }
+}
+
+static uint32_t crc32cPortable(uint32_t CRC, const uint8_t *P, size_t Len) {
+  static llvm::once_flag InitFlag;
+  static CRC32CTable Tbl;
+  llvm::call_once(InitFlag, initCRC32CTable, &Tbl);
+
+  for (; Len >= 8; Len -= 8) {
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+  }
+  while (Len--)
+    CRC = Tbl[(CRC ^ *P++) & 0xFF] ^ (CRC >> 8);
+  return CRC;
+}
+
+#if LLVM_X86_TARGET_DISPATCH
+__attribute__((target("sse4.2"))) static uint32_t
+crc32cSSE42(uint32_t CRC, const uint8_t *P, size_t Len) {
+#if defined(__x86_64__)
+  uint64_t CRC64 = CRC;
+  for (; Len >= 8; Len -= 8, P += 8) {
+    uint64_t V;
+    std::memcpy(&V, P, sizeof(V));
+    CRC64 = _mm_crc32_u64(CRC64, V);
+  }
+  CRC = uint32_t(CRC64);
+#endif
+  for (; Len >= 4; Len -= 4, P += 4) {
+    uint32_t V;
+    std::memcpy(&V, P, sizeof(V));
+    CRC = _mm_crc32_u32(CRC, V);
+  }
+  while (Len--)
+    CRC = _mm_crc32_u8(CRC, *P++);
+  return CRC;
+}
+#endif
+
+uint32_t llvm::crc32c(uint32_t CRC, ArrayRef<uint8_t> Data) {
+  CRC ^= 0xFFFFFFFFU;
+#if LLVM_X86_TARGET_DISPATCH
+  static const bool HasSSE42 = sys::hasHostCPUFeature("sse4.2");
+  if (HasSSE42 && sys::isTargetDispatchEnabled())
+    return crc32cSSE42(CRC, Data.data(), Data.size()) ^ 0xFFFFFFFFU;
+#endif
+  return crc32cPortable(CRC, Data.data(), Data.size()) ^ 0xFFFFFFFFU;
+}
@@ -0,0 +1,238 @@
+//===- ConcurrentBumpPtrAllocator.cpp - Concurrent bump allocator ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ConcurrentBumpPtrAllocator.
+//
+// Each thread finds its state in an allocator through a small thread-local
+// cache keyed by the allocator ID, and only falls back to the map guarded by
+// the pool lock on a miss.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ConcurrentBumpPtrAllocator.h"
+#include "llvm/Support/MemAlloc.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+constexpr size_t ConcurrentBumpPtrAllocator::NoSlab;
+
+namespace {
+
+struct StateCacheEntry {
+  uint64_t AllocatorID;
+  void *State;
+};
+
+} // end anonymous namespace
+
+static std::atomic<uint64_t> NextAllocatorID(1);
+static std::atomic<uint64_t> NextThreadKey(1);
+
+// The states of the allocators this thread used most recently.
+static const unsigned StateCacheSize = 4;
+static LLVM_THREAD_LOCAL StateCacheEntry StateCache[StateCacheSize];
+static LLVM_THREAD_LOCAL unsigned NextStateCacheVictim;
+
+// Identifies this thread in the allocators' maps.  Unlike the system thread
+// id, it is never reused by a later thread.
+static LLVM_THREAD_LOCAL uint64_t ThisThreadKey;
+
+ConcurrentBumpPtrAllocator::ConcurrentBumpPtrAllocator(size_t SlabSize,
+                                                       size_t SizeThreshold)
+    : ID(NextAllocatorID++), SlabSize(SlabSize),
+      SizeThreshold(std::min(SizeThreshold, SlabSize)) {}
+
+ConcurrentBumpPtrAllocator::~ConcurrentBumpPtrAllocator() {
+  for (SlabInfo &Slab : Slabs)
+    free(Slab.Begin);
+  for (SlabInfo &Slab : CustomSizedSlabs)
+    free(Slab.Begin);
+}
+
+ConcurrentBumpPtrAllocator::ThreadState &
+ConcurrentBumpPtrAllocator::getThreadState() {
+  for (StateCacheEntry &Entry : StateCache)
+    if (Entry.AllocatorID == ID)
+      return *static_cast<ThreadState *>(Entry.State);
+  return getThreadStateSlow();
+}
+
+ConcurrentBumpPtrAllocator::ThreadState &
+ConcurrentBumpPtrAllocator::getThreadStateSlow() {
+  if (!ThisThreadKey)
+    ThisThreadKey = NextThreadKey++;
+
+  ThreadState *TS;
+  {
+    std::lock_guard<std::mutex> Lock(PoolMutex);
+    ThreadState *&Slot = ThreadStateMap[ThisThreadKey];
+    if (!Slot) {
+      ThreadStates.push_back(llvm::make_unique<ThreadState>());
+      Slot = ThreadStates.back().get();
+      Slot->ThreadID = get_threadid();
+    }
+    TS = Slot;
+  }
+
+  StateCacheEntry &Victim = StateCache[NextStateCacheVictim];
+  NextStateCacheVictim = (NextStateCacheVictim + 1) % StateCacheSize;
+  Victim.AllocatorID = ID;
+  Victim.State = TS;
+  return *TS;
+}
+
+size_t ConcurrentBumpPtrAllocator::computeSlabSize(size_t SlabIdx) const {
+  // Scale the slab size the same way BumpPtrAllocator does.
+  return SlabSize * ((size_t)1 << std::min<size_t>(30, SlabIdx / 128));
+}
+
+void *ConcurrentBumpPtrAllocator::AllocateSlow(ThreadState &TS, size_t Size,
+                                               size_t SizeToAllocate,
+                                               size_t Alignment) {
+  // If Size is really big, allocate a separate slab for it.
+  size_t PaddedSize = SizeToAllocate + Alignment - 1;
+  if (PaddedSize > SizeThreshold) {
+    char *NewSlab = static_cast<char *>(safe_malloc(PaddedSize));
+    __asan_poison_memory_region(NewSlab, PaddedSize);
+    char *AlignedPtr = (char *)alignAddr(NewSlab, Alignment);
+    assert(AlignedPtr + Size <= NewSlab + PaddedSize);
+    {
+      std::lock_guard<std::mutex> Lock(PoolMutex);
+      CustomSizedSlabs.push_back({NewSlab, PaddedSize, AlignedPtr + Size});
+    }
+    TS.NumCustomSizedSlabs.store(
+        TS.NumCustomSizedSlabs.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    __msan_allocated_memory(AlignedPtr, Size);
+    __asan_unpoison_memory_region(AlignedPtr, Size);
+    return AlignedPtr;
+  }
+
+  // Otherwise, retire the current slab of the thread and take a new one from
+  // the pool.  The memory is allocated outside of the lock; the size may be
+  // off by one step if other threads take slabs in between, which is fine.
+  size_t AllocatedSlabSize;
+  {
+    std::lock_guard<std::mutex> Lock(PoolMutex);
+    AllocatedSlabSize = computeSlabSize(Slabs.size());
+  }
+  char *NewSlab = static_cast<char *>(safe_malloc(AllocatedSlabSize));
+  // We own the new slab and don't want anyone reading anything other than
+  // pieces returned from this method.  So poison the whole slab.
+  __asan_poison_memory_region(NewSlab, AllocatedSlabSize);
+  {
+    std::lock_guard<std::mutex> Lock(PoolMutex);
+    if (TS.CurSlab != NoSlab)
+      Slabs[TS.CurSlab].UsedEnd = TS.CurPtr;
+    TS.CurSlab = Slabs.size();
+    Slabs.push_back({NewSlab, AllocatedSlabSize, NewSlab});
+  }
+  TS.NumSlabs.store(TS.NumSlabs.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+
+  char *AlignedPtr = (char *)alignAddr(NewSlab, Alignment);
+  assert(AlignedPtr + SizeToAllocate <= NewSlab + AllocatedSlabSize &&
+         "Unable to allocate memory!");
+  TS.CurPtr = AlignedPtr + SizeToAllocate;
+  TS.End = NewSlab + AllocatedSlabSize;
+  __msan_allocated_memory(AlignedPtr, Size);
+  __asan_unpoison_memory_region(AlignedPtr, Size);
+  return AlignedPtr;
+}
+
+void ConcurrentBumpPtrAllocator::syncUsedEnds() {
+  for (auto &TS : ThreadStates)
+    if (TS->CurSlab != NoSlab)
+      Slabs[TS->CurSlab].UsedEnd = TS->CurPtr;
+}
+
+void ConcurrentBumpPtrAllocator::forEachUsedRange(
+    function_ref<void(char *, char *)> Fn) {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  syncUsedEnds();
+  for (SlabInfo &Slab : Slabs)
+    Fn(Slab.Begin, Slab.UsedEnd);
+  for (SlabInfo &Slab : CustomSizedSlabs)
+    Fn(Slab.Begin, Slab.UsedEnd);
+}
+
+void ConcurrentBumpPtrAllocator::Reset() {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+
+  for (SlabInfo &Slab : CustomSizedSlabs)
+    free(Slab.Begin);
+  CustomSizedSlabs.clear();
+
+  // Keep the current slab of every thread and rewind it.
+  std::vector<SlabInfo> Kept;
+  for (auto &TS : ThreadStates) {
+    TS->BytesAllocated.store(0, std::memory_order_relaxed);
+    TS->NumCustomSizedSlabs.store(0, std::memory_order_relaxed);
+    if (TS->CurSlab == NoSlab) {
+      TS->NumSlabs.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    SlabInfo &Slab = Slabs[TS->CurSlab];
+    __asan_poison_memory_region(Slab.Begin, Slab.Size);
+    TS->CurSlab = Kept.size();
+    TS->CurPtr = Slab.Begin;
+    TS->NumSlabs.store(1, std::memory_order_relaxed);
+    Kept.push_back({Slab.Begin, Slab.Size, Slab.Begin});
+    // Mark the slab as kept.
+    Slab.Begin = nullptr;
+  }
+  for (SlabInfo &Slab : Slabs)
+    free(Slab.Begin);
+  Slabs = std::move(Kept);
+}
+
+size_t ConcurrentBumpPtrAllocator::GetNumSlabs() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  return Slabs.size() + CustomSizedSlabs.size();
+}
+
+size_t ConcurrentBumpPtrAllocator::getTotalMemory() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  size_t TotalMemory = 0;
+  for (const SlabInfo &Slab : Slabs)
+    TotalMemory += Slab.Size;
+  for (const SlabInfo &Slab : CustomSizedSlabs)
+    TotalMemory += Slab.Size;
+  return TotalMemory;
+}
+
+size_t ConcurrentBumpPtrAllocator::getBytesAllocated() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  size_t BytesAllocated = 0;
+  for (auto &TS : ThreadStates)
+    BytesAllocated += TS->BytesAllocated.load(std::memory_order_relaxed);
+  return BytesAllocated;
+}
+
+std::vector<ConcurrentBumpPtrAllocator::ThreadStatistics>
+ConcurrentBumpPtrAllocator::getThreadStatistics() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  std::vector<ThreadStatistics> Result;
+  for (auto &TS : ThreadStates)
+    Result.push_back({TS->ThreadID,
+                      TS->BytesAllocated.load(std::memory_order_relaxed),
+                      TS->NumSlabs.load(std::memory_order_relaxed),
+                      TS->NumCustomSizedSlabs.load(std::memory_order_relaxed)});
+  return Result;
+}
+
+void ConcurrentBumpPtrAllocator::PrintStats() const {
+  detail::printBumpPtrAllocatorStats(GetNumSlabs(), getBytesAllocated(),
+                                     getTotalMemory());
+  for (const ThreadStatistics &Stats : getThreadStatistics())
+    errs() << "Thread " << Stats.ThreadID << ": " << Stats.BytesAllocated
+           << " bytes in " << Stats.NumSlabs << " slabs and "
+           << Stats.NumCustomSizedSlabs << " custom-sized slabs\n";
+}
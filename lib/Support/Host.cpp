@@ -23,6 +23,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <assert.h>
+#include <atomic>
 #include <string.h>
 
 // Include the platform-specific parts of this class.
@@ -1464,6 +1465,26 @@ bool sys::getHostCPUFeatures(StringMap<bool> &Features) {
 bool sys::getHostCPUFeatures(StringMap<bool> &Features) { return false; }
 #endif
 
+bool sys::hasHostCPUFeature(StringRef Feature) {
+  static const StringMap<bool> Features = [] {
+    StringMap<bool> Features;
+    if (!getHostCPUFeatures(Features))
+      Features.clear();
+    return Features;
+  }();
+  return Features.lookup(Feature);
+}
+
+static std::atomic<bool> TargetDispatchEnabled(true);
+
+bool sys::isTargetDispatchEnabled() {
+  return TargetDispatchEnabled.load(std::memory_order_relaxed);
+}
+
+void sys::setTargetDispatchEnabled(bool Enabled) {
+  TargetDispatchEnabled.store(Enabled, std::memory_order_relaxed);
+}
+
 std::string sys::getProcessTriple() {
   std::string TargetTripleString = updateTripleOSVersion(LLVM_HOST_TRIPLE);
   Triple PT(Triple::normalize(TargetTripleString));
@@ -0,0 +1,108 @@
+//===- MemoryBufferLoader.cpp - Concurrent MemoryBuffer loading -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemoryBufferLoader class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/MemoryBufferLoader.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Threading.h"
+#include <algorithm>
+#if defined(LLVM_ON_UNIX)
+#include <fcntl.h>
+#endif
+
+using namespace llvm;
+
+static unsigned getThreadCount(unsigned ThreadCount) {
+  if (ThreadCount)
+    return ThreadCount;
+  return 2 * std::max(1u, hardware_concurrency());
+}
+
+MemoryBufferLoader::MemoryBufferLoader(unsigned ThreadCount)
+    : ThreadCount(getThreadCount(ThreadCount)) {}
+
+MemoryBufferLoader::~MemoryBufferLoader() {
+  if (Pool)
+    Pool->wait();
+}
+
+ThreadPool &MemoryBufferLoader::getPool(size_t NumFiles) {
+  std::lock_guard<std::mutex> Lock(PoolLock);
+  if (!Pool) {
+    size_t Threads = std::min<size_t>(ThreadCount, NumFiles);
+    Pool = llvm::make_unique<ThreadPool>(std::max(1u, unsigned(Threads)));
+  }
+  return *Pool;
+}
+
+static MemoryBufferLoader::BufferOrError
+loadFile(const std::string &Filename, bool RequiresNullTerminator,
+         bool IsVolatile) {
+  int FD;
+  if (std::error_code EC = sys::fs::openFileForRead(Filename, FD))
+    return EC;
+
+#if defined(LLVM_ON_UNIX) && defined(POSIX_FADV_WILLNEED)
+  // Start readahead of the whole file.  This is only a hint, so errors are
+  // ignored.
+  ::posix_fadvise(FD, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+  MemoryBufferLoader::BufferOrError Buffer = MemoryBuffer::getOpenFile(
+      FD, Filename, /*FileSize=*/-1, RequiresNullTerminator, IsVolatile);
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (!Buffer)
+    return Buffer;
+
+  // A mapped file is only read when its pages are first touched.  Fault them
+  // in here, so that the caller does not block on I/O while parsing.
+  if ((*Buffer)->getBufferKind() == MemoryBuffer::MemoryBuffer_MMap) {
+    const volatile char *Start = (*Buffer)->getBufferStart();
+    size_t Size = (*Buffer)->getBufferSize();
+    size_t PageSize = sys::Process::getPageSize();
+    for (size_t I = 0; I < Size; I += PageSize)
+      (void)Start[I];
+  }
+  return Buffer;
+}
+
+std::future<MemoryBufferLoader::BufferOrError>
+MemoryBufferLoader::load(const Twine &Filename, bool RequiresNullTerminator,
+                         bool IsVolatile) {
+  auto Promise = std::make_shared<std::promise<BufferOrError>>();
+  std::future<BufferOrError> Result = Promise->get_future();
+  std::string Name = Filename.str();
+#if LLVM_ENABLE_THREADS
+  getPool(ThreadCount).async([=] {
+    Promise->set_value(loadFile(Name, RequiresNullTerminator, IsVolatile));
+  });
+#else
+  // The pool only runs tasks in wait(), which would leave a caller waiting
+  // on the future deadlocked.
+  Promise->set_value(loadFile(Name, RequiresNullTerminator, IsVolatile));
+#endif
+  return Result;
+}
+
+std::vector<std::future<MemoryBufferLoader::BufferOrError>>
+MemoryBufferLoader::loadAll(ArrayRef<std::string> Filenames,
+                            bool RequiresNullTerminator, bool IsVolatile) {
+  std::vector<std::future<BufferOrError>> Results;
+  Results.reserve(Filenames.size());
+#if LLVM_ENABLE_THREADS
+  getPool(Filenames.size());
+#endif
+  for (const std::string &Filename : Filenames)
+    Results.push_back(load(Filename, RequiresNullTerminator, IsVolatile));
+  return Results;
+}
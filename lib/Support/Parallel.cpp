@@ -11,11 +11,15 @@
 
 #if LLVM_ENABLE_THREADS
 
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Threading.h"
 
+#include <algorithm>
 #include <atomic>
-#include <stack>
+#include <chrono>
+#include <memory>
 #include <thread>
+#include <vector>
 
 namespace llvm {
 namespace parallel {
@@ -23,125 +27,388 @@ namespace detail {
 
 namespace {
 
-/// An abstract class that takes closures and runs them asynchronously.
-class Executor {
-public:
-  virtual ~Executor() = default;
-  virtual void add(std::function<void()> func) = 0;
-
-  static Executor *getDefaultExecutor();
-};
+using Task = std::function<void()>;
 
-#if defined(_MSC_VER)
-/// An Executor that runs tasks via ConcRT.
-class ConcRTExecutor : public Executor {
-  struct Taskish {
-    Taskish(std::function<void()> Task) : Task(Task) {}
+/// A Chase-Lev work-stealing deque of tasks.
+///
+/// The owner pushes and pops tasks at the bottom without taking a lock, and
+/// other threads steal them from the top.  Only one thread at a time may act
+/// as the owner.
+class WorkDeque {
+  class Array {
+    int64_t Mask;
+    std::unique_ptr<std::atomic<Task *>[]> Slots;
 
-    std::function<void()> Task;
+  public:
+    explicit Array(int64_t Size)
+        : Mask(Size - 1), Slots(new std::atomic<Task *>[Size]) {}
 
-    static void run(void *P) {
-      Taskish *Self = static_cast<Taskish *>(P);
-      Self->Task();
-      concurrency::Free(Self);
+    int64_t size() const { return Mask + 1; }
+    Task *get(int64_t I) const {
+      return Slots[I & Mask].load(std::memory_order_relaxed);
+    }
+    void put(int64_t I, Task *T) {
+      Slots[I & Mask].store(T, std::memory_order_relaxed);
     }
   };
 
+  std::atomic<int64_t> Top{0};
+  std::atomic<int64_t> Bottom{0};
+  std::atomic<Array *> Buffer;
+  // Arrays replaced by grow().  A thief may still be reading from them, so
+  // they are only freed along with the deque.
+  std::vector<std::unique_ptr<Array>> Arrays;
+
+  Array *grow(Array *Old, int64_t T, int64_t B) {
+    Arrays.push_back(llvm::make_unique<Array>(Old->size() * 2));
+    Array *New = Arrays.back().get();
+    for (int64_t I = T; I != B; ++I)
+      New->put(I, Old->get(I));
+    Buffer.store(New, std::memory_order_release);
+    return New;
+  }
+
 public:
-  virtual void add(std::function<void()> F) {
-    Concurrency::CurrentScheduler::ScheduleTask(
-        Taskish::run, new (concurrency::Alloc(sizeof(Taskish))) Taskish(F));
+  WorkDeque() {
+    Arrays.push_back(llvm::make_unique<Array>(64));
+    Buffer.store(Arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  ~WorkDeque() {
+    for (Task *T = pop(); T; T = pop())
+      delete T;
+  }
+
+  /// Owner only.
+  void push(Task *T) {
+    int64_t B = Bottom.load(std::memory_order_relaxed);
+    int64_t Tp = Top.load(std::memory_order_acquire);
+    Array *A = Buffer.load(std::memory_order_relaxed);
+    if (B - Tp > A->size() - 1)
+      A = grow(A, Tp, B);
+    A->put(B, T);
+    Bottom.store(B + 1, std::memory_order_release);
+  }
+
+  /// Owner only.  Returns the most recently pushed task, or null.
+  Task *pop() {
+    int64_t B = Bottom.load(std::memory_order_relaxed) - 1;
+    Array *A = Buffer.load(std::memory_order_relaxed);
+    Bottom.store(B, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t Tp = Top.load(std::memory_order_relaxed);
+    if (Tp > B) {
+      Bottom.store(B + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task *T = A->get(B);
+    if (Tp == B) {
+      // Last task; race against thieves for it.
+      if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        T = nullptr;
+      Bottom.store(B + 1, std::memory_order_relaxed);
+    }
+    return T;
+  }
+
+  /// Any thread.  Returns the oldest task, or null if the deque is empty or
+  /// another thread won the race for it.
+  Task *steal() {
+    int64_t Tp = Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t B = Bottom.load(std::memory_order_acquire);
+    if (Tp >= B)
+      return nullptr;
+    Task *T = Buffer.load(std::memory_order_acquire)->get(Tp);
+    if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      return nullptr;
+    return T;
+  }
+
+  bool empty() const {
+    return Top.load(std::memory_order_seq_cst) >=
+           Bottom.load(std::memory_order_seq_cst);
   }
 };
 
-Executor *Executor::getDefaultExecutor() {
-  static ConcRTExecutor exec;
-  return &exec;
-}
+/// Per thread counters, written by one thread and read by
+/// getExecutorStatistics().
+struct Counters {
+  std::atomic<uint64_t> TasksRun{0};
+  std::atomic<uint64_t> Steals{0};
+  std::atomic<uint64_t> IdleNanoseconds{0};
+
+  void bump(std::atomic<uint64_t> &C, uint64_t N = 1) {
+    C.store(C.load(std::memory_order_relaxed) + N, std::memory_order_relaxed);
+  }
+};
+
+/// An implementation of an Executor that runs closures on a thread pool.
+///
+/// Every worker owns a WorkDeque.  Tasks spawned on a worker go to its own
+/// deque, and idle workers steal from the others.  Tasks spawned on any other
+/// thread go to a shared deque whose owner side is guarded by a mutex.
+/// Threads waiting for a TaskGroup run queued tasks instead of blocking.
+class ThreadPoolExecutor {
+  struct Worker {
+    WorkDeque Queue;
+    Counters Stats;
+  };
+
+  /// A thread sleeping in helpUntilZero().
+  struct Waiter {
+    const std::atomic<size_t> *Pending;
+    std::condition_variable Cond;
+
+    explicit Waiter(const std::atomic<size_t> &Pending) : Pending(&Pending) {}
+  };
 
-#else
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
-class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(unsigned ThreadCount = hardware_concurrency())
       : Done(ThreadCount) {
+    for (unsigned I = 0; I != ThreadCount; ++I)
+      Workers.push_back(llvm::make_unique<Worker>());
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     std::thread([&, ThreadCount] {
-      for (size_t i = 1; i < ThreadCount; ++i) {
-        std::thread([=] { work(); }).detach();
+      for (unsigned I = 1; I < ThreadCount; ++I) {
+        std::thread([=] { work(I); }).detach();
       }
-      work();
+      work(0);
     }).detach();
   }
 
-  ~ThreadPoolExecutor() override {
-    std::unique_lock<std::mutex> Lock(Mutex);
+  ~ThreadPoolExecutor() {
+    std::unique_lock<std::mutex> Lock(SleepMutex);
     Stop = true;
     Lock.unlock();
-    Cond.notify_all();
+    SleepCond.notify_all();
     // Wait for ~Latch.
   }
 
-  void add(std::function<void()> F) override {
-    std::unique_lock<std::mutex> Lock(Mutex);
-    WorkStack.push(F);
-    Lock.unlock();
-    Cond.notify_one();
+  void add(std::function<void()> F) {
+    Task *T = new Task(std::move(F));
+    if (CurrentWorker) {
+      CurrentWorker->Queue.push(T);
+    } else {
+      std::lock_guard<std::mutex> Lock(ExternalMutex);
+      External.push(T);
+    }
+    wakeOne();
+  }
+
+  /// Run queued tasks on the calling thread until \p Pending drops to zero.
+  void helpUntilZero(const std::atomic<size_t> &Pending) {
+    Waiter W(Pending);
+    while (Pending.load(std::memory_order_acquire) != 0) {
+      if (Task *T = findTask()) {
+        run(T);
+        continue;
+      }
+      // Everything left is running elsewhere.  Sleep until a task is queued
+      // or the group completes.
+      std::unique_lock<std::mutex> Lock(SleepMutex);
+      Sleepers.fetch_add(1, std::memory_order_seq_cst);
+      if (Pending.load(std::memory_order_seq_cst) != 0 && !hasQueuedTasks()) {
+        Waiters.push_back(&W);
+        W.Cond.wait(Lock);
+        Waiters.erase(std::find(Waiters.begin(), Waiters.end(), &W));
+      }
+      Sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// Wake up one thread to run a newly queued task: a sleeping worker if
+  /// there is one, otherwise a thread waiting for a TaskGroup.
+  void wakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (Sleepers.load(std::memory_order_relaxed) == 0)
+      return;
+    std::lock_guard<std::mutex> Lock(SleepMutex);
+    if (SleepingWorkers != 0)
+      SleepCond.notify_one();
+    else if (!Waiters.empty())
+      Waiters.back()->Cond.notify_one();
+  }
+
+  /// Wake up the threads waiting for the TaskGroup whose counter of pending
+  /// tasks is \p Pending.  The group may already be gone, so \p Pending is
+  /// only compared, never read.
+  void wakeWaiters(const std::atomic<size_t> &Pending) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (Sleepers.load(std::memory_order_relaxed) == 0)
+      return;
+    std::lock_guard<std::mutex> Lock(SleepMutex);
+    for (Waiter *W : Waiters)
+      if (W->Pending == &Pending)
+        W->Cond.notify_one();
+  }
+
+  ExecutorStatistics getStatistics() const {
+    ExecutorStatistics S;
+    auto Add = [&](const Counters &C) {
+      S.TasksRun += C.TasksRun.load(std::memory_order_relaxed);
+      S.Steals += C.Steals.load(std::memory_order_relaxed);
+      S.IdleNanoseconds += C.IdleNanoseconds.load(std::memory_order_relaxed);
+    };
+    for (const auto &W : Workers)
+      Add(W->Stats);
+    std::lock_guard<std::mutex> Lock(ExternalStatsMutex);
+    Add(ExternalStats);
+    return S;
   }
 
 private:
-  void work() {
-    while (true) {
-      std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
-      if (Stop)
-        break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
+  void work(unsigned Index) {
+    CurrentWorker = Workers[Index].get();
+    while (!Stop) {
+      if (Task *T = findTask()) {
+        run(T);
+        continue;
+      }
+      auto IdleStart = std::chrono::steady_clock::now();
+      std::unique_lock<std::mutex> Lock(SleepMutex);
+      Sleepers.fetch_add(1, std::memory_order_seq_cst);
+      if (!Stop && !hasQueuedTasks()) {
+        ++SleepingWorkers;
+        SleepCond.wait(Lock);
+        --SleepingWorkers;
+      }
+      Sleepers.fetch_sub(1, std::memory_order_relaxed);
       Lock.unlock();
-      Task();
+      auto Idle = std::chrono::steady_clock::now() - IdleStart;
+      CurrentWorker->Stats.bump(
+          CurrentWorker->Stats.IdleNanoseconds,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Idle).count());
     }
+    CurrentWorker = nullptr;
     Done.dec();
   }
 
+  void run(Task *T) {
+    (*T)();
+    delete T;
+    if (CurrentWorker) {
+      CurrentWorker->Stats.bump(CurrentWorker->Stats.TasksRun);
+    } else {
+      std::lock_guard<std::mutex> Lock(ExternalStatsMutex);
+      ExternalStats.bump(ExternalStats.TasksRun);
+    }
+  }
+
+  /// Pop a task from the calling thread's own deque, or steal one.
+  Task *findTask() {
+    if (CurrentWorker) {
+      if (Task *T = CurrentWorker->Queue.pop())
+        return T;
+    } else {
+      std::lock_guard<std::mutex> Lock(ExternalMutex);
+      if (Task *T = External.pop())
+        return T;
+    }
+
+    // Start from a different victim each time to spread the thieves.
+    size_t N = Workers.size();
+    size_t Start = NextVictim.fetch_add(1, std::memory_order_relaxed);
+    for (size_t I = 0; I != N; ++I) {
+      Worker *Victim = Workers[(Start + I) % N].get();
+      if (Victim == CurrentWorker)
+        continue;
+      if (Task *T = Victim->Queue.steal()) {
+        countSteal();
+        return T;
+      }
+    }
+    if (CurrentWorker) {
+      if (Task *T = External.steal()) {
+        countSteal();
+        return T;
+      }
+    }
+    return nullptr;
+  }
+
+  void countSteal() {
+    if (CurrentWorker) {
+      CurrentWorker->Stats.bump(CurrentWorker->Stats.Steals);
+    } else {
+      std::lock_guard<std::mutex> Lock(ExternalStatsMutex);
+      ExternalStats.bump(ExternalStats.Steals);
+    }
+  }
+
+  bool hasQueuedTasks() const {
+    if (!External.empty())
+      return true;
+    for (const auto &W : Workers)
+      if (!W->Queue.empty())
+        return true;
+    return false;
+  }
+
+  static LLVM_THREAD_LOCAL Worker *CurrentWorker;
+
+  std::vector<std::unique_ptr<Worker>> Workers;
+  WorkDeque External;
+  std::mutex ExternalMutex;
+  Counters ExternalStats;
+  mutable std::mutex ExternalStatsMutex;
+  std::atomic<size_t> NextVictim{0};
+
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
-  std::mutex Mutex;
-  std::condition_variable Cond;
+  // Threads sleeping in work() or helpUntilZero().
+  std::atomic<unsigned> Sleepers{0};
+  std::mutex SleepMutex;
+  // Workers sleep on SleepCond, threads waiting for a TaskGroup on their own
+  // condition variable.  Both are guarded by SleepMutex.
+  std::condition_variable SleepCond;
+  unsigned SleepingWorkers = 0;
+  std::vector<Waiter *> Waiters;
   parallel::detail::Latch Done;
 };
 
-Executor *Executor::getDefaultExecutor() {
-  static ThreadPoolExecutor exec;
-  return &exec;
-}
-#endif
-}
+LLVM_THREAD_LOCAL ThreadPoolExecutor::Worker *ThreadPoolExecutor::CurrentWorker =
+    nullptr;
 
-static std::atomic<int> TaskGroupInstances;
+ThreadPoolExecutor *getDefaultExecutor() {
+  static ThreadPoolExecutor Exec;
+  return &Exec;
+}
+} // namespace
 
-// Latch::sync() called by the dtor may cause one thread to block. If is a dead
-// lock if all threads in the default executor are blocked. To prevent the dead
-// lock, only allow the first TaskGroup to run tasks parallelly. In the scenario
-// of nested parallel_for_each(), only the outermost one runs parallelly.
-TaskGroup::TaskGroup() : Parallel(TaskGroupInstances++ == 0) {}
-TaskGroup::~TaskGroup() { --TaskGroupInstances; }
+TaskGroup::~TaskGroup() { sync(); }
 
 void TaskGroup::spawn(std::function<void()> F) {
-  if (Parallel) {
-    L.inc();
-    Executor::getDefaultExecutor()->add([&, F] {
-      F();
-      L.dec();
-    });
-  } else {
+  Pending.fetch_add(1, std::memory_order_relaxed);
+  ThreadPoolExecutor *Exec = getDefaultExecutor();
+  Exec->add([this, Exec, F] {
     F();
-  }
+    // The group may be destroyed as soon as Pending drops to zero.
+    if (Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      Exec->wakeWaiters(Pending);
+  });
+}
+
+void TaskGroup::sync() const {
+  if (Pending.load(std::memory_order_acquire) != 0)
+    getDefaultExecutor()->helpUntilZero(Pending);
 }
 
 } // namespace detail
+
+ExecutorStatistics getExecutorStatistics() {
+  return detail::getDefaultExecutor()->getStatistics();
+}
+
 } // namespace parallel
 } // namespace llvm
+
+#else
+
+llvm::parallel::ExecutorStatistics llvm::parallel::getExecutorStatistics() {
+  return ExecutorStatistics();
+}
+
 #endif // LLVM_ENABLE_THREADS
@@ -24,6 +24,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -47,10 +48,39 @@ static cl::opt<bool> StatsAsJSON("stats-json",
                                  cl::desc("Display statistics as json data"),
                                  cl::Hidden);
 
+bool llvm::StatisticShardingEnabled = false;
+
+static cl::opt<bool, true> StatsSharded(
+    "stats-sharded",
+    cl::desc("Count statistics in per-thread counters summed when read"),
+    cl::location(StatisticShardingEnabled), cl::Hidden);
+
 static bool Enabled;
 static bool PrintOnExit;
 
 namespace {
+/// The per-thread counters of the statistics, indexed by Statistic::Index.
+/// Only the owning thread adds to them, so the additions do not contend, but
+/// other threads read and clear them with StatLock held.  The shards are
+/// owned by StatisticInfo and outlive their threads, so the counts of a
+/// finished thread are still summed when a statistic is read.
+struct StatisticShard {
+  std::unique_ptr<std::atomic<uint64_t>[]> Values;
+  unsigned Size = 0;
+
+  /// Make room for the statistic of index \p Index.  StatLock must be held.
+  void grow(unsigned Index);
+
+  uint64_t get(unsigned Index) const {
+    return Index < Size ? Values[Index].load(std::memory_order_relaxed) : 0;
+  }
+
+  uint64_t take(unsigned Index) {
+    return Index < Size ? Values[Index].exchange(0, std::memory_order_relaxed)
+                        : 0;
+  }
+};
+
 /// This class is used in a ManagedStatic so that it is created on demand (when
 /// the first statistic is bumped) and destroyed only when llvm_shutdown is
 /// called. We print statistics from the destructor.
@@ -62,6 +92,7 @@ class StatisticInfo {
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
   friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
+  friend StatisticSnapshot llvm::TakeStatisticSnapshot();
 
   /// Sort statistics by debugtype,name,description.
   void sort();
@@ -82,6 +113,14 @@ public:
   }
 
   void reset();
+
+  /// All statistics that were ever registered, by index.  Unlike Stats, this
+  /// is not cleared by reset(), so that indices stay valid.
+  std::vector<Statistic *> ByIndex{nullptr};
+
+  /// The counters of the threads that updated a statistic while sharding was
+  /// enabled.
+  std::vector<std::unique_ptr<StatisticShard>> Shards;
 };
 } // end anonymous namespace
 
@@ -108,12 +147,86 @@ void Statistic::RegisterStatistic() {
       return;
     if (Stats || Enabled)
       SI.addStatistic(this);
+    if (!Index) {
+      Index = SI.ByIndex.size();
+      SI.ByIndex.push_back(this);
+    }
 
     // Remember we have been registered.
     Initialized.store(true, std::memory_order_release);
   }
 }
 
+void StatisticShard::grow(unsigned Index) {
+  unsigned NewSize = std::max(Index + 1, Size * 2);
+  std::unique_ptr<std::atomic<uint64_t>[]> NewValues(
+      new std::atomic<uint64_t>[NewSize]);
+  for (unsigned I = 0; I != NewSize; ++I)
+    NewValues[I].store(get(I), std::memory_order_relaxed);
+  Values = std::move(NewValues);
+  Size = NewSize;
+}
+
+/// Set once a thread has per-thread counters, after which reading a statistic
+/// has to sum them even if sharding is disabled again.
+static std::atomic<bool> HaveShards(false);
+
+/// The counters of the calling thread, and the generation of StatInfo they
+/// belong to.  The generation changes when llvm_shutdown destroys StatInfo
+/// along with all shards.
+static LLVM_THREAD_LOCAL StatisticShard *ThreadShard = nullptr;
+static LLVM_THREAD_LOCAL unsigned ThreadShardGeneration = 0;
+static std::atomic<unsigned> ShardGeneration(1);
+
+static StatisticShard &getThreadShard() {
+  if (ThreadShard &&
+      ThreadShardGeneration == ShardGeneration.load(std::memory_order_relaxed))
+    return *ThreadShard;
+  // Dereference the ManagedStatics before taking the lock, see
+  // RegisterStatistic.
+  sys::SmartMutex<true> &Lock = *StatLock;
+  StatisticInfo &SI = *StatInfo;
+  sys::SmartScopedLock<true> Writer(Lock);
+  SI.Shards.push_back(llvm::make_unique<StatisticShard>());
+  HaveShards.store(true, std::memory_order_relaxed);
+  ThreadShard = SI.Shards.back().get();
+  ThreadShardGeneration = ShardGeneration.load(std::memory_order_relaxed);
+  return *ThreadShard;
+}
+
+uint64_t Statistic::addSharded(uint64_t Delta) {
+  StatisticShard &Shard = getThreadShard();
+  if (Index >= Shard.Size) {
+    sys::SmartScopedLock<true> Writer(*StatLock);
+    Shard.grow(Index);
+  }
+  return Shard.Values[Index].fetch_add(Delta, std::memory_order_relaxed);
+}
+
+void Statistic::setSharded(uint64_t Val) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  for (auto &Shard : StatInfo->Shards)
+    Shard->take(Index);
+  Value.store(Val, std::memory_order_relaxed);
+}
+
+void Statistic::updateMaxSharded(uint64_t V) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  uint64_t Current = getValue();
+  if (V > Current)
+    Value.fetch_add(V - Current, std::memory_order_relaxed);
+}
+
+uint64_t Statistic::getValue() const {
+  uint64_t Result = Value.load(std::memory_order_relaxed);
+  if (!Index || !HaveShards.load(std::memory_order_relaxed))
+    return Result;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  for (const auto &Shard : StatInfo->Shards)
+    Result += Shard->get(Index);
+  return Result;
+}
+
 StatisticInfo::StatisticInfo() {
   // Ensure timergroup lists are created first so they are destructed after us.
   TimerGroup::ConstructTimerLists();
@@ -123,6 +236,8 @@ StatisticInfo::StatisticInfo() {
 StatisticInfo::~StatisticInfo() {
   if (::Stats || PrintOnExit)
     llvm::PrintStatistics();
+  // The shards go away with us; threads have to get new ones.
+  ShardGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 void llvm::EnableStatistics(bool PrintOnExit) {
@@ -158,6 +273,8 @@ void StatisticInfo::reset() {
     // iteration for that statistic will be lost as intended.
     Stat->Initialized = false;
     Stat->Value = 0;
+    for (auto &Shard : Shards)
+      Shard->take(Stat->Index);
   }
 
   // Clear the registration list and release the lock once we're done. Any
@@ -169,35 +286,84 @@ void StatisticInfo::reset() {
 }
 
 void llvm::PrintStatistics(raw_ostream &OS) {
-  StatisticInfo &Stats = *StatInfo;
+  TakeStatisticSnapshot().print(OS);
+}
 
+void StatisticSnapshot::print(raw_ostream &OS) const {
   // Figure out how long the biggest Value and Name fields are.
   unsigned MaxDebugTypeLen = 0, MaxValLen = 0;
-  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
-    MaxValLen = std::max(MaxValLen,
-                         (unsigned)utostr(Stats.Stats[i]->getValue()).size());
-    MaxDebugTypeLen = std::max(MaxDebugTypeLen,
-                         (unsigned)std::strlen(Stats.Stats[i]->getDebugType()));
+  for (const Entry &E : Entries) {
+    MaxValLen = std::max(MaxValLen, (unsigned)utostr(E.Value).size());
+    MaxDebugTypeLen =
+        std::max(MaxDebugTypeLen, (unsigned)std::strlen(E.DebugType));
   }
 
-  Stats.sort();
-
   // Print out the statistics header...
   OS << "===" << std::string(73, '-') << "===\n"
      << "                          ... Statistics Collected ...\n"
      << "===" << std::string(73, '-') << "===\n\n";
 
   // Print all of the statistics.
-  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i)
-    OS << format("%*u %-*s - %s\n",
-                 MaxValLen, Stats.Stats[i]->getValue(),
-                 MaxDebugTypeLen, Stats.Stats[i]->getDebugType(),
-                 Stats.Stats[i]->getDesc());
+  for (const Entry &E : Entries)
+    OS << format("%*" PRIu64 " %-*s - %s\n", MaxValLen, E.Value,
+                 MaxDebugTypeLen, E.DebugType, E.Desc);
 
   OS << '\n';  // Flush the output stream.
   OS.flush();
 }
 
+uint64_t StatisticSnapshot::lookup(StringRef DebugType, StringRef Name) const {
+  for (const Entry &E : Entries)
+    if (DebugType == E.DebugType && Name == E.Name)
+      return E.Value;
+  return 0;
+}
+
+/// Order entries the way StatisticInfo::sort orders the statistics.
+static int compareEntries(const StatisticSnapshot::Entry &LHS,
+                          const StatisticSnapshot::Entry &RHS) {
+  if (int Cmp = std::strcmp(LHS.DebugType, RHS.DebugType))
+    return Cmp;
+  if (int Cmp = std::strcmp(LHS.Name, RHS.Name))
+    return Cmp;
+  return std::strcmp(LHS.Desc, RHS.Desc);
+}
+
+StatisticSnapshot
+StatisticSnapshot::diff(const StatisticSnapshot &Earlier) const {
+  // Both snapshots are sorted, so walk them side by side.
+  StatisticSnapshot Result;
+  auto EI = Earlier.Entries.begin(), EE = Earlier.Entries.end();
+  for (const Entry &E : Entries) {
+    while (EI != EE && compareEntries(*EI, E) < 0)
+      ++EI;
+    uint64_t Delta = E.Value;
+    if (EI != EE && compareEntries(*EI, E) == 0)
+      Delta -= EI->Value;
+    if (Delta)
+      Result.Entries.push_back({E.DebugType, E.Name, E.Desc, Delta});
+  }
+  return Result;
+}
+
+StatisticSnapshot llvm::TakeStatisticSnapshot() {
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  StatisticInfo &Stats = *StatInfo;
+
+  Stats.sort();
+
+  StatisticSnapshot Result;
+  Result.Entries.reserve(Stats.Stats.size());
+  for (const Statistic *Stat : Stats.Stats)
+    Result.Entries.push_back({Stat->getDebugType(), Stat->getName(),
+                              Stat->getDesc(), Stat->getValue()});
+  return Result;
+}
+
+void llvm::EnableShardedStatistics() {
+  StatisticShardingEnabled = true;
+}
+
 void llvm::PrintStatisticsJSON(raw_ostream &OS) {
   sys::SmartScopedLock<true> Reader(*StatLock);
   StatisticInfo &Stats = *StatInfo;
@@ -252,9 +418,9 @@ void llvm::PrintStatistics() {
 #endif
 }
 
-const std::vector<std::pair<StringRef, unsigned>> llvm::GetStatistics() {
+const std::vector<std::pair<StringRef, uint64_t>> llvm::GetStatistics() {
   sys::SmartScopedLock<true> Reader(*StatLock);
-  std::vector<std::pair<StringRef, unsigned>> ReturnStats;
+  std::vector<std::pair<StringRef, uint64_t>> ReturnStats;
 
   for (const auto &Stat : StatInfo->statistics())
     ReturnStats.emplace_back(Stat->getName(), Stat->getValue());
@@ -12,8 +12,14 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/edit_distance.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
 #include <bitset>
 
+#if LLVM_X86_TARGET_DISPATCH
+#include <immintrin.h>
+#endif
+
 using namespace llvm;
 
 // MSVC emits references to this into the translation units which reference it.
@@ -124,6 +130,75 @@ std::string StringRef::upper() const {
 // String Searching
 //===----------------------------------------------------------------------===//
 
+// Vectorized search for needles of at least two bytes: compare the first and
+// the last byte of the needle with a block of candidate positions at once,
+// and only memcmp the candidates where both match.  Count is the number of
+// candidate positions; the functions return the offset of the first match
+// from Start, or StringRef::npos.
+
+/// Check the candidates in \p Mask, lowest first.
+static inline size_t findInMask(uint32_t Mask, const char *Start, size_t I,
+                                const char *Needle, size_t N) {
+  while (Mask) {
+    size_t Pos = I + countTrailingZeros(Mask);
+    if (std::memcmp(Start + Pos + 1, Needle + 1, N - 2) == 0)
+      return Pos;
+    Mask &= Mask - 1;
+  }
+  return StringRef::npos;
+}
+
+static size_t findTail(const char *Start, size_t I, size_t Count,
+                       const char *Needle, size_t N) {
+  for (; I < Count; ++I)
+    if (std::memcmp(Start + I, Needle, N) == 0)
+      return I;
+  return StringRef::npos;
+}
+
+#if LLVM_X86_TARGET_DISPATCH
+__attribute__((target("avx2"))) static size_t
+findAVX2(const char *Start, size_t Count, const char *Needle, size_t N) {
+  const __m256i First = _mm256_set1_epi8(Needle[0]);
+  const __m256i Last = _mm256_set1_epi8(Needle[N - 1]);
+  size_t I = 0;
+  for (; I + 32 <= Count; I += 32) {
+    __m256i BlockFirst =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Start + I));
+    __m256i BlockLast = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(Start + I + N - 1));
+    __m256i Eq = _mm256_and_si256(_mm256_cmpeq_epi8(First, BlockFirst),
+                                  _mm256_cmpeq_epi8(Last, BlockLast));
+    uint32_t Mask = _mm256_movemask_epi8(Eq);
+    size_t Pos = findInMask(Mask, Start, I, Needle, N);
+    if (Pos != StringRef::npos)
+      return Pos;
+  }
+  return findTail(Start, I, Count, Needle, N);
+}
+#endif
+
+#if LLVM_X86_TARGET_DISPATCH && defined(__SSE2__)
+static size_t findSSE2(const char *Start, size_t Count, const char *Needle,
+                       size_t N) {
+  const __m128i First = _mm_set1_epi8(Needle[0]);
+  const __m128i Last = _mm_set1_epi8(Needle[N - 1]);
+  size_t I = 0;
+  for (; I + 16 <= Count; I += 16) {
+    __m128i BlockFirst =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Start + I));
+    __m128i BlockLast =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Start + I + N - 1));
+    __m128i Eq = _mm_and_si128(_mm_cmpeq_epi8(First, BlockFirst),
+                               _mm_cmpeq_epi8(Last, BlockLast));
+    uint32_t Mask = _mm_movemask_epi8(Eq);
+    size_t Pos = findInMask(Mask, Start, I, Needle, N);
+    if (Pos != StringRef::npos)
+      return Pos;
+  }
+  return findTail(Start, I, Count, Needle, N);
+}
+#endif
 
 /// find - Search for the first string \arg Str in the string.
 ///
@@ -149,6 +224,23 @@ size_t StringRef::find(StringRef Str, size_t From) const {
 
   const char *Stop = Start + (Size - N + 1);
 
+#if LLVM_X86_TARGET_DISPATCH
+  // Use the vectorized search once there is at least one block of candidate
+  // positions.  It finds the same, first, occurrence as the code below.
+  size_t Count = Stop - Start;
+  if (Count >= 16 && sys::isTargetDispatchEnabled()) {
+    auto ToIndex = [From](size_t Pos) {
+      return Pos == npos ? npos : From + Pos;
+    };
+    static const bool HasAVX2 = sys::hasHostCPUFeature("avx2");
+    if (HasAVX2 && Count >= 32)
+      return ToIndex(findAVX2(Start, Count, Needle, N));
+#if defined(__SSE2__)
+    return ToIndex(findSSE2(Start, Count, Needle, N));
+#endif
+  }
+#endif
+
   // For short haystacks or unsupported needles fall back to the naive algorithm
   if (Size < 16 || N > 255) {
     do {
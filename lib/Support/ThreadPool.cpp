@@ -12,76 +12,107 @@
 
 #include "llvm/Support/ThreadPool.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 
+bool ThreadPool::popTask(QueuedTask &Task, ThreadPoolTaskGroup *Group) {
+  for (auto &Queue : llvm::reverse(Tasks)) {
+    auto I = Group ? llvm::find_if(Queue,
+                                   [&](const QueuedTask &T) {
+                                     return T.Group == Group;
+                                   })
+                   : Queue.begin();
+    if (I == Queue.end())
+      continue;
+    Task = std::move(*I);
+    Queue.erase(I);
+    return true;
+  }
+  return false;
+}
+
+bool ThreadPool::hasQueuedTasks() const {
+  return llvm::any_of(Tasks, [](const std::deque<QueuedTask> &Queue) {
+    return !Queue.empty();
+  });
+}
+
 #if LLVM_ENABLE_THREADS
 
 // Default to hardware_concurrency
 ThreadPool::ThreadPool() : ThreadPool(hardware_concurrency()) {}
 
-ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0), EnableFlag(true) {
+ThreadPool::ThreadPool(unsigned ThreadCount) : EnableFlag(true) {
   // Create ThreadCount threads that will loop forever, wait on QueueCondition
   // for tasks to be queued or the Pool to be destroyed.
   Threads.reserve(ThreadCount);
   for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
     Threads.emplace_back([&] {
+      std::unique_lock<std::mutex> LockGuard(QueueLock);
       while (true) {
-        PackagedTaskTy Task;
-        {
-          std::unique_lock<std::mutex> LockGuard(QueueLock);
-          // Wait for tasks to be pushed in the queue
-          QueueCondition.wait(LockGuard,
-                              [&] { return !EnableFlag || !Tasks.empty(); });
-          // Exit condition
-          if (!EnableFlag && Tasks.empty())
-            return;
-          // Yeah, we have a task, grab it and release the lock on the queue
-
-          // We first need to signal that we are active before popping the queue
-          // in order for wait() to properly detect that even if the queue is
-          // empty, there is still a task in flight.
-          {
-            std::unique_lock<std::mutex> LockGuard(CompletionLock);
-            ++ActiveThreads;
-          }
-          Task = std::move(Tasks.front());
-          Tasks.pop();
-        }
-        // Run the task we just grabbed
-        Task();
-
-        {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
-          std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          --ActiveThreads;
-        }
-
-        // Notify task completion, in case someone waits on ThreadPool::wait()
-        CompletionCondition.notify_all();
+        // Wait for tasks to be pushed in the queue
+        QueueCondition.wait(LockGuard,
+                            [&] { return !EnableFlag || hasQueuedTasks(); });
+        // Exit condition
+        QueuedTask Task;
+        if (!popTask(Task, nullptr))
+          return;
+        runTask(Task, LockGuard);
       }
     });
   }
 }
 
+void ThreadPool::runTask(QueuedTask &Task, std::unique_lock<std::mutex> &Lock) {
+  // Signal that we are active before releasing the lock, so that wait()
+  // sees the task in flight even though the queue may be empty.
+  ++ActiveThreads;
+  Lock.unlock();
+  Task.Fn();
+  Task.Fn = nullptr;
+  Lock.lock();
+  --ActiveThreads;
+  if (Task.Group)
+    --Task.Group->Pending;
+  // Notify task completion, in case someone waits on ThreadPool::wait()
+  CompletionCondition.notify_all();
+}
+
+bool ThreadPool::isWorkerThread() const {
+  std::thread::id CurrentID = std::this_thread::get_id();
+  return llvm::any_of(Threads, [&](const llvm::thread &Thread) {
+    return Thread.get_id() == CurrentID;
+  });
+}
+
 void ThreadPool::wait() {
+  assert(!isWorkerThread() && "ThreadPool::wait() from a task would deadlock");
   // Wait for all threads to complete and the queue to be empty
-  std::unique_lock<std::mutex> LockGuard(CompletionLock);
-  // The order of the checks for ActiveThreads and Tasks.empty() matters because
-  // any active threads might be modifying the Tasks queue, and this would be a
-  // race.
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
   CompletionCondition.wait(LockGuard,
-                           [&] { return !ActiveThreads && Tasks.empty(); });
+                           [&] { return !ActiveThreads && !hasQueuedTasks(); });
+}
+
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  bool Help = isWorkerThread();
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  while (Group.Pending) {
+    // A task waiting for its own group would tie up a thread of the pool,
+    // so run the queued tasks of the group here instead.
+    QueuedTask Task;
+    if (Help && popTask(Task, &Group))
+      runTask(Task, LockGuard);
+    else
+      CompletionCondition.wait(LockGuard);
+  }
 }
 
-std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
-  /// Wrap the Task in a packaged_task to return a future object.
-  PackagedTaskTy PackagedTask(std::move(Task));
-  auto Future = PackagedTask.get_future();
+void ThreadPool::enqueue(TaskTy Task, ThreadPoolTaskGroup *Group,
+                         ThreadPoolPriority Priority) {
   {
     // Lock the queue and push the new task
     std::unique_lock<std::mutex> LockGuard(QueueLock);
@@ -89,10 +120,14 @@ std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
     // Don't allow enqueueing after disabling the pool
     assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
 
-    Tasks.push(std::move(PackagedTask));
+    if (Group)
+      ++Group->Pending;
+    Tasks[static_cast<unsigned>(Priority)].push_back({std::move(Task), Group});
   }
   QueueCondition.notify_one();
-  return Future.share();
+  // Wake up the pool threads waiting for this group, if any, to run the task.
+  if (Group)
+    CompletionCondition.notify_all();
 }
 
 // The destructor joins all threads, waiting for completion.
@@ -111,8 +146,7 @@ ThreadPool::~ThreadPool() {
 ThreadPool::ThreadPool() : ThreadPool(0) {}
 
 // No threads are launched, issue a warning if ThreadCount is not 0
-ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0) {
+ThreadPool::ThreadPool(unsigned ThreadCount) {
   if (ThreadCount) {
     errs() << "Warning: request a ThreadPool with " << ThreadCount
            << " threads, but LLVM_ENABLE_THREADS has been turned off\n";
@@ -121,21 +155,28 @@ ThreadPool::ThreadPool(unsigned ThreadCount)
 
 void ThreadPool::wait() {
   // Sequential implementation running the tasks
-  while (!Tasks.empty()) {
-    auto Task = std::move(Tasks.front());
-    Tasks.pop();
-    Task();
+  QueuedTask Task;
+  while (popTask(Task, nullptr)) {
+    Task.Fn();
+    if (Task.Group)
+      --Task.Group->Pending;
+  }
+}
+
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  // Sequential implementation running the tasks of the group
+  QueuedTask Task;
+  while (popTask(Task, &Group)) {
+    Task.Fn();
+    --Group.Pending;
   }
 }
 
-std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
-  // Get a Future with launch::deferred execution using std::async
-  auto Future = std::async(std::launch::deferred, std::move(Task)).share();
-  // Wrap the future so that both ThreadPool::wait() can operate and the
-  // returned future can be sync'ed on.
-  PackagedTaskTy PackagedTask([Future]() { Future.get(); });
-  Tasks.push(std::move(PackagedTask));
-  return Future;
+void ThreadPool::enqueue(TaskTy Task, ThreadPoolTaskGroup *Group,
+                         ThreadPoolPriority Priority) {
+  if (Group)
+    ++Group->Pending;
+  Tasks[static_cast<unsigned>(Priority)].push_back({std::move(Task), Group});
 }
 
 ThreadPool::~ThreadPool() {
@@ -11,12 +11,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/Threading.h"
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -30,51 +39,64 @@ static cl::opt<unsigned> TimeTraceGranularity(
         "Minimum time granularity (in microseconds) traced by time profiler"),
     cl::init(500));
 
+static cl::opt<unsigned> TimeTraceBufferSize(
+    "time-trace-buffer-size",
+    cl::desc("Number of time sections kept per thread by the time profiler; "
+             "the oldest ones are dropped when a thread records more"),
+    cl::init(16384));
+
 TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
 
 typedef duration<steady_clock::rep, steady_clock::period> DurationType;
 typedef std::pair<size_t, DurationType> CountAndDurationType;
-typedef std::pair<std::string, CountAndDurationType>
+typedef std::pair<StringRef, CountAndDurationType>
     NameAndCountAndDurationType;
 
 struct Entry {
   time_point<steady_clock> Start;
   DurationType Duration;
-  std::string Name;
+  StringRef Name;
   std::string Detail;
-
-  Entry(time_point<steady_clock> &&S, DurationType &&D, std::string &&N,
-        std::string &&Dt)
-      : Start(std::move(S)), Duration(std::move(D)), Name(std::move(N)),
-        Detail(std::move(Dt)){};
 };
 
-struct TimeTraceProfiler {
-  TimeTraceProfiler() {
-    StartTime = steady_clock::now();
+namespace {
+
+/// The sections recorded by one thread.  Only the owning thread touches it
+/// until the profile is written.  Names are interned in a per-thread pool,
+/// as there are few of them and the totals are kept by name.  Details are
+/// mostly unique, so each entry owns its own, which is freed when the entry
+/// is overwritten.  Finished sections go to a ring buffer allocated up
+/// front, so the memory used by a thread is bounded by the buffer size.
+struct ThreadTrace {
+  ThreadTrace(unsigned Tid, unsigned Granularity, size_t Capacity)
+      : Tid(Tid), OSThreadID(get_threadid()), Granularity(Granularity),
+        Names(Alloc), Entries(std::max<size_t>(Capacity, 1)) {
+    get_thread_name(ThreadName);
   }
 
-  void begin(std::string Name, llvm::function_ref<std::string()> Detail) {
-    Stack.emplace_back(steady_clock::now(), DurationType{}, std::move(Name),
-                       Detail());
+  void begin(StringRef Name, llvm::function_ref<std::string()> Detail) {
+    Stack.push_back(
+        {steady_clock::now(), DurationType{}, Names.save(Name), Detail()});
   }
 
   void end() {
     assert(!Stack.empty() && "Must call begin() first");
-    auto &E = Stack.back();
+    Entry &E = Stack.back();
     E.Duration = steady_clock::now() - E.Start;
 
-    // Only include sections longer than TimeTraceGranularity msec.
-    if (duration_cast<microseconds>(E.Duration).count() > TimeTraceGranularity)
-      Entries.emplace_back(E);
+    // Only include sections longer than Granularity msec.
+    // The detail is moved out of E; the name and duration are still used
+    // below.
+    if (duration_cast<microseconds>(E.Duration).count() > Granularity)
+      record(std::move(E));
 
     // Track total time taken by each "name", but only the topmost levels of
     // them; e.g. if there's a template instantiation that instantiates other
     // templates from within, we only want to add the topmost one. "topmost"
     // happens to be the ones that don't have any currently open entries above
-    // itself.
+    // itself.  Names are interned, so comparing the data pointers is enough.
     if (std::find_if(++Stack.rbegin(), Stack.rend(), [&](const Entry &Val) {
-          return Val.Name == E.Name;
+          return Val.Name.data() == E.Name.data();
         }) == Stack.rend()) {
       auto &CountAndTotal = CountAndTotalPerName[E.Name];
       CountAndTotal.first++;
@@ -84,33 +106,118 @@ struct TimeTraceProfiler {
     Stack.pop_back();
   }
 
+  void record(Entry &&E) {
+    Entries[Next] = std::move(E);
+    if (++Next == Entries.size())
+      Next = 0;
+    if (Size == Entries.size())
+      ++Dropped;
+    else
+      ++Size;
+  }
+
+  /// Return the number of bytes held by this trace.
+  size_t getMemoryUsage() const {
+    size_t Bytes = Alloc.getTotalMemory() + Stack.capacity() * sizeof(Entry) +
+                   Entries.capacity() * sizeof(Entry);
+    for (const Entry &E : Stack)
+      Bytes += E.Detail.capacity();
+    for (const Entry &E : Entries)
+      Bytes += E.Detail.capacity();
+    return Bytes;
+  }
+
+  /// Call \p F on the recorded sections, oldest first.
+  template <typename Fn> void forEachEntry(Fn F) const {
+    size_t First = Size == Entries.size() ? Next : 0;
+    for (size_t I = 0; I != Size; ++I)
+      F(Entries[(First + I) % Entries.size()]);
+  }
+
+  unsigned Tid;
+  uint64_t OSThreadID;
+  unsigned Granularity;
+  SmallString<32> ThreadName;
+  BumpPtrAllocator Alloc;
+  UniqueStringSaver Names;
+  SmallVector<Entry, 16> Stack;
+  std::vector<Entry> Entries;
+  size_t Next = 0;
+  size_t Size = 0;
+  size_t Dropped = 0;
+  DenseMap<StringRef, CountAndDurationType> CountAndTotalPerName;
+};
+
+} // end anonymous namespace
+
+/// The thread the calling thread records to, and the profiler it belongs to.
+/// The profiler is identified by its generation rather than its address, as
+/// a new profiler may be allocated where an old one was.
+static LLVM_THREAD_LOCAL ThreadTrace *CurrentThreadTrace = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentThreadGeneration = 0;
+static std::atomic<unsigned> ProfilerGeneration(0);
+
+struct TimeTraceProfiler {
+  TimeTraceProfiler(unsigned Granularity, unsigned BufferSize)
+      : Generation(++ProfilerGeneration), StartTime(steady_clock::now()),
+        Granularity(Granularity), BufferSize(BufferSize) {}
+
+  /// Return the trace of the calling thread, registering the thread the
+  /// first time.
+  ThreadTrace &getThreadTrace() {
+    if (CurrentThreadGeneration == Generation)
+      return *CurrentThreadTrace;
+    std::lock_guard<std::mutex> Lock(ThreadsLock);
+    Threads.push_back(llvm::make_unique<ThreadTrace>(Threads.size(),
+                                                     Granularity, BufferSize));
+    CurrentThreadTrace = Threads.back().get();
+    CurrentThreadGeneration = Generation;
+    return *CurrentThreadTrace;
+  }
+
+  void begin(StringRef Name, llvm::function_ref<std::string()> Detail) {
+    getThreadTrace().begin(Name, Detail);
+  }
+
+  void end() { getThreadTrace().end(); }
+
   void Write(raw_pwrite_stream &OS) {
-    assert(Stack.empty() &&
-           "All profiler sections should be ended when calling Write");
+    std::lock_guard<std::mutex> Lock(ThreadsLock);
     json::OStream J(OS);
     J.objectBegin();
     J.attributeBegin("traceEvents");
     J.arrayBegin();
 
-    // Emit all events for the main flame graph.
-    for (const auto &E : Entries) {
-      auto StartUs = duration_cast<microseconds>(E.Start - StartTime).count();
-      auto DurUs = duration_cast<microseconds>(E.Duration).count();
+    // Emit all events for the main flame graph, one track per thread.
+    StringMap<CountAndDurationType> CountAndTotalPerName;
+    for (const auto &T : Threads) {
+      assert(T->Stack.empty() &&
+             "All profiler sections should be ended when calling Write");
+      T->forEachEntry([&](const Entry &E) {
+        auto StartUs = duration_cast<microseconds>(E.Start - StartTime).count();
+        auto DurUs = duration_cast<microseconds>(E.Duration).count();
 
-      J.object([&]{
-        J.attribute("pid", 1);
-        J.attribute("tid", 0);
-        J.attribute("ph", "X");
-        J.attribute("ts", StartUs);
-        J.attribute("dur", DurUs);
-        J.attribute("name", E.Name);
-        J.attributeObject("args", [&] { J.attribute("detail", E.Detail); });
+        J.object([&]{
+          J.attribute("pid", 1);
+          J.attribute("tid", int64_t(T->Tid));
+          J.attribute("ph", "X");
+          J.attribute("ts", StartUs);
+          J.attribute("dur", DurUs);
+          J.attribute("name", E.Name);
+          J.attributeObject("args", [&] { J.attribute("detail", E.Detail); });
+        });
       });
+
+      for (const auto &E : T->CountAndTotalPerName) {
+        auto &CountAndTotal = CountAndTotalPerName[E.first];
+        CountAndTotal.first += E.second.first;
+        CountAndTotal.second += E.second.second;
+      }
     }
 
     // Emit totals by section name as additional "thread" events, sorted from
-    // longest one.
-    int Tid = 1;
+    // longest one.  Totals are summed over all threads.
+    int64_t Tid = Threads.size();
     std::vector<NameAndCountAndDurationType> SortedTotals;
     SortedTotals.reserve(CountAndTotalPerName.size());
     for (const auto &E : CountAndTotalPerName)
@@ -123,7 +230,7 @@ struct TimeTraceProfiler {
                });
     for (const auto &E : SortedTotals) {
       auto DurUs = duration_cast<microseconds>(E.second.second).count();
-      auto Count = CountAndTotalPerName[E.first].first;
+      auto Count = E.second.first;
 
       J.object([&]{
         J.attribute("pid", 1);
@@ -131,7 +238,7 @@ struct TimeTraceProfiler {
         J.attribute("ph", "X");
         J.attribute("ts", 0);
         J.attribute("dur", DurUs);
-        J.attribute("name", "Total " + E.first);
+        J.attribute("name", ("Total " + E.first).str());
         J.attributeObject("args", [&] {
           J.attribute("count", int64_t(Count));
           J.attribute("avg ms", int64_t(DurUs / Count / 1000));
@@ -152,21 +259,55 @@ struct TimeTraceProfiler {
       J.attributeObject("args", [&] { J.attribute("name", "clang"); });
     });
 
+    // Emit metadata events naming the thread tracks.
+    for (const auto &T : Threads) {
+      std::string Name = T->ThreadName.empty()
+                             ? "thread " + std::to_string(T->OSThreadID)
+                             : std::string(T->ThreadName.str());
+      if (T->Dropped)
+        Name += " (" + std::to_string(T->Dropped) + " sections dropped)";
+      J.object([&] {
+        J.attribute("cat", "");
+        J.attribute("pid", 1);
+        J.attribute("tid", int64_t(T->Tid));
+        J.attribute("ts", 0);
+        J.attribute("ph", "M");
+        J.attribute("name", "thread_name");
+        J.attributeObject("args", [&] { J.attribute("name", Name); });
+      });
+    }
+
     J.arrayEnd();
     J.attributeEnd();
     J.objectEnd();
   }
 
-  SmallVector<Entry, 16> Stack;
-  SmallVector<Entry, 128> Entries;
-  StringMap<CountAndDurationType> CountAndTotalPerName;
+  size_t getMemoryUsage() {
+    std::lock_guard<std::mutex> Lock(ThreadsLock);
+    size_t Bytes = 0;
+    for (const auto &T : Threads)
+      Bytes += T->getMemoryUsage();
+    return Bytes;
+  }
+
+  const unsigned Generation;
   time_point<steady_clock> StartTime;
+  const unsigned Granularity;
+  const unsigned BufferSize;
+  std::mutex ThreadsLock;
+  std::vector<std::unique_ptr<ThreadTrace>> Threads;
 };
 
 void timeTraceProfilerInitialize() {
+  timeTraceProfilerInitialize(TimeTraceGranularity, TimeTraceBufferSize);
+}
+
+void timeTraceProfilerInitialize(unsigned Granularity, unsigned BufferSize) {
   assert(TimeTraceProfilerInstance == nullptr &&
          "Profiler should not be initialized");
-  TimeTraceProfilerInstance = new TimeTraceProfiler();
+  TimeTraceProfilerInstance = new TimeTraceProfiler(Granularity, BufferSize);
+  // The initializing thread gets the first track.
+  TimeTraceProfilerInstance->getThreadTrace();
 }
 
 void timeTraceProfilerCleanup() {
@@ -180,6 +321,12 @@ void timeTraceProfilerWrite(raw_pwrite_stream &OS) {
   TimeTraceProfilerInstance->Write(OS);
 }
 
+size_t timeTraceProfilerMemoryUsage() {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "Profiler object can't be null");
+  return TimeTraceProfilerInstance->getMemoryUsage();
+}
+
 void timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
   if (TimeTraceProfilerInstance != nullptr)
     TimeTraceProfilerInstance->begin(Name, [&]() { return Detail; });
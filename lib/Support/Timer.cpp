@@ -14,6 +14,7 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -22,7 +23,17 @@
 #include "llvm/Support/Signposts.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <limits>
+#include <memory>
+#include <vector>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace llvm;
 
@@ -49,6 +60,13 @@ namespace {
                                       "tracking (this may be slow)"),
              cl::Hidden);
 
+  static cl::opt<bool>
+  TrackPerfCounters("track-perf-counters",
+                    cl::desc("Enable -time-passes hardware performance "
+                             "counters (cycles, instructions, cache and "
+                             "branch misses; Linux perf_event only)"),
+                    cl::Hidden);
+
   static cl::opt<std::string, true>
   InfoOutputFilename("info-output-file", cl::value_desc("filename"),
                      cl::desc("File to append -stats and -timer output to"),
@@ -114,26 +132,174 @@ static inline size_t getMemUsage() {
   return sys::Process::GetMallocUsage();
 }
 
+namespace {
+/// Raw values of the hardware performance counters of the calling thread.
+struct PerfCounterValues {
+  uint64_t Cycles = 0;
+  uint64_t Instructions = 0;
+  uint64_t CacheMisses = 0;
+  uint64_t BranchMisses = 0;
+  /// How long the counters were enabled, and actually counting.
+  uint64_t TimeEnabled = 0;
+  uint64_t TimeRunning = 0;
+};
+
+#if defined(__linux__)
+/// A perf_event group counting the user space cycles, instructions, cache
+/// misses and branch misses of the thread that opened it.  The counters are
+/// read together.  If the kernel had to multiplex them, the difference of
+/// two readings is scaled up by TimeRecord::scalePerfCounters.
+class PerfCounterGroup {
+  enum { NumCounters = 4 };
+  int FDs[NumCounters];
+  bool Valid = false;
+
+  static int open(uint64_t Config, int GroupFD) {
+    perf_event_attr Attr;
+    memset(&Attr, 0, sizeof(Attr));
+    Attr.size = sizeof(Attr);
+    Attr.type = PERF_TYPE_HARDWARE;
+    Attr.config = Config;
+    Attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    Attr.exclude_kernel = 1;
+    Attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &Attr, /*pid=*/0, /*cpu=*/-1, GroupFD,
+                   /*flags=*/0);
+  }
+
+public:
+  PerfCounterGroup() {
+    static const uint64_t Configs[NumCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    std::fill(std::begin(FDs), std::end(FDs), -1);
+    for (unsigned I = 0; I != NumCounters; ++I) {
+      FDs[I] = open(Configs[I], I == 0 ? -1 : FDs[0]);
+      if (FDs[I] < 0) {
+        static bool Warned = false;
+        if (!Warned)
+          errs() << "warning: -track-perf-counters: cannot open hardware "
+                    "performance counters\n";
+        Warned = true;
+        return;
+      }
+    }
+    Valid = true;
+  }
+
+  ~PerfCounterGroup() {
+    for (int FD : FDs)
+      if (FD >= 0)
+        ::close(FD);
+  }
+
+  PerfCounterValues read() const {
+    PerfCounterValues Result;
+    if (!Valid)
+      return Result;
+    // { nr, time_enabled, time_running, values[nr] }
+    uint64_t Data[3 + NumCounters];
+    if (::read(FDs[0], Data, sizeof(Data)) != sizeof(Data) ||
+        Data[0] != NumCounters)
+      return Result;
+    Result.TimeEnabled = Data[1];
+    Result.TimeRunning = Data[2];
+    Result.Cycles = Data[3];
+    Result.Instructions = Data[4];
+    Result.CacheMisses = Data[5];
+    Result.BranchMisses = Data[6];
+    return Result;
+  }
+};
+#endif
+} // namespace
+
+#if defined(__linux__)
+static std::atomic<unsigned> PerfCountersGeneration(1);
+
+namespace {
+/// The counter groups opened by all threads.  A group only counts the thread
+/// that opened it, so every thread needs its own.  They are closed by
+/// llvm_shutdown, which starts a new generation.
+struct PerfCounterGroupList {
+  sys::SmartMutex<true> Lock;
+  std::vector<std::unique_ptr<PerfCounterGroup>> Groups;
+
+  ~PerfCounterGroupList() {
+    PerfCountersGeneration.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+} // namespace
+
+static ManagedStatic<PerfCounterGroupList> PerfCounterGroups;
+static LLVM_THREAD_LOCAL PerfCounterGroup *ThreadPerfCounters = nullptr;
+static LLVM_THREAD_LOCAL unsigned ThreadPerfCountersGeneration = 0;
+#endif
+
+static PerfCounterValues getPerfCounters() {
+  if (!TrackPerfCounters)
+    return PerfCounterValues();
+#if defined(__linux__)
+  if (!ThreadPerfCounters ||
+      ThreadPerfCountersGeneration !=
+          PerfCountersGeneration.load(std::memory_order_relaxed)) {
+    PerfCounterGroupList &List = *PerfCounterGroups;
+    sys::SmartScopedLock<true> Lock(List.Lock);
+    List.Groups.push_back(llvm::make_unique<PerfCounterGroup>());
+    ThreadPerfCounters = List.Groups.back().get();
+    ThreadPerfCountersGeneration =
+        PerfCountersGeneration.load(std::memory_order_relaxed);
+  }
+  return ThreadPerfCounters->read();
+#else
+  return PerfCounterValues();
+#endif
+}
+
 TimeRecord TimeRecord::getCurrentTime(bool Start) {
   using Seconds = std::chrono::duration<double, std::ratio<1>>;
   TimeRecord Result;
   sys::TimePoint<> now;
   std::chrono::nanoseconds user, sys;
+  PerfCounterValues Counters;
 
   if (Start) {
     Result.MemUsed = getMemUsage();
     sys::Process::GetTimeUsage(now, user, sys);
+    Counters = getPerfCounters();
   } else {
+    Counters = getPerfCounters();
     sys::Process::GetTimeUsage(now, user, sys);
     Result.MemUsed = getMemUsage();
   }
 
+  Result.Cycles = Counters.Cycles;
+  Result.Instructions = Counters.Instructions;
+  Result.CacheMisses = Counters.CacheMisses;
+  Result.BranchMisses = Counters.BranchMisses;
+  Result.PerfTimeEnabled = Counters.TimeEnabled;
+  Result.PerfTimeRunning = Counters.TimeRunning;
+
   Result.WallTime = Seconds(now.time_since_epoch()).count();
   Result.UserTime = Seconds(user).count();
   Result.SystemTime = Seconds(sys).count();
   return Result;
 }
 
+void TimeRecord::scalePerfCounters() {
+  // The kernel only counted for PerfTimeRunning out of PerfTimeEnabled, so
+  // extrapolate to the whole interval.
+  if (PerfTimeRunning && PerfTimeRunning < PerfTimeEnabled) {
+    double Scale = double(PerfTimeEnabled) / PerfTimeRunning;
+    Cycles = Cycles * Scale;
+    Instructions = Instructions * Scale;
+    CacheMisses = CacheMisses * Scale;
+    BranchMisses = BranchMisses * Scale;
+  }
+  PerfTimeEnabled = PerfTimeRunning = 0;
+}
+
 void Timer::startTimer() {
   assert(!Running && "Cannot start a running timer");
   Running = Triggered = true;
@@ -144,8 +310,10 @@ void Timer::startTimer() {
 void Timer::stopTimer() {
   assert(Running && "Cannot stop a paused timer");
   Running = false;
-  Time += TimeRecord::getCurrentTime(false);
-  Time -= StartTime;
+  TimeRecord Elapsed = TimeRecord::getCurrentTime(false);
+  Elapsed -= StartTime;
+  Elapsed.scalePerfCounters();
+  Time += Elapsed;
   Signposts->endTimerInterval(this);
 }
 
@@ -174,6 +342,10 @@ void TimeRecord::print(const TimeRecord &Total, raw_ostream &OS) const {
 
   if (Total.getMemUsed())
     OS << format("%9" PRId64 "  ", (int64_t)getMemUsed());
+  if (Total.getInstructions())
+    OS << format("%12" PRIu64 "  %12" PRIu64 "  %12" PRIu64 "  %12" PRIu64 "  ",
+                 getCycles(), getInstructions(), getCacheMisses(),
+                 getBranchMisses());
 }
 
 
@@ -331,6 +503,8 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   OS << "   ---Wall Time---";
   if (Total.getMemUsed())
     OS << "  ---Mem---";
+  if (Total.getInstructions())
+    OS << "  ---Cycles---  ---Instrs---  -Cache Miss-  -Branch Miss";
   OS << "  --- Name ---\n";
 
   // Loop through all of the timing data, printing it out.
@@ -425,6 +599,16 @@ const char *TimerGroup::printJSONValues(raw_ostream &OS, const char *delim) {
       OS << delim;
       printJSONValue(OS, R, ".mem", T.getMemUsed());
     }
+    if (T.getInstructions()) {
+      OS << delim;
+      printJSONValue(OS, R, ".cycles", T.getCycles());
+      OS << delim;
+      printJSONValue(OS, R, ".instructions", T.getInstructions());
+      OS << delim;
+      printJSONValue(OS, R, ".cache-misses", T.getCacheMisses());
+      OS << delim;
+      printJSONValue(OS, R, ".branch-misses", T.getBranchMisses());
+    }
   }
   TimersToPrint.clear();
   return delim;
@@ -0,0 +1,151 @@
+//===- raw_mmap_ostream.cpp - Memory-mapped file output stream ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the raw_mmap_ostream class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/raw_mmap_ostream.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+
+// The size of the first mapping, and the least amount of space kept ahead of
+// the write position; the mapping doubles whenever it runs out.
+static const uint64_t InitialMappingSize = 64 * 1024;
+static const uint64_t MinBufferSize = 4096;
+
+raw_mmap_ostream::raw_mmap_ostream(StringRef Filename, std::error_code &EC)
+    : raw_pwrite_stream(/*Unbuffered=*/true) {
+  EC = sys::fs::openFileForReadWrite(Filename, FD, sys::fs::CD_CreateAlways,
+                                     sys::fs::OF_None);
+  if (EC)
+    return;
+
+  sys::fs::file_status Status;
+  EC = sys::fs::status(FD, Status);
+  if (!EC && Status.type() != sys::fs::file_type::regular_file)
+    EC = make_error_code(errc::not_supported);
+  if (!EC)
+    EC = reserve(InitialMappingSize);
+  if (EC) {
+    Region.reset();
+    sys::Process::SafelyCloseFileDescriptor(FD);
+    FD = -1;
+    return;
+  }
+  resetBuffer();
+}
+
+raw_mmap_ostream::~raw_mmap_ostream() {
+  if (FD >= 0)
+    close();
+
+  // As raw_fd_ostream does, report errors nobody has checked for.
+  if (has_error())
+    report_fatal_error("IO failure on output stream: " + error().message(),
+                       /*GenCrashDiag=*/false);
+}
+
+std::error_code raw_mmap_ostream::reserve(uint64_t Size) {
+  uint64_t OldSize = Region ? Region->size() : 0;
+  if (Size <= OldSize)
+    return std::error_code();
+
+  uint64_t NewSize = std::max(Size, OldSize * 2);
+  NewSize = alignTo(NewSize, sys::fs::mapped_file_region::alignment());
+
+  // The mapping has to be recreated to grow it.  Nothing is copied: the data
+  // written so far stays in the page cache.
+  Region.reset();
+  if (std::error_code EC = sys::fs::resize_file(FD, NewSize))
+    return EC;
+  std::error_code MapEC;
+  Region = llvm::make_unique<sys::fs::mapped_file_region>(
+      FD, sys::fs::mapped_file_region::readwrite, NewSize, 0, MapEC);
+  if (MapEC)
+    Region.reset();
+  return MapEC;
+}
+
+void raw_mmap_ostream::resetBuffer() {
+  if (Pos + MinBufferSize > Region->size()) {
+    if (std::error_code EC = reserve(Pos + MinBufferSize)) {
+      // Drop everything written from now on.
+      error_detected(EC);
+      SetUnbuffered();
+      return;
+    }
+  }
+  SetBuffer(Region->data() + Pos, Region->size() - Pos);
+}
+
+void raw_mmap_ostream::write_impl(const char *Ptr, size_t Size) {
+  if (!Region) {
+    Pos += Size;
+    return;
+  }
+
+  // When the buffer is flushed, the data is already in place.  Otherwise,
+  // the write was too large for the buffer and bypassed it.
+  if (Ptr != Region->data() + Pos) {
+    if (std::error_code EC = reserve(Pos + Size)) {
+      error_detected(EC);
+      SetUnbuffered();
+      Pos += Size;
+      return;
+    }
+    memcpy(Region->data() + Pos, Ptr, Size);
+  }
+  Pos += Size;
+  End = std::max(End, Pos);
+  resetBuffer();
+}
+
+void raw_mmap_ostream::pwrite_impl(const char *Ptr, size_t Size,
+                                   uint64_t Offset) {
+  if (!Region)
+    return;
+  assert(Offset + Size <= Region->size() && "pwrite past the mapping");
+  memcpy(Region->data() + Offset, Ptr, Size);
+}
+
+uint64_t raw_mmap_ostream::seek(uint64_t Off) {
+  flush();
+  Pos = Off;
+  if (Region)
+    resetBuffer();
+  return Pos;
+}
+
+StringRef raw_mmap_ostream::getWrittenData() {
+  flush();
+  if (!Region)
+    return StringRef();
+  return StringRef(Region->data(), End);
+}
+
+void raw_mmap_ostream::close() {
+  assert(FD >= 0 && "Stream is already closed!");
+  flush();
+  SetUnbuffered();
+  Region.reset();
+
+  // Give back the space reserved ahead of the data.
+  if (std::error_code EC = sys::fs::resize_file(FD, End))
+    error_detected(EC);
+  if (std::error_code EC = sys::Process::SafelyCloseFileDescriptor(FD))
+    error_detected(EC);
+  FD = -1;
+}
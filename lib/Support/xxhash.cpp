@@ -36,11 +36,18 @@
  * everything but a simple interface for computing XXh64. */
 
 #include "llvm/Support/xxhash.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#if LLVM_X86_TARGET_DISPATCH
+#include <immintrin.h>
+#endif
+
 using namespace llvm;
 using namespace support;
 
@@ -136,3 +143,378 @@ uint64_t llvm::xxHash64(StringRef Data) {
 uint64_t llvm::xxHash64(ArrayRef<uint8_t> Data) {
   return xxHash64({(const char *)Data.data(), Data.size()});
 }
+
+// The XXH3 64-bit hash with the default secret and a seed of 0, ported from
+// xxHash 0.8.2.  Inputs longer than 240 bytes are mixed 64 bytes at a time
+// into eight 64-bit accumulators, which is the part vectorized below.
+
+static const uint32_t PRIME32_1 = 0x9E3779B1U;
+static const uint32_t PRIME32_2 = 0x85EBCA77U;
+static const uint32_t PRIME32_3 = 0xC2B2AE3DU;
+
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+// Pseudorandom secret taken directly from FARSH.
+alignas(64) static const uint8_t Kkey[192] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static const size_t SecretSize = sizeof(Kkey);
+static const size_t StripeLen = 64;
+static const size_t SecretConsumeRate = 8;
+static const size_t AccNB = StripeLen / sizeof(uint64_t);
+static const size_t MidSizeMax = 240;
+static const size_t SecretSizeMin = 136;
+static const size_t SecretLastAccStart = 7;
+static const size_t SecretMergeAccsStart = 11;
+static const size_t MidSizeStartOffset = 3;
+static const size_t MidSizeLastOffset = 17;
+
+// Calculates a 64-bit to 128-bit multiply, then XOR folds it.
+static uint64_t mul128Fold64(uint64_t LHS, uint64_t RHS) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t Product = (__uint128_t)LHS * (__uint128_t)RHS;
+  return uint64_t(Product) ^ uint64_t(Product >> 64);
+#else
+  // First calculate all of the cross products.
+  uint64_t LoLo = (LHS & 0xFFFFFFFF) * (RHS & 0xFFFFFFFF);
+  uint64_t HiLo = (LHS >> 32) * (RHS & 0xFFFFFFFF);
+  uint64_t LoHi = (LHS & 0xFFFFFFFF) * (RHS >> 32);
+  uint64_t HiHi = (LHS >> 32) * (RHS >> 32);
+
+  // Now add the products together. These will never overflow.
+  uint64_t Cross = (LoLo >> 32) + (HiLo & 0xFFFFFFFF) + LoHi;
+  uint64_t Upper = (HiLo >> 32) + (Cross >> 32) + HiHi;
+  uint64_t Lower = (Cross << 32) | (LoLo & 0xFFFFFFFF);
+
+  return Upper ^ Lower;
+#endif
+}
+
+static uint64_t xxh64Avalanche(uint64_t Hash) {
+  Hash ^= Hash >> 33;
+  Hash *= PRIME64_2;
+  Hash ^= Hash >> 29;
+  Hash *= PRIME64_3;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
+
+static uint64_t xxh3Avalanche(uint64_t Hash) {
+  Hash ^= Hash >> 37;
+  Hash *= PRIME_MX1;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
+
+static uint64_t XXH3_len_1to3_64b(const uint8_t *Input, size_t Len,
+                                  const uint8_t *Secret) {
+  const uint8_t C1 = Input[0];
+  const uint8_t C2 = Input[Len >> 1];
+  const uint8_t C3 = Input[Len - 1];
+  uint32_t Combined = ((uint32_t)C1 << 16) | ((uint32_t)C2 << 24) |
+                      ((uint32_t)C3 << 0) | ((uint32_t)Len << 8);
+  uint64_t Bitflip =
+      (uint64_t)(endian::read32le(Secret) ^ endian::read32le(Secret + 4));
+  return xxh64Avalanche(uint64_t(Combined) ^ Bitflip);
+}
+
+static uint64_t XXH3_len_4to8_64b(const uint8_t *Input, size_t Len,
+                                  const uint8_t *Secret) {
+  const uint32_t Input1 = endian::read32le(Input);
+  const uint32_t Input2 = endian::read32le(Input + Len - 4);
+  uint64_t Acc =
+      (endian::read64le(Secret + 8) ^ endian::read64le(Secret + 16)) ^
+      (Input2 + ((uint64_t)Input1 << 32));
+  // XXH3_rrmxmx
+  Acc ^= rotl64(Acc, 49) ^ rotl64(Acc, 24);
+  Acc *= PRIME_MX2;
+  Acc ^= (Acc >> 35) + (uint64_t)Len;
+  Acc *= PRIME_MX2;
+  return Acc ^ (Acc >> 28);
+}
+
+static uint64_t XXH3_len_9to16_64b(const uint8_t *Input, size_t Len,
+                                   const uint8_t *Secret) {
+  uint64_t InputLo =
+      (endian::read64le(Secret + 24) ^ endian::read64le(Secret + 32)) ^
+      endian::read64le(Input);
+  uint64_t InputHi =
+      (endian::read64le(Secret + 40) ^ endian::read64le(Secret + 48)) ^
+      endian::read64le(Input + Len - 8);
+  uint64_t Acc = uint64_t(Len) + ByteSwap_64(InputLo) + InputHi +
+                 mul128Fold64(InputLo, InputHi);
+  return xxh3Avalanche(Acc);
+}
+
+static uint64_t XXH3_len_0to16_64b(const uint8_t *Input, size_t Len,
+                                   const uint8_t *Secret) {
+  if (LLVM_LIKELY(Len > 8))
+    return XXH3_len_9to16_64b(Input, Len, Secret);
+  if (LLVM_LIKELY(Len >= 4))
+    return XXH3_len_4to8_64b(Input, Len, Secret);
+  if (Len != 0)
+    return XXH3_len_1to3_64b(Input, Len, Secret);
+  return xxh64Avalanche(endian::read64le(Secret + 56) ^
+                        endian::read64le(Secret + 64));
+}
+
+static uint64_t XXH3_mix16B(const uint8_t *Input, uint8_t const *Secret) {
+  uint64_t LHS = endian::read64le(Input) ^ endian::read64le(Secret);
+  uint64_t RHS = endian::read64le(Input + 8) ^ endian::read64le(Secret + 8);
+  return mul128Fold64(LHS, RHS);
+}
+
+static uint64_t XXH3_len_17to128_64b(const uint8_t *Input, size_t Len,
+                                     const uint8_t *Secret) {
+  uint64_t Acc = Len * PRIME64_1;
+  if (Len > 32) {
+    if (Len > 64) {
+      if (Len > 96) {
+        Acc += XXH3_mix16B(Input + 48, Secret + 96);
+        Acc += XXH3_mix16B(Input + Len - 64, Secret + 112);
+      }
+      Acc += XXH3_mix16B(Input + 32, Secret + 64);
+      Acc += XXH3_mix16B(Input + Len - 48, Secret + 80);
+    }
+    Acc += XXH3_mix16B(Input + 16, Secret + 32);
+    Acc += XXH3_mix16B(Input + Len - 32, Secret + 48);
+  }
+  Acc += XXH3_mix16B(Input + 0, Secret + 0);
+  Acc += XXH3_mix16B(Input + Len - 16, Secret + 16);
+  return xxh3Avalanche(Acc);
+}
+
+static uint64_t XXH3_len_129to240_64b(const uint8_t *Input, size_t Len,
+                                      const uint8_t *Secret) {
+  uint64_t Acc = (uint64_t)Len * PRIME64_1;
+  const unsigned NbRounds = Len / 16;
+  for (unsigned I = 0; I < 8; ++I)
+    Acc += XXH3_mix16B(Input + 16 * I, Secret + 16 * I);
+  Acc = xxh3Avalanche(Acc);
+
+  for (unsigned I = 8; I < NbRounds; ++I)
+    Acc += XXH3_mix16B(Input + 16 * I,
+                       Secret + 16 * (I - 8) + MidSizeStartOffset);
+  // Last bytes
+  Acc += XXH3_mix16B(Input + Len - 16,
+                     Secret + SecretSizeMin - MidSizeLastOffset);
+  return xxh3Avalanche(Acc);
+}
+
+// Mix NbStripes stripes of 64 bytes into the accumulators, and scramble the
+// accumulators at the end of a block.  These are the only parts of XXH3 that
+// work on more than one lane at once, so there are several implementations
+// of them which all produce the same accumulators.
+typedef void AccumulateFn(uint64_t *Acc, const uint8_t *Input,
+                          const uint8_t *Secret, size_t NbStripes);
+typedef void ScrambleFn(uint64_t *Acc, const uint8_t *Secret);
+
+LLVM_ATTRIBUTE_UNUSED
+static void XXH3_accumulate_scalar(uint64_t *Acc, const uint8_t *Input,
+                                   const uint8_t *Secret, size_t NbStripes) {
+  for (size_t N = 0; N < NbStripes; ++N) {
+    const uint8_t *In = Input + N * StripeLen;
+    const uint8_t *Sec = Secret + N * SecretConsumeRate;
+    for (size_t I = 0; I < AccNB; ++I) {
+      uint64_t DataVal = endian::read64le(In + 8 * I);
+      uint64_t DataKey = DataVal ^ endian::read64le(Sec + 8 * I);
+      Acc[I ^ 1] += DataVal;
+      Acc[I] += uint32_t(DataKey) * (DataKey >> 32);
+    }
+  }
+}
+
+LLVM_ATTRIBUTE_UNUSED
+static void XXH3_scrambleAcc_scalar(uint64_t *Acc, const uint8_t *Secret) {
+  for (size_t I = 0; I < AccNB; ++I) {
+    Acc[I] ^= Acc[I] >> 47;
+    Acc[I] ^= endian::read64le(Secret + 8 * I);
+    Acc[I] *= PRIME32_1;
+  }
+}
+
+#if LLVM_X86_TARGET_DISPATCH && defined(__SSE2__) && defined(__x86_64__)
+// SSE2 is part of x86-64, so no dispatch is needed for it.
+static void XXH3_accumulate_sse2(uint64_t *Acc, const uint8_t *Input,
+                                 const uint8_t *Secret, size_t NbStripes) {
+  __m128i XAcc[4];
+  for (unsigned I = 0; I < 4; ++I)
+    XAcc[I] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Acc) + I);
+  for (size_t N = 0; N < NbStripes; ++N) {
+    const __m128i *XInput =
+        reinterpret_cast<const __m128i *>(Input + N * StripeLen);
+    const __m128i *XSecret =
+        reinterpret_cast<const __m128i *>(Secret + N * SecretConsumeRate);
+    for (unsigned I = 0; I < 4; ++I) {
+      __m128i DataVec = _mm_loadu_si128(XInput + I);
+      __m128i KeyVec = _mm_loadu_si128(XSecret + I);
+      __m128i DataKey = _mm_xor_si128(DataVec, KeyVec);
+      __m128i DataKeyLo = _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1));
+      __m128i Product = _mm_mul_epu32(DataKey, DataKeyLo);
+      __m128i DataSwap = _mm_shuffle_epi32(DataVec, _MM_SHUFFLE(1, 0, 3, 2));
+      __m128i Sum = _mm_add_epi64(XAcc[I], DataSwap);
+      XAcc[I] = _mm_add_epi64(Product, Sum);
+    }
+  }
+  for (unsigned I = 0; I < 4; ++I)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(Acc) + I, XAcc[I]);
+}
+
+static void XXH3_scrambleAcc_sse2(uint64_t *Acc, const uint8_t *Secret) {
+  const __m128i *XSecret = reinterpret_cast<const __m128i *>(Secret);
+  const __m128i Prime32 = _mm_set1_epi32((int)PRIME32_1);
+  for (unsigned I = 0; I < 4; ++I) {
+    __m128i *XAcc = reinterpret_cast<__m128i *>(Acc) + I;
+    __m128i AccVec = _mm_loadu_si128(XAcc);
+    __m128i DataVec = _mm_xor_si128(AccVec, _mm_srli_epi64(AccVec, 47));
+    __m128i DataKey = _mm_xor_si128(DataVec, _mm_loadu_si128(XSecret + I));
+    __m128i DataKeyHi = _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i ProdLo = _mm_mul_epu32(DataKey, Prime32);
+    __m128i ProdHi = _mm_mul_epu32(DataKeyHi, Prime32);
+    _mm_storeu_si128(XAcc,
+                     _mm_add_epi64(ProdLo, _mm_slli_epi64(ProdHi, 32)));
+  }
+}
+#endif
+
+#if LLVM_X86_TARGET_DISPATCH
+__attribute__((target("avx2"))) static void
+XXH3_accumulate_avx2(uint64_t *Acc, const uint8_t *Input,
+                     const uint8_t *Secret, size_t NbStripes) {
+  __m256i XAcc[2];
+  for (unsigned I = 0; I < 2; ++I)
+    XAcc[I] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Acc) + I);
+  for (size_t N = 0; N < NbStripes; ++N) {
+    const __m256i *XInput =
+        reinterpret_cast<const __m256i *>(Input + N * StripeLen);
+    const __m256i *XSecret =
+        reinterpret_cast<const __m256i *>(Secret + N * SecretConsumeRate);
+    for (unsigned I = 0; I < 2; ++I) {
+      __m256i DataVec = _mm256_loadu_si256(XInput + I);
+      __m256i KeyVec = _mm256_loadu_si256(XSecret + I);
+      __m256i DataKey = _mm256_xor_si256(DataVec, KeyVec);
+      __m256i DataKeyLo = _mm256_srli_epi64(DataKey, 32);
+      __m256i Product = _mm256_mul_epu32(DataKey, DataKeyLo);
+      __m256i DataSwap =
+          _mm256_shuffle_epi32(DataVec, _MM_SHUFFLE(1, 0, 3, 2));
+      __m256i Sum = _mm256_add_epi64(XAcc[I], DataSwap);
+      XAcc[I] = _mm256_add_epi64(Product, Sum);
+    }
+  }
+  for (unsigned I = 0; I < 2; ++I)
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(Acc) + I, XAcc[I]);
+}
+
+__attribute__((target("avx2"))) static void
+XXH3_scrambleAcc_avx2(uint64_t *Acc, const uint8_t *Secret) {
+  const __m256i *XSecret = reinterpret_cast<const __m256i *>(Secret);
+  const __m256i Prime32 = _mm256_set1_epi32((int)PRIME32_1);
+  for (unsigned I = 0; I < 2; ++I) {
+    __m256i *XAcc = reinterpret_cast<__m256i *>(Acc) + I;
+    __m256i AccVec = _mm256_loadu_si256(XAcc);
+    __m256i DataVec = _mm256_xor_si256(AccVec, _mm256_srli_epi64(AccVec, 47));
+    __m256i DataKey =
+        _mm256_xor_si256(DataVec, _mm256_loadu_si256(XSecret + I));
+    __m256i DataKeyHi = _mm256_srli_epi64(DataKey, 32);
+    __m256i ProdLo = _mm256_mul_epu32(DataKey, Prime32);
+    __m256i ProdHi = _mm256_mul_epu32(DataKeyHi, Prime32);
+    __m256i Product = _mm256_add_epi64(ProdLo, _mm256_slli_epi64(ProdHi, 32));
+    _mm256_storeu_si256(XAcc, Product);
+  }
+}
+#endif
+
+namespace {
+struct XXH3Kernels {
+  AccumulateFn *Accumulate;
+  ScrambleFn *Scramble;
+};
+} // end anonymous namespace
+
+static XXH3Kernels selectXXH3Kernels() {
+#if LLVM_X86_TARGET_DISPATCH
+  if (sys::hasHostCPUFeature("avx2"))
+    return {XXH3_accumulate_avx2, XXH3_scrambleAcc_avx2};
+#endif
+#if LLVM_X86_TARGET_DISPATCH && defined(__SSE2__) && defined(__x86_64__)
+  return {XXH3_accumulate_sse2, XXH3_scrambleAcc_sse2};
+#else
+  return {XXH3_accumulate_scalar, XXH3_scrambleAcc_scalar};
+#endif
+}
+
+static uint64_t XXH3_mix2Accs(const uint64_t *Acc, const uint8_t *Secret) {
+  return mul128Fold64(Acc[0] ^ endian::read64le(Secret),
+                      Acc[1] ^ endian::read64le(Secret + 8));
+}
+
+static uint64_t XXH3_mergeAccs(const uint64_t *Acc, const uint8_t *Key,
+                               uint64_t Start) {
+  uint64_t Result64 = Start;
+  for (size_t I = 0; I < 4; ++I)
+    Result64 += XXH3_mix2Accs(Acc + 2 * I, Key + 16 * I);
+  return xxh3Avalanche(Result64);
+}
+
+LLVM_ATTRIBUTE_NOINLINE
+static uint64_t XXH3_hashLong_64b(const uint8_t *Input, size_t Len,
+                                  const uint8_t *Secret) {
+  static const XXH3Kernels VectorKernels = selectXXH3Kernels();
+  const XXH3Kernels Kernels =
+      sys::isTargetDispatchEnabled()
+          ? VectorKernels
+          : XXH3Kernels{XXH3_accumulate_scalar, XXH3_scrambleAcc_scalar};
+  const size_t NbStripesPerBlock =
+      (SecretSize - StripeLen) / SecretConsumeRate;
+  const size_t BlockLen = StripeLen * NbStripesPerBlock;
+  const size_t NbBlocks = (Len - 1) / BlockLen;
+  alignas(32) uint64_t Acc[AccNB] = {
+      PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+      PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
+  };
+  for (size_t N = 0; N < NbBlocks; ++N) {
+    Kernels.Accumulate(Acc, Input + N * BlockLen, Secret, NbStripesPerBlock);
+    Kernels.Scramble(Acc, Secret + SecretSize - StripeLen);
+  }
+
+  // Last partial block
+  const size_t NbStripes = (Len - 1 - (BlockLen * NbBlocks)) / StripeLen;
+  assert(NbStripes <= SecretSize / SecretConsumeRate);
+  Kernels.Accumulate(Acc, Input + NbBlocks * BlockLen, Secret, NbStripes);
+
+  // Last stripe
+  Kernels.Accumulate(Acc, Input + Len - StripeLen,
+                     Secret + SecretSize - StripeLen - SecretLastAccStart, 1);
+
+  return XXH3_mergeAccs(Acc, Secret + SecretMergeAccsStart,
+                        (uint64_t)Len * PRIME64_1);
+}
+
+uint64_t llvm::xxh3_64bits(ArrayRef<uint8_t> Data) {
+  size_t Len = Data.size();
+  const uint8_t *In = Data.data();
+  if (Len <= 16)
+    return XXH3_len_0to16_64b(In, Len, Kkey);
+  if (Len <= 128)
+    return XXH3_len_17to128_64b(In, Len, Kkey);
+  if (Len <= MidSizeMax)
+    return XXH3_len_129to240_64b(In, Len, Kkey);
+  return XXH3_hashLong_64b(In, Len, Kkey);
+}
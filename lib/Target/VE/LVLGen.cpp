@@ -5,11 +5,29 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 //
 //===----------------------------------------------------------------------===//
+//
+// Vector instructions selected from the "_vl" intrinsics take their vector
+// length as an explicit scalar register operand, but the hardware reads it
+// from the single VL register.  This pass inserts the LVL instructions that
+// load VL before such instructions.
+//
+// The contents of VL are tracked over the whole function: a forward dataflow
+// computes, for every block entry, which register VL was last loaded from
+// and which constant it holds, if any.  An LVL is only emitted where the
+// required value is not already in VL.  Before that, loops whose vector
+// instructions all use the same loop-invariant length get a single LVL in
+// their preheader.
+//
+//===----------------------------------------------------------------------===//
 
 #include "VE.h"
 #include "VESubtarget.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/TargetInstrInfo.h"
 #include "llvm/Target/TargetMachine.h"
@@ -18,36 +36,161 @@ using namespace llvm;
 
 #define DEBUG_TYPE "lvl-gen"
 
+STATISTIC(NumLVLInserted, "Number of LVL instructions inserted");
+STATISTIC(NumLVLReused, "Number of vector instructions reusing the current VL");
+STATISTIC(NumLVLHoisted, "Number of LVL instructions hoisted out of loops");
+
 namespace {
+  // What is known about the contents of the VL register at a program point.
+  struct VLState {
+    // The block has not been reached by the dataflow yet.
+    bool Unvisited = true;
+    // Register VL was loaded from.  Valid as long as the register is not
+    // redefined.  NoRegister if unknown.
+    unsigned Reg = VE::NoRegister;
+    // Constant value held by VL, if known.
+    bool HasImm = false;
+    int64_t Imm = 0;
+
+    static VLState unknown() {
+      VLState S;
+      S.Unvisited = false;
+      return S;
+    }
+
+    bool holds(unsigned R, bool RHasImm, int64_t RImm) const {
+      if (Unvisited)
+        return false;
+      if (Reg != VE::NoRegister && Reg == R)
+        return true;
+      return HasImm && RHasImm && Imm == RImm;
+    }
+
+    // Merge the state flowing in from another predecessor.
+    void meet(const VLState &Other) {
+      if (Other.Unvisited)
+        return;
+      if (Unvisited) {
+        *this = Other;
+        return;
+      }
+      if (Reg != Other.Reg)
+        Reg = VE::NoRegister;
+      if (!HasImm || !Other.HasImm || Imm != Other.Imm)
+        HasImm = false;
+    }
+
+    bool operator==(const VLState &Other) const {
+      return Unvisited == Other.Unvisited && Reg == Other.Reg &&
+             HasImm == Other.HasImm && (!HasImm || Imm == Other.Imm);
+    }
+    bool operator!=(const VLState &Other) const { return !(*this == Other); }
+  };
+
   struct LVLGen : public MachineFunctionPass {
-    const MachineRegisterInfo *MRI;
+    const TargetInstrInfo *TII;
+    const TargetRegisterInfo *TRI;
+    MachineLoopInfo *MLI;
+    bool Inserted;
     static char ID;
     LVLGen() : MachineFunctionPass(ID) {}
-    bool runOnMachineBasicBlock(MachineBasicBlock &MBB);
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.addRequired<MachineLoopInfo>();
+      AU.addPreserved<MachineLoopInfo>();
+      AU.setPreservesCFG();
+      MachineFunctionPass::getAnalysisUsage(AU);
+    }
+
+    VLState runOnMachineBasicBlock(MachineBasicBlock &MBB, VLState State,
+                                   bool Insert);
+    bool hoistFromLoop(MachineLoop &L);
     bool runOnMachineFunction(MachineFunction &F) override;
+
+    StringRef getPassName() const override { return "VE LVL generator"; }
   };
   char LVLGen::ID = 0;
 
   // returns a register holding a vector length. NoRegister is returned when
   // this MI does not have a vector length.
-  //
-  // FIXME: is this reasonable impl?
-  unsigned getVL(const MachineRegisterInfo *MRI, const MachineInstr &MI)
+  unsigned getVL(const MachineInstr &MI)
   {
-    unsigned opc = MI.getOpcode();
-    if (opc < VE::andm_MMMl 
-            || (opc > VE::xorm_MMMl && opc < VE::andm_mmml)
-            || opc > VE::xorm_mmml)
+    if (!(MI.getDesc().TSFlags & VEII::VLInUse))
       return VE::NoRegister;
 
+    // The vector length is always the last explicit operand.
+    const MachineOperand &MO = MI.getOperand(MI.getNumExplicitOperands() - 1);
+    if (!MO.isReg())
+      return VE::NoRegister;
+    return MO.getReg();
+  }
+
+  // Returns true and sets Imm if MI materializes a constant into its first
+  // operand.
+  bool isConstantDef(const MachineInstr &MI, int64_t &Imm)
+  {
+    switch (MI.getOpcode()) {
+    case VE::LEAzzi:
+    case VE::LEA32zzi:
+      if (!MI.getOperand(1).isImm())
+        return false;
+      Imm = MI.getOperand(1).getImm();
+      return true;
+    case VE::ORim1:
+    case VE::OR32im1:
+      // "or %sx, imm, (0)1" is a plain move of imm.
+      if (!MI.getOperand(1).isImm() || !MI.getOperand(2).isImm() ||
+          MI.getOperand(2).getImm() != 0)
+        return false;
+      Imm = MI.getOperand(1).getImm();
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // Returns true if MI is an LVL instruction, either one this pass inserted
+  // or one generated earlier, e.g. by copyPhysReg or frame index elimination.
+  // Sets Src to the register VL is loaded from, or Imm if VL is loaded from
+  // an immediate.
+  bool isLVL(const MachineInstr &MI, unsigned &Src, bool &HasImm,
+             int64_t &Imm)
+  {
+    unsigned Idx;
+    switch (MI.getOpcode()) {
+    case VE::LVL2:
+      Idx = 0;
+      break;
+    case VE::LVL:
+      Idx = 1;
+      break;
+    default:
+      return false;
+    }
+    const MachineOperand &MO = MI.getOperand(Idx);
+    Src = VE::NoRegister;
+    HasImm = false;
+    if (MO.isReg()) {
+      Src = MO.getReg();
+    } else if (MO.isImm()) {
+      HasImm = true;
+      Imm = MO.getImm();
+    }
+    return true;
+  }
+
+  // Returns true if MI changes VL behind our back.
+  bool clobbersVL(const MachineInstr &MI)
+  {
+    if (MI.isCall() || MI.isInlineAsm())
+      return true;
     for (const MachineOperand &MO : MI.operands()) {
-      //if (MO.isReg() && MRI->getRegClass(MO.getReg()) == &VE::V64RegClass)
-      if (MO.isReg() && VE::V64RegClass.contains(MO.getReg())) {
-        // last operand should be a vector length
-        return MI.getOperand(MI.getNumOperands() - 1).getReg();
-      }
+      if (MO.isRegMask() && MO.clobbersPhysReg(VE::VL))
+        return true;
+      if (MO.isReg() && MO.isDef() && MO.getReg() == VE::VL)
+        return true;
     }
-    return VE::NoRegister;
+    return false;
   }
 
 } // end of anonymous namespace
@@ -56,66 +199,228 @@ FunctionPass *llvm::createLVLGenPass() {
   return new LVLGen;
 }
 
-bool LVLGen::runOnMachineBasicBlock(MachineBasicBlock &MBB)
+// Compute the VL state at the end of MBB from the state at its entry.  If
+// Insert is set, also generate the LVL instructions this block needs.
+VLState LVLGen::runOnMachineBasicBlock(MachineBasicBlock &MBB, VLState State,
+                                       bool Insert)
 {
-  bool Changed = false;
-  const VESubtarget *Subtarget = &MBB.getParent()->getSubtarget<VESubtarget>();
-  const TargetInstrInfo *TII = Subtarget->getInstrInfo();
-  const TargetRegisterInfo* TRI = Subtarget->getRegisterInfo();
-
-  bool hasRegForVL = false;
-  unsigned RegForVL;
+  // Constants held by registers defined in this block.
+  SmallDenseMap<unsigned, int64_t, 8> RegConst;
+  auto lookupConst = [&](unsigned Reg, int64_t &Imm) {
+    auto I = RegConst.find(Reg);
+    if (I != RegConst.end()) {
+      Imm = I->second;
+      return true;
+    }
+    // The VL operand is usually the 32 bit sub-register of a register that
+    // was materialized as a 64 bit constant.
+    for (MCSuperRegIterator SR(Reg, TRI); SR.isValid(); ++SR) {
+      I = RegConst.find(*SR);
+      if (I != RegConst.end()) {
+        Imm = I->second;
+        return true;
+      }
+    }
+    return false;
+  };
 
-  for (MachineBasicBlock::iterator I = MBB.begin(); I != MBB.end(); ) {
-    MachineBasicBlock::iterator MI = I;
+  for (MachineBasicBlock::iterator I = MBB.begin(); I != MBB.end(); ++I) {
+    MachineInstr &MI = *I;
 
-    unsigned Reg = getVL(MRI, *MI);
+    unsigned Reg = getVL(MI);
     if (Reg != VE::NoRegister) {
-      LLVM_DEBUG(dbgs() << "Vector instruction found: ");
-      LLVM_DEBUG(MI->dump());
-      LLVM_DEBUG(dbgs() << "Vector length is " << TRI->getName(Reg) << ". ");
-      LLVM_DEBUG(dbgs() << "Current VL is " 
-                 << (hasRegForVL ? TRI->getName(RegForVL) : "unknown") << ". ");
-
-      if (!hasRegForVL || RegForVL != Reg) {
-        LLVM_DEBUG(dbgs() << "Generate a LVL instruction to load " << TRI->getName(Reg) << ".\n");
-        BuildMI(MBB, I, MI->getDebugLoc(), TII->get(VE::LVL2)).addReg(Reg);
-        hasRegForVL = true;
-        RegForVL = Reg;
-        Changed = true;
-      } else {
-        LLVM_DEBUG(dbgs() << "Reuse current VL.\n");
+      int64_t Imm = 0;
+      bool HasImm = lookupConst(Reg, Imm);
+      if (Insert) {
+        LLVM_DEBUG(dbgs() << "Vector instruction found: ");
+        LLVM_DEBUG(MI.dump());
+        LLVM_DEBUG(dbgs() << "Vector length is " << printReg(Reg, TRI)
+                          << ". Current VL is "
+                          << printReg(State.Reg, TRI) << ". ");
       }
-    } else if (hasRegForVL) {
-      for (const MachineOperand &MO : MI->defs()) {
-        if (MO.isReg() && MO.getReg() == RegForVL) {
-          LLVM_DEBUG(dbgs() << TRI->getName(RegForVL) << " is killed: ");
-          LLVM_DEBUG(MI->dump());
-          hasRegForVL = false;
-          break;
+
+      if (!State.holds(Reg, HasImm, Imm)) {
+        if (Insert) {
+          LLVM_DEBUG(dbgs() << "Generate a LVL instruction to load "
+                            << printReg(Reg, TRI) << ".\n");
+          BuildMI(MBB, I, MI.getDebugLoc(), TII->get(VE::LVL2)).addReg(Reg);
+          ++NumLVLInserted;
+          Inserted = true;
+        }
+        State = VLState::unknown();
+        State.Reg = Reg;
+        State.HasImm = HasImm;
+        State.Imm = Imm;
+      } else {
+        if (Insert) {
+          LLVM_DEBUG(dbgs() << "Reuse current VL.\n");
+          ++NumLVLReused;
         }
+        // Remember the register as well, so that later uses of it match
+        // even if the constant is lost.
+        if (State.Reg == VE::NoRegister)
+          State.Reg = Reg;
+      }
+    }
+
+    unsigned Src;
+    bool SrcHasImm;
+    int64_t SrcImm = 0;
+    if (isLVL(MI, Src, SrcHasImm, SrcImm)) {
+      State = VLState::unknown();
+      State.Reg = Src;
+      State.HasImm = SrcHasImm ||
+                     (Src != VE::NoRegister && lookupConst(Src, SrcImm));
+      State.Imm = SrcImm;
+      // LVL defines nothing but VL.
+      continue;
+    }
+
+    if (clobbersVL(MI)) {
+      if (Insert)
+        LLVM_DEBUG(dbgs() << "VL is clobbered: "; MI.dump());
+      State = VLState::unknown();
+    }
+
+    for (const MachineOperand &MO : MI.operands()) {
+      if (!MO.isReg() || !MO.isDef() || !MO.getReg())
+        continue;
+      unsigned Def = MO.getReg();
+      for (auto RI = RegConst.begin(), RE = RegConst.end(); RI != RE;) {
+        auto Cur = RI++;
+        if (TRI->regsOverlap(Cur->first, Def))
+          RegConst.erase(Cur);
+      }
+      if (State.Reg != VE::NoRegister && TRI->regsOverlap(State.Reg, Def)) {
+        if (Insert)
+          LLVM_DEBUG(dbgs() << printReg(State.Reg, TRI) << " is killed: ";
+                     MI.dump());
+        // VL still holds the old value, which may be a known constant.
+        State.Reg = VE::NoRegister;
       }
     }
 
-    ++I;
+    int64_t Imm;
+    if (isConstantDef(MI, Imm) && MI.getOperand(0).isReg())
+      RegConst[MI.getOperand(0).getReg()] = Imm;
   }
-  return Changed;
+  return State;
 }
 
-bool LVLGen::runOnMachineFunction(MachineFunction &F) 
+// Load VL once in the preheader of L if every vector instruction in L uses
+// the same loop-invariant vector length.
+bool LVLGen::hoistFromLoop(MachineLoop &L)
+{
+  MachineBasicBlock *Preheader = L.getLoopPreheader();
+  if (!Preheader)
+    return false;
+
+  unsigned Reg = VE::NoRegister;
+  for (MachineBasicBlock *MBB : L.blocks()) {
+    // Somebody else is using VL inside the loop.
+    if (MBB->isLiveIn(VE::VL))
+      return false;
+    for (const MachineInstr &MI : *MBB) {
+      unsigned Src;
+      bool SrcHasImm;
+      int64_t SrcImm;
+      if (clobbersVL(MI) || isLVL(MI, Src, SrcHasImm, SrcImm))
+        return false;
+      unsigned VL = getVL(MI);
+      if (VL == VE::NoRegister)
+        continue;
+      if (Reg != VE::NoRegister && Reg != VL)
+        return false;
+      Reg = VL;
+    }
+  }
+  if (Reg == VE::NoRegister)
+    return false;
+
+  // The length must not change within the loop.
+  for (MachineBasicBlock *MBB : L.blocks())
+    for (const MachineInstr &MI : *MBB)
+      for (const MachineOperand &MO : MI.operands())
+        if (MO.isReg() && MO.isDef() && MO.getReg() &&
+            TRI->regsOverlap(MO.getReg(), Reg))
+          return false;
+
+  // Do not clobber a VL value that is live after the loop.
+  SmallVector<MachineBasicBlock *, 4> ExitBlocks;
+  L.getExitBlocks(ExitBlocks);
+  for (MachineBasicBlock *Exit : ExitBlocks)
+    if (Exit->isLiveIn(VE::VL))
+      return false;
+
+  LLVM_DEBUG(dbgs() << "Hoist LVL of " << printReg(Reg, TRI)
+                    << " into preheader " << printMBBReference(*Preheader)
+                    << "\n");
+  MachineBasicBlock::iterator InsertPt = Preheader->getFirstTerminator();
+  DebugLoc DL = InsertPt != Preheader->end() ? InsertPt->getDebugLoc()
+                                             : DebugLoc();
+  BuildMI(*Preheader, InsertPt, DL, TII->get(VE::LVL2)).addReg(Reg);
+  ++NumLVLHoisted;
+  return true;
+}
+
+bool LVLGen::runOnMachineFunction(MachineFunction &F)
 {
   LLVM_DEBUG(dbgs() << "********** Begin LVLGen **********\n");
   LLVM_DEBUG(dbgs() << "********** Function: " << F.getName() << '\n');
 
   bool Changed = false;
 
-  MRI = &F.getRegInfo();
+  const VESubtarget &Subtarget = F.getSubtarget<VESubtarget>();
+  TII = Subtarget.getInstrInfo();
+  TRI = Subtarget.getRegisterInfo();
+  MLI = &getAnalysis<MachineLoopInfo>();
+  Inserted = false;
 
   LLVM_DEBUG(F.dump());
 
-  for (MachineFunction::iterator FI = F.begin(), FE = F.end();
-       FI != FE; ++FI)
-    Changed |= runOnMachineBasicBlock(*FI);
+  // Hoist from the outermost loops first.  Inner loops are only considered
+  // when their parent could not be handled.
+  SmallVector<MachineLoop *, 8> Worklist(MLI->begin(), MLI->end());
+  while (!Worklist.empty()) {
+    MachineLoop *L = Worklist.pop_back_val();
+    if (hoistFromLoop(*L))
+      Changed = true;
+    else
+      Worklist.append(L->begin(), L->end());
+  }
+
+  // Propagate the contents of VL until a fixed point is reached.  Iterating
+  // in reverse post order makes this converge after very few rounds.
+  DenseMap<const MachineBasicBlock *, VLState> OutState;
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&F);
+  auto getInState = [&](MachineBasicBlock *MBB) {
+    if (MBB->pred_empty() || MBB->isEHPad())
+      return VLState::unknown();
+    VLState In;
+    for (MachineBasicBlock *Pred : MBB->predecessors())
+      In.meet(OutState[Pred]);
+    // Blocks whose predecessors are all unreachable.
+    if (In.Unvisited)
+      return VLState::unknown();
+    return In;
+  };
+
+  bool Updated;
+  do {
+    Updated = false;
+    for (MachineBasicBlock *MBB : RPOT) {
+      VLState Out = runOnMachineBasicBlock(*MBB, getInState(MBB), false);
+      VLState &Old = OutState[MBB];
+      if (Old != Out) {
+        Old = Out;
+        Updated = true;
+      }
+    }
+  } while (Updated);
+
+  for (MachineBasicBlock &MBB : F)
+    runOnMachineBasicBlock(MBB, getInState(&MBB), true);
+  Changed |= Inserted;
 
   if (Changed) {
     LLVM_DEBUG(dbgs() << "\n");
@@ -124,5 +429,3 @@ bool LVLGen::runOnMachineFunction(MachineFunction &F)
   LLVM_DEBUG(dbgs() << "********** End LVLGen **********\n");
   return Changed;
 }
-
-
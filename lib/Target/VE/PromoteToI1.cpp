@@ -6,14 +6,14 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This is a simple local pass that tries to promote vector registers to
-// expected vector mask registers if and only if those vector registers
-// defined as vector mask registers.  As you know, C/clang doesn't support
-// i1 type natively, so vector mask registers are declared as v4i64 in C
-// instead of v256i1.  This involves cast between v4i64 and v256i1.
-// Unfortunately, SX-Aurora Tsubasa has penalties for such casts.
-// This pass promotes all vector register which is used as vector mask
-// registers into expacted vector mask registers to avoid cast penalties.
+// This pass promotes vector registers to vector mask registers if those
+// vector registers are used as vector mask registers.  As you know, C/clang
+// doesn't support i1 type natively, so vector mask registers are declared
+// as v4i64 (or v8i64 for packed masks) in C instead of v256i1.  This involves
+// cast between v4i64 and v256i1.  Unfortunately, SX-Aurora Tsubasa has
+// penalties for such casts.  This pass promotes vector registers which are
+// used as vector mask registers into expected vector mask registers to avoid
+// cast penalties.
 //
 // Input:
 //   v4i64 m = (v4i64)create_mask(...);
@@ -22,11 +22,22 @@
 // Output:
 //   v256i1 m = create_mask(...);
 //   v256i64 v = vadd_mask(..., m);
+//
+// The pass works on the whole function before register allocation, while
+// the code is still in SSA form.  V64 virtual registers connected through
+// COPY and PHI instructions are grouped into classes, so a mask flowing
+// through branches and loops is promoted as a single value.  A class may
+// also have members defined or used by other instructions, e.g. a load, a
+// store or an argument of a call.  Those boundaries keep a single cast and
+// the rest of the class lives in VM (or VM512 for packed masks) registers.
+// A class is promoted only if this removes more casts than it inserts.
 //===----------------------------------------------------------------------===//
 
 #include "VE.h"
 #include "VESubtarget.h"
-#include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/IntEqClasses.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
@@ -40,6 +51,11 @@ using namespace llvm;
 
 #define DEBUG_TYPE "promote-to-i1"
 
+STATISTIC(NumCastsRemoved, "Number of mask casts removed");
+STATISTIC(NumCastsInserted, "Number of mask casts inserted at boundaries");
+STATISTIC(NumCastsRemaining, "Number of mask casts remaining after promotion");
+STATISTIC(NumClassesPromoted, "Number of mask classes promoted");
+
 static cl::opt<bool> DisablePromoteToI1(
   "disable-promote-to-i1",
   cl::init(false),
@@ -49,68 +65,32 @@ static cl::opt<bool> DisablePromoteToI1(
 namespace {
   struct Promoter : public MachineFunctionPass {
     const VESubtarget *Subtarget;
-    MachineRegisterInfo *MRI;
+    const TargetInstrInfo *TII;
     const TargetRegisterInfo *TRI;
+    MachineRegisterInfo *MRI;
 
-    struct Info {
-      unsigned NewReg;
-      unsigned GraphNo;
-      bool Valid;
-      const TargetRegisterClass *RegClass;
+    // Classes of V64 virtual registers connected through COPY and PHI,
+    // indexed by virtual register index.
+    IntEqClasses Classes;
+
+    struct ClassInfo {
+      // Register class of promoted registers; VM or VM512.  nullptr means
+      // the class doesn't carry a mask.
+      const TargetRegisterClass *RegClass = nullptr;
+      // Number of VM2V, VMP2V, V2VM and V2VMP instructions in the class.
+      unsigned NumCasts = 0;
+      // Number of casts required at the boundaries of the class.
+      unsigned NumBoundaries = 0;
+      // False if the class mixes VM and VM512, or is used in a way this
+      // pass cannot rewrite.
+      bool Valid = true;
     };
-    std::map<unsigned, Info> Candidates;
-    std::vector<unsigned> GraphInfo;
-
-    unsigned add_graph(unsigned reg)
-    {
-      unsigned graph = GraphInfo.size();
-      GraphInfo.push_back(reg);
-      return graph;
-    }
-    void remove_graph(unsigned graph)
-    { GraphInfo[graph] = 0; }
-    void merge_graph(unsigned oldg, unsigned newg)
-    {
-      remove_graph(oldg);
-      for (auto &v : Candidates) {
-        if (v.second.GraphNo == oldg)
-          v.second.GraphNo = newg;
-      }
-    }
+    DenseMap<unsigned, ClassInfo> Infos;
 
-    void new_vec(unsigned reg, const TargetRegisterClass *rc)
-    {
-      unsigned graph = add_graph(reg);
-      Candidates[reg] = { 0, graph, true, rc };
-    }
-    void new_vec(unsigned reg, unsigned graph, const TargetRegisterClass *rc)
-    {
-      Candidates[reg] = { 0, graph, true, rc };
-    }
-    bool exist_vec(unsigned reg)
-    {
-      return Candidates.find(reg) != Candidates.end();
-    }
-    bool valid_vec(unsigned reg)
-    {
-      return exist_vec(reg) && vec(reg).Valid;
-    }
-    Info& vec(unsigned reg)
-    {
-      return Candidates[reg];
-    }
-
-    void dump(void)
-    {
-      dbgs() << "Dump status of PromoteToV1\n";
-      for (const auto &v64 : Candidates) {
-        dbgs() << "vec " << printReg(v64.first, TRI) << " - V64, ("
-          << printReg(v64.second.NewReg) << ", "
-          << v64.second.GraphNo << ", "
-          << v64.second.Valid << ", "
-          << printRegClass(v64.second.RegClass) << ")\n";
-      }
-    }
+    // Member registers defined by an instruction outside of the class.
+    DenseMap<unsigned, bool> ForeignDef;
+    // New VM or VM512 register for each promoted member.
+    DenseMap<unsigned, unsigned> NewRegs;
 
     static char ID;
     Promoter() : MachineFunctionPass(ID) {}
@@ -118,58 +98,49 @@ namespace {
     StringRef getPassName() const override
     { return "VE Vector Mask Register Promoter"; }
 
-    static const char* printRegClass(const TargetRegisterClass* RC) {
-      if (RC == nullptr) return "nullptr";
-      else if (RC == &VE::I64RegClass) return "I64";
-      else if (RC == &VE::I32RegClass) return "I32";
-      else if (RC == &VE::F32RegClass) return "F32";
-      else if (VE::F128RegClass.hasSubClassEq(RC))  return "F128";
-      else if (RC == &VE::V64RegClass) return "V64";
-      else if (RC == &VE::VMRegClass) return "VM";
-      else if (RC == &VE::VM512RegClass) return "VM512";
-      else  return "Unknown";
+    static bool isMaskToVec(const MachineInstr &MI) {
+      return MI.getOpcode() == VE::VM2V || MI.getOpcode() == VE::VMP2V;
+    }
+    static bool isVecToMask(const MachineInstr &MI) {
+      return MI.getOpcode() == VE::V2VM || MI.getOpcode() == VE::V2VMP;
+    }
+    static bool isCast(const MachineInstr &MI) {
+      return isMaskToVec(MI) || isVecToMask(MI);
     }
 
-    // Gather all v64 registers defined by VM2V or VMP2V instructions.
-    void gatherVecCandidates(MachineBasicBlock &MBB);
-    // Expand candidates using def-use relationships.
-    bool expandVecCandidates(MachineBasicBlock &MBB);
-    // Remove candidates if its def-use relationships are wrong.
-    void removeVecCandidates(MachineBasicBlock &MBB);
-    // Modify all instructions using v64 regsiters 
-    bool runOnMachineBasicBlock(MachineBasicBlock &MBB);
-    bool runOnMachineFunction(MachineFunction &F) override {
-      bool Changed = false;
-      Subtarget = &F.getSubtarget<VESubtarget>();
-      MRI = &F.getRegInfo();
-      TRI = Subtarget->getRegisterInfo();
-
-      if (DisablePromoteToI1)
-        return false;
-
-      LLVM_DEBUG(F.dump());
-
-      for (MachineFunction::iterator FI = F.begin(), FE = F.end();
-           FI != FE; ++FI)
-        gatherVecCandidates(*FI);
-
-      bool changed;
-      do {
-        changed = false;
-        for (MachineFunction::iterator FI = F.begin(), FE = F.end();
-             FI != FE; ++FI)
-          changed |= expandVecCandidates(*FI);
-        LLVM_DEBUG(dump());
-      } while (changed);
-
-      for (MachineFunction::iterator FI = F.begin(), FE = F.end();
-           FI != FE; ++FI)
-        Changed |= runOnMachineBasicBlock(*FI);
-      LLVM_DEBUG(F.dump());
-      Candidates.clear();
-      GraphInfo.clear();
-      return Changed;
+    // Return true if Reg is a V64 virtual register.
+    bool isVecReg(unsigned Reg) const {
+      return TargetRegisterInfo::isVirtualRegister(Reg) &&
+             MRI->getRegClass(Reg) == &VE::V64RegClass;
     }
+    unsigned classOf(unsigned Reg) const {
+      return Classes[TargetRegisterInfo::virtReg2Index(Reg)];
+    }
+    // Return the class information of Reg if Reg is a member of a class
+    // carrying a mask.
+    ClassInfo *maskClass(unsigned Reg) {
+      if (!isVecReg(Reg))
+        return nullptr;
+      auto It = Infos.find(classOf(Reg));
+      if (It == Infos.end() || !It->second.RegClass)
+        return nullptr;
+      return &It->second;
+    }
+    bool isPromoted(unsigned Reg) const {
+      return NewRegs.count(Reg);
+    }
+
+    // Return true if MI only moves a value inside of the class of Reg,
+    // so it is rewritten instead of getting a cast.
+    bool isInternal(const MachineInstr &MI) const;
+
+    void buildClasses(MachineFunction &MF);
+    void analyzeClasses(MachineFunction &MF);
+    bool rewrite(MachineFunction &MF);
+    void rewriteInternal(MachineInstr &MI);
+    void addBoundaryCasts(MachineInstr &MI);
+
+    bool runOnMachineFunction(MachineFunction &MF) override;
   };
   char Promoter::ID = 0;
 } // end of anonymous namespace
@@ -181,172 +152,289 @@ FunctionPass *llvm::createVEPromoteToI1Pass() {
   return new Promoter;
 }
 
+bool Promoter::isInternal(const MachineInstr &MI) const {
+  if (MI.isImplicitDef() || isCast(MI))
+    return true;
+  if (MI.isPHI()) {
+    if (!isVecReg(MI.getOperand(0).getReg()))
+      return false;
+    for (unsigned i = 1, e = MI.getNumOperands(); i < e; i += 2)
+      if (MI.getOperand(i).getSubReg() || !isVecReg(MI.getOperand(i).getReg()))
+        return false;
+    return true;
+  }
+  if (MI.isCopy()) {
+    const MachineOperand &Dst = MI.getOperand(0);
+    const MachineOperand &Src = MI.getOperand(1);
+    return !Dst.getSubReg() && !Src.getSubReg() && isVecReg(Dst.getReg()) &&
+           isVecReg(Src.getReg());
+  }
+  return false;
+}
 
-void Promoter::gatherVecCandidates(MachineBasicBlock &MBB) {
-
-  for (MachineBasicBlock::iterator I = MBB.begin(); I != MBB.end(); ) {
-    MachineBasicBlock::iterator MI = I;
-    ++I;
+/// Group V64 virtual registers connected through COPY and PHI.
+void Promoter::buildClasses(MachineFunction &MF) {
+  Classes.clear();
+  Classes.grow(MRI->getNumVirtRegs());
 
-    // If MI is VM2V or VMP2V, result operand is the target.
-    if (MI->getOpcode() == VE::VM2V || MI->getOpcode() == VE::VMP2V) {
-      assert (MI->getOperand(0).isReg() && MI->getOperand(1).isReg() &&
-              "one of VM*2V operands is not a register.");
-      unsigned VR = MI->getOperand(0).getReg();
-      unsigned VMR = MI->getOperand(1).getReg();
-      assert (TargetRegisterInfo::isVirtualRegister(VMR) &&
-              "one of VM*2V operands is not a virtual register.");
-      new_vec(VR, MRI->getRegClass(VMR));
-      continue;
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      if (!(MI.isPHI() || MI.isCopy()) || !isInternal(MI))
+        continue;
+      unsigned Dst = MI.getOperand(0).getReg();
+      if (!isVecReg(Dst))
+        continue;
+      for (unsigned i = 1, e = MI.getNumOperands(); i != e; ++i) {
+        const MachineOperand &MO = MI.getOperand(i);
+        if (MO.isReg() && isVecReg(MO.getReg()))
+          Classes.join(TargetRegisterInfo::virtReg2Index(Dst),
+                       TargetRegisterInfo::virtReg2Index(MO.getReg()));
+      }
     }
   }
+  Classes.compress();
 }
 
-bool Promoter::expandVecCandidates(MachineBasicBlock &MBB) {
-  bool Changed = false;
+/// Find classes carrying masks, and count casts removed and required by
+/// promoting each of them.
+void Promoter::analyzeClasses(MachineFunction &MF) {
+  Infos.clear();
+  ForeignDef.clear();
 
-  for (MachineBasicBlock::iterator I = MBB.begin(); I != MBB.end(); ) {
-    MachineBasicBlock::iterator MI = I;
-    ++I;
+  // Seed classes from the casts.
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      if (!isCast(MI))
+        continue;
+      bool Packed = MI.getOpcode() == VE::VMP2V ||
+                    MI.getOpcode() == VE::V2VMP;
+      unsigned Reg = MI.getOperand(isMaskToVec(MI) ? 0 : 1).getReg();
+      if (!isVecReg(Reg))
+        continue;
+      const TargetRegisterClass *RC =
+          Packed ? &VE::VM512RegClass : &VE::VMRegClass;
+      ClassInfo &Info = Infos[classOf(Reg)];
+      if (Info.RegClass && Info.RegClass != RC) {
+        LLVM_DEBUG(dbgs() << "class of " << printReg(Reg, TRI)
+                          << " mixes VM and VM512\n");
+        Info.Valid = false;
+      }
+      Info.RegClass = RC;
+      ++Info.NumCasts;
+    }
+  }
 
-    if (MI->isPHI() || MI->isCopy()) {
-      for (const auto &v : Candidates) {
-        if (!MI->readsVirtualRegister(v.first))
-          continue;
-        if (MI->getNumOperands() == 0)
+  // Count boundaries.  A member defined outside of the class needs a cast
+  // to a mask after its definition, which also serves every outside use of
+  // that member.  Other members need a cast back to V64 at each outside
+  // instruction using them.
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      if (isInternal(MI) || MI.isDebugInstr())
+        continue;
+      for (const MachineOperand &MO : MI.operands()) {
+        if (!MO.isReg() || !MO.isDef() || !maskClass(MO.getReg()))
           continue;
-        for (unsigned i = 0, e = MI->getNumOperands(); i != e; ++i) {
-          const MachineOperand &MO = MI->getOperand(i);
-          if (!MO.isReg()) continue;
-          // Check a register in def which uses one of vector register in
-          // Candidates.
-          unsigned reg = MO.getReg();
-          if (exist_vec(reg) && vec(reg).GraphNo != v.second.GraphNo) {
-            // If a reg is registered in Candidates with different graph
-            // number, we merge two def-use graph into one.
-            LLVM_DEBUG(dbgs() << "merging " << v.second.GraphNo \
-                         << " to " << vec(reg).GraphNo << "\n");
-            merge_graph(v.second.GraphNo, vec(reg).GraphNo);
-            Changed = true;
-          } else if (!exist_vec(reg)) {
-            // If a reg is not registered, add new reg as a new node of
-            // existing graph
-            LLVM_DEBUG(dbgs() << "adding " << printReg(reg, TRI) \
-                         << " as part of " << v.second.GraphNo << "\n");
-            new_vec(reg, v.second.GraphNo, v.second.RegClass);
-            Changed = true;
-          }
+        ClassInfo *Info = maskClass(MO.getReg());
+        // A PHI mixing register classes would need casts in predecessors.
+        // That doesn't happen after isel, so simply give up such classes.
+        if (MI.isPHI())
+          Info->Valid = false;
+        if (!ForeignDef[MO.getReg()]) {
+          ForeignDef[MO.getReg()] = true;
+          ++Info->NumBoundaries;
         }
       }
     }
   }
-  return Changed;
-}
-
-void Promoter::removeVecCandidates(MachineBasicBlock &MBB) {
-  for (MachineBasicBlock::iterator I = MBB.begin(); I != MBB.end(); ) {
-    MachineBasicBlock::iterator MI = I;
-    ++I;
-
-    for (auto &v : Candidates) {
-      auto result = MI->readsWritesVirtualRegister(v.first);
-      if (result.first || result.second) {
-        if (MI->isPHI() || MI->isCopy() || MI->isImplicitDef()) {
-          // it's OK, so nothing to do here
-        } else if (MI->getOpcode() == VE::VM2V
-                   || MI->getOpcode() == VE::VMP2V) {
-        } else if (MI->getOpcode() == VE::V2VM
-                   || MI->getOpcode() == VE::V2VMP) {
-        } else {
-          LLVM_DEBUG(dbgs() << "invalidating " << printReg(v.first, TRI) \
-                       << " because of "; MI->dump());
-          v.second.Valid = false;
-        }
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      if (isInternal(MI) || MI.isDebugInstr())
+        continue;
+      SmallVector<unsigned, 2> Seen;
+      for (const MachineOperand &MO : MI.operands()) {
+        if (!MO.isReg() || !MO.isUse() || !maskClass(MO.getReg()))
+          continue;
+        unsigned Reg = MO.getReg();
+        if (ForeignDef.lookup(Reg) || is_contained(Seen, Reg))
+          continue;
+        Seen.push_back(Reg);
+        ClassInfo *Info = maskClass(Reg);
+        ++Info->NumBoundaries;
+        // Uses with a sub-register or in a PHI cannot be redirected to a
+        // cast in front of the instruction.
+        if (MO.getSubReg() || MI.isPHI())
+          Info->Valid = false;
       }
     }
   }
-  return;
 }
 
-/// runOnMachineBasicBlock - Fill in delay slots for the given basic block.
-/// We assume there is only one delay slot per delayed instruction.
+/// Rewrite an instruction inside a promoted class to work on VM or VM512
+/// registers.
 ///
-bool Promoter::runOnMachineBasicBlock(MachineBasicBlock &MBB) {
-  bool Changed = false;
-  Subtarget = &MBB.getParent()->getSubtarget<VESubtarget>();
-  const TargetInstrInfo *TII = Subtarget->getInstrInfo();
-
-  for (MachineBasicBlock::iterator I = MBB.begin(); I != MBB.end(); ) {
-    MachineBasicBlock::iterator MI = I;
-    ++I;
-
-    if (!MI->isPHI() && !MI->isCopy() && !MI->isImplicitDef()
-      && MI->getOpcode() != VE::VM2V && MI->getOpcode() != VE::VMP2V
-      && MI->getOpcode() != VE::V2VM && MI->getOpcode() != VE::V2VMP)
-      continue;
+/// For example:
+///    input:  %12:v64 = VM2V %11:vm
+///            %13:v64 = PHI %12:v64, %bb.1, %14:v64, %bb.2
+///            %15:vm = V2VM %13:v64
+///    output: %16:vm = COPY %11:vm
+///            %17:vm = PHI %16:vm, %bb.1, %18:vm, %bb.2
+///            %15:vm = COPY %17:vm
+void Promoter::rewriteInternal(MachineInstr &MI) {
+  MachineBasicBlock &MBB = *MI.getParent();
+  const DebugLoc &DL = MI.getDebugLoc();
+  unsigned Dst = MI.getOperand(0).getReg();
+
+  if (MI.isPHI()) {
+    MachineInstrBuilder MIB =
+        BuildMI(MBB, MI, DL, TII->get(TargetOpcode::PHI), NewRegs[Dst]);
+    for (unsigned i = 1, e = MI.getNumOperands(); i != e; i += 2)
+      MIB.addReg(NewRegs[MI.getOperand(i).getReg()])
+         .addMBB(MI.getOperand(i + 1).getMBB());
+  } else if (MI.isImplicitDef()) {
+    BuildMI(MBB, MI, DL, TII->get(TargetOpcode::IMPLICIT_DEF), NewRegs[Dst]);
+  } else if (MI.isCopy()) {
+    BuildMI(MBB, MI, DL, TII->get(TargetOpcode::COPY), NewRegs[Dst])
+        .addReg(NewRegs[MI.getOperand(1).getReg()]);
+  } else if (isMaskToVec(MI)) {
+    BuildMI(MBB, MI, DL, TII->get(TargetOpcode::COPY), NewRegs[Dst])
+        .addReg(MI.getOperand(1).getReg());
+  } else {
+    assert(isVecToMask(MI) && "unexpected instruction in a mask class");
+    BuildMI(MBB, MI, DL, TII->get(TargetOpcode::COPY), Dst)
+        .addReg(NewRegs[MI.getOperand(1).getReg()]);
+  }
+  MI.eraseFromParent();
+}
 
-    // Check whether this MI access one of Candidates registers.
-    if (MI->isPHI() || MI->isCopy() || MI->isImplicitDef()
-      || MI->getOpcode() == VE::VM2V || MI->getOpcode() == VE::VMP2V) {
-      const MachineOperand &MO = MI->getOperand(0);
-      if (!MO.isReg() || !valid_vec(MO.getReg()))
-        continue;
-    }
-    if (MI->getOpcode() == VE::V2VM || MI->getOpcode() == VE::V2VMP) {
-      const MachineOperand &MO = MI->getOperand(1);
-      if (!MO.isReg() || !valid_vec(MO.getReg()))
-        continue;
+/// Insert casts between MI, which is outside of any promoted class, and
+/// promoted registers it defines or uses.
+void Promoter::addBoundaryCasts(MachineInstr &MI) {
+  MachineBasicBlock &MBB = *MI.getParent();
+  const DebugLoc &DL = MI.getDebugLoc();
+
+  // Uses: read a V64 copy of the promoted register.
+  SmallVector<std::pair<unsigned, unsigned>, 2> Casted;
+  for (MachineOperand &MO : MI.uses()) {
+    if (!MO.isReg() || !isPromoted(MO.getReg()) ||
+        ForeignDef.lookup(MO.getReg()))
+      continue;
+    unsigned Reg = MO.getReg();
+    unsigned Tmp = 0;
+    for (auto &P : Casted)
+      if (P.first == Reg)
+        Tmp = P.second;
+    if (!Tmp) {
+      bool Packed = MRI->getRegClass(NewRegs[Reg]) == &VE::VM512RegClass;
+      Tmp = MRI->createVirtualRegister(&VE::V64RegClass);
+      BuildMI(MBB, MI, DL, TII->get(Packed ? VE::VMP2V : VE::VM2V), Tmp)
+          .addReg(NewRegs[Reg]);
+      Casted.push_back({Reg, Tmp});
+      ++NumCastsInserted;
     }
+    MO.setReg(Tmp);
+  }
+
+  // Defs: keep the V64 register and derive the promoted one from it.
+  for (const MachineOperand &MO : MI.defs()) {
+    if (!MO.isReg() || !isPromoted(MO.getReg()))
+      continue;
+    unsigned Reg = MO.getReg();
+    bool Packed = MRI->getRegClass(NewRegs[Reg]) == &VE::VM512RegClass;
+    BuildMI(MBB, std::next(MI.getIterator()), DL,
+            TII->get(Packed ? VE::V2VMP : VE::V2VM), NewRegs[Reg])
+        .addReg(Reg);
+    ++NumCastsInserted;
+  }
+}
 
-    // Convert MI to new MI using VM/VMP registers
-    //
-    // For example:
-    //    input:  %12:v64 = VM2V %11:v256i1
-    //            v
-    //    output: %13:v256i1 = COPY %11:v256i1
-    //
-
-    // create virtual register first
-    for (unsigned i = 0, e = MI->getNumOperands(); i != e; ++i) {
-      const MachineOperand &MO = MI->getOperand(i);
-      if (!MO.isReg()) continue;
-      unsigned v = MO.getReg();
-      if (valid_vec(v) && vec(v).NewReg == 0)
-        vec(v).NewReg = MRI->createVirtualRegister(vec(v).RegClass);
+bool Promoter::rewrite(MachineFunction &MF) {
+  NewRegs.clear();
+
+  // Allocate promoted registers for all members of profitable classes.
+  for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
+    unsigned Reg = TargetRegisterInfo::index2VirtReg(i);
+    if (MRI->reg_nodbg_empty(Reg))
+      continue;
+    ClassInfo *Info = maskClass(Reg);
+    if (!Info || !Info->Valid || Info->NumBoundaries >= Info->NumCasts)
+      continue;
+    NewRegs[Reg] = MRI->createVirtualRegister(Info->RegClass);
+  }
+  if (NewRegs.empty())
+    return false;
+
+  for (auto &I : Infos) {
+    const ClassInfo &Info = I.second;
+    if (!Info.RegClass || !Info.Valid ||
+        Info.NumBoundaries >= Info.NumCasts) {
+      LLVM_DEBUG(if (Info.RegClass) dbgs()
+                     << "not promoting class " << I.first << ": "
+                     << Info.NumCasts << " casts, " << Info.NumBoundaries
+                     << " boundaries, valid " << Info.Valid << "\n");
+      continue;
     }
-    // convert MI
-    if (MI->isPHI()) {
-      MachineInstrBuilder MIB = BuildMI(
-        MBB, I, MI->getDebugLoc(), TII->get(MI->getOpcode()),
-        vec(MI->getOperand(0).getReg()).NewReg);
-      for (unsigned i = 1, e = MI->getNumOperands(); i != e; ++i) {
-        const MachineOperand &MO = MI->getOperand(i);
-        if (MO.isReg()) {
-          MIB.addReg(vec(MO.getReg()).NewReg);
-        } else if (MO.isMBB()) {
-          MIB.addMBB(MO.getMBB());
-        } else {
-          llvm_unreachable("PHI has unexpected operand.");
-        }
+    NumCastsRemoved += Info.NumCasts;
+    ++NumClassesPromoted;
+  }
+
+  // Collect instructions first since rewriting erases them.
+  SmallVector<MachineInstr *, 32> Internals, Boundaries;
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      bool Touches = false;
+      for (MachineOperand &MO : MI.operands()) {
+        if (!MO.isReg() || !isPromoted(MO.getReg()))
+          continue;
+        Touches = true;
+        // Debug values of erased registers are dropped.
+        if (MI.isDebugInstr() && !ForeignDef.lookup(MO.getReg()))
+          MO.setReg(0);
       }
-    } else if (MI->isCopy()) {
-      BuildMI(MBB, I, MI->getDebugLoc(), TII->get(TargetOpcode::COPY),
-              vec(MI->getOperand(0).getReg()).NewReg)
-        .addReg(vec(MI->getOperand(1).getReg()).NewReg);
-    } else if (MI->isImplicitDef()) {
-      BuildMI(MBB, I, MI->getDebugLoc(), TII->get(MI->getOpcode()),
-              vec(MI->getOperand(0).getReg()).NewReg);
-    } else if (MI->getOpcode() == VE::VM2V || MI->getOpcode() == VE::VMP2V) {
-      BuildMI(MBB, I, MI->getDebugLoc(), TII->get(TargetOpcode::COPY),
-              vec(MI->getOperand(0).getReg()).NewReg)
-        .addReg(MI->getOperand(1).getReg());
-    } else if (MI->getOpcode() == VE::V2VM || MI->getOpcode() == VE::V2VMP) {
-      BuildMI(MBB, I, MI->getDebugLoc(), TII->get(TargetOpcode::COPY),
-              MI->getOperand(0).getReg())
-        .addReg(vec(MI->getOperand(1).getReg()).NewReg);
+      if (!Touches || MI.isDebugInstr())
+        continue;
+      if (isInternal(MI))
+        Internals.push_back(&MI);
+      else
+        Boundaries.push_back(&MI);
     }
-    MI->eraseFromParent();
-    Changed = true;
   }
+
+  for (MachineInstr *MI : Boundaries)
+    addBoundaryCasts(*MI);
+  for (MachineInstr *MI : Internals)
+    rewriteInternal(*MI);
+  return true;
+}
+
+bool Promoter::runOnMachineFunction(MachineFunction &MF) {
+  if (DisablePromoteToI1)
+    return false;
+
+  Subtarget = &MF.getSubtarget<VESubtarget>();
+  TII = Subtarget->getInstrInfo();
+  TRI = Subtarget->getRegisterInfo();
+  MRI = &MF.getRegInfo();
+  assert(MRI->isSSA() && "PromoteToI1 requires SSA form");
+
+  LLVM_DEBUG(dbgs() << "********** PromoteToI1: " << MF.getName()
+                    << " **********\n");
+
+  buildClasses(MF);
+  analyzeClasses(MF);
+  bool Changed = rewrite(MF);
+
+  unsigned Remaining = 0;
+  for (MachineBasicBlock &MBB : MF)
+    for (MachineInstr &MI : MBB)
+      if (isCast(MI))
+        ++Remaining;
+  NumCastsRemaining += Remaining;
+  LLVM_DEBUG(dbgs() << Remaining << " mask casts remain in " << MF.getName()
+                    << "\n");
+
+  Infos.clear();
+  ForeignDef.clear();
+  NewRegs.clear();
   return Changed;
 }
@@ -14,6 +14,9 @@
 #include "VEInstrInfo.h"
 #include "VEMachineFunctionInfo.h"
 #include "VESubtarget.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
@@ -23,10 +26,17 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetOptions.h"
 
 using namespace llvm;
 
+#define DEBUG_TYPE "ve-frame-lowering"
+
+STATISTIC(NumVectorSpillBytesSaved,
+          "Number of bytes of vector spill and reload traffic saved by "
+          "partial-length spills");
+
 static cl::opt<bool>
 DisableLeafProc("disable-ve-leaf-proc",
                 cl::init(false),
@@ -450,3 +460,71 @@ void VEFrameLowering::determineCalleeSaves(MachineFunction &MF,
     MFI->setLeafProc(true);
   }
 }
+
+void VEFrameLowering::processFunctionBeforeFrameFinalized(
+    MachineFunction &MF, RegScavenger *RS) const {
+  shrinkVectorSpillSlots(MF);
+}
+
+void VEFrameLowering::shrinkVectorSpillSlots(MachineFunction &MF) const {
+  const unsigned MaxVL = 256;
+  MachineFrameInfo &MFI = MF.getFrameInfo();
+
+  // VEInstrInfo::storeRegToStackSlot stores only the elements of a vector
+  // register that are in use, but loadRegFromStackSlot does not know the
+  // length yet.  Collect the longest store into each spill slot.
+  DenseMap<int, unsigned> SlotVL;
+  SmallSet<int, 4> FullLength;
+  SmallVector<MachineInstr *, 16> Accesses;
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      for (const MachineOperand &MO : MI.operands()) {
+        if (!MO.isFI() || !MFI.isSpillSlotObjectIndex(MO.getIndex()))
+          continue;
+        int FI = MO.getIndex();
+        unsigned OpNo = MI.getOperandNo(&MO);
+        if (MI.getOpcode() == VE::STVRri && OpNo == 0 &&
+            MI.getOperand(3).isImm()) {
+          unsigned &VL = SlotVL[FI];
+          VL = std::max(VL, (unsigned)MI.getOperand(3).getImm());
+          Accesses.push_back(&MI);
+        } else if (MI.getOpcode() == VE::LDVRri && OpNo == 1 &&
+                   MI.getOperand(3).isImm()) {
+          Accesses.push_back(&MI);
+        } else {
+          // Somebody else accesses the slot.  Keep its full size.
+          FullLength.insert(FI);
+        }
+      }
+    }
+  }
+
+  for (auto &Slot : SlotVL) {
+    if (Slot.second >= MaxVL || FullLength.count(Slot.first))
+      continue;
+    LLVM_DEBUG(dbgs() << "Shrink vector spill slot fi#" << Slot.first
+                      << " to " << Slot.second << " elements\n");
+    MFI.setObjectSize(Slot.first, Slot.second * 8);
+  }
+
+  for (MachineInstr *MI : Accesses) {
+    int FI = MI->getOperand(MI->getOpcode() == VE::STVRri ? 0 : 1).getIndex();
+    unsigned VL = MaxVL;
+    auto It = SlotVL.find(FI);
+    if (It != SlotVL.end() && !FullLength.count(FI))
+      VL = It->second;
+    // A store into a slot that is also read at full length has to write
+    // all elements.  Otherwise use the length of the slot for reloads.
+    if (MI->getOpcode() == VE::LDVRri || VL == MaxVL)
+      MI->getOperand(3).setImm(VL);
+    VL = MI->getOperand(3).getImm();
+    if (VL == MaxVL)
+      continue;
+    NumVectorSpillBytesSaved += (MaxVL - VL) * 8;
+
+    SmallVector<MachineMemOperand *, 1> MemRefs;
+    for (MachineMemOperand *MMO : MI->memoperands())
+      MemRefs.push_back(MF.getMachineMemOperand(MMO, 0, VL * 8));
+    MI->setMemRefs(MF, MemRefs);
+  }
+}
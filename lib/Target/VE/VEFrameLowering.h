@@ -43,6 +43,8 @@ public:
   bool hasFP(const MachineFunction &MF) const override;
   void determineCalleeSaves(MachineFunction &MF, BitVector &SavedRegs,
                             RegScavenger *RS = nullptr) const override;
+  void processFunctionBeforeFrameFinalized(
+      MachineFunction &MF, RegScavenger *RS = nullptr) const override;
 
   int getFrameIndexReference(const MachineFunction &MF, int FI,
                              unsigned &FrameReg) const override;
@@ -67,6 +69,10 @@ public:
   bool targetHandlesStackFrameRounding() const override { return true; }
 
 private:
+  // Shrink the stack slots of vector spills to the vector length actually
+  // stored into them.
+  void shrinkVectorSpillSlots(MachineFunction &MF) const;
+
   // Returns true if MF is a leaf procedure.
   bool isLeafProc(MachineFunction &MF) const;
 
@@ -29,6 +29,7 @@
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/CodeGen/TargetLoweringObjectFileImpl.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
@@ -88,6 +89,129 @@ VETargetLowering::LowerBitcast(SDValue Op, SelectionDAG &DAG) const {
   }
 }
 
+/// Returns the scalar of a splat that is either a BUILD_VECTOR or an
+/// already lowered VEC_BROADCAST.
+static SDValue getSplatScalar(SDValue V) {
+  if (V.getOpcode() == VEISD::VEC_BROADCAST)
+    return V.getOperand(0);
+  if (auto *BVN = dyn_cast<BuildVectorSDNode>(V))
+    return BVN->getSplatValue();
+  return SDValue();
+}
+
+/// Returns true if V is the sequence <0, 1, 2, ...>.
+static bool isStepVector(SDValue V) {
+  if (V.getOpcode() == VEISD::VEC_SEQ)
+    return isOneConstant(V.getOperand(0));
+  if (V.getOpcode() != ISD::BUILD_VECTOR)
+    return false;
+  for (unsigned i = 0; i < V.getNumOperands(); ++i) {
+    auto *C = dyn_cast<ConstantSDNode>(V.getOperand(i));
+    if (!C || C->getZExtValue() != i)
+      return false;
+  }
+  return true;
+}
+
+/// If Mask only activates a prefix of the vector, returns the length of that
+/// prefix as an i64.  This recognizes constant masks and the header mask of
+/// a loop whose tail is folded by masking,
+///   (setcc (add (splat IV), <0, 1, ...>), (splat BTC), setule),
+/// if the add is known not to wrap.
+static SDValue getActiveLaneCount(SDValue Mask, const SDLoc &dl,
+                                  SelectionDAG &DAG) {
+  unsigned NumElts = Mask.getValueType().getVectorNumElements();
+
+  if (Mask.getOpcode() == ISD::BUILD_VECTOR) {
+    unsigned Count = 0;
+    for (unsigned i = 0; i < NumElts; ++i) {
+      SDValue E = Mask.getOperand(i);
+      if (E.isUndef())
+        continue;
+      auto *C = dyn_cast<ConstantSDNode>(E);
+      if (!C)
+        return SDValue();
+      if (C->getZExtValue() & 1) {
+        if (Count != i)
+          return SDValue();
+        ++Count;
+      }
+    }
+    return DAG.getConstant(Count, dl, MVT::i64);
+  }
+
+  if (Mask.getOpcode() != ISD::SETCC)
+    return SDValue();
+  ISD::CondCode CC = cast<CondCodeSDNode>(Mask.getOperand(2))->get();
+  if (CC != ISD::SETULE && CC != ISD::SETULT)
+    return SDValue();
+  SDValue Lanes = Mask.getOperand(0);
+  SDValue Bound = getSplatScalar(Mask.getOperand(1));
+  if (!Bound || Lanes.getOpcode() != ISD::ADD)
+    return SDValue();
+  SDValue Base = getSplatScalar(Lanes.getOperand(0));
+  SDValue Step = Lanes.getOperand(1);
+  if (!Base) {
+    Base = getSplatScalar(Step);
+    Step = Lanes.getOperand(0);
+  }
+  if (!Base || !isStepVector(Step))
+    return SDValue();
+
+  // The lanes are only a prefix if IV + i does not wrap around at the
+  // element width.  Otherwise the lanes past the wrap compare below BTC
+  // and are active, too.
+  EVT EltVT = Lanes.getValueType().getVectorElementType();
+  unsigned EltBits = EltVT.getSizeInBits();
+  if (!Lanes->getFlags().hasNoUnsignedWrap()) {
+    KnownBits Known = DAG.computeKnownBits(Base);
+    if (Known.getBitWidth() > EltBits)
+      Known = Known.trunc(EltBits);
+    APInt MaxBase = ~Known.Zero;
+    if (MaxBase.ugt(APInt::getMaxValue(EltBits) - (NumElts - 1)))
+      return SDValue();
+  }
+
+  // Lanes IV + i with IV + i <= BTC are active, which are the first
+  // BTC - IV + 1 ones, or none if IV > BTC.
+  Base = DAG.getZExtOrTrunc(DAG.getZExtOrTrunc(Base, dl, EltVT), dl,
+                            MVT::i64);
+  Bound = DAG.getZExtOrTrunc(DAG.getZExtOrTrunc(Bound, dl, EltVT), dl,
+                             MVT::i64);
+  SDValue Count = DAG.getNode(ISD::SUB, dl, MVT::i64, Bound, Base);
+  SDValue None;
+  if (CC == ISD::SETULE) {
+    Count = DAG.getNode(ISD::UMIN, dl, MVT::i64, Count,
+                        DAG.getConstant(NumElts - 1, dl, MVT::i64));
+    Count = DAG.getNode(ISD::ADD, dl, MVT::i64, Count,
+                        DAG.getConstant(1, dl, MVT::i64));
+    None = DAG.getSetCC(dl, MVT::i32, Base, Bound, ISD::SETUGT);
+  } else {
+    Count = DAG.getNode(ISD::UMIN, dl, MVT::i64, Count,
+                        DAG.getConstant(NumElts, dl, MVT::i64));
+    None = DAG.getSetCC(dl, MVT::i32, Base, Bound, ISD::SETUGE);
+  }
+  return DAG.getSelect(dl, MVT::i64, None, DAG.getConstant(0, dl, MVT::i64),
+                       Count);
+}
+
+/// Returns the addresses of the elements of a vector of type VT stored at
+/// BasePtr.
+static SDValue getElementAddresses(MVT VT, SDValue BasePtr, const SDLoc &dl,
+                                   SelectionDAG &DAG) {
+  unsigned EltBytes = VT.getScalarSizeInBits() / 8;
+  MVT AddrVT = MVT::getVectorVT(MVT::i64, VT.getVectorNumElements());
+  SDValue Seq = DAG.getNode(VEISD::VEC_SEQ, dl, AddrVT,
+                            DAG.getConstant(1, dl, MVT::i64));
+  SDValue Offsets = DAG.getNode(
+      ISD::SHL, dl, AddrVT, Seq,
+      DAG.getNode(VEISD::VEC_BROADCAST, dl, AddrVT,
+                  DAG.getConstant(Log2_32(EltBytes), dl, MVT::i64)));
+  return DAG.getNode(ISD::ADD, dl, AddrVT,
+                     DAG.getNode(VEISD::VEC_BROADCAST, dl, AddrVT, BasePtr),
+                     Offsets);
+}
+
 SDValue
 VETargetLowering::LowerMGATHER_MSCATTER(SDValue Op, SelectionDAG &DAG) const {
   LLVM_DEBUG(dbgs() << "Lowering gather or scatter\n");
@@ -127,39 +251,35 @@ VETargetLowering::LowerMGATHER_MSCATTER(SDValue Op, SelectionDAG &DAG) const {
 
   SDValue addresses = DAG.getNode(ISD::ADD, dl, IndexVT, {BaseBroadcast, index_addr});
 
-  // TODO: vmx = svm (mask);
-  //Mask.dumpr(&DAG);
-  if (Mask.getOpcode() != ISD::BUILD_VECTOR || Mask.getNumOperands() != 256) {
-    LLVM_DEBUG(dbgs() << "Cannot handle gathers with complex masks.\n");
-    return SDValue();
-  }
-  for (unsigned i = 0; i < 256; i++) {
-    const SDValue Operand = Mask.getOperand(i);
-    if (Operand.getOpcode() != ISD::Constant) {
-      LLVM_DEBUG(dbgs() << "Cannot handle gather masks with complex elements.\n");
-      return SDValue();
-    }
-    if (Mask.getConstantOperandVal(i) != 1) {
-      LLVM_DEBUG(dbgs() << "Cannot handle gather masks with elements != 1.\n");
-      return SDValue();
+  if (ISD::isBuildVectorAllOnes(Mask.getNode())) {
+    if (Op.getOpcode() == ISD::MGATHER) {
+      // vt = vgt (vindex, vmx, cs=0, sx=0, sy=0, sw=0);
+      // The mask is all ones, so PassThru is never used.
+      return DAG.getNode(VEISD::VEC_GATHER, dl, Op.getNode()->getVTList(),
+                         {Chain, addresses});
     }
+    return DAG.getNode(VEISD::VEC_SCATTER, dl, Op.getNode()->getVTList(),
+                       {Chain, Source, addresses});
   }
 
-  if (Op.getOpcode() == ISD::MGATHER) {
-    // vt = vgt (vindex, vmx, cs=0, sx=0, sy=0, sw=0);
-    SDValue load = DAG.getNode(VEISD::VEC_GATHER, dl, Op.getNode()->getVTList(), {Chain, addresses});
-    //load.dumpr(&DAG);
-
-    // TODO: merge (vt, default, vmx);
-    //PassThru.dumpr(&DAG);
-    // We can safely ignore PassThru right now, the mask is guaranteed to be constant 1s.
-
-    return load;
-  } else {
-    SDValue store = DAG.getNode(VEISD::VEC_SCATTER, dl, Op.getNode()->getVTList(), {Chain, Source, addresses});
-    //store.dumpr(&DAG);
-    return store;
+  if (Mask.getValueType() != MVT::v256i1 || IndexVT != MVT::v256i64) {
+    LLVM_DEBUG(dbgs() << "Cannot handle gathers with complex masks.\n");
+    return SDValue();
   }
+
+  if (Op.getOpcode() == ISD::MSCATTER)
+    return DAG.getNode(VEISD::VEC_MSCATTER, dl, MVT::Other,
+                       {Chain, Source, addresses, Mask});
+
+  // Gather the active elements and merge the passthru into the others.
+  MVT VT = Op.getSimpleValueType();
+  SDValue Load = DAG.getNode(VEISD::VEC_MGATHER, dl,
+                             DAG.getVTList(VT, MVT::Other),
+                             {Chain, addresses, Mask});
+  SDValue Result = Load;
+  if (!PassThru.isUndef())
+    Result = DAG.getNode(VEISD::VEC_VMRG, dl, VT, PassThru, Load, Mask);
+  return DAG.getMergeValues({Result, Load.getValue(1)}, dl);
 }
 
 SDValue
@@ -169,56 +289,142 @@ VETargetLowering::LowerMLOAD(SDValue Op, SelectionDAG &DAG) const {
   SDLoc dl(Op);
 
   MaskedLoadSDNode *N = cast<MaskedLoadSDNode>(Op.getNode());
+  MVT VT = Op.getSimpleValueType();
 
   SDValue BasePtr = N->getBasePtr();
   SDValue Mask = N->getMask();
   SDValue Chain = N->getChain();
   SDValue PassThru = N->getPassThru();
 
-  MachinePointerInfo info = N->getPointerInfo();
-
-  if (Mask.getOpcode() != ISD::BUILD_VECTOR || Mask.getNumOperands() != 256) {
-    LLVM_DEBUG(dbgs() << "Cannot handle gathers with complex masks.\n");
+  if (Mask.getValueType() != MVT::v256i1 ||
+      N->getExtensionType() != ISD::NON_EXTLOAD) {
+    LLVM_DEBUG(dbgs() << "Cannot handle masked loads of this type.\n");
     return SDValue();
   }
 
-  int firstzero = 256;
+  // Masks of the leading elements only shorten the vector length, which is
+  // how loops with a folded tail load their last iteration.  Other masks
+  // gather the active elements.
+  SDValue Load;
+  if (SDValue VL = getActiveLaneCount(Mask, dl, DAG))
+    Load = DAG.getNode(VEISD::VEC_VLD, dl, DAG.getVTList(VT, MVT::Other),
+                       {Chain, BasePtr, VL});
+  else
+    Load = DAG.getNode(VEISD::VEC_MGATHER, dl, DAG.getVTList(VT, MVT::Other),
+                       {Chain, getElementAddresses(VT, BasePtr, dl, DAG),
+                        Mask});
+
+  SDValue Result = Load;
+  if (!PassThru.isUndef())
+    Result = DAG.getNode(VEISD::VEC_VMRG, dl, VT, PassThru, Load, Mask);
+  SDValue Merge = DAG.getMergeValues({Result, Load.getValue(1)}, dl);
+  LLVM_DEBUG(dbgs() << "Becomes\n");
+  LLVM_DEBUG(Merge.dumpr(&DAG));
+  return Merge;
+}
 
-  for (unsigned i = 0; i < 256; i++) {
-    const SDValue Operand = Mask.getOperand(i);
-    if (Operand.getOpcode() != ISD::Constant) {
-      LLVM_DEBUG(dbgs() << "Cannot handle load masks with complex elements.\n");
-      return SDValue();
-    }
-    if (Mask.getConstantOperandVal(i) != 1) {
-      if (firstzero == 256)
-        firstzero = i;
-      if (!PassThru.isUndef() && !PassThru.getOperand(i).isUndef()) {
-        LLVM_DEBUG(dbgs() << "Cannot handle passthru.\n");
-        return SDValue();
-      }
-    } else {
-      if (firstzero != 256) {
-        LLVM_DEBUG(dbgs() << "Cannot handle mixed load masks.\n");
-        return SDValue();
-      }
-    }
+SDValue
+VETargetLowering::LowerMSTORE(SDValue Op, SelectionDAG &DAG) const {
+  LLVM_DEBUG(dbgs() << "Lowering MSTORE\n");
+  SDLoc dl(Op);
+
+  MaskedStoreSDNode *N = cast<MaskedStoreSDNode>(Op.getNode());
+  SDValue Mask = N->getMask();
+
+  if (Mask.getValueType() != MVT::v256i1 || N->isTruncatingStore()) {
+    LLVM_DEBUG(dbgs() << "Cannot handle masked stores of this type.\n");
+    return SDValue();
   }
 
-  EVT i32 = EVT::getIntegerVT(*DAG.getContext(), 32);
+  // Like LowerMLOAD, masks of the leading elements shorten the vector
+  // length.  VST takes any other mask directly.
+  SDValue VL = getActiveLaneCount(Mask, dl, DAG);
+  if (VL)
+    Mask = DAG.getUNDEF(MVT::v256i1);
+  else
+    VL = DAG.getConstant(256, dl, MVT::i64);
+  return DAG.getNode(VEISD::VEC_VST, dl, MVT::Other,
+                     {N->getChain(), N->getValue(), N->getBasePtr(), Mask,
+                      VL});
+}
+
+/// Returns true if V is a splat of the neutral element of the reduction Opc.
+static bool isReductionIdentity(unsigned Opc, SDValue V) {
+  SDValue S = getSplatScalar(V);
+  if (!S)
+    return false;
+  switch (Opc) {
+  case ISD::VECREDUCE_ADD:
+  case ISD::VECREDUCE_OR:
+  case ISD::VECREDUCE_XOR:
+    return isNullConstant(S);
+  case ISD::VECREDUCE_AND:
+    return isAllOnesConstant(S);
+  case ISD::VECREDUCE_FADD:
+    // Only fast reductions reach here, so the sign of zero does not matter.
+    if (auto *C = dyn_cast<ConstantFPSDNode>(S))
+      return C->isZero();
+    return false;
+  default:
+    return false;
+  }
+}
 
-  // FIXME: LVL instruction has output VL now, need to update VEC_LVL too.
-  Chain = DAG.getNode(VEISD::VEC_LVL, dl, MVT::Other, {Chain, DAG.getConstant(firstzero, dl, i32)});
+SDValue
+VETargetLowering::LowerVECREDUCE(SDValue Op, SelectionDAG &DAG) const {
+  SDLoc dl(Op);
+  unsigned Opc = Op.getOpcode();
+  SDValue V = Op.getOperand(0);
+  MVT VT = V.getSimpleValueType();
+  MVT EltVT = VT.getVectorElementType();
+
+  unsigned ReduceOpc;
+  switch (Opc) {
+  default: llvm_unreachable("Unexpected reduction");
+  case ISD::VECREDUCE_ADD:  ReduceOpc = VEISD::VEC_RSUM;  break;
+  case ISD::VECREDUCE_FADD: ReduceOpc = VEISD::VEC_RFSUM; break;
+  case ISD::VECREDUCE_SMAX:
+  case ISD::VECREDUCE_UMAX: ReduceOpc = VEISD::VEC_RSMAX; break;
+  case ISD::VECREDUCE_SMIN:
+  case ISD::VECREDUCE_UMIN: ReduceOpc = VEISD::VEC_RSMIN; break;
+  case ISD::VECREDUCE_FMAX: ReduceOpc = VEISD::VEC_RFMAX; break;
+  case ISD::VECREDUCE_FMIN: ReduceOpc = VEISD::VEC_RFMIN; break;
+  case ISD::VECREDUCE_AND:  ReduceOpc = VEISD::VEC_RAND;  break;
+  case ISD::VECREDUCE_OR:   ReduceOpc = VEISD::VEC_ROR;   break;
+  case ISD::VECREDUCE_XOR:  ReduceOpc = VEISD::VEC_RXOR;  break;
+  }
 
-  SDValue load = DAG.getLoad(Op.getSimpleValueType(), dl, Chain, BasePtr, info);
+  // Reduce under the mask of a select whose other side is the neutral
+  // element instead of merging the neutral elements in first.
+  SDValue Mask = DAG.getUNDEF(MVT::v256i1);
+  if (V.getOpcode() == ISD::VSELECT &&
+      V.getOperand(0).getValueType() == MVT::v256i1 &&
+      isReductionIdentity(Opc, V.getOperand(2))) {
+    Mask = V.getOperand(0);
+    V = V.getOperand(1);
+  }
 
-  // FIXME: LVL instruction has output VL now, need to update VEC_LVL too.
-  Chain = DAG.getNode(VEISD::VEC_LVL, dl, MVT::Other, {load.getValue(1), DAG.getConstant(256, dl, i32)});
+  // VE only has signed integer max and min reductions.  Flipping the sign
+  // bits maps the unsigned order onto the signed one.
+  SDValue SignBits;
+  if (Opc == ISD::VECREDUCE_UMAX || Opc == ISD::VECREDUCE_UMIN) {
+    unsigned EltBits = EltVT.getSizeInBits();
+    SignBits = DAG.getNode(
+        VEISD::VEC_BROADCAST, dl, VT,
+        DAG.getConstant(APInt::getSignMask(EltBits), dl, EltVT));
+    V = DAG.getNode(ISD::XOR, dl, VT, V, SignBits);
+  }
 
-  SDValue merge = DAG.getMergeValues({load, Chain}, dl);
-  LLVM_DEBUG(dbgs() << "Becomes\n");
-  LLVM_DEBUG(merge.dumpr(&DAG));
-  return merge;
+  SDValue Reduced = DAG.getNode(ReduceOpc, dl, VT, V, Mask);
+  if (SignBits)
+    Reduced = DAG.getNode(ISD::XOR, dl, VT, Reduced, SignBits);
+  SDValue Result =
+      DAG.getNode(ISD::EXTRACT_VECTOR_ELT, dl, EltVT, Reduced,
+                  DAG.getConstant(0, dl, getVectorIdxTy(DAG.getDataLayout())));
+  // Integer reductions may produce a wider result than the element type.
+  if (Op.getValueType() != EltVT)
+    Result = DAG.getAnyExtOrTrunc(Result, dl, Op.getValueType());
+  return Result;
 }
 
 static bool isBroadCast(BuildVectorSDNode *BVN,
@@ -1379,6 +1585,20 @@ VETargetLowering::VETargetLowering(const TargetMachine &TM,
       setOperationAction(ISD::MGATHER,   VT, Custom);
 
       setOperationAction(ISD::MLOAD, VT, Custom);
+      if (VT.getVectorNumElements() == 256)
+        setOperationAction(ISD::MSTORE, VT, Custom);
+
+      // Reductions of non-packed vectors map to the vector sum, max/min and
+      // fold instructions.  VE has no product reductions.
+      if (VT.getVectorNumElements() <= 256) {
+        for (unsigned Opc : {ISD::VECREDUCE_ADD, ISD::VECREDUCE_AND,
+                             ISD::VECREDUCE_OR, ISD::VECREDUCE_XOR,
+                             ISD::VECREDUCE_SMAX, ISD::VECREDUCE_SMIN,
+                             ISD::VECREDUCE_UMAX, ISD::VECREDUCE_UMIN,
+                             ISD::VECREDUCE_FADD, ISD::VECREDUCE_FMAX,
+                             ISD::VECREDUCE_FMIN})
+          setOperationAction(Opc, VT, Custom);
+      }
 
       // VE doesn't have instructions for fp<->uint, so expand them by llvm
       if (VT.getVectorElementType() == MVT::i32) {
@@ -1488,8 +1708,25 @@ const char *VETargetLowering::getTargetNodeName(unsigned Opcode) const {
   case VEISD::VEC_LVL:         return "VEISD::VEC_LVL";
   case VEISD::VEC_SEQ:         return "VEISD::VEC_SEQ";
   case VEISD::VEC_VMV:         return "VEISD::VEC_VMV";
+  case VEISD::VEC_VMRG:        return "VEISD::VEC_VMRG";
+  case VEISD::VEC_COMPRESS:    return "VEISD::VEC_COMPRESS";
+  case VEISD::VEC_EXPAND:      return "VEISD::VEC_EXPAND";
+  case VEISD::VEC_VSHF:        return "VEISD::VEC_VSHF";
+  case VEISD::VEC_RSUM:        return "VEISD::VEC_RSUM";
+  case VEISD::VEC_RFSUM:       return "VEISD::VEC_RFSUM";
+  case VEISD::VEC_RSMAX:       return "VEISD::VEC_RSMAX";
+  case VEISD::VEC_RSMIN:       return "VEISD::VEC_RSMIN";
+  case VEISD::VEC_RFMAX:       return "VEISD::VEC_RFMAX";
+  case VEISD::VEC_RFMIN:       return "VEISD::VEC_RFMIN";
+  case VEISD::VEC_RAND:        return "VEISD::VEC_RAND";
+  case VEISD::VEC_ROR:         return "VEISD::VEC_ROR";
+  case VEISD::VEC_RXOR:        return "VEISD::VEC_RXOR";
   case VEISD::VEC_SCATTER:     return "VEISD::VEC_SCATTER";
   case VEISD::VEC_GATHER:      return "VEISD::VEC_GATHER";
+  case VEISD::VEC_MSCATTER:    return "VEISD::VEC_MSCATTER";
+  case VEISD::VEC_MGATHER:     return "VEISD::VEC_MGATHER";
+  case VEISD::VEC_VLD:         return "VEISD::VEC_VLD";
+  case VEISD::VEC_VST:         return "VEISD::VEC_VST";
   case VEISD::Wrapper:         return "VEISD::Wrapper";
   case VEISD::INT_LVM:         return "VEISD::INT_LVM";
   case VEISD::INT_SVM:         return "VEISD::INT_SVM";
@@ -3223,134 +3460,404 @@ SDValue VETargetLowering::LowerINSERT_VECTOR_ELT(SDValue Op,
   return Op;
 }
 
-SDValue VETargetLowering::LowerVECTOR_SHUFFLE(SDValue Op, SelectionDAG &DAG) const {
-  LLVM_DEBUG(dbgs() << "Lowering Shuffle\n");
-  SDLoc dl(Op);
-  ShuffleVectorSDNode *ShuffleInstr = cast<ShuffleVectorSDNode>(Op.getNode());
-
-  SDValue firstVec = ShuffleInstr->getOperand(0);
-  int firstVecLength = firstVec.getSimpleValueType().getVectorNumElements();
-  SDValue secondVec = ShuffleInstr->getOperand(1);
-  int secondVecLength = secondVec.getSimpleValueType().getVectorNumElements();
-
-  MVT ElementType = Op.getSimpleValueType().getScalarType();
-  int resultSize = Op.getSimpleValueType().getVectorNumElements();
-
-  if (ShuffleInstr->isSplat()) {
-    int index = ShuffleInstr->getSplatIndex();
-    if (index >= firstVecLength) {
-      index -= firstVecLength;
-      SDValue elem = DAG.getNode(ISD::EXTRACT_VECTOR_ELT, dl, ElementType, {secondVec, DAG.getConstant(index, dl, EVT::getIntegerVT(*DAG.getContext(), 64))});
-      return DAG.getNode(VEISD::VEC_BROADCAST, dl, Op.getSimpleValueType(), elem);
-    } else {
-      SDValue elem = DAG.getNode(ISD::EXTRACT_VECTOR_ELT, dl, ElementType, {firstVec, DAG.getConstant(index, dl, EVT::getIntegerVT(*DAG.getContext(), 64))});
-      return DAG.getNode(VEISD::VEC_BROADCAST, dl, Op.getSimpleValueType(), elem);
-    }
+// Returns the mask of a shuffle of packed vectors in units of 64 bit lanes,
+// or false if some lane would be split.  Even elements live in the lower
+// and odd elements in the upper half of a lane.
+static bool getLaneShuffleMask(ArrayRef<int> Mask,
+                               SmallVectorImpl<int> &LaneMask) {
+  LaneMask.clear();
+  for (unsigned i = 0; i < Mask.size(); i += 2) {
+    int Lo = Mask[i], Hi = Mask[i + 1];
+    if ((Lo >= 0 && Lo % 2 != 0) || (Hi >= 0 && Hi % 2 != 1) ||
+        (Lo >= 0 && Hi >= 0 && Hi != Lo + 1))
+      return false;
+    LaneMask.push_back(Lo >= 0 ? Lo / 2 : Hi >= 0 ? Hi / 2 : -1);
   }
+  return true;
+}
 
-  // Supports v256 shuffles only atm.
-  if (firstVecLength != 256 || secondVecLength != 256 || resultSize != 256) {
-    LLVM_DEBUG(dbgs() << "Invalid vector lengths\n");
-    return SDValue();
+// Returns true and sets Sel if a VSHF of the packed sources computes Mask.
+// The selector picks the source of the upper half of each result lane in
+// bits 3-2 and that of the lower half in bits 1-0, where 0 is the upper
+// and 1 the lower half of the first source, and 2 and 3 those of the
+// second source.
+static bool getVSHFSelector(ArrayRef<int> Mask, unsigned &Sel) {
+  unsigned NumElts = Mask.size();
+  int HalfSel[2] = {-1, -1};
+  for (unsigned i = 0; i < NumElts; ++i) {
+    if (Mask[i] < 0)
+      continue;
+    unsigned Src = Mask[i] / NumElts;
+    unsigned Elt = Mask[i] % NumElts;
+    // VSHF only moves halves within a lane.
+    if (Elt / 2 != i / 2)
+      return false;
+    int S = Src * 2 + (Elt % 2 == 1 ? 0 : 1);
+    int &H = HalfSel[i % 2];
+    if (H >= 0 && H != S)
+      return false;
+    H = S;
   }
+  // Keep undefined halves where they are.
+  unsigned Lower = HalfSel[0] >= 0 ? HalfSel[0] : 1;
+  unsigned Upper = HalfSel[1] >= 0 ? HalfSel[1] : 0;
+  Sel = (Upper << 2) | Lower;
+  return true;
+}
 
-  int firstrot = 256;
-  int secondrot = 256;
-  int firstsecond = 256;
-  bool inv_order;
+// Try to move the elements taken from one source into place with VMV, VCP,
+// and VEX.  Elts holds pairs of result position and source element, sorted
+// by position.
+static bool planShuffleSource(ArrayRef<std::pair<int, int>> Elts,
+                              unsigned NumElts,
+                              VEShufflePlan::SourcePlan &Plan) {
+  Plan = VEShufflePlan::SourcePlan();
+  if (Elts.empty())
+    return true;
 
-  if (ShuffleInstr->getMaskElt(0) < 256) {
-    inv_order = false;
-  } else {
-    inv_order = true;
+  // A rotation moves all elements by the same distance.
+  unsigned Amount = (Elts[0].second + NumElts - Elts[0].first) % NumElts;
+  if (llvm::all_of(Elts, [&](const std::pair<int, int> &E) {
+        return (E.first + Amount) % NumElts == (unsigned)E.second;
+      })) {
+    Plan.Kind = Amount ? VEShufflePlan::Rotate : VEShufflePlan::Identity;
+    Plan.Amount = Amount;
+    return true;
   }
 
-  for (int i = 0; i < 256; i++) {
-    int mask_value = ShuffleInstr->getMaskElt(i);
-
-    if (mask_value < 0) // Undef
-      continue;
+  // VCP and VEX keep the order of the elements.
+  for (unsigned i = 1; i < Elts.size(); ++i)
+    if (Elts[i].second <= Elts[i - 1].second)
+      return false;
 
-    if (mask_value < 256) {
-      if (firstsecond != 256 && !inv_order) {
-        LLVM_DEBUG(dbgs() << "Mixing\n");
-        return SDValue();
+  // Compress the elements to the front, then rotate them to their first
+  // position if necessary.  Undefined positions between two elements are
+  // filled with the source elements right before the second one, so there
+  // have to be enough of them.
+  int First = Elts[0].first;
+  for (int Offset : {0, First}) {
+    Plan.Select = BitVector(NumElts);
+    int PrevPos = -1, PrevSrc = -1;
+    bool Fits = true;
+    for (const auto &E : Elts) {
+      int Pos = E.first - Offset;
+      if (E.second - PrevSrc < Pos - PrevPos) {
+        Fits = false;
+        break;
       }
+      Plan.Select.set(E.second - (Pos - PrevPos - 1), E.second + 1);
+      PrevPos = Pos;
+      PrevSrc = E.second;
+    }
+    if (Fits) {
+      Plan.Kind = Offset ? VEShufflePlan::CompressRotate
+                         : VEShufflePlan::Compress;
+      Plan.Amount = (NumElts - Offset) % NumElts;
+      return true;
+    }
+    if (First == 0)
+      break;
+  }
 
-      if (firstsecond == 256 && inv_order)
-        firstsecond = i;
-
-      if (firstrot == 256)
-        firstrot = i - mask_value;
-      else if (firstrot != i - mask_value) {
-        LLVM_DEBUG(dbgs() << "Bad first rot\n");
-        return SDValue();
-      }
-    } else { //mask_value >= 256
-      if (firstsecond != 256 && inv_order) {
-        LLVM_DEBUG(dbgs() << "Mixing\n");
-        return SDValue();
+  // Rotate the first element to the front if necessary, then expand the
+  // elements to their positions.  Source elements between two elements
+  // are put into the undefined positions right before the second one.
+  for (int Offset : {0, Elts[0].second}) {
+    Plan.Select = BitVector(NumElts);
+    int PrevPos = -1, PrevSrc = -1;
+    bool Fits = true;
+    for (const auto &E : Elts) {
+      int Src = E.second - Offset;
+      if (E.first - PrevPos < Src - PrevSrc) {
+        Fits = false;
+        break;
       }
+      Plan.Select.set(E.first - (Src - PrevSrc - 1), E.first + 1);
+      PrevPos = E.first;
+      PrevSrc = Src;
+    }
+    if (Fits) {
+      Plan.Kind = VEShufflePlan::RotateExpand;
+      Plan.Amount = Offset;
+      return true;
+    }
+    if (Elts[0].second == 0)
+      break;
+  }
 
-      if (firstsecond == 256 && !inv_order)
-        firstsecond = i;
+  Plan = VEShufflePlan::SourcePlan();
+  return false;
+}
+
+static VEShufflePlan computeShufflePlan(ArrayRef<int> Mask) {
+  VEShufflePlan Plan;
+  unsigned NumElts = Mask.size();
+
+  // Packed vectors.  Shuffle whole lanes as v256i64 or use a VSHF if all
+  // halves stay in their lane.  Anything else is expanded.
+  if (NumElts > 256) {
+    SmallVector<int, 256> LaneMask;
+    if (getLaneShuffleMask(Mask, LaneMask)) {
+      Plan = computeShufflePlan(LaneMask);
+      Plan.ByLanes = Plan.Strategy != VEShufflePlan::Expand;
+      return Plan;
+    }
+    if (getVSHFSelector(Mask, Plan.Imm)) {
+      Plan.Strategy = VEShufflePlan::LaneShuffle;
+      Plan.NumElts = 256;
+      Plan.NumVectorOps = 1;
+    }
+    return Plan;
+  }
 
-      mask_value -= 256;
+  Plan.NumElts = NumElts;
+  SmallVector<std::pair<int, int>, 256> Elts[2];
+  for (unsigned i = 0; i < NumElts; ++i)
+    if (Mask[i] >= 0)
+      Elts[Mask[i] / NumElts].push_back({(int)i, (int)(Mask[i] % NumElts)});
+
+  if (Elts[0].empty() && Elts[1].empty())
+    return Plan;
+
+  int SplatElt = Mask[Elts[0].empty() ? Elts[1][0].first : Elts[0][0].first];
+  if (llvm::all_of(Mask, [&](int M) { return M < 0 || M == SplatElt; })) {
+    Plan.Strategy = VEShufflePlan::Splat;
+    Plan.Imm = SplatElt;
+    Plan.NumVectorOps = 1;
+    return Plan;
+  }
 
-      if (secondrot == 256)
-        secondrot = i - mask_value;
-      else if (secondrot != i - mask_value) {
-        LLVM_DEBUG(dbgs() << "Bad second rot\n");
-        return SDValue();
+  unsigned MaskWords = divideCeil(NumElts, 64);
+  if (planShuffleSource(Elts[0], NumElts, Plan.Sources[0]) &&
+      planShuffleSource(Elts[1], NumElts, Plan.Sources[1])) {
+    Plan.Strategy = VEShufflePlan::Permute;
+    for (const VEShufflePlan::SourcePlan &S : Plan.Sources) {
+      switch (S.Kind) {
+      case VEShufflePlan::Unused:
+      case VEShufflePlan::Identity:
+        break;
+      case VEShufflePlan::Rotate:
+        Plan.NumVectorOps += 1;
+        break;
+      case VEShufflePlan::Compress:
+        Plan.NumVectorOps += 1;
+        Plan.NumMaskWords += MaskWords;
+        break;
+      case VEShufflePlan::CompressRotate:
+        Plan.NumVectorOps += 2;
+        Plan.NumMaskWords += MaskWords;
+        break;
+      case VEShufflePlan::RotateExpand:
+        Plan.NumVectorOps += S.Amount ? 2 : 1;
+        Plan.NumMaskWords += MaskWords;
+        break;
       }
     }
+    if (Plan.Sources[0].Kind == VEShufflePlan::Unused ||
+        Plan.Sources[1].Kind == VEShufflePlan::Unused)
+      return Plan;
+
+    // VEX keeps the elements of its pass-through operand outside of the
+    // expanded positions, so the second source can be expanded right into
+    // the first one if that does not overwrite any of its elements.
+    if (Plan.Sources[1].Kind == VEShufflePlan::RotateExpand &&
+        llvm::none_of(Elts[0], [&](const std::pair<int, int> &E) {
+          return Plan.Sources[1].Select.test(E.first);
+        })) {
+      Plan.ExpandInto = true;
+      return Plan;
+    }
+
+    Plan.Merge = BitVector(NumElts);
+    for (const auto &E : Elts[1])
+      Plan.Merge.set(E.first);
+    Plan.NumVectorOps += 1;
+    Plan.NumMaskWords += MaskWords;
+    return Plan;
   }
 
-  if (firstrot < 0)
-    firstrot *= -1;
-  else
-    firstrot = 256 - firstrot;
-  if (secondrot < 0)
-    secondrot *= -1;
-  else
-    secondrot = 256 - secondrot;
+  // Everything else goes through memory: store the sources, load a vector
+  // of offsets from the constant pool, and gather.
+  Plan = VEShufflePlan();
+  Plan.Strategy = VEShufflePlan::Gather;
+  Plan.NumElts = NumElts;
+  Plan.NumVectorOps = (Elts[0].empty() ? 0 : 1) + (Elts[1].empty() ? 0 : 1) +
+                      3;
+  return Plan;
+}
+
+VEShufflePlan VETargetLowering::getShufflePlan(ArrayRef<int> Mask) const {
+  // Plans are not cached: this object is shared by all functions compiled
+  // for the subtarget, possibly on several threads at once.
+  return computeShufflePlan(Mask);
+}
+
+// Returns a mask register with the bits in Bits set.
+static SDValue getConstantMask(const BitVector &Bits, const SDLoc &dl,
+                               SelectionDAG &DAG) {
+  SDValue Mask = DAG.getUNDEF(MVT::v256i1);
+  for (unsigned W = 0, E = divideCeil(Bits.size(), 64); W < E; ++W) {
+    // Element 0 is the most significant bit of the first word.
+    uint64_t Val = 0;
+    for (unsigned b = 0; b < 64 && W * 64 + b < Bits.size(); ++b)
+      if (Bits.test(W * 64 + b))
+        Val |= uint64_t(1) << (63 - b);
+    Mask = DAG.getNode(VEISD::INT_LVM, dl, MVT::v256i1,
+                       {Mask, DAG.getConstant(W, dl, MVT::i64),
+                        DAG.getConstant(Val, dl, MVT::i64)});
+  }
+  return Mask;
+}
+
+SDValue
+VETargetLowering::lowerShuffleSource(const VEShufflePlan::SourcePlan &Plan,
+                                     MVT VT, SDValue V, SDValue PassThru,
+                                     const SDLoc &dl, SelectionDAG &DAG) const {
+  auto Rotate = [&](SDValue Vec, unsigned Amount) {
+    return DAG.getNode(VEISD::VEC_VMV, dl, VT,
+                       {DAG.getConstant(Amount, dl, MVT::i32), Vec});
+  };
 
-  SDValue firstrotated = firstrot % 256 != 0 ? DAG.getNode(VEISD::VEC_VMV, dl, firstVec.getSimpleValueType(), {DAG.getConstant(firstrot % 256, dl, EVT::getIntegerVT(*DAG.getContext(), 32)), firstVec}) : firstVec;
-  SDValue secondrotated = secondrot % 256 != 0 ? DAG.getNode(VEISD::VEC_VMV, dl, secondVec.getSimpleValueType(), {DAG.getConstant(secondrot % 256, dl, EVT::getIntegerVT(*DAG.getContext(), 32)), secondVec}) : secondVec;
+  switch (Plan.Kind) {
+  case VEShufflePlan::Unused:
+    return SDValue();
+  case VEShufflePlan::Identity:
+    return V;
+  case VEShufflePlan::Rotate:
+    return Rotate(V, Plan.Amount);
+  case VEShufflePlan::Compress:
+  case VEShufflePlan::CompressRotate: {
+    SDValue R = DAG.getNode(VEISD::VEC_COMPRESS, dl, VT,
+                            {V, getConstantMask(Plan.Select, dl, DAG),
+                             DAG.getUNDEF(VT)});
+    return Plan.Kind == VEShufflePlan::Compress ? R : Rotate(R, Plan.Amount);
+  }
+  case VEShufflePlan::RotateExpand:
+    if (Plan.Amount)
+      V = Rotate(V, Plan.Amount);
+    return DAG.getNode(VEISD::VEC_EXPAND, dl, VT,
+                       {V, getConstantMask(Plan.Select, dl, DAG),
+                        PassThru ? PassThru : DAG.getUNDEF(VT)});
+  }
+  llvm_unreachable("Unknown shuffle source plan");
+}
 
-  EVT i64 = EVT::getIntegerVT(*DAG.getContext(), 64);
-  EVT v256i1 = EVT::getVectorVT(*DAG.getContext(), EVT::getIntegerVT(*DAG.getContext(), 1), 256);
+SDValue VETargetLowering::lowerShuffleByGather(MVT VT, SDValue V1, SDValue V2,
+                                               ArrayRef<int> Mask,
+                                               const SDLoc &dl,
+                                               SelectionDAG &DAG) const {
+  MachineFunction &MF = DAG.getMachineFunction();
+  EVT PtrVT = getPointerTy(DAG.getDataLayout());
+  unsigned NumElts = Mask.size();
+  // Vector stores of 32 bit elements are dense.
+  unsigned EltBytes = VT.getScalarSizeInBits() / 8;
+  MVT IdxVT = MVT::getVectorVT(MVT::i64, NumElts);
+
+  bool UseV1 = llvm::any_of(Mask, [&](int M) {
+    return M >= 0 && (unsigned)M < NumElts;
+  });
+  bool UseV2 = llvm::any_of(Mask, [&](int M) {
+    return (unsigned)M >= NumElts && M >= 0;
+  });
+
+  // Store both sources next to each other, so that the mask indexes the
+  // stack slot directly.
+  int FI = MF.getFrameInfo().CreateStackObject(2 * NumElts * EltBytes, 8,
+                                               false);
+  SDValue Base = DAG.getFrameIndex(FI, PtrVT);
+  MachinePointerInfo PtrInfo = MachinePointerInfo::getFixedStack(MF, FI);
+  SmallVector<SDValue, 2> Stores;
+  if (UseV1)
+    Stores.push_back(DAG.getStore(DAG.getEntryNode(), dl, V1, Base, PtrInfo));
+  if (UseV2) {
+    SDValue Addr = DAG.getNode(ISD::ADD, dl, PtrVT, Base,
+                               DAG.getConstant(NumElts * EltBytes, dl, PtrVT));
+    Stores.push_back(DAG.getStore(DAG.getEntryNode(), dl, V2, Addr,
+                                  PtrInfo.getWithOffset(NumElts * EltBytes)));
+  }
+  SDValue Chain = DAG.getNode(ISD::TokenFactor, dl, MVT::Other, Stores);
+
+  // The byte offset of each element is loaded from the constant pool.
+  SmallVector<Constant *, 256> Offsets;
+  Type *Int64Ty = Type::getInt64Ty(*DAG.getContext());
+  for (int M : Mask)
+    Offsets.push_back(ConstantInt::get(Int64Ty, M < 0 ? 0 : M * EltBytes));
+  SDValue CP = DAG.getConstantPool(ConstantVector::get(Offsets), PtrVT, 8);
+  SDValue Offs = DAG.getLoad(IdxVT, dl, DAG.getEntryNode(), CP,
+                             MachinePointerInfo::getConstantPool(MF));
+
+  SDValue Addrs = DAG.getNode(ISD::ADD, dl, IdxVT,
+                              DAG.getNode(VEISD::VEC_BROADCAST, dl, IdxVT,
+                                          Base),
+                              Offs);
+  return DAG.getNode(VEISD::VEC_GATHER, dl, DAG.getVTList(VT, MVT::Other),
+                     {Chain, Addrs});
+}
 
-  //TODO: use LVM and SVM instructions!
-  int block = firstsecond / 64;
-  int secondblock = firstsecond % 64;
+SDValue VETargetLowering::LowerVECTOR_SHUFFLE(SDValue Op, SelectionDAG &DAG) const {
+  LLVM_DEBUG(dbgs() << "Lowering Shuffle\n");
+  SDLoc dl(Op);
+  ShuffleVectorSDNode *SVN = cast<ShuffleVectorSDNode>(Op.getNode());
+  MVT VT = Op.getSimpleValueType();
+  SDValue V1 = SVN->getOperand(0);
+  SDValue V2 = SVN->getOperand(1);
+  ArrayRef<int> Mask = SVN->getMask();
+
+  VEShufflePlan Plan = getShufflePlan(Mask);
+
+  // Packed vectors moving whole lanes are shuffled as v256i64.
+  SmallVector<int, 256> LaneMask;
+  MVT ShufVT = VT;
+  if (Plan.ByLanes) {
+    getLaneShuffleMask(Mask, LaneMask);
+    Mask = LaneMask;
+    ShufVT = MVT::v256i64;
+    V1 = DAG.getBitcast(ShufVT, V1);
+    V2 = DAG.getBitcast(ShufVT, V2);
+  }
+  unsigned NumElts = Mask.size();
 
-  SDValue Mask = DAG.getUNDEF(v256i1);
+  SDValue Result;
+  switch (Plan.Strategy) {
+  case VEShufflePlan::Expand:
+    LLVM_DEBUG(dbgs() << "Expand shuffle\n");
+    return SDValue();
 
-  for (int i = 0; i < block; i++) {
-    //set blocks to all 0s
-    SDValue mask = inv_order ? DAG.getConstant(0xffffffffffffffff, dl, i64) : DAG.getConstant(0, dl, i64);
-    SDValue index = DAG.getConstant(i, dl, i64);
-    Mask = DAG.getNode(VEISD::INT_LVM, dl, v256i1, {Mask, index, mask});
+  case VEShufflePlan::Splat: {
+    SDValue Src = Plan.Imm < NumElts ? V1 : V2;
+    SDValue Elem = DAG.getNode(ISD::EXTRACT_VECTOR_ELT, dl,
+                               ShufVT.getVectorElementType(), Src,
+                               DAG.getConstant(Plan.Imm % NumElts, dl,
+                                               MVT::i64));
+    Result = DAG.getNode(VEISD::VEC_BROADCAST, dl, ShufVT, Elem);
+    break;
   }
 
-  SDValue mask = DAG.getConstant(0xffffffffffffffff, dl, i64);
-  if (!inv_order)
-    mask = DAG.getNode(ISD::SRL, dl, i64, {mask, DAG.getConstant(secondblock, dl, i64)});
-  else
-    mask = DAG.getNode(ISD::SHL, dl, i64, {mask, DAG.getConstant(64 - secondblock, dl, i64)});
-  Mask = DAG.getNode(VEISD::INT_LVM, dl, v256i1, {Mask, DAG.getConstant(block, dl, i64), mask});
-
-  for (int i = block + 1; i < 4; i++) {
-    //set blocks to all 1s
-    SDValue mask = inv_order ? DAG.getConstant(0, dl, i64) : DAG.getConstant(0xffffffffffffffff, dl, i64);
-    SDValue index = DAG.getConstant(i, dl, i64);
-    Mask = DAG.getNode(VEISD::INT_LVM, dl, v256i1, {Mask, index, mask});
+  case VEShufflePlan::LaneShuffle:
+    return DAG.getNode(VEISD::VEC_VSHF, dl, VT, V1, V2,
+                       DAG.getConstant(Plan.Imm, dl, MVT::i64));
+
+  case VEShufflePlan::Permute: {
+    SDValue R1 = lowerShuffleSource(Plan.Sources[0], ShufVT, V1, SDValue(),
+                                    dl, DAG);
+    SDValue R2 = lowerShuffleSource(Plan.Sources[1], ShufVT, V2,
+                                    Plan.ExpandInto ? R1 : SDValue(), dl,
+                                    DAG);
+    if (!R1 || Plan.ExpandInto)
+      Result = R2;
+    else if (!R2)
+      Result = R1;
+    else
+      Result = DAG.getNode(VEISD::VEC_VMRG, dl, ShufVT, R1, R2,
+                           getConstantMask(Plan.Merge, dl, DAG));
+    break;
   }
 
-  SDValue resultSizeConst = DAG.getConstant(256, dl, i64);
-  SDValue returnValue = DAG.getNode(VEISD::INT_VMRG_M, dl, Op.getSimpleValueType(), {firstrotated, secondrotated, Mask, resultSizeConst});
-  return returnValue;
+  case VEShufflePlan::Gather:
+    Result = lowerShuffleByGather(ShufVT, V1, V2, Mask, dl, DAG);
+    break;
+  }
+  return DAG.getBitcast(VT, Result);
 }
 
 SDValue VETargetLowering::LowerEXTRACT_VECTOR_ELT(SDValue Op,
@@ -3421,6 +3928,19 @@ LowerOperation(SDValue Op, SelectionDAG &DAG) const {
   case ISD::MGATHER:            return LowerMGATHER_MSCATTER(Op, DAG);
 
   case ISD::MLOAD:              return LowerMLOAD(Op, DAG);
+  case ISD::MSTORE:             return LowerMSTORE(Op, DAG);
+
+  case ISD::VECREDUCE_ADD:
+  case ISD::VECREDUCE_AND:
+  case ISD::VECREDUCE_OR:
+  case ISD::VECREDUCE_XOR:
+  case ISD::VECREDUCE_SMAX:
+  case ISD::VECREDUCE_SMIN:
+  case ISD::VECREDUCE_UMAX:
+  case ISD::VECREDUCE_UMIN:
+  case ISD::VECREDUCE_FADD:
+  case ISD::VECREDUCE_FMAX:
+  case ISD::VECREDUCE_FMIN:     return LowerVECREDUCE(Op, DAG);
   }
 }
 
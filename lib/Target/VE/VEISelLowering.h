@@ -15,6 +15,7 @@
 #define LLVM_LIB_TARGET_VE_VEISELLOWERING_H
 
 #include "VE.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/CodeGen/TargetLowering.h"
 
 namespace llvm {
@@ -64,11 +65,38 @@ namespace llvm {
       VEC_BROADCAST,   // a scalar value is broadcast across all vector lanes (Operand 0: the broadcast register)
       VEC_SEQ,         // sequence vector match (Operand 0: the constant stride)
 
-      VEC_VMV,
+      VEC_VMV,         // rotate the elements of a vector (Operand 0: the amount)
+      VEC_VMRG,        // select elements of operand 1 where the mask is set
+                       // and of operand 0 elsewhere (Operand 2: the mask)
+      VEC_COMPRESS,    // VCP: pack the masked elements of operand 0 to the
+                       // front, keeping the rest of operand 2
+      VEC_EXPAND,      // VEX: spread the leading elements of operand 0 to
+                       // the masked positions, keeping the rest of operand 2
+      VEC_VSHF,        // VSHF of two packed vectors (Operand 2: the selector)
+
+      /// Reductions of the elements of operand 0 selected by the mask in
+      /// operand 1 (UNDEF for all elements).  The result is element 0.
+      VEC_RSUM,
+      VEC_RFSUM,
+      VEC_RSMAX,
+      VEC_RSMIN,
+      VEC_RFMAX,
+      VEC_RFMIN,
+      VEC_RAND,
+      VEC_ROR,
+      VEC_RXOR,
 
       /// Scatter and gather instructions.
       VEC_GATHER,
       VEC_SCATTER,
+      VEC_MGATHER,     // gather under the mask in operand 2
+      VEC_MSCATTER,    // scatter under the mask in operand 3
+
+      /// Load and store of the leading elements of a vector.  The last
+      /// operand is the number of elements.  Stores take a mask before it,
+      /// UNDEF for all elements.
+      VEC_VLD,
+      VEC_VST,
 
       VEC_LVL,
 
@@ -452,8 +480,59 @@ namespace llvm {
     };
   }
 
+  /// Describes how a VECTOR_SHUFFLE of a legal vector type is lowered.  The
+  /// plan is also used by the cost model to price shuffles.
+  struct VEShufflePlan {
+    enum StrategyKind {
+      Expand,      // Not handled, left to the generic expansion.
+      Splat,       // LVS of the element followed by VBRD.
+      Permute,     // Move the elements of each source into place, then VMRG.
+      LaneShuffle, // A single VSHF of two packed vectors.
+      Gather,      // Store both sources and VGT the elements back in order.
+    };
+
+    /// How the elements taken from one source are moved into place.
+    enum SourceKind {
+      Unused,         // No element is taken from this source.
+      Identity,       // All elements already are in place.
+      Rotate,         // VMV by Amount.
+      Compress,       // VCP of the elements in Select.
+      CompressRotate, // VCP of the elements in Select, then VMV by Amount.
+      RotateExpand,   // VMV by Amount (if non-zero), then VEX into Select.
+    };
+
+    struct SourcePlan {
+      SourceKind Kind = Unused;
+      unsigned Amount = 0;
+      BitVector Select;
+    };
+
+    StrategyKind Strategy = Expand;
+    /// Number of elements the instructions operate on.
+    unsigned NumElts = 0;
+    /// Packed vectors whose shuffle moves whole 64 bit lanes are shuffled as
+    /// v256i64.
+    bool ByLanes = false;
+    /// Splat: the element to broadcast.  LaneShuffle: the VSHF selector.
+    unsigned Imm = 0;
+    /// Permute: the plans of the first and second source.
+    SourcePlan Sources[2];
+    /// Permute: the positions taken from the second source if both sources
+    /// are merged by a VMRG, or empty.
+    BitVector Merge;
+    /// Permute: the second source is expanded into the result of the first
+    /// one, so no VMRG is needed.
+    bool ExpandInto = false;
+
+    /// Number of vector instructions of the plan.
+    unsigned NumVectorOps = 0;
+    /// Number of 64 bit words loaded into mask registers with LVM.
+    unsigned NumMaskWords = 0;
+  };
+
   class VETargetLowering : public TargetLowering {
     const VESubtarget *Subtarget;
+
   public:
     VETargetLowering(const TargetMachine &TM, const VESubtarget &STI);
     SDValue LowerOperation(SDValue Op, SelectionDAG &DAG) const override;
@@ -547,10 +626,23 @@ namespace llvm {
     SDValue LowerBitcast(SDValue Op, SelectionDAG &DAG) const;
 
     SDValue LowerVECTOR_SHUFFLE(SDValue Op, SelectionDAG &DAG) const;
+    SDValue lowerShuffleSource(const VEShufflePlan::SourcePlan &Plan,
+                               MVT VT, SDValue V, SDValue PassThru,
+                               const SDLoc &dl, SelectionDAG &DAG) const;
+    SDValue lowerShuffleByGather(MVT VT, SDValue V1, SDValue V2,
+                                 ArrayRef<int> Mask, const SDLoc &dl,
+                                 SelectionDAG &DAG) const;
+
+    /// Returns how a VECTOR_SHUFFLE with Mask is lowered.  Masks with more
+    /// than 256 elements shuffle packed vectors.
+    VEShufflePlan getShufflePlan(ArrayRef<int> Mask) const;
 
     SDValue LowerMGATHER_MSCATTER(SDValue Op, SelectionDAG &DAG) const;
 
+    SDValue LowerVECREDUCE(SDValue Op, SelectionDAG &DAG) const;
+
     SDValue LowerMLOAD(SDValue Op, SelectionDAG &DAG) const;
+    SDValue LowerMSTORE(SDValue Op, SelectionDAG &DAG) const;
 
     SDValue LowerEH_SJLJ_SETJMP(SDValue Op, SelectionDAG &DAG) const;
     SDValue LowerEH_SJLJ_LONGJMP(SDValue Op, SelectionDAG &DAG) const;
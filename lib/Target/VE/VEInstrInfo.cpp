@@ -462,6 +462,71 @@ void VEInstrInfo::copyPhysReg(MachineBasicBlock &MBB,
   }
 }
 
+// Returns true and sets Imm if Reg is defined once by an instruction loading
+// an immediate.
+static bool getConstantValue(const MachineRegisterInfo &MRI, unsigned Reg,
+                             int64_t &Imm) {
+  if (!TargetRegisterInfo::isVirtualRegister(Reg))
+    return false;
+  const MachineInstr *MI = MRI.getUniqueVRegDef(Reg);
+  if (!MI)
+    return false;
+  switch (MI->getOpcode()) {
+  case VE::LEAzzi:
+  case VE::LEA32zzi:
+    if (!MI->getOperand(1).isImm())
+      return false;
+    Imm = MI->getOperand(1).getImm();
+    return true;
+  case VE::ORim1:
+  case VE::OR32im1:
+    if (!MI->getOperand(1).isImm() || !MI->getOperand(2).isImm() ||
+        MI->getOperand(2).getImm() != 0)
+      return false;
+    Imm = MI->getOperand(1).getImm();
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Returns the number of leading elements of the vector register Reg that
+// may hold defined values.  This is the largest vector length used by the
+// instructions defining Reg, or 256 if it is not known.
+static unsigned getActiveVectorLength(const MachineRegisterInfo &MRI,
+                                      unsigned Reg, unsigned Depth = 0) {
+  const unsigned MaxVL = 256;
+  if (!TargetRegisterInfo::isVirtualRegister(Reg) || Depth > 4)
+    return MaxVL;
+
+  unsigned VL = 0;
+  for (const MachineOperand &MO : MRI.def_operands(Reg)) {
+    const MachineInstr &MI = *MO.getParent();
+    unsigned DefVL = MaxVL;
+    if (MI.isImplicitDef()) {
+      DefVL = 0;
+    } else if (MI.isCopy()) {
+      if (!MO.getSubReg() && !MI.getOperand(1).getSubReg())
+        DefVL = getActiveVectorLength(MRI, MI.getOperand(1).getReg(),
+                                      Depth + 1);
+    } else if ((MI.getDesc().TSFlags & VEII::VLInUse) &&
+               !MI.isRegTiedToUseOperand(MI.getOperandNo(&MO))) {
+      // Elements beyond VL are left untouched, so this is only valid if the
+      // result does not pass through an input register.
+      const MachineOperand &VLOp =
+          MI.getOperand(MI.getNumExplicitOperands() - 1);
+      int64_t Imm;
+      if (VLOp.isReg() && getConstantValue(MRI, VLOp.getReg(), Imm) &&
+          Imm > 0 && Imm <= MaxVL)
+        DefVL = Imm;
+    }
+    VL = std::max(VL, DefVL);
+    if (VL == MaxVL)
+      break;
+  }
+  return VL ? VL : MaxVL;
+}
+
 void VEInstrInfo::
 storeRegToStackSlot(MachineBasicBlock &MBB, MachineBasicBlock::iterator I,
                     unsigned SrcReg, bool isKill, int FI,
@@ -501,9 +566,14 @@ storeRegToStackSlot(MachineBasicBlock &MBB, MachineBasicBlock::iterator I,
   else if (VE::F128RegClass.hasSubClassEq(RC))
     BuildMI(MBB, I, DL, get(VE::STQri)).addFrameIndex(FI).addImm(0)
       .addReg(SrcReg, getKillRegState(isKill)).addMemOperand(MMO);
-  else if (RC == &VE::V64RegClass)
+  else if (RC == &VE::V64RegClass) {
+    // Only store the elements that are in use.  The reloads and the size of
+    // the stack slot are adjusted to the longest spill into each slot in
+    // VEFrameLowering::processFunctionBeforeFrameFinalized.
+    unsigned VL = getActiveVectorLength(MF->getRegInfo(), SrcReg);
     BuildMI(MBB, I, DL, get(VE::STVRri)).addFrameIndex(FI).addImm(0)
-      .addReg(SrcReg, getKillRegState(isKill)).addImm(256).addMemOperand(MMO);
+      .addReg(SrcReg, getKillRegState(isKill)).addImm(VL).addMemOperand(MMO);
+  }
   else if (RC == &VE::VMRegClass)
     BuildMI(MBB, I, DL, get(VE::STVMri)).addFrameIndex(FI).addImm(0)
       .addReg(SrcReg, getKillRegState(isKill)).addMemOperand(MMO);
@@ -556,6 +626,7 @@ loadRegFromStackSlot(MachineBasicBlock &MBB, MachineBasicBlock::iterator I,
     BuildMI(MBB, I, DL, get(VE::LDQri), DestReg).addFrameIndex(FI).addImm(0)
       .addMemOperand(MMO);
   else if (RC == &VE::V64RegClass)
+    // Reloads use the full length until the spills into FI are known.
     BuildMI(MBB, I, DL, get(VE::LDVRri), DestReg).addFrameIndex(FI).addImm(0)
       .addImm(256).addMemOperand(MMO);
   else if (RC == &VE::VMRegClass)
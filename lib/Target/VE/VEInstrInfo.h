@@ -31,7 +31,9 @@ namespace VEII {
     Pseudo = (1<<0),
     Load = (1<<1),
     Store = (1<<2),
-    DelaySlot = (1<<3)
+    DelaySlot = (1<<3),
+    // The last explicit operand is a register holding the vector length.
+    VLInUse = (1<<4)
   };
 }
 
@@ -0,0 +1,64 @@
+//===-- VEMachineScheduler.cpp - MI Scheduler for VE ----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "VEMachineScheduler.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "machine-scheduler"
+
+static cl::opt<bool> DisableVEEarlyVLD(
+  "disable-ve-early-vld",
+  cl::init(false),
+  cl::desc("Disable issuing VE vector loads early in the MI scheduler."),
+  cl::Hidden);
+
+bool VEPreRASchedStrategy::isLongLatencyLoad(const SUnit *SU) const {
+  if (!SU->isInstr() || !SU->getInstr()->mayLoad())
+    return false;
+  return SU->Latency > SchedModel->getMCSchedModel()->LoadLatency;
+}
+
+void VEPreRASchedStrategy::tryCandidate(SchedCandidate &Cand,
+                                        SchedCandidate &TryCand,
+                                        SchedBoundary *Zone) const {
+  if (DisableVEEarlyVLD || !Cand.isValid() || !Zone) {
+    GenericScheduler::tryCandidate(Cand, TryCand, Zone);
+    return;
+  }
+
+  // Physical register copies and excess pressure come first, as in the
+  // generic strategy.
+  if (tryGreater(biasPhysReg(TryCand.SU, TryCand.AtTop),
+                 biasPhysReg(Cand.SU, Cand.AtTop), TryCand, Cand, PhysReg))
+    return;
+  if (DAG->isTrackingPressure() && tryPressure(TryCand.RPDelta.Excess,
+                                               Cand.RPDelta.Excess,
+                                               TryCand, Cand, RegExcess, TRI,
+                                               DAG->MF))
+    return;
+
+  // Then move long latency loads towards the top of the region.  Top-down,
+  // that means picking them first; bottom-up, picking them last.
+  bool TryLoad = isLongLatencyLoad(TryCand.SU);
+  bool CandLoad = isLongLatencyLoad(Cand.SU);
+  if (Zone->isTop()) {
+    if (tryGreater(TryLoad, CandLoad, TryCand, Cand, Stall))
+      return;
+  } else {
+    if (tryLess(TryLoad, CandLoad, TryCand, Cand, Stall))
+      return;
+  }
+
+  GenericScheduler::tryCandidate(Cand, TryCand, Zone);
+}
+
+ScheduleDAGInstrs *llvm::createVEMachineScheduler(MachineSchedContext *C) {
+  return new ScheduleDAGMILive(C, llvm::make_unique<VEPreRASchedStrategy>(C));
+}
@@ -0,0 +1,45 @@
+//===-- VEMachineScheduler.h - Custom VE MI scheduler -----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Custom VE MI scheduler.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_VE_VEMACHINESCHEDULER_H
+#define LLVM_LIB_TARGET_VE_VEMACHINESCHEDULER_H
+
+#include "llvm/CodeGen/MachineScheduler.h"
+
+namespace llvm {
+
+/// A MachineSchedStrategy implementation for VE pre RA scheduling.
+///
+/// Vector loads take far longer than any vector computation.  Unless that
+/// exceeds the register pressure limit, this strategy issues them as early
+/// as their operands allow, so that they overlap with the computation of
+/// earlier iterations instead of running in sequence with it.
+class VEPreRASchedStrategy : public GenericScheduler {
+public:
+  VEPreRASchedStrategy(const MachineSchedContext *C) :
+    GenericScheduler(C) {}
+
+protected:
+  void tryCandidate(SchedCandidate &Cand, SchedCandidate &TryCand,
+                    SchedBoundary *Zone) const override;
+
+private:
+  /// Return true if SU is a load whose latency is longer than the one of
+  /// scalar loads.
+  bool isLongLatencyLoad(const SUnit *SU) const;
+};
+
+ScheduleDAGInstrs *createVEMachineScheduler(MachineSchedContext *C);
+
+} // end namespace llvm
+
+#endif // LLVM_LIB_TARGET_VE_VEMACHINESCHEDULER_H
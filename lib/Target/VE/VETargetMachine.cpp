@@ -11,6 +11,7 @@
 
 #include "VETargetMachine.h"
 #include "VE.h"
+#include "VEMachineScheduler.h"
 // #include "VETargetObjectFile.h"
 #include "VETargetTransformInfo.h"
 #include "llvm/CodeGen/Passes.h"
@@ -108,6 +109,11 @@ public:
     return getTM<VETargetMachine>();
   }
 
+  ScheduleDAGInstrs *
+  createMachineScheduler(MachineSchedContext *C) const override {
+    return createVEMachineScheduler(C);
+  }
+
   void addIRPasses() override;
   bool addInstSelector() override;
   void addPreRegAlloc() override;
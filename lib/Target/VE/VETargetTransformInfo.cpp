@@ -0,0 +1,450 @@
+//===-- VETargetTransformInfo.cpp - VE specific TTI -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a TargetTransformInfo analysis pass specific to the
+// VE target machine.  The vector costs model the SX-Aurora vector engine:
+// every vector instruction streams VL elements through a pipe, so its cost
+// grows with the vector length, while moving single elements between the
+// scalar and the vector unit and indirect memory accesses are expensive.
+//
+//===----------------------------------------------------------------------===//
+
+#include "VETargetTransformInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/CodeGen/BasicTTIImpl.h"
+#include "llvm/CodeGen/TargetLowering.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "vetti"
+
+//===----------------------------------------------------------------------===//
+//
+// VE cost model.
+//
+//===----------------------------------------------------------------------===//
+
+// Issue costs of the vector engine.  A cost of one corresponds to one
+// scalar instruction.  How long each vector pipe is busy and how long
+// results take to arrive is read from VESchedModel.
+namespace {
+/// Maximum number of 64 bit elements held by one V64 register.
+const unsigned MaxVL = 256;
+/// Issue cost of any vector instruction before the first element leaves the
+/// pipe.  This is what makes very short vectors unprofitable.
+const unsigned VectorStartupCost = 1;
+/// Additional startup cost of VLD/VST.
+const unsigned VectorMemStartupCost = 2;
+/// Cost of computing a vector length from a mask of the leading elements
+/// and loading it into VL.
+const unsigned VectorLengthSetupCost = 3;
+} // end anonymous namespace
+
+const MCSchedClassDesc *VETTIImpl::getSchedClass(unsigned Opcode) const {
+  // Without -mcpu the subtarget has no scheduling model, but the "ve"
+  // processor is the only one there is.
+  const MCSchedModel &SM = ST->getSchedModel().hasInstrSchedModel()
+                               ? ST->getSchedModel()
+                               : ST->getSchedModelForCPU("ve");
+  if (!SM.hasInstrSchedModel())
+    return nullptr;
+  unsigned Idx = ST->getInstrInfo()->get(Opcode).getSchedClass();
+  const MCSchedClassDesc *SC = SM.getSchedClassDesc(Idx);
+  return SC->isValid() && !SC->isVariant() ? SC : nullptr;
+}
+
+unsigned VETTIImpl::getPipeCycles(unsigned Opcode) const {
+  const MCSchedClassDesc *SC = getSchedClass(Opcode);
+  if (!SC)
+    return 1;
+  unsigned Cycles = 1;
+  for (const MCWriteProcResEntry *WPR = ST->getWriteProcResBegin(SC),
+                                 *E = ST->getWriteProcResEnd(SC);
+       WPR != E; ++WPR)
+    Cycles = std::max<unsigned>(Cycles, WPR->Cycles);
+  return Cycles;
+}
+
+unsigned VETTIImpl::getLatency(unsigned Opcode) const {
+  const MCSchedClassDesc *SC = getSchedClass(Opcode);
+  if (!SC)
+    return 1;
+  return std::max(MCSchedModel::computeInstrLatency(*ST, *SC), 1);
+}
+
+unsigned VETTIImpl::getElementTransferCost() const {
+  // LVS and LSV go through the vector pipes.  The scalar unit waits for
+  // the whole transfer before it can use or overwrite the element.
+  return getLatency(VE::LVSr);
+}
+
+unsigned VETTIImpl::getVectorChimes(Type *Ty, unsigned Opcode) {
+  std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, Ty);
+  unsigned NumElts =
+      LT.second.isVector() ? LT.second.getVectorNumElements() : 1;
+  // Packed operations on v512i32 and v512f32 handle two elements per lane.
+  if (NumElts > MaxVL)
+    NumElts = divideCeil(NumElts, 2);
+  // The sched model describes instructions at the maximum vector length.
+  return LT.first * divideCeil(NumElts * getPipeCycles(Opcode), MaxVL);
+}
+
+int VETTIImpl::getArithmeticInstrCost(
+    unsigned Opcode, Type *Ty, TTI::OperandValueKind Op1Info,
+    TTI::OperandValueKind Op2Info, TTI::OperandValueProperties Opd1PropInfo,
+    TTI::OperandValueProperties Opd2PropInfo,
+    ArrayRef<const Value *> Args) {
+  if (!Ty->isVectorTy())
+    return BaseT::getArithmeticInstrCost(Opcode, Ty, Op1Info, Op2Info,
+                                         Opd1PropInfo, Opd2PropInfo, Args);
+
+  int ISD = TLI->InstructionOpcodeToISD(Opcode);
+  assert(ISD && "Invalid opcode");
+  std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, Ty);
+
+  // Anything the vector unit cannot do natively is scalarized.  The base
+  // implementation prices that with our element transfer costs.
+  if (!LT.second.isVector() ||
+      LT.second.getVectorElementType() == MVT::i1 ||
+      !TLI->isOperationLegalOrCustom(ISD, LT.second))
+    return BaseT::getArithmeticInstrCost(Opcode, Ty, Op1Info, Op2Info,
+                                         Opd1PropInfo, Opd2PropInfo, Args);
+
+  unsigned VEOpcode = VE::VADDlv;
+  switch (ISD) {
+  case ISD::SDIV:
+  case ISD::UDIV:
+  case ISD::FDIV:
+    VEOpcode = VE::VFDVdv;
+    break;
+  case ISD::MUL:
+    VEOpcode = VE::VMPYlv;
+    break;
+  case ISD::FADD:
+  case ISD::FSUB:
+  case ISD::FMUL:
+    VEOpcode = VE::VFADdv;
+    break;
+  default:
+    break;
+  }
+  return LT.first * VectorStartupCost + getVectorChimes(Ty, VEOpcode);
+}
+
+int VETTIImpl::getShuffleCost(TTI::ShuffleKind Kind, Type *Tp, int Index,
+                              Type *SubTp) {
+  std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, Tp);
+  if (LT.first != 1 || !LT.second.isVector() ||
+      Tp->getVectorElementType()->isIntegerTy(1))
+    return BaseT::getShuffleCost(Kind, Tp, Index, SubTp);
+
+  // Price a typical mask of this kind with the instructions the shuffle
+  // lowering emits for it.
+  int NumElts = LT.second.getVectorNumElements();
+  SmallVector<int, 256> Mask(NumElts, -1);
+  switch (Kind) {
+  case TTI::SK_Broadcast:
+    std::fill(Mask.begin(), Mask.end(), 0);
+    break;
+  case TTI::SK_Select:
+    for (int i = 0; i < NumElts; ++i)
+      Mask[i] = i % 2 ? NumElts + i : i;
+    break;
+  case TTI::SK_Transpose:
+    for (int i = 0; i < NumElts; ++i)
+      Mask[i] = i % 2 ? NumElts + i - 1 : i;
+    break;
+  case TTI::SK_ExtractSubvector: {
+    int SubElts = SubTp ? SubTp->getVectorNumElements() : NumElts - Index;
+    for (int i = 0; i < SubElts && Index + i < NumElts; ++i)
+      Mask[i] = Index + i;
+    break;
+  }
+  case TTI::SK_InsertSubvector: {
+    int SubElts = SubTp ? SubTp->getVectorNumElements() : 0;
+    for (int i = 0; i < NumElts; ++i)
+      Mask[i] = i >= Index && i < Index + SubElts ? NumElts + i - Index : i;
+    break;
+  }
+  case TTI::SK_Reverse:
+  case TTI::SK_PermuteSingleSrc:
+    // Assume the worst for an unknown permutation.
+    for (int i = 0; i < NumElts; ++i)
+      Mask[i] = NumElts - 1 - i;
+    break;
+  case TTI::SK_PermuteTwoSrc:
+    for (int i = 0; i < NumElts; ++i)
+      Mask[i] = (i % 2 ? NumElts : 0) + NumElts - 1 - i;
+    break;
+  }
+
+  VEShufflePlan Plan = TLI->getShufflePlan(Mask);
+  int Cost = Plan.NumVectorOps * (VectorStartupCost + getVectorChimes(Tp)) +
+             Plan.NumMaskWords * (getElementTransferCost() + 1);
+  switch (Plan.Strategy) {
+  case VEShufflePlan::Expand:
+    return BaseT::getShuffleCost(Kind, Tp, Index, SubTp);
+  case VEShufflePlan::Splat:
+    return Cost + getElementTransferCost();
+  case VEShufflePlan::Gather:
+    // The lowering never falls back to the generic expansion once it
+    // picked a gather, so neither does the price.
+    return Cost + VectorMemStartupCost +
+           divideCeil(Plan.NumElts * getPipeCycles(VE::VGTv), MaxVL);
+  default:
+    return Cost;
+  }
+}
+
+int VETTIImpl::getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index) {
+  if (!Val->isVectorTy())
+    return BaseT::getVectorInstrCost(Opcode, Val, Index);
+
+  std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, Val);
+  // Mask bits and packed elements need additional shifts and masking around
+  // the transfer.
+  if (Val->getVectorElementType()->isIntegerTy(1) ||
+      (LT.second.isVector() && LT.second.getVectorNumElements() > MaxVL))
+    return getElementTransferCost() + 2;
+  return getElementTransferCost();
+}
+
+int VETTIImpl::getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
+                               unsigned AddressSpace, const Instruction *I) {
+  if (!Src->isVectorTy())
+    return BaseT::getMemoryOpCost(Opcode, Src, Alignment, AddressSpace, I);
+
+  std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, Src);
+  if (!LT.second.isVector())
+    return BaseT::getMemoryOpCost(Opcode, Src, Alignment, AddressSpace, I);
+
+  // Masks are transferred through scalar registers one 64 bit word at a time.
+  if (Src->getVectorElementType()->isIntegerTy(1)) {
+    unsigned NumWords = divideCeil(Src->getVectorNumElements(), 64);
+    return NumWords * (getElementTransferCost() + 1);
+  }
+
+  // A contiguous VLD/VST.
+  return LT.first * VectorMemStartupCost +
+         getVectorChimes(Src, Opcode == Instruction::Load ? VE::VLDrr
+                                                          : VE::VSTrr);
+}
+
+int VETTIImpl::getMaskedMemoryOpCost(unsigned Opcode, Type *Src,
+                                     unsigned Alignment,
+                                     unsigned AddressSpace) {
+  // A mask of the leading elements, such as the header mask of a loop with
+  // a folded tail, only shortens the vector length: the access is a single
+  // VLD/VST after the lane count is computed and loaded with LVL.  Other
+  // masks are handled by a VGT or by the mask operand of VST.  Price the
+  // common case.
+  if (isLegalMaskedAccess(Src))
+    return getMemoryOpCost(Opcode, Src, Alignment, AddressSpace) +
+           VectorLengthSetupCost;
+
+  // Everything else is scalarized: every element needs its mask bit, the
+  // scalar access and the transfer of the value.
+  unsigned NumElts = Src->getVectorNumElements();
+  int ScalarCost = BaseT::getMemoryOpCost(Opcode, Src->getScalarType(),
+                                          Alignment, AddressSpace);
+  return NumElts * (ScalarCost + 2 * getElementTransferCost());
+}
+
+int VETTIImpl::getGatherScatterOpCost(unsigned Opcode, Type *DataTy,
+                                      Value *Ptr, bool VariableMask,
+                                      unsigned Alignment) {
+  unsigned NumElts = DataTy->getVectorNumElements();
+  std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, DataTy);
+
+  // Gathers and scatters with a non-constant mask are scalarized: each
+  // element needs its address, its mask bit and the value transferred.
+  if (VariableMask || !LT.second.isVector()) {
+    int ScalarCost = BaseT::getMemoryOpCost(Opcode, DataTy->getScalarType(),
+                                            Alignment, 0);
+    return NumElts * (ScalarCost + 3 * getElementTransferCost());
+  }
+
+  // The address vector is rebuilt from broadcast base and scale with a
+  // VMUL and a VADD before the VGT/VSC.
+  unsigned AddressCost = 2 * VectorStartupCost +
+                         getVectorChimes(DataTy, VE::VMPYlv) +
+                         getVectorChimes(DataTy, VE::VADDlv);
+  return AddressCost + LT.first * VectorMemStartupCost +
+         getVectorChimes(DataTy, Opcode == Instruction::Load ? VE::VGTv
+                                                             : VE::VSCv);
+}
+
+int VETTIImpl::getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
+                                     ArrayRef<Type *> Tys, FastMathFlags FMF,
+                                     unsigned ScalarizationCostPassed) {
+  if (RetTy->isVectorTy()) {
+    std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, RetTy);
+    switch (ID) {
+    case Intrinsic::fma:
+    case Intrinsic::fmuladd:
+      // A single VFMAD.
+      if (LT.second.isVector() &&
+          TLI->isOperationLegal(ISD::FMA, LT.second))
+        return LT.first * VectorStartupCost +
+               getVectorChimes(RetTy, VE::VFMADdv);
+      break;
+    default:
+      break;
+    }
+  }
+
+  switch (ID) {
+  case Intrinsic::experimental_vector_reduce_fadd:
+    // vfsum reassociates the sum.  A strict order reduction is expanded
+    // into a chain of scalar additions, each waiting for the previous one.
+    if (!FMF.isFast() && Tys[0]->isVectorTy()) {
+      unsigned NumElts = Tys[0]->getVectorNumElements();
+      return NumElts *
+             (getVectorInstrCost(Instruction::ExtractElement, Tys[0], 0) +
+              getLatency(VE::FADrr));
+    }
+    break;
+  case Intrinsic::experimental_vector_reduce_smax:
+  case Intrinsic::experimental_vector_reduce_smin:
+  case Intrinsic::experimental_vector_reduce_umax:
+  case Intrinsic::experimental_vector_reduce_umin:
+  case Intrinsic::experimental_vector_reduce_fmax:
+  case Intrinsic::experimental_vector_reduce_fmin:
+    // BasicTTIImpl passes the signedness of these the other way around.
+    return getMinMaxReductionCost(
+        Tys[0], CmpInst::makeCmpResultType(Tys[0]), /*IsPairwise=*/false,
+        /*IsUnsigned=*/ID == Intrinsic::experimental_vector_reduce_umax ||
+            ID == Intrinsic::experimental_vector_reduce_umin);
+  default:
+    break;
+  }
+  return BaseT::getIntrinsicInstrCost(ID, RetTy, Tys, FMF,
+                                      ScalarizationCostPassed);
+}
+
+int VETTIImpl::getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
+                                     ArrayRef<Value *> Args, FastMathFlags FMF,
+                                     unsigned VF) {
+  switch (ID) {
+  case Intrinsic::experimental_vector_reduce_fadd:
+  case Intrinsic::experimental_vector_reduce_fmul:
+    // The reduced vector follows the start value.
+    return getIntrinsicInstrCost(ID, RetTy, {Args[1]->getType()}, FMF);
+  case Intrinsic::experimental_vector_reduce_smax:
+  case Intrinsic::experimental_vector_reduce_smin:
+  case Intrinsic::experimental_vector_reduce_umax:
+  case Intrinsic::experimental_vector_reduce_umin:
+  case Intrinsic::experimental_vector_reduce_fmax:
+  case Intrinsic::experimental_vector_reduce_fmin:
+    return getIntrinsicInstrCost(ID, RetTy, {Args[0]->getType()}, FMF);
+  default:
+    break;
+  }
+  return BaseT::getIntrinsicInstrCost(ID, RetTy, Args, FMF, VF);
+}
+
+bool VETTIImpl::hasNativeReduction(Type *Ty) const {
+  EVT VT = TLI->getValueType(DL, Ty);
+  if (!VT.isSimple() || !VT.isVector() || !TLI->isTypeLegal(VT))
+    return false;
+  // Packed vectors and masks have no reduction instructions.
+  return VT.getVectorNumElements() <= MaxVL &&
+         VT.getScalarSizeInBits() >= 32;
+}
+
+int VETTIImpl::getArithmeticReductionCost(unsigned Opcode, Type *Ty,
+                                          bool IsPairwise) {
+  // Sums and bitwise folds are a single reduction instruction followed by
+  // a transfer of element 0 to a scalar register.
+  int ISD = TLI->InstructionOpcodeToISD(Opcode);
+  if (hasNativeReduction(Ty) &&
+      (ISD == ISD::ADD || ISD == ISD::FADD || ISD == ISD::AND ||
+       ISD == ISD::OR || ISD == ISD::XOR))
+    return VectorStartupCost + getVectorChimes(Ty, VE::VSUMXv) +
+           getElementTransferCost();
+
+  // Everything else is expanded into a shuffle tree.  Price it as
+  // extracting every element and reducing in scalar registers.
+  unsigned NumElts = Ty->getVectorNumElements();
+  Type *ScalarTy = Ty->getVectorElementType();
+  int ScalarOpCost = getArithmeticInstrCost(Opcode, ScalarTy);
+  return NumElts * getVectorInstrCost(Instruction::ExtractElement, Ty, 0) +
+         (NumElts - 1) * ScalarOpCost;
+}
+
+int VETTIImpl::getMinMaxReductionCost(Type *Ty, Type *CondTy,
+                                      bool IsPairwise, bool IsUnsigned) {
+  if (hasNativeReduction(Ty)) {
+    int Cost = VectorStartupCost + getVectorChimes(Ty, VE::VMAXSalsxv) +
+               getElementTransferCost();
+    // Unsigned reductions flip the sign bits before and after the signed
+    // reduction.
+    if (IsUnsigned)
+      Cost += 3 * (VectorStartupCost + getVectorChimes(Ty)) +
+              getElementTransferCost();
+    return Cost;
+  }
+
+  // See getArithmeticReductionCost: each step is a scalar compare and select.
+  unsigned NumElts = Ty->getVectorNumElements();
+  Type *ScalarTy = Ty->getVectorElementType();
+  Type *ScalarCondTy = CondTy->getVectorElementType();
+  unsigned CmpOpcode =
+      ScalarTy->isFloatingPointTy() ? Instruction::FCmp : Instruction::ICmp;
+  int ScalarOpCost =
+      getCmpSelInstrCost(CmpOpcode, ScalarTy, ScalarCondTy, nullptr) +
+      getCmpSelInstrCost(Instruction::Select, ScalarTy, ScalarCondTy, nullptr);
+  return NumElts * getVectorInstrCost(Instruction::ExtractElement, Ty, 0) +
+         (NumElts - 1) * ScalarOpCost;
+}
+
+bool VETTIImpl::useReductionIntrinsic(unsigned Opcode, Type *Ty,
+                                      TTI::ReductionFlags Flags) const {
+  switch (Opcode) {
+  case Instruction::Add:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::ICmp:
+  case Instruction::FAdd:
+    return hasNativeReduction(Ty);
+  case Instruction::FCmp:
+    return Flags.NoNaN && hasNativeReduction(Ty);
+  default:
+    // There are no product reductions.
+    return false;
+  }
+}
+
+bool VETTIImpl::shouldExpandReduction(const IntrinsicInst *II) const {
+  switch (II->getIntrinsicID()) {
+  case Intrinsic::experimental_vector_reduce_fadd:
+    // vfsum adds in an unspecified order, so it only implements
+    // reassociating sums.
+    return !II->getFastMathFlags().isFast() ||
+           !hasNativeReduction(II->getArgOperand(1)->getType());
+  case Intrinsic::experimental_vector_reduce_fmax:
+  case Intrinsic::experimental_vector_reduce_fmin:
+    if (!II->getFastMathFlags().noNaNs())
+      return true;
+    LLVM_FALLTHROUGH;
+  case Intrinsic::experimental_vector_reduce_add:
+  case Intrinsic::experimental_vector_reduce_and:
+  case Intrinsic::experimental_vector_reduce_or:
+  case Intrinsic::experimental_vector_reduce_xor:
+  case Intrinsic::experimental_vector_reduce_smax:
+  case Intrinsic::experimental_vector_reduce_smin:
+  case Intrinsic::experimental_vector_reduce_umax:
+  case Intrinsic::experimental_vector_reduce_umin:
+    return !hasNativeReduction(II->getArgOperand(0)->getType());
+  default:
+    return true;
+  }
+}
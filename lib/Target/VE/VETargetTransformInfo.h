@@ -30,6 +30,7 @@ namespace llvm {
 
 class VETTIImpl : public BasicTTIImplBase<VETTIImpl> {
   using BaseT = BasicTTIImplBase<VETTIImpl>;
+  using TTI = TargetTransformInfo;
   friend BaseT;
 
   const VESubtarget *ST;
@@ -60,9 +61,18 @@ public:
   unsigned getMinVectorRegisterBitWidth() const { return 256*64; }
 
   bool isLegalMaskedLoad(Type *DataType) {
-    return true;
+    return isLegalMaskedAccess(DataType);
   }
 
+  bool isLegalMaskedStore(Type *DataType) {
+    return isLegalMaskedAccess(DataType);
+  }
+
+  /// Masked accesses of the leading elements only set the vector length,
+  /// so folding the remainder of a loop into the vector loop is cheaper
+  /// than a scalar epilogue.
+  bool preferPredicateOverEpilogue(Loop *L) const { return true; }
+
   bool isLegalMaskedGather(Type *DataType) {
       //if (DataType->getVectorNumElements() != 256) {
       //  return false;
@@ -77,6 +87,77 @@ public:
       return true;
   };
 
+  /// \name Vector cost model
+  /// @{
+
+  int getArithmeticInstrCost(
+      unsigned Opcode, Type *Ty,
+      TTI::OperandValueKind Opd1Info = TTI::OK_AnyValue,
+      TTI::OperandValueKind Opd2Info = TTI::OK_AnyValue,
+      TTI::OperandValueProperties Opd1PropInfo = TTI::OP_None,
+      TTI::OperandValueProperties Opd2PropInfo = TTI::OP_None,
+      ArrayRef<const Value *> Args = ArrayRef<const Value *>());
+  int getShuffleCost(TTI::ShuffleKind Kind, Type *Tp, int Index, Type *SubTp);
+  int getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index);
+  int getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
+                      unsigned AddressSpace, const Instruction *I = nullptr);
+  int getMaskedMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
+                            unsigned AddressSpace);
+  int getGatherScatterOpCost(unsigned Opcode, Type *DataTy, Value *Ptr,
+                             bool VariableMask, unsigned Alignment);
+  int getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
+                            ArrayRef<Type *> Tys, FastMathFlags FMF,
+                            unsigned ScalarizationCostPassed = UINT_MAX);
+  int getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
+                            ArrayRef<Value *> Args, FastMathFlags FMF,
+                            unsigned VF = 1);
+  int getArithmeticReductionCost(unsigned Opcode, Type *Ty, bool IsPairwise);
+  int getMinMaxReductionCost(Type *Ty, Type *CondTy, bool IsPairwise,
+                             bool IsUnsigned);
+
+  /// @}
+
+  bool useReductionIntrinsic(unsigned Opcode, Type *Ty,
+                             TTI::ReductionFlags Flags) const;
+  bool shouldExpandReduction(const IntrinsicInst *II) const;
+
+private:
+  /// Return the number of cycles the vector pipeline is busy when it
+  /// streams the instruction \p Opcode over a value of vector type \p Ty.
+  unsigned getVectorChimes(Type *Ty, unsigned Opcode = VE::VADDlv);
+
+  /// Return the scheduling class of the machine instruction \p Opcode, or
+  /// null if the subtarget has no scheduling model for it.
+  const MCSchedClassDesc *getSchedClass(unsigned Opcode) const;
+
+  /// Return the number of cycles \p Opcode occupies its pipe at the maximum
+  /// vector length, according to the scheduling model.
+  unsigned getPipeCycles(unsigned Opcode) const;
+
+  /// Return the latency of \p Opcode according to the scheduling model.
+  unsigned getLatency(unsigned Opcode) const;
+
+  /// Return the cost of moving one element between a scalar register and a
+  /// vector register.
+  unsigned getElementTransferCost() const;
+
+  /// Return true if masked loads and stores of \p DataType, or of full
+  /// length vectors of it if it is a scalar, are lowered natively.
+  bool isLegalMaskedAccess(Type *DataType) const {
+    if (DataType->isVectorTy()) {
+      if (DataType->getVectorNumElements() != 256)
+        return false;
+      DataType = DataType->getVectorElementType();
+    }
+    if (DataType->isPointerTy() || DataType->isFloatTy() ||
+        DataType->isDoubleTy())
+      return true;
+    return DataType->isIntegerTy(32) || DataType->isIntegerTy(64);
+  }
+
+  /// Return true if reductions of the vector type \p Ty map to a single
+  /// vector reduction instruction.
+  bool hasNativeReduction(Type *Ty) const;
 };
 
 }
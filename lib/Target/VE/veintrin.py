@@ -300,6 +300,7 @@ class Inst(object):
         s += '  let isCodeGenOnly = 1;\n'
         if self.hasVLOp():
             s += '  let DisableEncoding = "$vl";\n'
+            s += '  let VE_VLInUse = 1;\n'
         s += "}\n"
         return s
 
@@ -3396,7 +3396,7 @@ void NewGVN::iterateTouchedInstructions() {
       updateProcessedCount(V);
     }
   }
-  NumGVNMaxIterations = std::max(NumGVNMaxIterations.getValue(), Iterations);
+  NumGVNMaxIterations.updateMax(Iterations);
 }
 
 // This is the main transformation entry point.
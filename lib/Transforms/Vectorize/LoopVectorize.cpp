@@ -4674,8 +4674,25 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
   }
 
   unsigned TC = PSE.getSE()->getSmallConstantTripCount(TheLoop);
-  if (!OptForSize) // Remaining checks deal with scalar loop when OptForSize.
-    return computeFeasibleMaxVF(OptForSize, TC);
+  if (!OptForSize) { // Remaining checks deal with scalar loop when OptForSize.
+    unsigned MaxVF = computeFeasibleMaxVF(OptForSize, TC);
+    // Fold the tail into the vector loop if the target prefers it and no
+    // runtime checks are needed, which cannot be combined with folding.
+    if (MaxVF > 1 && (TC == 0 || TC % MaxVF != 0) &&
+        TTI.preferPredicateOverEpilogue(TheLoop) &&
+        !Legal->getRuntimePointerChecking()->Need &&
+        PSE.getUnionPredicate().getPredicates().empty() &&
+        Legal->canFoldTailByMasking()) {
+      LLVM_DEBUG(dbgs() << "LV: Folding the tail by masking.\n");
+      FoldTailByMasking = true;
+      // The folded loop has no scalar epilogue to run the last iterations
+      // of interleave groups that need one, as under -Os/-Oz.
+      IsScalarEpilogueAllowed = false;
+      if (!useMaskedInterleavedAccesses(TTI))
+        InterleaveInfo.invalidateGroupsRequiringScalarEpilogue();
+    }
+    return MaxVF;
+  }
 
   if (Legal->getRuntimePointerChecking()->Need) {
     ORE->emit(createMissedAnalysis("CantVersionLoopWithOptForSize")
@@ -0,0 +1,24 @@
+; RUN: opt < %s -cost-model -analyze -mtriple=ve-unknown-unknown | FileCheck %s
+;
+; Gathers and scatters pay per element and must not look cheaper than the
+; equivalent contiguous access.
+
+define void @load_store(<256 x double>* %p) {
+; CHECK-LABEL: 'load_store'
+; CHECK: Found an estimated cost of 10 for instruction:   %v = load <256 x double>, <256 x double>* %p
+; CHECK: Found an estimated cost of 10 for instruction:   store <256 x double> %v, <256 x double>* %p
+  %v = load <256 x double>, <256 x double>* %p
+  store <256 x double> %v, <256 x double>* %p
+  ret void
+}
+
+define void @gather(<256 x double*> %ptrs, <256 x i1> %m) {
+; CHECK-LABEL: 'gather'
+; CHECK: Found an estimated cost of 52 for instruction:   %r0 = call <256 x double> @llvm.masked.gather
+; CHECK: Found an estimated cost of 9472 for instruction:   %r1 = call <256 x double> @llvm.masked.gather
+  %r0 = call <256 x double> @llvm.masked.gather.v256f64.v256p0f64(<256 x double*> %ptrs, i32 8, <256 x i1> <i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true>, <256 x double> undef)
+  %r1 = call <256 x double> @llvm.masked.gather.v256f64.v256p0f64(<256 x double*> %ptrs, i32 8, <256 x i1> %m, <256 x double> undef)
+  ret void
+}
+
+declare <256 x double> @llvm.masked.gather.v256f64.v256p0f64(<256 x double*>, i32, <256 x i1>, <256 x double>)
@@ -0,0 +1,67 @@
+; Decoding function blocks ahead of the reader must not change the module
+; that is read, including the use-list order.
+; RUN: llvm-as -preserve-bc-uselistorder < %s > %t.bc
+; RUN: llvm-dis -preserve-ll-uselistorder < %t.bc > %t.serial.ll
+; RUN: llvm-dis -preserve-ll-uselistorder -bitcode-decode-threads=1 < %t.bc > %t.1.ll
+; RUN: llvm-dis -preserve-ll-uselistorder -bitcode-decode-threads=4 < %t.bc > %t.4.ll
+; RUN: diff %t.serial.ll %t.1.ll
+; RUN: diff %t.serial.ll %t.4.ll
+; RUN: FileCheck %s < %t.4.ll
+
+@table = global [2 x i8*] [i8* blockaddress(@later, %target), i8* null]
+@g = global i32 0
+
+; CHECK-LABEL: define i32 @first(
+; CHECK: %sum = add i32 %x, 42, !dbg
+; CHECK: call void @later(i8* blockaddress(@later, %target))
+define i32 @first(i32 %x) !dbg !4 {
+entry:
+  %sum = add i32 %x, 42, !dbg !8
+  store i32 %sum, i32* @g, !tbaa !10
+  call void @later(i8* blockaddress(@later, %target))
+  call void @llvm.dbg.value(metadata i32 %sum, metadata !9, metadata !DIExpression()), !dbg !8
+  ret i32 %sum
+}
+
+; CHECK-LABEL: define void @later(
+; CHECK: indirectbr i8* %dest, [label %target]
+define void @later(i8* %dest) {
+entry:
+  %v = load i32, i32* @g
+  %c = icmp eq i32 %v, 42
+  br i1 %c, label %jump, label %target
+
+jump:
+  indirectbr i8* %dest, [label %target]
+
+target:
+  %p = phi i32 [ %v, %entry ], [ 0, %jump ]
+  store i32 %p, i32* @g
+  ret void
+}
+
+; CHECK-LABEL: define float @consts(
+; CHECK: fadd float %f, 1.500000e+00
+define float @consts(float %f) {
+  %a = fadd float %f, 1.5
+  %b = fmul float %a, 1.5
+  %c = fadd float %b, 2.5
+  ret float %c
+}
+
+declare void @llvm.dbg.value(metadata, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, emissionKind: FullDebug)
+!1 = !DIFile(filename: "t.c", directory: "/")
+!2 = !DISubroutineType(types: !{})
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !2, unit: !0)
+!7 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!8 = !DILocation(line: 2, column: 3, scope: !4)
+!9 = !DILocalVariable(name: "sum", scope: !4, file: !1, line: 2, type: !7)
+!10 = !{!11, !11, i64 0}
+!11 = !{!"int", !12, i64 0}
+!12 = !{!"tbaa root"}
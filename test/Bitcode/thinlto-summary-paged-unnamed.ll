@@ -0,0 +1,11 @@
+; The summary keys its entries by name, so llvm-dis does not compute one for
+; a module with unnamed globals.
+; RUN: not llvm-dis -compute-summary -o - %s 2>&1 | FileCheck %s
+
+; CHECK: error: cannot compute a summary for a module with unnamed globals
+
+@0 = global i32 0
+
+define i32* @f() {
+  ret i32* @0
+}
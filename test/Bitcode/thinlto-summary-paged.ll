@@ -0,0 +1,35 @@
+; Check the summary computed by llvm-dis while paging function bodies in and
+; out of the file.  For this module it is printed the same as the one written
+; by opt, but that does not hold in general: the bitcode writer sorts the
+; refs of a summary, drops the relative block frequency of calls that have a
+; profile hotness, and leaves out declarations that nothing refers to.
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: llvm-dis -o - %t.bc | FileCheck %s
+; RUN: llvm-as %s -o %t2.bc
+; RUN: llvm-dis -compute-summary -summary-budget=1 -o - %t2.bc | FileCheck %s
+; RUN: llvm-dis -compute-summary -o - %s | FileCheck %s
+
+@g = global i32 0
+
+define i32 @callee(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+define i32 @caller() {
+  %v = load i32, i32* @g
+  %r = call i32 @callee(i32 %v)
+  %s = call i32 @callee(i32 %r)
+  ret i32 %s
+}
+
+define void @last() {
+  call i32 @caller()
+  ret void
+}
+
+; CHECK: ^0 = module: (path: "{{.*}}", hash: (0, 0, 0, 0, 0))
+; CHECK: ^1 = gv: (name: "last", summaries: (function: (module: ^0, flags: (linkage: external, notEligibleToImport: 0, live: 0, dsoLocal: 0), insts: 2, calls: ((callee: ^4)))))
+; CHECK: ^2 = gv: (name: "callee", summaries: (function: (module: ^0, flags: (linkage: external, notEligibleToImport: 0, live: 0, dsoLocal: 0), insts: 2)))
+; CHECK: ^3 = gv: (name: "g", summaries: (variable: (module: ^0, flags: (linkage: external, notEligibleToImport: 0, live: 0, dsoLocal: 0), varFlags: (readonly: 1))))
+; CHECK: ^4 = gv: (name: "caller", summaries: (function: (module: ^0, flags: (linkage: external, notEligibleToImport: 0, live: 0, dsoLocal: 0), insts: 4, calls: ((callee: ^2)), refs: (readonly ^3))))
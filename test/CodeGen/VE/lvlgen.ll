@@ -0,0 +1,83 @@
+; RUN: llc < %s -mtriple=ve-unknown-unknown | FileCheck %s
+
+; Check that VL is loaded only once when all vector instructions of a
+; function use the same vector length.
+
+; CHECK-LABEL: lvl_same_vl:
+; CHECK: lvl %s
+; CHECK-NOT: lvl %s
+; CHECK: vst
+; CHECK-NOT: lvl %s
+; CHECK: vst
+define void @lvl_same_vl(i8* %p, i8* %q, i32 %vl) {
+  %a = tail call <256 x double> @llvm.ve.vl.vld.vssl(i64 8, i8* %p, i32 %vl)
+  %b = tail call <256 x double> @llvm.ve.vl.vld.vssl(i64 8, i8* %q, i32 %vl)
+  %c = tail call <256 x double> @llvm.ve.vl.vaddsl.vvvl(<256 x double> %a, <256 x double> %b, i32 %vl)
+  tail call void @llvm.ve.vl.vst.vssl(<256 x double> %c, i64 8, i8* %p, i32 %vl)
+  tail call void @llvm.ve.vl.vst.vssl(<256 x double> %b, i64 8, i8* %q, i32 %vl)
+  ret void
+}
+
+; The vector length is loop invariant, so VL is loaded before the loop.
+
+; CHECK-LABEL: lvl_loop:
+; CHECK: lvl %s
+; CHECK: .LBB{{[0-9_]+}}: {{.*}}%loop
+; CHECK-NOT: lvl %s
+; CHECK: vst
+; CHECK-NOT: lvl %s
+; CHECK: .Lfunc_end
+define void @lvl_loop(i64* %p, i64 %n, i32 %vl) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ptr = getelementptr inbounds i64, i64* %p, i64 %i
+  %addr = bitcast i64* %ptr to i8*
+  %v = tail call <256 x double> @llvm.ve.vl.vld.vssl(i64 8, i8* %addr, i32 %vl)
+  %w = tail call <256 x double> @llvm.ve.vl.vaddsl.vvvl(<256 x double> %v, <256 x double> %v, i32 %vl)
+  tail call void @llvm.ve.vl.vst.vssl(<256 x double> %w, i64 8, i8* %addr, i32 %vl)
+  %i.next = add nuw nsw i64 %i, 256
+  %cmp = icmp slt i64 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; A call clobbers VL, so it has to be loaded again afterwards.
+
+; CHECK-LABEL: lvl_call:
+; CHECK: lvl %s
+; CHECK: vld
+; CHECK: bsic
+; CHECK: lvl %s
+; CHECK: vst
+define void @lvl_call(i8* %p, i32 %vl) {
+  %a = tail call <256 x double> @llvm.ve.vl.vld.vssl(i64 8, i8* %p, i32 %vl)
+  call void @foo()
+  tail call void @llvm.ve.vl.vst.vssl(<256 x double> %a, i64 8, i8* %p, i32 %vl)
+  ret void
+}
+
+; The vector argument is reloaded from the stack with an LVL generated
+; before this pass.  The reduction uses the same length, so that LVL is
+; reused.
+
+; CHECK-LABEL: lvl_existing:
+; CHECK: lvl %s
+; CHECK-NOT: lvl %s
+; CHECK: vsum.l
+; CHECK-NOT: lvl %s
+; CHECK: .Lfunc_end
+define i64 @lvl_existing(<256 x i64> %a) {
+  %r = call i64 @llvm.experimental.vector.reduce.add.v256i64(<256 x i64> %a)
+  ret i64 %r
+}
+
+declare void @foo()
+declare i64 @llvm.experimental.vector.reduce.add.v256i64(<256 x i64>)
+declare <256 x double> @llvm.ve.vl.vld.vssl(i64, i8*, i32)
+declare <256 x double> @llvm.ve.vl.vaddsl.vvvl(<256 x double>, <256 x double>, i32)
+declare void @llvm.ve.vl.vst.vssl(<256 x double>, i64, i8*, i32)
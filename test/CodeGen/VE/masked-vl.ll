@@ -0,0 +1,112 @@
+; RUN: llc < %s -mtriple=ve-unknown-unknown | FileCheck %s
+
+; Check that masked operations use the vector length and the mask
+; operands of the vector instructions.
+
+; The header mask of a loop with a folded tail only shortens the vector
+; length.
+; CHECK-LABEL: tail_fold:
+; CHECK-NOT: vgt
+; CHECK: lvl
+; CHECK: vld
+; CHECK: vst
+define void @tail_fold(double* %p, double* %q, i64 %iv, i64 %btc) {
+  %iv.ins = insertelement <256 x i64> undef, i64 %iv, i32 0
+  %iv.splat = shufflevector <256 x i64> %iv.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %btc.ins = insertelement <256 x i64> undef, i64 %btc, i32 0
+  %btc.splat = shufflevector <256 x i64> %btc.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %lanes = add nuw <256 x i64> %iv.splat, <i64 0, i64 1, i64 2, i64 3, i64 4, i64 5, i64 6, i64 7, i64 8, i64 9, i64 10, i64 11, i64 12, i64 13, i64 14, i64 15, i64 16, i64 17, i64 18, i64 19, i64 20, i64 21, i64 22, i64 23, i64 24, i64 25, i64 26, i64 27, i64 28, i64 29, i64 30, i64 31, i64 32, i64 33, i64 34, i64 35, i64 36, i64 37, i64 38, i64 39, i64 40, i64 41, i64 42, i64 43, i64 44, i64 45, i64 46, i64 47, i64 48, i64 49, i64 50, i64 51, i64 52, i64 53, i64 54, i64 55, i64 56, i64 57, i64 58, i64 59, i64 60, i64 61, i64 62, i64 63, i64 64, i64 65, i64 66, i64 67, i64 68, i64 69, i64 70, i64 71, i64 72, i64 73, i64 74, i64 75, i64 76, i64 77, i64 78, i64 79, i64 80, i64 81, i64 82, i64 83, i64 84, i64 85, i64 86, i64 87, i64 88, i64 89, i64 90, i64 91, i64 92, i64 93, i64 94, i64 95, i64 96, i64 97, i64 98, i64 99, i64 100, i64 101, i64 102, i64 103, i64 104, i64 105, i64 106, i64 107, i64 108, i64 109, i64 110, i64 111, i64 112, i64 113, i64 114, i64 115, i64 116, i64 117, i64 118, i64 119, i64 120, i64 121, i64 122, i64 123, i64 124, i64 125, i64 126, i64 127, i64 128, i64 129, i64 130, i64 131, i64 132, i64 133, i64 134, i64 135, i64 136, i64 137, i64 138, i64 139, i64 140, i64 141, i64 142, i64 143, i64 144, i64 145, i64 146, i64 147, i64 148, i64 149, i64 150, i64 151, i64 152, i64 153, i64 154, i64 155, i64 156, i64 157, i64 158, i64 159, i64 160, i64 161, i64 162, i64 163, i64 164, i64 165, i64 166, i64 167, i64 168, i64 169, i64 170, i64 171, i64 172, i64 173, i64 174, i64 175, i64 176, i64 177, i64 178, i64 179, i64 180, i64 181, i64 182, i64 183, i64 184, i64 185, i64 186, i64 187, i64 188, i64 189, i64 190, i64 191, i64 192, i64 193, i64 194, i64 195, i64 196, i64 197, i64 198, i64 199, i64 200, i64 201, i64 202, i64 203, i64 204, i64 205, i64 206, i64 207, i64 208, i64 209, i64 210, i64 211, i64 212, i64 213, i64 214, i64 215, i64 216, i64 217, i64 218, i64 219, i64 220, i64 221, i64 222, i64 223, i64 224, i64 225, i64 226, i64 227, i64 228, i64 229, i64 230, i64 231, i64 232, i64 233, i64 234, i64 235, i64 236, i64 237, i64 238, i64 239, i64 240, i64 241, i64 242, i64 243, i64 244, i64 245, i64 246, i64 247, i64 248, i64 249, i64 250, i64 251, i64 252, i64 253, i64 254, i64 255>
+  %m = icmp ule <256 x i64> %lanes, %btc.splat
+  %pv = bitcast double* %p to <256 x double>*
+  %qv = bitcast double* %q to <256 x double>*
+  %v = call <256 x double> @llvm.masked.load.v256f64.p0v256f64(<256 x double>* %pv, i32 8, <256 x i1> %m, <256 x double> undef)
+  call void @llvm.masked.store.v256f64.p0v256f64(<256 x double> %v, <256 x double>* %qv, i32 8, <256 x i1> %m)
+  ret void
+}
+
+; No lane is active once IV is past BTC, so the length is clamped to zero
+; rather than computed as a huge BTC - IV + 1.
+; CHECK-LABEL: tail_fold_clamp:
+; CHECK: cmpu.l
+; CHECK: cmov.l.gt
+; CHECK: lvl
+; CHECK: vld
+define <256 x double> @tail_fold_clamp(double* %p, i64 %iv, i64 %btc) {
+  %iv.ins = insertelement <256 x i64> undef, i64 %iv, i32 0
+  %iv.splat = shufflevector <256 x i64> %iv.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %btc.ins = insertelement <256 x i64> undef, i64 %btc, i32 0
+  %btc.splat = shufflevector <256 x i64> %btc.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %lanes = add nuw <256 x i64> %iv.splat, <i64 0, i64 1, i64 2, i64 3, i64 4, i64 5, i64 6, i64 7, i64 8, i64 9, i64 10, i64 11, i64 12, i64 13, i64 14, i64 15, i64 16, i64 17, i64 18, i64 19, i64 20, i64 21, i64 22, i64 23, i64 24, i64 25, i64 26, i64 27, i64 28, i64 29, i64 30, i64 31, i64 32, i64 33, i64 34, i64 35, i64 36, i64 37, i64 38, i64 39, i64 40, i64 41, i64 42, i64 43, i64 44, i64 45, i64 46, i64 47, i64 48, i64 49, i64 50, i64 51, i64 52, i64 53, i64 54, i64 55, i64 56, i64 57, i64 58, i64 59, i64 60, i64 61, i64 62, i64 63, i64 64, i64 65, i64 66, i64 67, i64 68, i64 69, i64 70, i64 71, i64 72, i64 73, i64 74, i64 75, i64 76, i64 77, i64 78, i64 79, i64 80, i64 81, i64 82, i64 83, i64 84, i64 85, i64 86, i64 87, i64 88, i64 89, i64 90, i64 91, i64 92, i64 93, i64 94, i64 95, i64 96, i64 97, i64 98, i64 99, i64 100, i64 101, i64 102, i64 103, i64 104, i64 105, i64 106, i64 107, i64 108, i64 109, i64 110, i64 111, i64 112, i64 113, i64 114, i64 115, i64 116, i64 117, i64 118, i64 119, i64 120, i64 121, i64 122, i64 123, i64 124, i64 125, i64 126, i64 127, i64 128, i64 129, i64 130, i64 131, i64 132, i64 133, i64 134, i64 135, i64 136, i64 137, i64 138, i64 139, i64 140, i64 141, i64 142, i64 143, i64 144, i64 145, i64 146, i64 147, i64 148, i64 149, i64 150, i64 151, i64 152, i64 153, i64 154, i64 155, i64 156, i64 157, i64 158, i64 159, i64 160, i64 161, i64 162, i64 163, i64 164, i64 165, i64 166, i64 167, i64 168, i64 169, i64 170, i64 171, i64 172, i64 173, i64 174, i64 175, i64 176, i64 177, i64 178, i64 179, i64 180, i64 181, i64 182, i64 183, i64 184, i64 185, i64 186, i64 187, i64 188, i64 189, i64 190, i64 191, i64 192, i64 193, i64 194, i64 195, i64 196, i64 197, i64 198, i64 199, i64 200, i64 201, i64 202, i64 203, i64 204, i64 205, i64 206, i64 207, i64 208, i64 209, i64 210, i64 211, i64 212, i64 213, i64 214, i64 215, i64 216, i64 217, i64 218, i64 219, i64 220, i64 221, i64 222, i64 223, i64 224, i64 225, i64 226, i64 227, i64 228, i64 229, i64 230, i64 231, i64 232, i64 233, i64 234, i64 235, i64 236, i64 237, i64 238, i64 239, i64 240, i64 241, i64 242, i64 243, i64 244, i64 245, i64 246, i64 247, i64 248, i64 249, i64 250, i64 251, i64 252, i64 253, i64 254, i64 255>
+  %m = icmp ule <256 x i64> %lanes, %btc.splat
+  %pv = bitcast double* %p to <256 x double>*
+  %v = call <256 x double> @llvm.masked.load.v256f64.p0v256f64(<256 x double>* %pv, i32 8, <256 x i1> %m, <256 x double> undef)
+  ret <256 x double> %v
+}
+
+; Without nuw, the lanes may wrap around, which activates the lanes past the
+; wrap again.  The mask is not a prefix then.
+; CHECK-LABEL: tail_fold_wrap:
+; CHECK: vgt
+define <256 x double> @tail_fold_wrap(double* %p, i64 %iv, i64 %btc) {
+  %iv.ins = insertelement <256 x i64> undef, i64 %iv, i32 0
+  %iv.splat = shufflevector <256 x i64> %iv.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %btc.ins = insertelement <256 x i64> undef, i64 %btc, i32 0
+  %btc.splat = shufflevector <256 x i64> %btc.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %lanes = add <256 x i64> %iv.splat, <i64 0, i64 1, i64 2, i64 3, i64 4, i64 5, i64 6, i64 7, i64 8, i64 9, i64 10, i64 11, i64 12, i64 13, i64 14, i64 15, i64 16, i64 17, i64 18, i64 19, i64 20, i64 21, i64 22, i64 23, i64 24, i64 25, i64 26, i64 27, i64 28, i64 29, i64 30, i64 31, i64 32, i64 33, i64 34, i64 35, i64 36, i64 37, i64 38, i64 39, i64 40, i64 41, i64 42, i64 43, i64 44, i64 45, i64 46, i64 47, i64 48, i64 49, i64 50, i64 51, i64 52, i64 53, i64 54, i64 55, i64 56, i64 57, i64 58, i64 59, i64 60, i64 61, i64 62, i64 63, i64 64, i64 65, i64 66, i64 67, i64 68, i64 69, i64 70, i64 71, i64 72, i64 73, i64 74, i64 75, i64 76, i64 77, i64 78, i64 79, i64 80, i64 81, i64 82, i64 83, i64 84, i64 85, i64 86, i64 87, i64 88, i64 89, i64 90, i64 91, i64 92, i64 93, i64 94, i64 95, i64 96, i64 97, i64 98, i64 99, i64 100, i64 101, i64 102, i64 103, i64 104, i64 105, i64 106, i64 107, i64 108, i64 109, i64 110, i64 111, i64 112, i64 113, i64 114, i64 115, i64 116, i64 117, i64 118, i64 119, i64 120, i64 121, i64 122, i64 123, i64 124, i64 125, i64 126, i64 127, i64 128, i64 129, i64 130, i64 131, i64 132, i64 133, i64 134, i64 135, i64 136, i64 137, i64 138, i64 139, i64 140, i64 141, i64 142, i64 143, i64 144, i64 145, i64 146, i64 147, i64 148, i64 149, i64 150, i64 151, i64 152, i64 153, i64 154, i64 155, i64 156, i64 157, i64 158, i64 159, i64 160, i64 161, i64 162, i64 163, i64 164, i64 165, i64 166, i64 167, i64 168, i64 169, i64 170, i64 171, i64 172, i64 173, i64 174, i64 175, i64 176, i64 177, i64 178, i64 179, i64 180, i64 181, i64 182, i64 183, i64 184, i64 185, i64 186, i64 187, i64 188, i64 189, i64 190, i64 191, i64 192, i64 193, i64 194, i64 195, i64 196, i64 197, i64 198, i64 199, i64 200, i64 201, i64 202, i64 203, i64 204, i64 205, i64 206, i64 207, i64 208, i64 209, i64 210, i64 211, i64 212, i64 213, i64 214, i64 215, i64 216, i64 217, i64 218, i64 219, i64 220, i64 221, i64 222, i64 223, i64 224, i64 225, i64 226, i64 227, i64 228, i64 229, i64 230, i64 231, i64 232, i64 233, i64 234, i64 235, i64 236, i64 237, i64 238, i64 239, i64 240, i64 241, i64 242, i64 243, i64 244, i64 245, i64 246, i64 247, i64 248, i64 249, i64 250, i64 251, i64 252, i64 253, i64 254, i64 255>
+  %m = icmp ule <256 x i64> %lanes, %btc.splat
+  %pv = bitcast double* %p to <256 x double>*
+  %v = call <256 x double> @llvm.masked.load.v256f64.p0v256f64(<256 x double>* %pv, i32 8, <256 x i1> %m, <256 x double> undef)
+  ret <256 x double> %v
+}
+
+; A zero extended i32 induction cannot wrap in 64 bit lanes.
+; CHECK-LABEL: tail_fold_zext:
+; CHECK-NOT: vgt
+; CHECK: lvl
+; CHECK: vld
+define <256 x double> @tail_fold_zext(double* %p, i32 %iv32, i64 %btc) {
+  %iv = zext i32 %iv32 to i64
+  %iv.ins = insertelement <256 x i64> undef, i64 %iv, i32 0
+  %iv.splat = shufflevector <256 x i64> %iv.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %btc.ins = insertelement <256 x i64> undef, i64 %btc, i32 0
+  %btc.splat = shufflevector <256 x i64> %btc.ins, <256 x i64> undef, <256 x i32> zeroinitializer
+  %lanes = add <256 x i64> %iv.splat, <i64 0, i64 1, i64 2, i64 3, i64 4, i64 5, i64 6, i64 7, i64 8, i64 9, i64 10, i64 11, i64 12, i64 13, i64 14, i64 15, i64 16, i64 17, i64 18, i64 19, i64 20, i64 21, i64 22, i64 23, i64 24, i64 25, i64 26, i64 27, i64 28, i64 29, i64 30, i64 31, i64 32, i64 33, i64 34, i64 35, i64 36, i64 37, i64 38, i64 39, i64 40, i64 41, i64 42, i64 43, i64 44, i64 45, i64 46, i64 47, i64 48, i64 49, i64 50, i64 51, i64 52, i64 53, i64 54, i64 55, i64 56, i64 57, i64 58, i64 59, i64 60, i64 61, i64 62, i64 63, i64 64, i64 65, i64 66, i64 67, i64 68, i64 69, i64 70, i64 71, i64 72, i64 73, i64 74, i64 75, i64 76, i64 77, i64 78, i64 79, i64 80, i64 81, i64 82, i64 83, i64 84, i64 85, i64 86, i64 87, i64 88, i64 89, i64 90, i64 91, i64 92, i64 93, i64 94, i64 95, i64 96, i64 97, i64 98, i64 99, i64 100, i64 101, i64 102, i64 103, i64 104, i64 105, i64 106, i64 107, i64 108, i64 109, i64 110, i64 111, i64 112, i64 113, i64 114, i64 115, i64 116, i64 117, i64 118, i64 119, i64 120, i64 121, i64 122, i64 123, i64 124, i64 125, i64 126, i64 127, i64 128, i64 129, i64 130, i64 131, i64 132, i64 133, i64 134, i64 135, i64 136, i64 137, i64 138, i64 139, i64 140, i64 141, i64 142, i64 143, i64 144, i64 145, i64 146, i64 147, i64 148, i64 149, i64 150, i64 151, i64 152, i64 153, i64 154, i64 155, i64 156, i64 157, i64 158, i64 159, i64 160, i64 161, i64 162, i64 163, i64 164, i64 165, i64 166, i64 167, i64 168, i64 169, i64 170, i64 171, i64 172, i64 173, i64 174, i64 175, i64 176, i64 177, i64 178, i64 179, i64 180, i64 181, i64 182, i64 183, i64 184, i64 185, i64 186, i64 187, i64 188, i64 189, i64 190, i64 191, i64 192, i64 193, i64 194, i64 195, i64 196, i64 197, i64 198, i64 199, i64 200, i64 201, i64 202, i64 203, i64 204, i64 205, i64 206, i64 207, i64 208, i64 209, i64 210, i64 211, i64 212, i64 213, i64 214, i64 215, i64 216, i64 217, i64 218, i64 219, i64 220, i64 221, i64 222, i64 223, i64 224, i64 225, i64 226, i64 227, i64 228, i64 229, i64 230, i64 231, i64 232, i64 233, i64 234, i64 235, i64 236, i64 237, i64 238, i64 239, i64 240, i64 241, i64 242, i64 243, i64 244, i64 245, i64 246, i64 247, i64 248, i64 249, i64 250, i64 251, i64 252, i64 253, i64 254, i64 255>
+  %m = icmp ule <256 x i64> %lanes, %btc.splat
+  %pv = bitcast double* %p to <256 x double>*
+  %v = call <256 x double> @llvm.masked.load.v256f64.p0v256f64(<256 x double>* %pv, i32 8, <256 x i1> %m, <256 x double> undef)
+  ret <256 x double> %v
+}
+
+; Other masks are passed to the instructions.
+; CHECK-LABEL: masked_store:
+; CHECK: vfmk
+; CHECK: vst %v{{[0-9]+}},8,%s{{[0-9]+}},%vm{{[0-9]+}}
+define void @masked_store(double* %p, <256 x double> %v) {
+  %m = fcmp ogt <256 x double> %v, zeroinitializer
+  %pv = bitcast double* %p to <256 x double>*
+  call void @llvm.masked.store.v256f64.p0v256f64(<256 x double> %v, <256 x double>* %pv, i32 8, <256 x i1> %m)
+  ret void
+}
+
+; CHECK-LABEL: masked_load:
+; CHECK: vfmk
+; CHECK: vgt %v{{[0-9]+}},%v{{[0-9]+}},0,0,%vm{{[0-9]+}}
+define <256 x double> @masked_load(double* %p, <256 x double> %v) {
+  %m = fcmp ogt <256 x double> %v, zeroinitializer
+  %pv = bitcast double* %p to <256 x double>*
+  %r = call <256 x double> @llvm.masked.load.v256f64.p0v256f64(<256 x double>* %pv, i32 8, <256 x i1> %m, <256 x double> undef)
+  ret <256 x double> %r
+}
+
+; CHECK-LABEL: select_fadd:
+; CHECK: vfadd.d %v{{[0-9]+}},%v{{[0-9]+}},%v{{[0-9]+}},%vm{{[0-9]+}}
+; CHECK-NOT: vmrg
+define <256 x double> @select_fadd(<256 x double> %x, <256 x double> %y) {
+  %m = fcmp ogt <256 x double> %y, zeroinitializer
+  %s = fadd <256 x double> %x, %y
+  %r = select <256 x i1> %m, <256 x double> %s, <256 x double> %x
+  ret <256 x double> %r
+}
+
+declare <256 x double> @llvm.masked.load.v256f64.p0v256f64(<256 x double>*, i32, <256 x i1>, <256 x double>)
+declare void @llvm.masked.store.v256f64.p0v256f64(<256 x double>, <256 x double>*, i32, <256 x i1>)
@@ -0,0 +1,132 @@
+; RUN: llc -mtriple ve < %s | FileCheck %s
+
+@pIn = common global i8* null, align 8
+
+; The mask flows through a loop PHI and is also stored to memory.  The whole
+; class lives in mask registers and a single cast to a vector register is
+; left in front of the store.
+define void @mask_escapes(i32 %n, <4 x i64>* %out) {
+; CHECK-LABEL: mask_escapes:
+; CHECK:       vfmk.s.eq %vm{{[0-9]+}},%v0
+; CHECK-NOT:   lsv
+; CHECK:       nndm
+; CHECK-NOT:   lvm
+; CHECK:       vadds.l %v0,%v0,%v0,%vm{{[0-9]+}}
+; CHECK:       svm %s16,%vm{{[0-9]+}},0
+; CHECK:       svm %s16,%vm{{[0-9]+}},3
+; CHECK-NEXT:  lsv %v{{[0-9]+}}(3),%s16
+; CHECK-NOT:   svm
+; CHECK:       vst
+entry:
+  %p = load i8*, i8** @pIn, align 8
+  %v = tail call <256 x double> @llvm.ve.vldu.vss(i64 4, i8* %p)
+  %m0 = tail call <4 x i64> @llvm.ve.vfmks.mcv(i32 10, <256 x double> %v)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %m = phi <4 x i64> [ %m0, %entry ], [ %m.next, %loop ]
+  %m.next = tail call <4 x i64> @llvm.ve.nndm.mmm(<4 x i64> %m0, <4 x i64> %m)
+  %i.next = add nsw i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = tail call <256 x double> @llvm.ve.vaddsl.vvvmv(<256 x double> %v, <256 x double> %v, <4 x i64> %m.next, <256 x double> undef)
+  tail call void @llvm.ve.vstl.vss(<256 x double> %r, i64 4, i8* %p)
+  store <4 x i64> %m.next, <4 x i64>* %out, align 32
+  ret void
+}
+
+declare <256 x double> @llvm.ve.vldu.vss(i64, i8*)
+declare <4 x i64> @llvm.ve.vfmks.mcv(i32, <256 x double>)
+declare <4 x i64> @llvm.ve.nndm.mmm(<4 x i64>, <4 x i64>)
+declare <256 x double> @llvm.ve.vaddsl.vvvmv(<256 x double>, <256 x double>, <4 x i64>, <256 x double>)
+declare void @llvm.ve.vstl.vss(<256 x double>, i64, i8*)
+
+; The same for a packed mask: the class lives in VM512 register pairs.
+define void @packed_mask_escapes(i32 %n, <8 x i64>* %out) {
+; CHECK-LABEL: packed_mask_escapes:
+; CHECK:       vfmk.s.eq %vm{{[0-9]+}},%v0
+; CHECK:       pvfmk.s.lo.eq %vm{{[0-9]+}},%v0
+; CHECK-NOT:   lsv
+; CHECK:       nndm
+; CHECK-NOT:   lvm
+; CHECK:       pvadds %v0,%v0,%v0,%vm{{[0-9]+}}
+; CHECK:       svm
+; CHECK:       lsv
+; CHECK:       vst
+entry:
+  %p = load i8*, i8** @pIn, align 8
+  %v = tail call <256 x double> @llvm.ve.vldu.vss(i64 4, i8* %p)
+  %m0 = tail call <8 x i64> @llvm.ve.pvfmks.Mcv(i32 10, <256 x double> %v)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %m = phi <8 x i64> [ %m0, %entry ], [ %m.next, %loop ]
+  %m.next = tail call <8 x i64> @llvm.ve.nndm.MMM(<8 x i64> %m0, <8 x i64> %m)
+  %i.next = add nsw i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = tail call <256 x double> @llvm.ve.pvadds.vvvMv(<256 x double> %v, <256 x double> %v, <8 x i64> %m.next, <256 x double> undef)
+  tail call void @llvm.ve.vstl.vss(<256 x double> %r, i64 4, i8* %p)
+  store <8 x i64> %m.next, <8 x i64>* %out, align 64
+  ret void
+}
+
+; A mask passed to a call leaves the class in a vector register; the masked
+; operation still reads it from a mask register.
+define void @mask_to_call() {
+; CHECK-LABEL: mask_to_call:
+; CHECK:       vfmk.s.eq %vm{{[0-9]+}},%v0
+; CHECK:       svm
+; CHECK:       lsv
+; CHECK-NOT:   lvm
+; CHECK:       vadds.l %v{{[0-9]+}},%v{{[0-9]+}},%v{{[0-9]+}},%vm{{[0-9]+}}
+; CHECK:       bsic
+entry:
+  %p = load i8*, i8** @pIn, align 8
+  %v = tail call <256 x double> @llvm.ve.vldu.vss(i64 4, i8* %p)
+  %m = tail call <4 x i64> @llvm.ve.vfmks.mcv(i32 10, <256 x double> %v)
+  %r = tail call <256 x double> @llvm.ve.vaddsl.vvvmv(<256 x double> %v, <256 x double> %v, <4 x i64> %m, <256 x double> undef)
+  tail call void @llvm.ve.vstl.vss(<256 x double> %r, i64 4, i8* %p)
+  call void @use_mask(<4 x i64> %m)
+  ret void
+}
+
+; Two casts against two boundaries (the store and the call argument): the
+; class is not worth promoting, so the mask goes through a vector register
+; and is cast back for the masked operation.
+define void @mask_stays_vector(i1 %c, <4 x i64>* %out) {
+; CHECK-LABEL: mask_stays_vector:
+; CHECK:       vfmk.s.eq %vm{{[0-9]+}},%v0
+; CHECK:       lsv %v0(3),
+; CHECK:       vst %v0,8,%s1
+; CHECK:       lvs %s{{[0-9]+}},%v0(0)
+; CHECK:       lvm %vm{{[0-9]+}},0,
+; CHECK:       bsic
+; CHECK:       vadds.l %v0,%v0,%v0,%vm{{[0-9]+}}
+entry:
+  %p = load i8*, i8** @pIn, align 8
+  %v = tail call <256 x double> @llvm.ve.vldu.vss(i64 4, i8* %p)
+  %m = tail call <4 x i64> @llvm.ve.vfmks.mcv(i32 10, <256 x double> %v)
+  br i1 %c, label %use, label %exit
+
+use:
+  store <4 x i64> %m, <4 x i64>* %out, align 32
+  call void @use_mask(<4 x i64> %m)
+  %r = tail call <256 x double> @llvm.ve.vaddsl.vvvmv(<256 x double> %v, <256 x double> %v, <4 x i64> %m, <256 x double> undef)
+  tail call void @llvm.ve.vstl.vss(<256 x double> %r, i64 4, i8* %p)
+  br label %exit
+
+exit:
+  ret void
+}
+
+declare <8 x i64> @llvm.ve.pvfmks.Mcv(i32, <256 x double>)
+declare <8 x i64> @llvm.ve.nndm.MMM(<8 x i64>, <8 x i64>)
+declare <256 x double> @llvm.ve.pvadds.vvvMv(<256 x double>, <256 x double>, <8 x i64>, <256 x double>)
+declare void @use_mask(<4 x i64>)
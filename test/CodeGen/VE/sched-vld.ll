@@ -0,0 +1,37 @@
+; RUN: llc < %s -mtriple=ve-unknown-unknown | FileCheck %s
+; RUN: llc < %s -mtriple=ve-unknown-unknown -enable-misched=false \
+; RUN:   | FileCheck %s --check-prefix=NOSCHED
+
+; The scheduling model gives vld a far longer latency than the vector
+; arithmetic, so the machine scheduler issues the second load before the
+; multiply chain instead of just ahead of its use.
+
+define void @late_vld(i8* %b, i8* %c, <256 x double> %v) {
+; CHECK-LABEL: late_vld:
+; CHECK:       vld %v1,8,%s0
+; CHECK-NEXT:  vfmul.d
+; CHECK-NEXT:  vfmul.d
+; CHECK-NEXT:  vfmul.d
+; CHECK-NEXT:  vfadd.d
+; CHECK-NEXT:  vst
+; NOSCHED-LABEL: late_vld:
+; NOSCHED:       vfmul.d
+; NOSCHED-NEXT:  vfmul.d
+; NOSCHED-NEXT:  vfmul.d
+; NOSCHED-NEXT:  vld %v1,8,%s0
+; NOSCHED-NEXT:  vfadd.d
+  tail call void @llvm.ve.lvl(i32 256)
+  %x = tail call <256 x double> @llvm.ve.vfmuld.vvv(<256 x double> %v, <256 x double> %v)
+  %x2 = tail call <256 x double> @llvm.ve.vfmuld.vvv(<256 x double> %x, <256 x double> %v)
+  %x3 = tail call <256 x double> @llvm.ve.vfmuld.vvv(<256 x double> %x2, <256 x double> %v)
+  %y = tail call <256 x double> @llvm.ve.vld.vss(i64 8, i8* %b)
+  %z = tail call <256 x double> @llvm.ve.vfaddd.vvv(<256 x double> %x3, <256 x double> %y)
+  tail call void @llvm.ve.vst.vss(<256 x double> %z, i64 8, i8* %c)
+  ret void
+}
+
+declare void @llvm.ve.lvl(i32)
+declare <256 x double> @llvm.ve.vld.vss(i64, i8*)
+declare <256 x double> @llvm.ve.vfmuld.vvv(<256 x double>, <256 x double>)
+declare <256 x double> @llvm.ve.vfaddd.vvv(<256 x double>, <256 x double>)
+declare void @llvm.ve.vst.vss(<256 x double>, i64, i8*)
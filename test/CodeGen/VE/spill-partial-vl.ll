@@ -0,0 +1,38 @@
+; RUN: llc < %s -mtriple=ve-unknown-unknown | FileCheck %s
+
+; A vector register holding a value computed with a short vector length is
+; spilled and reloaded with that length only.
+
+; CHECK-LABEL: spill_short_vl:
+; CHECK:       lvl 16
+; CHECK-NEXT:  lea %s{{[0-9]+}},{{-?[0-9]+}}(,%s9)
+; CHECK-NEXT:  vst %v{{[0-9]+}},8,%s{{[0-9]+}}  # 128-byte Folded Spill
+; CHECK:       bsic
+; CHECK:       lvl 16
+; CHECK-NEXT:  lea %s{{[0-9]+}},{{-?[0-9]+}}(,%s9)
+; CHECK-NEXT:  vld %v{{[0-9]+}},8,%s{{[0-9]+}}  # 128-byte Folded Reload
+define void @spill_short_vl(i8* %p) {
+  %v = tail call <256 x double> @llvm.ve.vl.vld.vssl(i64 8, i8* %p, i32 16)
+  call void @foo()
+  tail call void @llvm.ve.vl.vst.vssl(<256 x double> %v, i64 8, i8* %p, i32 16)
+  ret void
+}
+
+; Values merged through a pass-through operand keep the elements beyond VL,
+; so they are spilled at full length.
+
+; CHECK-LABEL: spill_passthru:
+; CHECK:       vst %v{{[0-9]+}},8,%s{{[0-9]+}}  # 2048-byte Folded Spill
+; CHECK:       bsic
+; CHECK:       vld %v{{[0-9]+}},8,%s{{[0-9]+}}  # 2048-byte Folded Reload
+define void @spill_passthru(i8* %p, <256 x double> %pt) {
+  %v = tail call <256 x double> @llvm.ve.vl.vld.vssvl(i64 8, i8* %p, <256 x double> %pt, i32 16)
+  call void @foo()
+  tail call void @llvm.ve.vl.vst.vssl(<256 x double> %v, i64 8, i8* %p, i32 256)
+  ret void
+}
+
+declare void @foo()
+declare <256 x double> @llvm.ve.vl.vld.vssl(i64, i8*, i32)
+declare <256 x double> @llvm.ve.vl.vld.vssvl(i64, i8*, <256 x double>, i32)
+declare void @llvm.ve.vl.vst.vssl(<256 x double>, i64, i8*, i32)
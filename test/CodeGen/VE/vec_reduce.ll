@@ -0,0 +1,75 @@
+; RUN: llc < %s -mtriple=ve-unknown-unknown | FileCheck %s
+
+; Check that vector reductions use the vector reduction instructions and
+; transfer element 0 of the result.
+
+; CHECK-LABEL: reduce_add_v256i64:
+; CHECK: vsum.l
+; CHECK: lvs
+define i64 @reduce_add_v256i64(<256 x i64> %a) {
+  %r = call i64 @llvm.experimental.vector.reduce.add.v256i64(<256 x i64> %a)
+  ret i64 %r
+}
+
+; CHECK-LABEL: reduce_add_v256i32:
+; CHECK: vsum.w.sx
+; CHECK: lvs
+define i32 @reduce_add_v256i32(<256 x i32> %a) {
+  %r = call i32 @llvm.experimental.vector.reduce.add.v256i32(<256 x i32> %a)
+  ret i32 %r
+}
+
+; CHECK-LABEL: reduce_fadd_v256f64:
+; CHECK: vfsum.d
+; CHECK: lvs
+define double @reduce_fadd_v256f64(<256 x double> %a) {
+  %r = call fast double @llvm.experimental.vector.reduce.fadd.f64.v256f64(double 0.0, <256 x double> %a)
+  ret double %r
+}
+
+; CHECK-LABEL: reduce_fadd_ordered_v4f64:
+; CHECK-NOT: vfsum
+; CHECK: fadd.d
+define double @reduce_fadd_ordered_v4f64(double %s, <4 x double> %a) {
+  %r = call double @llvm.experimental.vector.reduce.fadd.f64.v4f64(double %s, <4 x double> %a)
+  ret double %r
+}
+
+; CHECK-LABEL: reduce_fmax_v256f64:
+; CHECK: vfrmax.d.fst
+define double @reduce_fmax_v256f64(<256 x double> %a) {
+  %r = call nnan double @llvm.experimental.vector.reduce.fmax.f64.v256f64(<256 x double> %a)
+  ret double %r
+}
+
+; CHECK-LABEL: reduce_smin_v256i32:
+; CHECK: vrmins.w.fst.sx
+define i32 @reduce_smin_v256i32(<256 x i32> %a) {
+  %r = call i32 @llvm.experimental.vector.reduce.smin.v256i32(<256 x i32> %a)
+  ret i32 %r
+}
+
+; CHECK-LABEL: reduce_umax_v256i64:
+; CHECK: vxor
+; CHECK: vrmaxs.l.fst
+; CHECK: vxor
+define i64 @reduce_umax_v256i64(<256 x i64> %a) {
+  %r = call i64 @llvm.experimental.vector.reduce.umax.v256i64(<256 x i64> %a)
+  ret i64 %r
+}
+
+; CHECK-LABEL: reduce_xor_v128i64:
+; CHECK: vrxor
+define i64 @reduce_xor_v128i64(<128 x i64> %a) {
+  %r = call i64 @llvm.experimental.vector.reduce.xor.v128i64(<128 x i64> %a)
+  ret i64 %r
+}
+
+declare i64 @llvm.experimental.vector.reduce.add.v256i64(<256 x i64>)
+declare i32 @llvm.experimental.vector.reduce.add.v256i32(<256 x i32>)
+declare double @llvm.experimental.vector.reduce.fadd.f64.v256f64(double, <256 x double>)
+declare double @llvm.experimental.vector.reduce.fadd.f64.v4f64(double, <4 x double>)
+declare double @llvm.experimental.vector.reduce.fmax.f64.v256f64(<256 x double>)
+declare i32 @llvm.experimental.vector.reduce.smin.v256i32(<256 x i32>)
+declare i64 @llvm.experimental.vector.reduce.umax.v256i64(<256 x i64>)
+declare i64 @llvm.experimental.vector.reduce.xor.v128i64(<128 x i64>)
@@ -0,0 +1,14 @@
+target datalayout = "e-m:e-i64:64-n32:64-S64-v64:64:64-v128:64:64-v256:64:64-v512:64:64-v1024:64:64-v2048:64:64-v4096:64:64-v8192:64:64-v16384:64:64"
+target triple = "ve-unknown-unknown"
+
+define available_externally i32 @f() {
+  ret i32 2
+}
+
+define i32 @h() {
+  %r = call i32 @f()
+  ret i32 %r
+}
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"ThinLTO", i32 0}
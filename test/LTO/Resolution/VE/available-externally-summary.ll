@@ -0,0 +1,34 @@
+; Check that of a definition and an available_externally copy of the same
+; function in regular LTO modules with summaries, whatever their order, only
+; the definition is linked in.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %S/Inputs/available-externally-summary.ll -o %t2.bc
+
+; RUN: llvm-lto2 run %t1.bc %t2.bc -r %t1.bc,f,px -r %t1.bc,g,px \
+; RUN:   -r %t2.bc,f, -r %t2.bc,h,px -save-temps -filetype=asm -o %t3
+; RUN: llvm-dis %t3.0.0.preopt.bc -o - | FileCheck %s
+
+; RUN: llvm-lto2 run %t2.bc %t1.bc -r %t1.bc,f,px -r %t1.bc,g,px \
+; RUN:   -r %t2.bc,f, -r %t2.bc,h,px -save-temps -filetype=asm -o %t3
+; RUN: llvm-dis %t3.0.0.preopt.bc -o - | FileCheck %s
+
+; CHECK-NOT: define {{.*}} @f()
+; CHECK: define i32 @f()
+; CHECK-NEXT: ret i32 1
+; CHECK-NOT: define {{.*}} @f()
+
+target datalayout = "e-m:e-i64:64-n32:64-S64-v64:64:64-v128:64:64-v256:64:64-v512:64:64-v1024:64:64-v2048:64:64-v4096:64:64-v8192:64:64-v16384:64:64"
+target triple = "ve-unknown-unknown"
+
+define i32 @f() {
+  ret i32 1
+}
+
+define i32 @g() {
+  %r = call i32 @f()
+  ret i32 %r
+}
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"ThinLTO", i32 0}
@@ -0,0 +1,37 @@
+; Check that the objects of the partitions of the regular LTO module are
+; cached, and that a change to one of them only misses the cache for its own
+; partition.
+; RUN: rm -rf %t.cache
+; RUN: llvm-as %s -o %t.bc
+; RUN: sed -e 's/ret i32 1/ret i32 3/' %s | llvm-as -o %t2.bc
+
+; RUN: llvm-lto2 run -o %t.o %t.bc -cache-dir %t.cache -lto-partitions=2 \
+; RUN:   -r %t.bc,foo,px -r %t.bc,bar,px
+; RUN: ls %t.cache | count 2
+; RUN: llvm-nm %t.o.0 %t.o.1 | FileCheck %s
+
+; The objects of a second link come from the cache.
+; RUN: rm -f %t.o.0 %t.o.1
+; RUN: llvm-lto2 run -o %t.o %t.bc -cache-dir %t.cache -lto-partitions=2 \
+; RUN:   -r %t.bc,foo,px -r %t.bc,bar,px
+; RUN: ls %t.cache | count 2
+; RUN: llvm-nm %t.o.0 %t.o.1 | FileCheck %s
+
+; RUN: llvm-lto2 run -o %t2.o %t2.bc -cache-dir %t.cache -lto-partitions=2 \
+; RUN:   -r %t2.bc,foo,px -r %t2.bc,bar,px
+; RUN: ls %t.cache | count 3
+; RUN: llvm-nm %t2.o.0 %t2.o.1 | FileCheck %s
+
+; CHECK-DAG: T bar
+; CHECK-DAG: T foo
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @foo() {
+  ret i32 1
+}
+
+define i32 @bar() {
+  ret i32 2
+}
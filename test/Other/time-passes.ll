@@ -4,6 +4,11 @@
 ; RUN: opt < %s -disable-output -passes='instcombine,loop(licm),instcombine,loop(licm)' -time-passes 2>&1 | FileCheck %s --check-prefix=TIME --check-prefix=TIME-NEW -check-prefix=TIME-DOUBLE-LICM-NEW
 ; RUN: opt < %s -disable-output -passes='default<O2>' -time-passes 2>&1 | FileCheck %s --check-prefix=TIME
 ;
+; The report is still printed when hardware performance counters are requested,
+; whether or not the host lets us open them.
+; RUN: opt < %s -disable-output -instcombine -licm -time-passes -track-perf-counters 2>&1 | FileCheck %s --check-prefix=TIME
+; RUN: opt < %s -disable-output -passes='instcombine,loop(licm)' -time-passes -track-perf-counters 2>&1 | FileCheck %s --check-prefix=TIME
+;
 ; The following 4 test runs verify -info-output-file interaction (default goes to stderr, '-' goes to stdout).
 ; RUN: opt < %s -disable-output -O2 -time-passes -info-output-file='-' 2>/dev/null | FileCheck %s --check-prefix=TIME
 ; RUN: opt < %s -disable-output -passes='default<O2>' -time-passes -info-output-file='-' 2>/dev/null | FileCheck %s --check-prefix=TIME
@@ -0,0 +1,79 @@
+; RUN: opt < %s -loop-vectorize -force-vector-width=256 -force-vector-interleave=1 -mtriple=ve-unknown-unknown -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=256 -force-vector-interleave=1 -enable-interleaved-mem-accesses -mtriple=ve-unknown-unknown -S | FileCheck %s --check-prefix=GROUP
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=1 -mtriple=ve-unknown-unknown -S | FileCheck %s --check-prefix=AUTO
+
+; VE folds the remainder of a loop into the vector loop by masking instead
+; of running a scalar epilogue.
+
+; CHECK-LABEL: @add(
+; CHECK: vector.body:
+; CHECK: icmp ule <256 x i64>
+; CHECK: call <256 x double> @llvm.masked.load.v256f64.p0v256f64
+; CHECK: call <256 x double> @llvm.masked.load.v256f64.p0v256f64
+; CHECK: fadd <256 x double>
+; CHECK: call void @llvm.masked.store.v256f64.p0v256f64
+; CHECK: middle.block:
+; CHECK-NEXT: br i1 true
+
+; The cost model picks the full vector length for a loop whose trip count
+; is only known at run time: the masked accesses are single VLD/VSTs.
+; AUTO-LABEL: @add(
+; AUTO: vector.body:
+; AUTO: call <256 x double> @llvm.masked.load.v256f64.p0v256f64
+; AUTO: call <256 x double> @llvm.masked.load.v256f64.p0v256f64
+; AUTO: fadd <256 x double>
+; AUTO: call void @llvm.masked.store.v256f64.p0v256f64
+define void @add(double* noalias %a, double* noalias %b, double* noalias %c, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %pb = getelementptr inbounds double, double* %b, i64 %i
+  %vb = load double, double* %pb, align 8
+  %pc = getelementptr inbounds double, double* %c, i64 %i
+  %vc = load double, double* %pc, align 8
+  %sum = fadd double %vb, %vc
+  %pa = getelementptr inbounds double, double* %a, i64 %i
+  store double %sum, double* %pa, align 8
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; The field at 3*i+2 is never read, so the interleave group of %b needs a
+; scalar epilogue to avoid reading past the end.  A folded loop has none,
+; so the group is dropped and the fields are accessed one by one.
+
+; GROUP-LABEL: @gap(
+; GROUP: vector.body:
+; GROUP-NOT: load <768 x double>
+; GROUP: middle.block:
+; GROUP-NEXT: br i1 true
+define void @gap(double* noalias %a, double* noalias %b, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %j = mul nuw nsw i64 %i, 3
+  %pb0 = getelementptr inbounds double, double* %b, i64 %j
+  %vb0 = load double, double* %pb0, align 8
+  %j1 = add nuw nsw i64 %j, 1
+  %pb1 = getelementptr inbounds double, double* %b, i64 %j1
+  %vb1 = load double, double* %pb1, align 8
+  %sum = fadd double %vb0, %vb1
+  %pa = getelementptr inbounds double, double* %a, i64 %i
+  store double %sum, double* %pa, align 8
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
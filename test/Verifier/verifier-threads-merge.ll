@@ -0,0 +1,34 @@
+; The functions that escape and recover a frame are verified on different
+; threads: the checks between them must still be done.
+; RUN: not llvm-as -disable-output -verifier-threads=4 %s 2>&1 | FileCheck %s
+
+; CHECK-NOT: Instruction
+; CHECK: all indices passed to llvm.localrecover must be less than the number of arguments passed to llvm.localescape in the parent function
+; CHECK-NEXT: void ()* @escapes
+; CHECK-NOT: all indices
+
+define void @escapes() {
+  %a = alloca i32
+  %b = alloca i32
+  call void (...) @llvm.localescape(i32* %a, i32* %b)
+  ret void
+}
+
+define void @also.escapes() {
+  %a = alloca i32
+  call void (...) @llvm.localescape(i32* %a)
+  ret void
+}
+
+define i8* @recovers() {
+  %p = call i8* @llvm.localrecover(i8* bitcast (void ()* @also.escapes to i8*), i8* null, i32 0)
+  ret i8* %p
+}
+
+define i8* @recovers.too.far() {
+  %p = call i8* @llvm.localrecover(i8* bitcast (void ()* @escapes to i8*), i8* null, i32 2)
+  ret i8* %p
+}
+
+declare void @llvm.localescape(...)
+declare i8* @llvm.localrecover(i8*, i8*, i32)
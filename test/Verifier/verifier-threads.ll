@@ -0,0 +1,45 @@
+; Verifying the functions on several threads must report the same failures,
+; in the same order, as verifying them one at a time.
+; RUN: not llvm-as -disable-output %s 2>&1 | FileCheck %s
+; RUN: not llvm-as -disable-output -verifier-threads=4 %s 2>&1 | FileCheck %s
+
+define void @escapes() {
+  %a = alloca i32
+  call void (...) @llvm.localescape(i32* %a)
+  ret void
+}
+
+; CHECK: Instruction does not dominate all uses!
+; CHECK-NEXT: %first.def = add i32 %x, 1
+; CHECK-NEXT: %first.use = add i32 %first.def, 1
+define i32 @first(i32 %x) {
+  %first.use = add i32 %first.def, 1
+  %first.def = add i32 %x, 1
+  ret i32 %first.use
+}
+
+define i8* @recovers() {
+  %p = call i8* @llvm.localrecover(i8* bitcast (void ()* @escapes to i8*), i8* null, i32 0)
+  ret i8* %p
+}
+
+; CHECK: Instruction does not dominate all uses!
+; CHECK-NEXT: %second.def = add i32 %x, 2
+; CHECK-NEXT: %second.use = add i32 %second.def, 2
+define i32 @second(i32 %x) {
+  %second.use = add i32 %second.def, 2
+  %second.def = add i32 %x, 2
+  ret i32 %second.use
+}
+
+; The escaped and recovered frames of @escapes are only checked against each
+; other once all functions have been verified.
+; CHECK: all indices passed to llvm.localrecover must be less than the number of arguments passed to llvm.localescape in the parent function
+; CHECK-NEXT: void ()* @escapes
+define i8* @recovers.too.far() {
+  %p = call i8* @llvm.localrecover(i8* bitcast (void ()* @escapes to i8*), i8* null, i32 1)
+  ret i8* %p
+}
+
+declare void @llvm.localescape(...)
+declare i8* @llvm.localrecover(i8*, i8*, i32)
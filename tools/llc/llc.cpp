@@ -49,6 +49,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_mmap_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include <memory>
@@ -534,11 +535,24 @@ static int compileModule(char **argv, LLVMContext &Context) {
   {
     raw_pwrite_stream *OS = &Out->os();
 
+    // Write objects straight into a mapping of the output file when it is a
+    // regular file, rather than through the stream's buffer and write calls.
+    std::unique_ptr<raw_mmap_ostream> MMapOS;
+    if (FileType == TargetMachine::CGFT_ObjectFile && !CompileTwice &&
+        OutputFilename != "-") {
+      std::error_code EC;
+      MMapOS = llvm::make_unique<raw_mmap_ostream>(OutputFilename, EC);
+      if (EC)
+        MMapOS.reset();
+      else
+        OS = MMapOS.get();
+    }
+
     // Manually do the buffering rather than using buffer_ostream,
     // so we can memcmp the contents in CompileTwice mode
     SmallVector<char, 0> Buffer;
     std::unique_ptr<raw_svector_ostream> BOS;
-    if ((FileType != TargetMachine::CGFT_AssemblyFile &&
+    if ((FileType != TargetMachine::CGFT_AssemblyFile && !MMapOS &&
          !Out->os().supportsSeeking()) ||
         CompileTwice) {
       BOS = make_unique<raw_svector_ostream>(Buffer);
@@ -632,6 +646,17 @@ static int compileModule(char **argv, LLVMContext &Context) {
     if (BOS) {
       Out->os() << Buffer;
     }
+
+    if (MMapOS) {
+      MMapOS->close();
+      if (MMapOS->has_error()) {
+        WithColor::error(errs(), argv[0])
+            << "cannot write '" << OutputFilename
+            << "': " << MMapOS->error().message() << '\n';
+        MMapOS->clear_error();
+        return 1;
+      }
+    }
   }
 
   // Declare success.
@@ -15,6 +15,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/DebugInfo.h"
@@ -23,13 +25,16 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/Type.h"
+#include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
 #include <system_error>
@@ -67,6 +72,17 @@ static cl::opt<bool>
                         cl::desc("Load module without materializing metadata, "
                                  "then materialize only the metadata"));
 
+static cl::opt<bool>
+    ComputeSummary("compute-summary",
+                   cl::desc("Print the summary index computed for the module "
+                            "instead of the module"));
+
+static cl::opt<unsigned long long> SummaryBudget(
+    "summary-budget", cl::init(64 << 20),
+    cl::desc("Bytes of function bodies kept in memory by -compute-summary; "
+             "the least recently read are dropped past it"),
+    cl::value_desc("bytes"));
+
 namespace {
 
 static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
@@ -156,19 +172,54 @@ int main(int argc, char **argv) {
       llvm::make_unique<LLVMDisDiagnosticHandler>(argv[0]));
   cl::ParseCommandLineOptions(argc, argv, "llvm .bc -> .ll disassembler\n");
 
-  std::unique_ptr<MemoryBuffer> MB =
-      ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFilename)));
-  std::unique_ptr<Module> M = ExitOnErr(getLazyBitcodeModule(
-      *MB, Context, /*ShouldLazyLoadMetadata=*/true, SetImporting));
-  if (MaterializeMetadata)
-    ExitOnErr(M->materializeMetadata());
-  else
-    ExitOnErr(M->materializeAll());
-
-  BitcodeLTOInfo LTOInfo = ExitOnErr(getBitcodeLTOInfo(*MB));
+  std::unique_ptr<MemoryBuffer> MB;
+  std::unique_ptr<Module> M;
   std::unique_ptr<ModuleSummaryIndex> Index;
-  if (LTOInfo.HasSummary)
-    Index = ExitOnErr(getModuleSummaryIndex(*MB));
+  if (ComputeSummary) {
+    // The summary looks at one function body at a time, so the bodies are
+    // read as needed and dropped again rather than all kept in memory.
+    SMDiagnostic Err;
+    M = getPagedIRFileModule(InputFilename, Err, Context, SummaryBudget);
+    if (!M) {
+      Err.print(argv[0], errs());
+      return 1;
+    }
+    // The summaries are keyed by name, as in opt -module-summary, which
+    // expects -name-anon-globals to have run.
+    for (const GlobalValue &GV : M->global_values())
+      if (!GV.hasName()) {
+        WithColor::error(errs(), argv[0])
+            << "cannot compute a summary for a module with unnamed globals\n";
+        return 1;
+      }
+    ProfileSummaryInfo PSI(*M);
+    Index = llvm::make_unique<ModuleSummaryIndex>(
+        ExitOnErr(buildModuleSummaryIndexFromLazyModule(*M, nullptr, &PSI)));
+    // The summaries refer to the module they were read from.
+    StringRef ModulePath =
+        Index->addModule(M->getModuleIdentifier(), 0)->first();
+    for (auto &Entry : *Index)
+      for (auto &Summary : Entry.second.SummaryList)
+        Summary->setModulePath(ModulePath);
+    // The symbol table of a file written by opt -module-summary names every
+    // global value of the module, declarations included, so list them all
+    // as it does.
+    for (const GlobalValue &GV : M->global_values())
+      Index->getOrInsertValueInfo(GV.getGUID(), GV.getName());
+  } else {
+    MB = ExitOnErr(
+        errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFilename)));
+    M = ExitOnErr(getLazyBitcodeModule(
+        *MB, Context, /*ShouldLazyLoadMetadata=*/true, SetImporting));
+    if (MaterializeMetadata)
+      ExitOnErr(M->materializeMetadata());
+    else
+      ExitOnErr(M->materializeAll());
+
+    BitcodeLTOInfo LTOInfo = ExitOnErr(getBitcodeLTOInfo(*MB));
+    if (LTOInfo.HasSummary)
+      Index = ExitOnErr(getModuleSummaryIndex(*MB));
+  }
 
   // Just use stdout.  We won't actually print anything on it.
   if (DontPrint)
@@ -198,7 +249,8 @@ int main(int argc, char **argv) {
 
   // All that llvm-dis does is write the assembly to a file.
   if (!DontPrint) {
-    M->print(Out->os(), Annotator.get(), PreserveAssemblyUseListOrder);
+    if (!ComputeSummary)
+      M->print(Out->os(), Annotator.get(), PreserveAssemblyUseListOrder);
     if (Index)
       Index->print(Out->os());
   }
@@ -26,15 +26,18 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBufferLoader.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_mmap_ostream.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 using namespace llvm;
@@ -113,15 +116,28 @@ static ExitOnError ExitOnErr;
 // Read the specified bitcode file in and return it. This routine searches the
 // link path for the specified file to try to find it...
 //
-static std::unique_ptr<Module> loadFile(const char *argv0,
-                                        const std::string &FN,
-                                        LLVMContext &Context,
-                                        bool MaterializeMetadata = true) {
+// If \p Pending is given, the file is parsed from the buffer it yields rather
+// than read here.
+static std::unique_ptr<Module>
+loadFile(const char *argv0, const std::string &FN, LLVMContext &Context,
+         bool MaterializeMetadata = true,
+         std::future<MemoryBufferLoader::BufferOrError> *Pending = nullptr) {
   SMDiagnostic Err;
   if (Verbose)
     errs() << "Loading '" << FN << "'\n";
   std::unique_ptr<Module> Result;
-  if (DisableLazyLoad)
+  if (Pending) {
+    MemoryBufferLoader::BufferOrError Buffer = Pending->get();
+    if (!Buffer)
+      Err = SMDiagnostic(FN, SourceMgr::DK_Error,
+                         "Could not open input file: " +
+                             Buffer.getError().message());
+    else if (DisableLazyLoad)
+      Result = parseIR((*Buffer)->getMemBufferRef(), Err, Context);
+    else
+      Result = getLazyIRModule(std::move(*Buffer), Err, Context,
+                               !MaterializeMetadata);
+  } else if (DisableLazyLoad)
     Result = parseIRFile(FN, Err, Context);
   else
     Result = getLazyIRFileModule(FN, Err, Context, !MaterializeMetadata);
@@ -279,8 +295,27 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
   unsigned ApplicableFlags = Flags & Linker::Flags::OverrideFromSrc;
   // Similar to some flags, internalization doesn't apply to the first file.
   bool InternalizeLinkedSymbols = false;
-  for (const auto &File : Files) {
-    std::unique_ptr<Module> M = loadFile(argv0, File, Context);
+
+  // Read the inputs in the background, a bounded number of files ahead of the
+  // one being linked in.  Standard input is read by loadFile as usual.
+  const unsigned PrefetchWindow = 16;
+  MemoryBufferLoader Loader(
+      std::max(1u, std::min(PrefetchWindow, unsigned(Files.size()))));
+  std::vector<std::future<MemoryBufferLoader::BufferOrError>> Pending(
+      Files.size());
+  auto Prefetch = [&](unsigned I) {
+    if (I < Files.size() && Files[I] != "-")
+      Pending[I] = Loader.load(Files[I]);
+  };
+  for (unsigned I = 0; I != PrefetchWindow; ++I)
+    Prefetch(I);
+
+  for (unsigned I = 0, E = Files.size(); I != E; ++I) {
+    const std::string &File = Files[I];
+    Prefetch(I + PrefetchWindow);
+    std::unique_ptr<Module> M =
+        loadFile(argv0, File, Context, /*MaterializeMetadata=*/true,
+                 Pending[I].valid() ? &Pending[I] : nullptr);
     if (!M.get()) {
       errs() << argv0 << ": ";
       WithColor::error() << " loading file '" << File << "'\n";
@@ -397,8 +432,28 @@ int main(int argc, char **argv) {
     errs() << "Writing bitcode...\n";
   if (OutputAssembly) {
     Composite->print(Out.os(), nullptr, PreserveAssemblyUseListOrder);
-  } else if (Force || !CheckBitcodeOutputToConsole(Out.os(), true))
-    WriteBitcodeToFile(*Composite, Out.os(), PreserveBitcodeUseListOrder);
+  } else if (Force || !CheckBitcodeOutputToConsole(Out.os(), true)) {
+    // Stream the bitcode into a mapping of the output file when it is a
+    // regular file, so that it is not all buffered in memory first.
+    std::unique_ptr<raw_mmap_ostream> MMapOS;
+    if (OutputFilename != "-") {
+      MMapOS = llvm::make_unique<raw_mmap_ostream>(OutputFilename, EC);
+      if (EC)
+        MMapOS.reset();
+    }
+    if (MMapOS) {
+      WriteBitcodeToFile(*Composite, *MMapOS, PreserveBitcodeUseListOrder);
+      MMapOS->close();
+      if (MMapOS->has_error()) {
+        WithColor::error() << "cannot write '" << OutputFilename
+                           << "': " << MMapOS->error().message() << '\n';
+        MMapOS->clear_error();
+        return 1;
+      }
+    } else {
+      WriteBitcodeToFile(*Composite, Out.os(), PreserveBitcodeUseListOrder);
+    }
+  }
 
   // Declare success.
   Out.keep();
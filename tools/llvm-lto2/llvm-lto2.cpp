@@ -23,6 +23,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBufferLoader.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Threading.h"
 
@@ -68,6 +69,12 @@ static cl::opt<bool>
 static cl::opt<int> Threads("thinlto-threads",
                             cl::init(llvm::heavyweight_hardware_concurrency()));
 
+static cl::opt<unsigned> Partitions(
+    "lto-partitions",
+    cl::desc("Number of partitions to split the regular LTO module into "
+             "for parallel code generation"),
+    cl::init(1));
+
 static cl::list<std::string> SymbolResolutions(
     "r",
     cl::desc("Specify a symbol resolution: filename,symbolname,resolution\n"
@@ -273,11 +280,18 @@ static int run(int argc, char **argv) {
                                             /* OnWrite */ {});
   else
     Backend = createInProcessThinBackend(Threads);
-  LTO Lto(std::move(Conf), std::move(Backend));
+  LTO Lto(std::move(Conf), std::move(Backend), Partitions);
 
   bool HasErrors = false;
-  for (std::string F : InputFilenames) {
-    std::unique_ptr<MemoryBuffer> MB = check(MemoryBuffer::getFile(F), F);
+  // All of the inputs are kept alive until the link is done, so read them all
+  // in the background and add each one as soon as it is available.
+  MemoryBufferLoader Loader;
+  std::vector<std::future<MemoryBufferLoader::BufferOrError>> PendingMBs =
+      Loader.loadAll(InputFilenames);
+  for (unsigned FileIdx = 0, E = InputFilenames.size(); FileIdx != E;
+       ++FileIdx) {
+    const std::string &F = InputFilenames[FileIdx];
+    std::unique_ptr<MemoryBuffer> MB = check(PendingMBs[FileIdx].get(), F);
     std::unique_ptr<InputFile> Input =
         check(InputFile::create(MB->getMemBufferRef()), F);
 
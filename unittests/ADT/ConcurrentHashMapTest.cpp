@@ -0,0 +1,129 @@
+//===- ConcurrentHashMapTest.cpp - Concurrent hash map tests --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ConcurrentHashMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ConcurrentStringMapTest, Basics) {
+  ConcurrentStringMap<int> Map;
+  EXPECT_TRUE(Map.empty());
+  auto R1 = Map.try_emplace("a", 1);
+  EXPECT_TRUE(R1.second);
+  EXPECT_EQ("a", R1.first->getKey());
+  EXPECT_EQ(1, R1.first->getValue());
+
+  auto R2 = Map.try_emplace("a", 2);
+  EXPECT_FALSE(R2.second);
+  EXPECT_EQ(R1.first, R2.first);
+  EXPECT_EQ(1, R2.first->getValue());
+
+  Map.insert({"b", 3});
+  EXPECT_EQ(2U, Map.size());
+  EXPECT_EQ(3, Map.lookup("b"));
+  EXPECT_EQ(0, Map.lookup("c"));
+  EXPECT_EQ(nullptr, Map.find("c"));
+  EXPECT_EQ(1U, Map.count("a"));
+
+  int Sum = 0;
+  Map.forEach([&](const StringMapEntry<int> &E) { Sum += E.getValue(); });
+  EXPECT_EQ(4, Sum);
+
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(nullptr, Map.find("a"));
+}
+
+TEST(ConcurrentDenseMapTest, Basics) {
+  ConcurrentDenseMap<unsigned, std::string> Map;
+  auto R1 = Map.try_emplace(1, "one");
+  EXPECT_TRUE(R1.second);
+  EXPECT_EQ(1U, R1.first->first);
+  EXPECT_EQ("one", R1.first->second);
+
+  // Entries stay in place while the shards grow.
+  for (unsigned I = 2; I < 10000; ++I)
+    Map.try_emplace(I, std::to_string(I));
+  EXPECT_EQ(R1.first, Map.find(1));
+  EXPECT_FALSE(Map.try_emplace(1, "uno").second);
+  EXPECT_EQ("one", Map.lookup(1));
+  EXPECT_EQ(9999U, Map.size());
+  EXPECT_EQ("", Map.lookup(10000));
+
+  Map.clear();
+  EXPECT_EQ(0U, Map.size());
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(ConcurrentStringMapTest, Threads) {
+  const unsigned NumThreads = 4;
+  const unsigned NumKeys = 5000;
+  ConcurrentStringMap<std::atomic<unsigned>> Map;
+  std::vector<std::vector<StringMapEntry<std::atomic<unsigned>> *>> Entries(
+      NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      // Every thread interns the same keys.
+      for (unsigned I = 0; I < NumKeys; ++I) {
+        auto *E = Map.try_emplace("key" + std::to_string(I), 0).first;
+        ++E->getValue();
+        Entries[T].push_back(E);
+      }
+    });
+  for (std::thread &T : Threads)
+    T.join();
+
+  EXPECT_EQ(NumKeys, Map.size());
+  for (unsigned I = 0; I < NumKeys; ++I)
+    for (unsigned T = 1; T < NumThreads; ++T)
+      EXPECT_EQ(Entries[0][I], Entries[T][I]);
+
+  std::atomic<unsigned> Visited(0);
+  Map.parallelForEach([&](const StringMapEntry<std::atomic<unsigned>> &E) {
+    EXPECT_EQ(NumThreads, E.getValue());
+    ++Visited;
+  });
+  EXPECT_EQ(NumKeys, Visited);
+}
+
+TEST(ConcurrentDenseMapTest, Threads) {
+  const unsigned NumThreads = 4;
+  const unsigned NumKeys = 5000;
+  ConcurrentDenseMap<unsigned, unsigned> Map;
+  std::atomic<unsigned> Inserted(0);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&] {
+      for (unsigned I = 0; I < NumKeys; ++I)
+        if (Map.try_emplace(I, I * 2).second)
+          ++Inserted;
+    });
+  for (std::thread &T : Threads)
+    T.join();
+
+  EXPECT_EQ(NumKeys, Inserted);
+  EXPECT_EQ(NumKeys, Map.size());
+  std::atomic<unsigned> Sum(0);
+  Map.parallelForEach([&](const std::pair<const unsigned, unsigned> &KV) {
+    EXPECT_EQ(KV.first * 2, KV.second);
+    Sum += KV.second;
+  });
+  EXPECT_EQ(NumKeys * (NumKeys - 1), Sum);
+}
+#endif
+
+} // end anonymous namespace
@@ -9,9 +9,10 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <thread>
 using namespace llvm;
 
-using OptionalStatistic = Optional<std::pair<StringRef, unsigned>>;
+using OptionalStatistic = Optional<std::pair<StringRef, uint64_t>>;
 
 namespace {
 #define DEBUG_TYPE "unittest"
@@ -20,7 +21,7 @@ STATISTIC(Counter2, "Counts other things");
 
 #if LLVM_ENABLE_STATS
 static void
-extractCounters(const std::vector<std::pair<StringRef, unsigned>> &Range,
+extractCounters(const std::vector<std::pair<StringRef, uint64_t>> &Range,
                 OptionalStatistic &S1, OptionalStatistic &S2) {
   for (const auto &S : Range) {
     if (S.first == "Counter")
@@ -156,4 +157,61 @@ TEST(StatisticTest, API) {
 #endif
 }
 
+TEST(StatisticTest, Snapshot) {
+  EnableStatistics();
+
+  Counter = 5;
+  Counter2 = 4;
+  StatisticSnapshot Before = TakeStatisticSnapshot();
+  Counter += 3;
+  StatisticSnapshot After = TakeStatisticSnapshot();
+  StatisticSnapshot Diff = After.diff(Before);
+#if LLVM_ENABLE_STATS
+  EXPECT_EQ(Before.lookup("unittest", "Counter"), 5u);
+  EXPECT_EQ(After.lookup("unittest", "Counter"), 8u);
+  // Only the statistics that changed are in the difference.
+  ASSERT_EQ(Diff.entries().size(), 1u);
+  EXPECT_STREQ(Diff.entries()[0].Name, "Counter");
+  EXPECT_EQ(Diff.entries()[0].Value, 3u);
+#else
+  EXPECT_TRUE(Diff.entries().empty());
+#endif
+  ResetStatistics();
+}
+
+TEST(StatisticTest, Sharded) {
+  EnableStatistics();
+  EnableShardedStatistics();
+
+  Counter = 0;
+  std::vector<std::thread> Threads;
+  for (int I = 0; I != 4; ++I)
+    Threads.emplace_back([] {
+      for (int J = 0; J != 1000; ++J)
+        ++Counter;
+    });
+  // Updates of running threads are seen when reading, and kept when the
+  // threads exit.
+  for (std::thread &T : Threads)
+    T.join();
+  Counter += 10;
+#if LLVM_ENABLE_STATS
+  EXPECT_EQ(Counter, 4010u);
+  Counter.updateMax(5000);
+  EXPECT_EQ(Counter, 5000u);
+  Counter = 7;
+  EXPECT_EQ(Counter, 7u);
+
+  // Counts are 64 bit.
+  Counter += uint64_t(1) << 32;
+  EXPECT_EQ(Counter, (uint64_t(1) << 32) + 7);
+#else
+  EXPECT_EQ(Counter, 0u);
+#endif
+
+  StatisticShardingEnabled = false;
+  ResetStatistics();
+  EXPECT_EQ(Counter, 0u);
+}
+
 } // end anonymous namespace
@@ -12,6 +12,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 using namespace llvm;
@@ -502,6 +503,48 @@ TEST(StringRefTest, Find) {
   EXPECT_EQ(StringRef::npos, Str.find_last_not_of("helo"));
 }
 
+TEST(StringRefTest, FindLong) {
+  // Long haystacks take the vectorized path on hosts that have one; check it
+  // against std::string::find, including matches straddling block boundaries
+  // and in the tail.
+  std::string Haystack;
+  for (unsigned I = 0; I != 600; ++I)
+    Haystack += char('a' + (I * 7 + I / 13) % 5);
+  StringRef Str(Haystack);
+
+  for (size_t NeedleLen : {2, 3, 4, 15, 16, 17, 31, 32, 33, 64, 255, 300}) {
+    for (size_t Pos = 0; Pos + NeedleLen <= Haystack.size(); Pos += 37) {
+      std::string Needle = Haystack.substr(Pos, NeedleLen);
+      for (size_t From : {size_t(0), Pos / 2, Pos, Pos + 1})
+        EXPECT_EQ(Haystack.find(Needle, From), Str.find(Needle, From))
+            << "needle length " << NeedleLen << " from " << From;
+    }
+    // Needles ending right at the end of the haystack.
+    std::string Needle = Haystack.substr(Haystack.size() - NeedleLen);
+    EXPECT_EQ(Haystack.find(Needle), Str.find(Needle));
+  }
+
+  // Needles which match in the first and last bytes only.
+  EXPECT_EQ(StringRef::npos, Str.find("azzzzzzzzzzzzzzzzzzb"));
+  EXPECT_EQ(StringRef::npos, Str.find("ab"));
+  std::string Mixed = std::string(100, 'x') + "xy" + std::string(100, 'x');
+  EXPECT_EQ(100U, StringRef(Mixed).find("xy"));
+  EXPECT_EQ(StringRef::npos, StringRef(Mixed).find("yy"));
+  EXPECT_EQ(99U, StringRef(Mixed).find("xxy"));
+
+  // The portable search finds the same occurrences as the vectorized one.
+  for (size_t NeedleLen : {2, 3, 16, 33}) {
+    for (size_t Pos = 0; Pos + NeedleLen <= Haystack.size(); Pos += 41) {
+      std::string Needle = Haystack.substr(Pos, NeedleLen);
+      size_t Dispatched = Str.find(Needle, Pos / 2);
+      sys::setTargetDispatchEnabled(false);
+      size_t Portable = Str.find(Needle, Pos / 2);
+      sys::setTargetDispatchEnabled(true);
+      EXPECT_EQ(Portable, Dispatched) << "needle length " << NeedleLen;
+    }
+  }
+}
+
 TEST(StringRefTest, Count) {
   StringRef Str("hello");
   EXPECT_EQ(2U, Str.count('l'));
@@ -0,0 +1,236 @@
+//===- llvm/unittest/ADT/SwissMapTest.cpp - SwissMap unit tests -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SwissMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+/// Counts live instances, to check that every entry constructed is destroyed
+/// exactly once.
+struct Counted {
+  static int Live;
+  int Value;
+
+  Counted(int Value = 0) : Value(Value) { ++Live; }
+  Counted(const Counted &Other) : Value(Other.Value) { ++Live; }
+  Counted(Counted &&Other) : Value(Other.Value) { ++Live; }
+  Counted &operator=(const Counted &) = default;
+  ~Counted() { --Live; }
+  bool operator==(const Counted &RHS) const { return Value == RHS.Value; }
+  bool operator!=(const Counted &RHS) const { return Value != RHS.Value; }
+};
+
+int Counted::Live = 0;
+
+struct CountedInfo {
+  // SwissMap never asks for the empty or tombstone keys.
+  static unsigned getHashValue(const Counted &Val) { return Val.Value; }
+  static bool isEqual(const Counted &LHS, const Counted &RHS) {
+    return LHS.Value == RHS.Value;
+  }
+};
+
+TEST(SwissMapTest, Empty) {
+  SwissMap<int, int> Map;
+  const SwissMap<int, int> &ConstMap = Map;
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_TRUE(ConstMap.begin() == ConstMap.end());
+  EXPECT_EQ(0u, Map.count(0));
+  EXPECT_TRUE(Map.find(0) == Map.end());
+  EXPECT_EQ(0, Map.lookup(0));
+  EXPECT_FALSE(Map.erase(0));
+  EXPECT_EQ(0u, Map.getMemorySize());
+  Map.clear();
+}
+
+TEST(SwissMapTest, SingleEntry) {
+  SwissMap<int, int> Map;
+  auto Result = Map.insert(std::make_pair(1, 2));
+  EXPECT_TRUE(Result.second);
+  EXPECT_EQ(1, Result.first->first);
+  EXPECT_EQ(2, Result.first->second);
+  EXPECT_FALSE(Map.insert(std::make_pair(1, 3)).second);
+  EXPECT_EQ(1u, Map.size());
+  EXPECT_EQ(2, Map.lookup(1));
+  EXPECT_EQ(2, Map[1]);
+  EXPECT_TRUE(++Map.begin() == Map.end());
+
+  Map[1] = 5;
+  EXPECT_EQ(5, Map.find(1)->second);
+  Map.erase(Map.find(1));
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+}
+
+// Check the map against std::map through a long sequence of random inserts
+// and erases, with keys drawn from a small range so that the table fills with
+// deleted slots and is rehashed in place as well as grown.
+TEST(SwissMapTest, RandomOperations) {
+  SwissMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Expected;
+  std::mt19937 Rand(42);
+  for (unsigned I = 0; I != 200000; ++I) {
+    unsigned Key = Rand() % 3000;
+    if (Rand() % 3) {
+      bool Inserted = Map.try_emplace(Key, I).second;
+      EXPECT_EQ(Expected.insert(std::make_pair(Key, I)).second, Inserted);
+    } else {
+      EXPECT_EQ(Expected.erase(Key) != 0, Map.erase(Key));
+    }
+  }
+  EXPECT_EQ(Expected.size(), Map.size());
+  for (const auto &KV : Expected)
+    EXPECT_EQ(KV.second, Map.lookup(KV.first));
+
+  // Iteration visits every entry exactly once.
+  std::map<unsigned, unsigned> Visited;
+  for (const auto &KV : Map)
+    EXPECT_TRUE(Visited.insert(KV).second);
+  EXPECT_EQ(Expected, Visited);
+}
+
+// Pointer keys with DenseMapInfo's weak hash.
+TEST(SwissMapTest, PointerKeys) {
+  std::vector<int> Objects(10000);
+  SwissMap<int *, unsigned> Map;
+  for (unsigned I = 0; I != Objects.size(); ++I)
+    Map[&Objects[I]] = I;
+  EXPECT_EQ(Objects.size(), Map.size());
+  for (unsigned I = 0; I != Objects.size(); ++I)
+    EXPECT_EQ(I, Map.lookup(&Objects[I]));
+  EXPECT_EQ(0u, Map.count(Objects.data() + Objects.size()));
+}
+
+TEST(SwissMapTest, ConstructionAndDestruction) {
+  {
+    SwissMap<Counted, Counted, CountedInfo> Map;
+    for (int I = 0; I != 1000; ++I)
+      Map.try_emplace(Counted(I), I * 2);
+    EXPECT_EQ(2000, Counted::Live);
+    for (int I = 0; I != 1000; I += 2)
+      EXPECT_TRUE(Map.erase(Counted(I)));
+    EXPECT_EQ(1000, Counted::Live);
+
+    SwissMap<Counted, Counted, CountedInfo> Copy(Map);
+    EXPECT_EQ(2000, Counted::Live);
+    EXPECT_TRUE(Copy == Map);
+    Copy.clear();
+    EXPECT_EQ(1000, Counted::Live);
+    Copy = std::move(Map);
+    EXPECT_EQ(1000, Counted::Live);
+    EXPECT_EQ(500u, Copy.size());
+    EXPECT_EQ(0u, Map.size());
+  }
+  EXPECT_EQ(0, Counted::Live);
+}
+
+TEST(SwissMapTest, MoveOnlyValues) {
+  SwissMap<int, std::unique_ptr<int>> Map;
+  for (int I = 0; I != 100; ++I)
+    Map.try_emplace(I, new int(I));
+  for (int I = 0; I != 100; ++I)
+    EXPECT_EQ(I, *Map.find(I)->second);
+  SwissMap<int, std::unique_ptr<int>> Moved(std::move(Map));
+  EXPECT_EQ(100u, Moved.size());
+  EXPECT_TRUE(Map.empty());
+}
+
+TEST(SwissMapTest, CopyAssignAndSwap) {
+  SwissMap<int, int> A = {{1, 10}, {2, 20}, {3, 30}};
+  SwissMap<int, int> B;
+  B = A;
+  EXPECT_TRUE(A == B);
+  B[4] = 40;
+  EXPECT_TRUE(A != B);
+
+  A.swap(B);
+  EXPECT_EQ(4u, A.size());
+  EXPECT_EQ(3u, B.size());
+  EXPECT_EQ(40, A.lookup(4));
+  EXPECT_EQ(0u, B.count(4));
+}
+
+TEST(SwissMapTest, Reserve) {
+  SwissMap<unsigned, unsigned> Map;
+  Map.reserve(1000);
+  const void *Slots = Map.getPointerIntoBucketsArray();
+  size_t MemorySize = Map.getMemorySize();
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[I] = I;
+  // Nothing was reallocated.
+  EXPECT_EQ(Slots, Map.getPointerIntoBucketsArray());
+  EXPECT_EQ(MemorySize, Map.getMemorySize());
+  EXPECT_TRUE(Map.isPointerIntoBucketsArray(&Map.find(500)->second));
+
+  // Clearing a mostly unused table shrinks it.
+  Map.reserve(100000);
+  MemorySize = Map.getMemorySize();
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_GT(MemorySize, Map.getMemorySize());
+}
+
+struct StringKeyInfo {
+  static unsigned getHashValue(const std::string &Val) {
+    return hash_value(StringRef(Val));
+  }
+  static unsigned getHashValue(StringRef Val) { return hash_value(Val); }
+  static bool isEqual(const std::string &LHS, const std::string &RHS) {
+    return LHS == RHS;
+  }
+  static bool isEqual(StringRef LHS, const std::string &RHS) {
+    return LHS == RHS;
+  }
+};
+
+TEST(SwissMapTest, FindAs) {
+  SwissMap<std::string, int, StringKeyInfo> Map;
+  Map["a"] = 1;
+  Map["b"] = 2;
+  EXPECT_EQ(1, Map.find_as(StringRef("a"))->second);
+  EXPECT_EQ(2, Map.find_as(StringRef("b"))->second);
+  EXPECT_TRUE(Map.find_as(StringRef("c")) == Map.end());
+}
+
+TEST(SwissMapTest, ConstIterator) {
+  SwissMap<int, int> Map;
+  for (int I = 0; I != 50; ++I)
+    Map[I] = I;
+  SwissMap<int, int>::iterator It = Map.begin();
+  SwissMap<int, int>::const_iterator CIt = It;
+  EXPECT_TRUE(It == CIt);
+  EXPECT_EQ(50, std::distance(Map.begin(), Map.end()));
+}
+
+TEST(SwissSetTest, Basic) {
+  SwissSet<unsigned> Set;
+  for (unsigned I = 0; I != 1000; ++I)
+    EXPECT_TRUE(Set.insert(I * 3).second);
+  EXPECT_FALSE(Set.insert(3).second);
+  EXPECT_EQ(1000u, Set.size());
+  EXPECT_EQ(1u, Set.count(300));
+  EXPECT_EQ(0u, Set.count(301));
+  EXPECT_TRUE(Set.erase(300));
+  EXPECT_EQ(0u, Set.count(300));
+
+  std::set<unsigned> Visited(Set.begin(), Set.end());
+  EXPECT_EQ(999u, Visited.size());
+}
+
+} // end anonymous namespace
@@ -11,6 +11,7 @@
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
@@ -18,6 +19,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -190,4 +192,90 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+static std::string printFunction(const Function &F) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  F.print(OS);
+  return OS.str();
+}
+
+// Tests that a paged module drops the least recently materialized bodies and
+// reads them again on demand.
+TEST(BitReaderTest, MaterializePagedFunctions) {
+  SmallString<1024> Mem;
+  LLVMContext Context;
+  writeModuleToBuffer(
+      parseAssembly(Context, "@table = global i8* null\n"
+                             "define i32 @f(i32 %x) {\n"
+                             "  %a = add i32 %x, 1\n"
+                             "  %b = mul i32 %a, %x\n"
+                             "  ret i32 %b\n"
+                             "}\n"
+                             "define i32 @g(i32 %x) {\n"
+                             "  %c = call i32 @f(i32 %x)\n"
+                             "  ret i32 %c\n"
+                             "}\n"
+                             "define void @h() {\n"
+                             "  store i8* blockaddress(@j, %bb), i8** @table\n"
+                             "  ret void\n"
+                             "}\n"
+                             "define void @j() {\n"
+                             "  unreachable\n"
+                             "bb:\n"
+                             "  unreachable\n"
+                             "}\n"),
+      Mem);
+  Expected<std::vector<BitcodeModule>> BMsOrErr =
+      getBitcodeModuleList(MemoryBufferRef(Mem.str(), "test"));
+  ASSERT_TRUE(bool(BMsOrErr));
+  // With a budget this small, only the last body read is kept.
+  Expected<std::unique_ptr<Module>> MOrErr =
+      (*BMsOrErr)[0].getPagedModule(Context, 1);
+  ASSERT_TRUE(bool(MOrErr));
+  std::unique_ptr<Module> M = std::move(*MOrErr);
+
+  Function *F = M->getFunction("f");
+  Function *G = M->getFunction("g");
+  Function *H = M->getFunction("h");
+  Function *J = M->getFunction("j");
+
+  ASSERT_FALSE(F->materialize());
+  std::string FBody = printFunction(*F);
+
+  // Materializing g drops the body of f.
+  ASSERT_FALSE(G->materialize());
+  EXPECT_FALSE(G->empty());
+  EXPECT_TRUE(F->empty());
+  EXPECT_TRUE(F->isMaterializable());
+  EXPECT_FALSE(F->isDeclaration());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+
+  // Reading f again gives the same body, and drops the body of g.
+  ASSERT_FALSE(F->materialize());
+  EXPECT_EQ(FBody, printFunction(*F));
+  EXPECT_TRUE(G->empty());
+
+  // Uses of a function survive the dropping of its body.
+  ASSERT_FALSE(G->materialize());
+  EXPECT_TRUE(F->empty());
+  EXPECT_EQ(F, cast<CallInst>(G->getEntryBlock().front()).getCalledFunction());
+
+  // The function whose block h takes the address of is never dropped.
+  ASSERT_FALSE(H->materialize());
+  EXPECT_FALSE(H->empty());
+  EXPECT_FALSE(J->empty());
+  ASSERT_FALSE(G->materialize());
+  EXPECT_TRUE(H->empty());
+  EXPECT_FALSE(J->empty());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+
+  // Materializing the whole module keeps every body.
+  ASSERT_FALSE(M->materializeAll());
+  EXPECT_FALSE(F->empty());
+  EXPECT_FALSE(G->empty());
+  EXPECT_FALSE(H->empty());
+  EXPECT_EQ(FBody, printFunction(*F));
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+}
+
 } // end namespace
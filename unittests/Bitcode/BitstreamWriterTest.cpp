@@ -9,6 +9,10 @@
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_mmap_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -55,4 +59,50 @@ TEST(BitstreamWriterTest, emitBlob4ByteAligned) {
   EXPECT_EQ(StringRef("str0"), Buffer);
 }
 
+// Write nested blocks, with a 64-bit value backpatched at an unaligned
+// position in the outer one.
+static void writeNestedBlocks(BitstreamWriter &W) {
+  W.EnterSubblock(8, 3);
+  W.Emit(1, 5);
+  uint64_t PlaceholderBit = W.GetCurrentBitNo();
+  W.Emit(0, 32);
+  W.Emit(0, 32);
+  for (unsigned I = 0; I != 100; ++I) {
+    W.EnterSubblock(9, 4);
+    W.EmitVBR(I, 6);
+    W.ExitBlock();
+  }
+  W.BackpatchWord64(PlaceholderBit, 0x123456789abcdef0ULL);
+  W.ExitBlock();
+}
+
+TEST(BitstreamWriterTest, flushToFile) {
+  SmallString<0> Expected;
+  {
+    BitstreamWriter W(Expected);
+    writeNestedBlocks(W);
+  }
+
+  SmallString<64> Path;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("bitstream", "bc", Path));
+  FileRemover Cleanup(Path);
+  {
+    std::error_code EC;
+    raw_mmap_ostream OS(Path, EC);
+    ASSERT_FALSE(EC);
+    SmallString<0> Buffer;
+    {
+      // With no threshold, the buffer is flushed at the end of every block,
+      // so that the backpatched words are in the file already.
+      BitstreamWriter W(Buffer, &OS, /*FlushThreshold=*/0);
+      writeNestedBlocks(W);
+    }
+    EXPECT_TRUE(Buffer.empty());
+  }
+
+  auto File = MemoryBuffer::getFile(Path);
+  ASSERT_TRUE(bool(File));
+  EXPECT_EQ(StringRef(Expected), (*File)->getBuffer());
+}
+
 } // end namespace
@@ -15,6 +15,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Linker/IRMover.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
@@ -359,4 +360,64 @@ TEST_F(LinkModuleTest, RemangleIntrinsics) {
   ASSERT_EQ(F->getNumUses(), (unsigned)2);
 }
 
+TEST_F(LinkModuleTest, MoveAppendingVariables) {
+  // Each move replaces llvm.used with a longer one.  The constants built for
+  // the replaced variables and their initializers must not pile up as users
+  // of what is linked in, or every later move walks them again.
+  LLVMContext C;
+  Module Dst("Linked", C);
+  IRMover Mover(Dst);
+  for (unsigned I = 0; I != 4; ++I) {
+    std::string Suffix = std::to_string(I);
+    SMDiagnostic Err;
+    std::unique_ptr<Module> Src = parseAssemblyString(
+        "@g" + Suffix + " = global i32 0\n"
+        "@llvm.used = appending global [1 x i8*] "
+        "[i8* bitcast (i32* @g" + Suffix + " to i8*)]\n"
+        "define i8** @f" + Suffix + "() {\n"
+        "  call void @lazy" + Suffix + "()\n"
+        "  ret i8** getelementptr ([1 x i8*], [1 x i8*]* @llvm.used, "
+        "i32 0, i32 0)\n"
+        "}\n"
+        "define linkonce void @lazy" + Suffix + "() {\n"
+        "  ret void\n"
+        "}\n",
+        Err, C);
+    ASSERT_TRUE(Src);
+
+    // Link llvm.used first, so that it has been replaced by the time the
+    // body of the function asks whether to link the one it calls.
+    std::vector<GlobalValue *> ValuesToLink = {
+        Src->getNamedGlobal("llvm.used"), Src->getNamedGlobal("g" + Suffix),
+        Src->getFunction("f" + Suffix)};
+    // The elements of llvm.used are only used by the live initializer.
+    auto CheckElements = [&] {
+      GlobalVariable *Used = Dst.getNamedGlobal("llvm.used");
+      for (unsigned J = 0; J != I; ++J) {
+        GlobalVariable *GV = Dst.getNamedGlobal("g" + std::to_string(J));
+        ASSERT_TRUE(GV->hasOneUse());
+        EXPECT_TRUE(GV->user_back()->hasOneUse());
+        EXPECT_EQ(Used->getInitializer(), GV->user_back()->user_back());
+      }
+    };
+    bool AddedLazy = false;
+    ASSERT_FALSE(errorToBool(Mover.move(
+        std::move(Src), ValuesToLink,
+        [&](GlobalValue &, IRMover::ValueAdder) {
+          AddedLazy = true;
+          CheckElements();
+        },
+        /*IsPerformingImport=*/false)));
+    EXPECT_TRUE(AddedLazy);
+
+    GlobalVariable *Used = Dst.getNamedGlobal("llvm.used");
+    ASSERT_TRUE(Used);
+    EXPECT_EQ(I + 1, cast<ArrayType>(Used->getValueType())->getNumElements());
+    // A move leaves behind the casts of the variable it replaced, but the
+    // next one drops them rather than recast them.
+    EXPECT_GE(2, count_if(Used->users(),
+                          [](const User *U) { return U->use_empty(); }));
+  }
+}
+
 } // end anonymous namespace
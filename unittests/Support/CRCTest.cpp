@@ -11,7 +11,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/CRC.h"
+#include "llvm/Support/Host.h"
 #include "gtest/gtest.h"
+#include <cstring>
+#include <string>
 
 using namespace llvm;
 
@@ -26,4 +29,45 @@ TEST(CRCTest, CRC32) {
   EXPECT_EQ(0xCBF43926U, llvm::crc32(0, StringRef("123456789")));
 }
 
+TEST(CRCTest, CRC32C) {
+  // CRC-32/ISCSI test vector
+  // http://reveng.sourceforge.net/crc-catalogue/17plus.htm#crc.cat.crc-32c
+  EXPECT_EQ(0xE3069283U, llvm::crc32c(0, StringRef("123456789")));
+  EXPECT_EQ(0U, llvm::crc32c(0, StringRef()));
+
+  // Test vectors from RFC 3720, B.4.
+  uint8_t Data[32];
+  memset(Data, 0, sizeof(Data));
+  EXPECT_EQ(0x8A9136AAU, llvm::crc32c(0, Data));
+  memset(Data, 0xFF, sizeof(Data));
+  EXPECT_EQ(0x62A8AB43U, llvm::crc32c(0, Data));
+  for (unsigned I = 0; I != 32; ++I)
+    Data[I] = I;
+  EXPECT_EQ(0x46DD794EU, llvm::crc32c(0, Data));
+  for (unsigned I = 0; I != 32; ++I)
+    Data[I] = 31 - I;
+  EXPECT_EQ(0x113FDB5CU, llvm::crc32c(0, Data));
+
+  // Computing the checksum piecewise, at any split and alignment, gives the
+  // same result as computing it at once.
+  std::string Str;
+  for (unsigned I = 0; I != 1000; ++I)
+    Str += char(I * 31 + I / 7);
+  StringRef Ref(Str);
+  uint32_t Expected = llvm::crc32c(0, Ref);
+  for (size_t Split : {1, 7, 8, 9, 63, 500, 999})
+    EXPECT_EQ(Expected, llvm::crc32c(llvm::crc32c(0, Ref.take_front(Split)),
+                                     Ref.drop_front(Split)));
+
+  // The table-driven fallback gives the same checksums as the crc32
+  // instruction.
+  sys::setTargetDispatchEnabled(false);
+  EXPECT_EQ(0xE3069283U, llvm::crc32c(0, StringRef("123456789")));
+  EXPECT_EQ(0x113FDB5CU, llvm::crc32c(0, Data));
+  for (size_t Len : {1, 3, 4, 7, 8, 9, 999, 1000})
+    EXPECT_EQ(Expected, llvm::crc32c(llvm::crc32c(0, Ref.take_front(Len)),
+                                     Ref.drop_front(Len)));
+  sys::setTargetDispatchEnabled(true);
+}
+
 } // end anonymous namespace
@@ -0,0 +1,141 @@
+//===- ConcurrentBumpPtrAllocatorTest.cpp - Concurrent allocator tests ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ConcurrentBumpPtrAllocator.h"
+#include "llvm/Config/llvm-config.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ConcurrentBumpPtrAllocatorTest, Basics) {
+  ConcurrentBumpPtrAllocator Alloc;
+  int *a = (int *)Alloc.Allocate(sizeof(int), alignof(int));
+  int *b = (int *)Alloc.Allocate(sizeof(int) * 10, alignof(int));
+  int *c = Alloc.Allocate<int>();
+  *a = 1;
+  b[0] = 2;
+  b[9] = 2;
+  *c = 3;
+  EXPECT_EQ(1, *a);
+  EXPECT_EQ(2, b[0]);
+  EXPECT_EQ(2, b[9]);
+  EXPECT_EQ(3, *c);
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+  EXPECT_EQ(12 * sizeof(int), Alloc.getBytesAllocated());
+  EXPECT_EQ(4096U, Alloc.getTotalMemory());
+}
+
+TEST(ConcurrentBumpPtrAllocatorTest, ResetAndCustomSizedSlabs) {
+  ConcurrentBumpPtrAllocator Alloc;
+  Alloc.Allocate(3000, 1);
+  Alloc.Allocate(3000, 1);
+  Alloc.Allocate(5000, 1);
+  EXPECT_EQ(3U, Alloc.GetNumSlabs());
+  EXPECT_EQ(4096U * 2 + 5000, Alloc.getTotalMemory());
+
+  Alloc.Reset();
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+  EXPECT_EQ(0U, Alloc.getBytesAllocated());
+  Alloc.Allocate(3000, 1);
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+}
+
+TEST(ConcurrentBumpPtrAllocatorTest, TwoAllocators) {
+  // A thread alternating between allocators must not mix up their slabs.
+  ConcurrentBumpPtrAllocator Alloc1, Alloc2;
+  for (int I = 0; I < 10; ++I) {
+    Alloc1.Allocate(1000, 1);
+    Alloc2.Allocate(10, 1);
+  }
+  EXPECT_EQ(10000U, Alloc1.getBytesAllocated());
+  EXPECT_EQ(100U, Alloc2.getBytesAllocated());
+  EXPECT_EQ(1U, Alloc2.GetNumSlabs());
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(ConcurrentBumpPtrAllocatorTest, Threads) {
+  const unsigned NumThreads = 4;
+  const unsigned NumAllocs = 10000;
+  ConcurrentBumpPtrAllocator Alloc;
+  std::vector<std::vector<uint64_t *>> Results(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      for (unsigned I = 0; I < NumAllocs; ++I) {
+        uint64_t *P = Alloc.Allocate<uint64_t>();
+        *P = uint64_t(T) << 32 | I;
+        Results[T].push_back(P);
+      }
+    });
+  for (std::thread &T : Threads)
+    T.join();
+
+  // Nothing was overwritten, and no address was handed out twice.
+  std::set<uint64_t *> Seen;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    for (unsigned I = 0; I < NumAllocs; ++I) {
+      EXPECT_EQ(uint64_t(T) << 32 | I, *Results[T][I]);
+      EXPECT_TRUE(Seen.insert(Results[T][I]).second);
+    }
+
+  auto Stats = Alloc.getThreadStatistics();
+  ASSERT_EQ(NumThreads, Stats.size());
+  size_t NumSlabs = 0;
+  for (const auto &S : Stats) {
+    EXPECT_EQ(NumAllocs * sizeof(uint64_t), S.BytesAllocated);
+    EXPECT_EQ(0U, S.NumCustomSizedSlabs);
+    NumSlabs += S.NumSlabs;
+  }
+  EXPECT_EQ(NumSlabs, Alloc.GetNumSlabs());
+  EXPECT_EQ(NumThreads * NumAllocs * sizeof(uint64_t),
+            Alloc.getBytesAllocated());
+}
+
+struct Counted {
+  static std::atomic<unsigned> NumDestroyed;
+  char Data[24];
+  ~Counted() { ++NumDestroyed; }
+};
+std::atomic<unsigned> Counted::NumDestroyed;
+
+TEST(ConcurrentBumpPtrAllocatorTest, SpecificDestroyAll) {
+  const unsigned NumThreads = 4;
+  const unsigned NumAllocs = 1000;
+  Counted::NumDestroyed = 0;
+  {
+    SpecificConcurrentBumpPtrAllocator<Counted> Alloc;
+    std::vector<std::thread> Threads;
+    for (unsigned T = 0; T < NumThreads; ++T)
+      Threads.emplace_back([&] {
+        for (unsigned I = 0; I < NumAllocs; ++I)
+          new (Alloc.Allocate()) Counted();
+        // One array that does not fit in a slab.
+        Counted *Array = Alloc.Allocate(200);
+        for (unsigned I = 0; I < 200; ++I)
+          new (&Array[I]) Counted();
+      });
+    for (std::thread &T : Threads)
+      T.join();
+
+    Alloc.DestroyAll();
+    EXPECT_EQ(NumThreads * (NumAllocs + 200), Counted::NumDestroyed);
+
+    // The allocator is reusable after DestroyAll.
+    new (Alloc.Allocate()) Counted();
+  }
+  EXPECT_EQ(NumThreads * (NumAllocs + 200) + 1, Counted::NumDestroyed);
+}
+#endif
+
+} // end anonymous namespace
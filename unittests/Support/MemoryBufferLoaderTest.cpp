@@ -0,0 +1,88 @@
+//===- MemoryBufferLoaderTest.cpp - MemoryBufferLoader tests --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/MemoryBufferLoader.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+class MemoryBufferLoaderTest : public testing::Test {
+protected:
+  void SetUp() override {
+    for (unsigned I = 0; I != 8; ++I) {
+      SmallString<64> Path;
+      ASSERT_FALSE(sys::fs::createTemporaryFile("loader", "bin", Path));
+      // Vary the sizes so that both mapped and read buffers are covered.
+      std::string Contents(I * 10000 + 1, 'a' + I);
+      raw_fd_ostream OS(Path, EC);
+      ASSERT_FALSE(EC);
+      OS << Contents;
+      Paths.push_back(Path.str());
+      Expected.push_back(Contents);
+    }
+  }
+
+  void TearDown() override {
+    for (const std::string &Path : Paths)
+      sys::fs::remove(Path);
+  }
+
+  std::error_code EC;
+  std::vector<std::string> Paths;
+  std::vector<std::string> Expected;
+};
+
+TEST_F(MemoryBufferLoaderTest, LoadAll) {
+  MemoryBufferLoader Loader(4);
+  auto Futures = Loader.loadAll(Paths);
+  ASSERT_EQ(Paths.size(), Futures.size());
+  for (unsigned I = 0; I != Futures.size(); ++I) {
+    MemoryBufferLoader::BufferOrError Buffer = Futures[I].get();
+    ASSERT_TRUE(bool(Buffer));
+    EXPECT_EQ(Paths[I], (*Buffer)->getBufferIdentifier());
+    EXPECT_EQ(Expected[I], (*Buffer)->getBuffer());
+    EXPECT_EQ('\0', *(*Buffer)->getBufferEnd());
+  }
+}
+
+TEST_F(MemoryBufferLoaderTest, Missing) {
+  SmallString<64> Missing(Paths[0]);
+  Missing += ".missing";
+  MemoryBufferLoader Loader;
+  auto Buffer = Loader.load(Missing).get();
+  EXPECT_EQ(errc::no_such_file_or_directory, Buffer.getError());
+
+  // A failure does not affect the other files.
+  auto Other = Loader.load(Paths[1], /*RequiresNullTerminator=*/false).get();
+  ASSERT_TRUE(bool(Other));
+  EXPECT_EQ(Expected[1], (*Other)->getBuffer());
+}
+
+TEST_F(MemoryBufferLoaderTest, Unwaited) {
+  // Destroying the loader waits for the loads still in flight, whether or
+  // not their futures are kept.
+  std::vector<std::future<MemoryBufferLoader::BufferOrError>> Futures;
+  {
+    MemoryBufferLoader Loader(2);
+    Futures = Loader.loadAll(Paths);
+    Loader.loadAll(Paths);
+  }
+  for (auto &Future : Futures)
+    EXPECT_EQ(std::future_status::ready,
+              Future.wait_for(std::chrono::seconds(0)));
+}
+
+} // end anonymous namespace
@@ -14,7 +14,10 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <random>
+#include <thread>
 
 uint32_t array[1024 * 1024];
 
@@ -49,4 +52,61 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, nested_parallel_for) {
+  // Inner loops run in parallel too; the threads waiting for them must keep
+  // running tasks instead of blocking the executor.
+  std::atomic<uint64_t> Sum(0);
+  for_each_n(parallel::par, 0, 64, [&Sum](size_t I) {
+    for_each_n(parallel::par, 0, 1024,
+               [&Sum, I](size_t J) { Sum += I * 1024 + J; });
+  });
+  ASSERT_EQ(Sum, uint64_t(64 * 1024) * (64 * 1024 - 1) / 2);
+}
+
+TEST(Parallel, executor_statistics) {
+  parallel::ExecutorStatistics Before = parallel::getExecutorStatistics();
+  {
+    parallel::detail::TaskGroup TG;
+    for (int I = 0; I != 100; ++I)
+      TG.spawn([] {});
+  }
+  parallel::ExecutorStatistics After = parallel::getExecutorStatistics();
+  ASSERT_GE(After.TasksRun - Before.TasksRun, 100u);
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(Parallel, executor_steals) {
+  // A task spawned on this thread goes to the shared queue.  This thread
+  // does not run it while spinning, so a worker has to steal it.
+  parallel::ExecutorStatistics Before = parallel::getExecutorStatistics();
+  {
+    std::atomic<bool> Ran(false);
+    parallel::detail::TaskGroup TG;
+    TG.spawn([&Ran] { Ran = true; });
+    while (!Ran)
+      std::this_thread::yield();
+  }
+  parallel::ExecutorStatistics After = parallel::getExecutorStatistics();
+  ASSERT_GE(After.Steals - Before.Steals, 1u);
+}
+
+TEST(Parallel, executor_idle_time) {
+  // Make sure the workers are up, then leave them without work for a while.
+  // The worker picking up the next task accounts for its sleep first.
+  parallel::detail::TaskGroup().spawn([] {});
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  parallel::ExecutorStatistics Before = parallel::getExecutorStatistics();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    std::atomic<bool> Ran(false);
+    parallel::detail::TaskGroup TG;
+    TG.spawn([&Ran] { Ran = true; });
+    while (!Ran)
+      std::this_thread::yield();
+  }
+  parallel::ExecutorStatistics After = parallel::getExecutorStatistics();
+  ASSERT_GE(After.IdleNanoseconds - Before.IdleNanoseconds, 50000000u);
+}
+#endif
+
 #endif
@@ -163,3 +163,87 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   }
   ASSERT_EQ(5, checked_in);
 }
+
+TEST_F(ThreadPoolTest, AsyncResult) {
+  CHECK_UNSUPPORTED();
+  ThreadPool Pool{2};
+  std::shared_future<int> F1 = Pool.async([] { return 1; });
+  std::shared_future<int> F2 = Pool.async([](int I) { return I * 2; }, 21);
+  ASSERT_EQ(1, F1.get());
+  ASSERT_EQ(42, F2.get());
+}
+
+TEST_F(ThreadPoolTest, Priorities) {
+  CHECK_UNSUPPORTED();
+  // With a single thread blocked on the main thread, the queued tasks run by
+  // priority and then in submission order.
+  ThreadPool Pool{1};
+  std::mutex OrderLock;
+  std::vector<int> Order;
+  auto Record = [&](int I) {
+    std::lock_guard<std::mutex> Lock(OrderLock);
+    Order.push_back(I);
+  };
+  Pool.async([this] { waitForMainThread(); });
+  Pool.async(ThreadPoolPriority::Low, Record, 0);
+  Pool.async(Record, 1);
+  Pool.async(ThreadPoolPriority::High, Record, 2);
+  Pool.async(ThreadPoolPriority::High, Record, 3);
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ((std::vector<int>{2, 3, 1, 0}), Order);
+}
+
+TEST_F(ThreadPoolTest, TaskGroupWait) {
+  CHECK_UNSUPPORTED();
+  // Waiting for a group does not wait for the tasks of the pool outside it.
+  ThreadPool Pool{2};
+  std::atomic_int checked_in{0};
+  Pool.async([this] { waitForMainThread(); });
+  {
+    ThreadPoolTaskGroup Group(Pool);
+    for (size_t i = 0; i < 5; ++i)
+      Group.async([&checked_in] { ++checked_in; });
+    Group.wait();
+    ASSERT_EQ(5, checked_in);
+  }
+  setMainThreadReady();
+  Pool.wait();
+}
+
+TEST_F(ThreadPoolTest, NestedTaskGroup) {
+  CHECK_UNSUPPORTED();
+  // A task waiting for a group on a pool of one thread runs the tasks of the
+  // group itself.
+  ThreadPool Pool{1};
+  std::atomic_int checked_in{0};
+  ThreadPoolTaskGroup Outer(Pool);
+  Outer.async([&] {
+    ThreadPoolTaskGroup Inner(Pool);
+    for (size_t i = 0; i < 5; ++i)
+      Inner.async([&checked_in] { ++checked_in; });
+    Inner.wait();
+    ASSERT_EQ(5, checked_in);
+  });
+  Outer.wait();
+  ASSERT_EQ(5, checked_in);
+}
+
+TEST_F(ThreadPoolTest, TaskGroupCancel) {
+  CHECK_UNSUPPORTED();
+  ThreadPool Pool{1};
+  ThreadPoolTaskGroup Group(Pool);
+  std::atomic_int checked_in{0};
+  Group.async([this] { waitForMainThread(); });
+  std::shared_future<bool> Ran = Group.async([&] {
+    if (Group.isCancelled())
+      return false;
+    ++checked_in;
+    return true;
+  });
+  Group.cancel();
+  setMainThreadReady();
+  ASSERT_FALSE(Ran.get());
+  Group.wait();
+  ASSERT_EQ(0, checked_in);
+}
@@ -0,0 +1,103 @@
+//===- unittests/TimeProfilerTest.cpp - Time profiler tests ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/JSON.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace llvm;
+
+namespace {
+
+// Long enough to pass the default -time-trace-granularity.
+void sleepPastGranularity() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+TEST(TimeProfiler, Threads) {
+  timeTraceProfilerInitialize();
+  {
+    TimeTraceScope Scope("Main", StringRef("main thread"));
+    std::thread T1([] {
+      TimeTraceScope Scope("Worker", StringRef("first"));
+      sleepPastGranularity();
+    });
+    std::thread T2([] {
+      TimeTraceScope Scope("Worker", StringRef("second"));
+      sleepPastGranularity();
+    });
+    T1.join();
+    T2.join();
+    sleepPastGranularity();
+  }
+
+  SmallString<1024> Buffer;
+  raw_svector_ostream OS(Buffer);
+  timeTraceProfilerWrite(OS);
+  timeTraceProfilerCleanup();
+
+  Expected<json::Value> Trace = json::parse(Buffer);
+  ASSERT_TRUE(bool(Trace));
+  const json::Array *Events =
+      Trace->getAsObject()->getArray("traceEvents");
+  ASSERT_NE(Events, nullptr);
+
+  // Each thread has its own track, and the totals add up the sections of
+  // all threads.
+  std::set<int64_t> WorkerTids;
+  Optional<int64_t> MainTid, WorkerCount;
+  for (const json::Value &V : *Events) {
+    const json::Object *E = V.getAsObject();
+    Optional<StringRef> Name = E->getString("name");
+    if (*Name == "Main")
+      MainTid = E->getInteger("tid");
+    else if (*Name == "Worker")
+      WorkerTids.insert(*E->getInteger("tid"));
+    else if (*Name == "Total Worker")
+      WorkerCount = E->getObject("args")->getInteger("count");
+  }
+  ASSERT_TRUE(MainTid.hasValue());
+  EXPECT_EQ(0, *MainTid);
+  EXPECT_EQ(2u, WorkerTids.size());
+  EXPECT_EQ(0u, WorkerTids.count(*MainTid));
+  ASSERT_TRUE(WorkerCount.hasValue());
+  EXPECT_EQ(2, *WorkerCount);
+}
+
+TEST(TimeProfiler, BoundedMemory) {
+  // Sections with a unique detail each, long enough to be heap allocated.
+  unsigned Id = 0;
+  auto recordSections = [&](unsigned N) {
+    for (unsigned I = 0; I != N; ++I) {
+      TimeTraceScope Scope("Section", [&] {
+        return std::string(200, 'x') + std::to_string(100000 + Id++);
+      });
+      auto Start = std::chrono::steady_clock::now();
+      while (std::chrono::steady_clock::now() - Start <
+             std::chrono::microseconds(2))
+        ;
+    }
+  };
+
+  // Record every section into a small ring.
+  timeTraceProfilerInitialize(/*Granularity=*/0, /*BufferSize=*/64);
+  recordSections(128);
+  size_t Wrapped = timeTraceProfilerMemoryUsage();
+  recordSections(4096);
+  size_t Later = timeTraceProfilerMemoryUsage();
+  timeTraceProfilerCleanup();
+
+  EXPECT_LE(Later, Wrapped);
+}
+
+} // end anonymous namespace
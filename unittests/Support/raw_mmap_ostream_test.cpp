@@ -0,0 +1,137 @@
+//===- raw_mmap_ostream_test.cpp - raw_mmap_ostream tests -----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/raw_mmap_ostream.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace llvm;
+
+#define ASSERT_NO_ERROR(x)                                                     \
+  if (std::error_code ASSERT_NO_ERROR_ec = x) {                                \
+    SmallString<128> MessageStorage;                                           \
+    raw_svector_ostream Message(MessageStorage);                               \
+    Message << #x ": did not return errc::success.\n"                          \
+            << "error number: " << ASSERT_NO_ERROR_ec.value() << "\n"          \
+            << "error message: " << ASSERT_NO_ERROR_ec.message() << "\n";      \
+    GTEST_FATAL_FAILURE_(MessageStorage.c_str());                              \
+  } else {                                                                     \
+  }
+
+namespace {
+
+std::string readFile(StringRef Path) {
+  auto BufferOrErr = MemoryBuffer::getFile(Path);
+  EXPECT_TRUE(bool(BufferOrErr));
+  if (!BufferOrErr)
+    return "";
+  return (*BufferOrErr)->getBuffer().str();
+}
+
+TEST(raw_mmap_ostreamTest, Basic) {
+  SmallString<64> Path;
+  ASSERT_NO_ERROR(sys::fs::createTemporaryFile("raw_mmap", "out", Path));
+  FileRemover Cleanup(Path);
+
+  std::error_code EC;
+  {
+    raw_mmap_ostream OS(Path, EC);
+    ASSERT_NO_ERROR(EC);
+    OS << "hello " << 42 << '\n';
+    EXPECT_EQ(9U, OS.tell());
+    EXPECT_EQ("hello 42\n", OS.getWrittenData());
+  }
+  // The file is truncated to the data written.
+  EXPECT_EQ("hello 42\n", readFile(Path));
+}
+
+TEST(raw_mmap_ostreamTest, Growth) {
+  SmallString<64> Path;
+  ASSERT_NO_ERROR(sys::fs::createTemporaryFile("raw_mmap", "out", Path));
+  FileRemover Cleanup(Path);
+
+  // Write well past the initial mapping, both in small pieces which go
+  // through the buffer and in chunks larger than the mapping.
+  std::string Expected;
+  std::error_code EC;
+  {
+    raw_mmap_ostream OS(Path, EC);
+    ASSERT_NO_ERROR(EC);
+    for (unsigned I = 0; I != 100000; ++I) {
+      char C = 'a' + I % 26;
+      OS << C;
+      Expected += C;
+    }
+    std::string Large(1 << 20, 'x');
+    OS << Large;
+    Expected += Large;
+    OS << "end";
+    Expected += "end";
+    EXPECT_EQ(Expected.size(), OS.tell());
+  }
+  EXPECT_EQ(Expected, readFile(Path));
+}
+
+TEST(raw_mmap_ostreamTest, PWriteAndSeek) {
+  SmallString<64> Path;
+  ASSERT_NO_ERROR(sys::fs::createTemporaryFile("raw_mmap", "out", Path));
+  FileRemover Cleanup(Path);
+
+  std::error_code EC;
+  {
+    raw_mmap_ostream OS(Path, EC);
+    ASSERT_NO_ERROR(EC);
+    OS << "0000abcd";
+    // Patch data that is still in the buffer.
+    OS.pwrite("1234", 4, 0);
+    EXPECT_EQ(8U, OS.tell());
+
+    // Seek back and overwrite, then seek past the end.
+    EXPECT_EQ(2U, OS.seek(2));
+    OS << "XY";
+    EXPECT_EQ(4U, OS.tell());
+    EXPECT_EQ("12XYabcd", OS.getWrittenData());
+    OS.seek(10);
+    OS << "!";
+  }
+  EXPECT_EQ(std::string("12XYabcd\0\0!", 11), readFile(Path));
+}
+
+TEST(raw_mmap_ostreamTest, Overwrite) {
+  SmallString<64> Path;
+  ASSERT_NO_ERROR(sys::fs::createTemporaryFile("raw_mmap", "out", Path));
+  FileRemover Cleanup(Path);
+
+  std::error_code EC;
+  {
+    raw_fd_ostream OS(Path, EC);
+    ASSERT_NO_ERROR(EC);
+    OS << std::string(100000, 'z');
+  }
+  {
+    raw_mmap_ostream OS(Path, EC);
+    ASSERT_NO_ERROR(EC);
+    OS << "short";
+  }
+  EXPECT_EQ("short", readFile(Path));
+}
+
+#ifdef LLVM_ON_UNIX
+TEST(raw_mmap_ostreamTest, NotRegularFile) {
+  std::error_code EC;
+  raw_mmap_ostream OS("/dev/null", EC);
+  EXPECT_EQ(errc::not_supported, EC);
+}
+#endif
+
+} // end anonymous namespace
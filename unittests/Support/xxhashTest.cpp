@@ -7,7 +7,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/xxhash.h"
+#include "llvm/Support/Host.h"
 #include "gtest/gtest.h"
+#include <string>
 
 using namespace llvm;
 
@@ -17,3 +19,36 @@ TEST(xxhashTest, Basic) {
   EXPECT_EQ(0x69196c1b3af0bff9U,
             xxHash64("0123456789abcdefghijklmnopqrstuvwxyz"));
 }
+
+TEST(xxhashTest, xxh3) {
+  EXPECT_EQ(0x2d06800538d394c2U, xxh3_64bits(StringRef()));
+  EXPECT_EQ(0xe6c632b61e964e1fU, xxh3_64bits("a"));
+  EXPECT_EQ(0xab6e5f64077e7d8aU, xxh3_64bits("foo"));
+  EXPECT_EQ(0xd78fda63144c5c84U, xxh3_64bits("foobar"));
+  EXPECT_EQ(0x64439946d8fa212dU, xxh3_64bits("0123456789abcdef"));
+  EXPECT_EQ(0xffb92a87c6306d55U,
+            xxh3_64bits("0123456789abcdefghijklmnopqrstuvwxyz"));
+  // The 129-240 byte path.
+  EXPECT_EQ(0x4e151cfc44a9680cU, xxh3_64bits(std::string(129, 'z')));
+  EXPECT_EQ(0xadac0421a71eb202U, xxh3_64bits(std::string(200, 'z')));
+  EXPECT_EQ(0xbf0e0b40af0c6df2U, xxh3_64bits(std::string(240, 'z')));
+  // The long input path.
+  EXPECT_EQ(0xa5d1b4607dc83554U, xxh3_64bits(std::string(300, 'x')));
+  EXPECT_EQ(0x1668b98dc63ebebaU, xxh3_64bits(std::string(4096, 'y')));
+}
+
+TEST(xxhashTest, xxh3Portable) {
+  // The vector kernels of the long input path give the same hashes as the
+  // portable ones, for partial blocks and stripes too.
+  std::string Str;
+  for (unsigned I = 0; I != 5000; ++I)
+    Str += char(I * 31 + I / 7);
+  for (size_t Len : {241, 255, 256, 1023, 1024, 1025, 4999, 5000}) {
+    StringRef Input = StringRef(Str).take_front(Len);
+    uint64_t Dispatched = xxh3_64bits(Input);
+    sys::setTargetDispatchEnabled(false);
+    uint64_t Portable = xxh3_64bits(Input);
+    sys::setTargetDispatchEnabled(true);
+    EXPECT_EQ(Portable, Dispatched) << "length " << Len;
+  }
+}